@@ -1,7 +1,9 @@
 ﻿#include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <time.h>
+#include <pthread.h>
 #include <iothub_client_core_common.h>
 #include <iothub_device_client_ll.h>
 #include <iothub_client_options.h>
@@ -10,6 +12,8 @@
 #include <applibs/log.h>
 #include <azure_sphere_provisioning.h>
 #include "azure_iot_utilities.h"
+#include "payload_compression.h"
+#include "provisioning_backoff.h"
 
 // Refer to https://docs.microsoft.com/en-us/azure/iot-hub/iot-hub-device-sdk-c-intro for more
 // information on Azure IoT SDK for C
@@ -63,6 +67,61 @@ static IOTHUB_DEVICE_CLIENT_LL_HANDLE iothubClientHandle = NULL;
 /// </summary>
 static bool iothubAuthenticated = false;
 
+/// <summary>
+///     State of the connection to the IoT Hub.
+/// </summary>
+typedef enum {
+    /// <summary>No client; a provisioning attempt is made once the backoff delay expires.</summary>
+    ConnectionState_NotProvisioned,
+    /// <summary>The client exists and the SDK is (re)connecting to the hub.</summary>
+    ConnectionState_Connecting,
+    /// <summary>The client is authenticated with the hub.</summary>
+    ConnectionState_Connected
+} ConnectionState;
+
+static ConnectionState connectionState = ConnectionState_NotProvisioned;
+
+/// <summary>
+///     Number of consecutive failed provisioning attempts, used as the backoff exponent.
+/// </summary>
+static unsigned int provisioningFailureCount = 0;
+
+/// <summary>
+///     Earliest CLOCK_MONOTONIC time at which the next provisioning attempt may be made.
+/// </summary>
+static struct timespec nextProvisioningAttempt = {0, 0};
+
+/// <summary>
+///     Timeout passed to the Device Provisioning Service call, which blocks the caller.
+/// </summary>
+static const unsigned int provisioningTimeoutMs = 10000;
+
+/// <summary>
+///     Thread making the blocking provisioning call, so that the main loop keeps serving the
+///     UART and the timers. The result and the client it creates are handed to the main
+///     thread once 'provisioningDone' is set; until then only the thread touches them.
+/// </summary>
+static pthread_t provisioningThread;
+static bool provisioningInProgress = false;
+static atomic_bool provisioningDone = false;
+static AZURE_SPHERE_PROV_RETURN_VALUE provisioningThreadResult;
+static IOTHUB_DEVICE_CLIENT_LL_HANDLE provisionedClientHandle = NULL;
+
+/// <summary>
+///     Time the SDK keeps retrying a dropped connection with its own exponential backoff before
+///     reporting IOTHUB_CLIENT_CONNECTION_RETRY_EXPIRED, after which the device is provisioned
+///     again.
+/// </summary>
+static const size_t sdkRetryTimeoutSeconds = 300;
+
+/// <summary>
+///     Retry delays, in seconds, after the first failure of each class; see
+///     provisioning_backoff.h for how they grow with further failures.
+/// </summary>
+static const unsigned int transientRetryBaseSeconds = 2;
+static const unsigned int serviceRetryBaseSeconds = 10;
+static const unsigned int credentialRetryBaseSeconds = 60;
+
 /// <summary>
 ///     Used to set the keepalive period over MQTT to 20 seconds.
 /// </summary>
@@ -159,6 +218,146 @@ static char *getAzureSphereProvisioningResultString(
     }
 }
 
+/// <summary>
+///     Returns the base retry delay for a failed provisioning attempt.
+/// </summary>
+static unsigned int getProvisioningRetryBaseSeconds(AZURE_SPHERE_PROV_RESULT result)
+{
+    switch (result) {
+    case AZURE_SPHERE_PROV_RESULT_DEVICEAUTH_NOT_READY:
+        // The device will be ready shortly; retry soon.
+        return transientRetryBaseSeconds;
+    case AZURE_SPHERE_PROV_RESULT_INVALID_PARAM:
+        // Retrying will not help until the configuration is fixed; keep the load off DPS.
+        return credentialRetryBaseSeconds;
+    default:
+        return serviceRetryBaseSeconds;
+    }
+}
+
+/// <summary>
+///     Returns the base retry delay for provisioning again after the SDK reported the connection
+///     as down for the given reason, or 0 if the SDK keeps retrying on the existing client.
+/// </summary>
+static unsigned int getConnectionRetryBaseSeconds(IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason)
+{
+    switch (reason) {
+    case IOTHUB_CLIENT_CONNECTION_NO_NETWORK:
+    case IOTHUB_CLIENT_CONNECTION_COMMUNICATION_ERROR:
+    case IOTHUB_CLIENT_CONNECTION_OK:
+        // Transient; the SDK reconnects the existing client with its own backoff.
+        return 0;
+    case IOTHUB_CLIENT_CONNECTION_EXPIRED_SAS_TOKEN:
+        // The client needs new credentials; provision again after the short transient delay,
+        // which grows with the failure count like any other.
+        return transientRetryBaseSeconds;
+    case IOTHUB_CLIENT_CONNECTION_RETRY_EXPIRED:
+        return serviceRetryBaseSeconds;
+    case IOTHUB_CLIENT_CONNECTION_DEVICE_DISABLED:
+    case IOTHUB_CLIENT_CONNECTION_BAD_CREDENTIAL:
+    default:
+        return credentialRetryBaseSeconds;
+    }
+}
+
+/// <summary>
+///     Defers the next provisioning attempt by the given delay.
+/// </summary>
+static void scheduleProvisioningAttempt(uint32_t delayMs)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    nextProvisioningAttempt.tv_sec = now.tv_sec + (time_t)(delayMs / 1000);
+    nextProvisioningAttempt.tv_nsec = now.tv_nsec + (long)(delayMs % 1000) * 1000000L;
+    if (nextProvisioningAttempt.tv_nsec >= 1000000000L) {
+        nextProvisioningAttempt.tv_sec++;
+        nextProvisioningAttempt.tv_nsec -= 1000000000L;
+    }
+}
+
+/// <summary>
+///     Schedules the next provisioning attempt after a failure, with exponential backoff and
+///     jitter.
+/// </summary>
+/// <param name="baseSeconds">The retry delay after the first failure.</param>
+static void scheduleProvisioningRetry(unsigned int baseSeconds)
+{
+    static bool randomSeeded = false;
+
+    if (!randomSeeded) {
+        // Seed from the wall clock and the boot-relative clock, so that devices powered on
+        // together still draw different delays.
+        struct timespec wallClock;
+        struct timespec now;
+        timespec_get(&wallClock, TIME_UTC);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        srand((unsigned int)(wallClock.tv_nsec ^ wallClock.tv_sec ^ now.tv_nsec));
+        randomSeeded = true;
+    }
+
+    uint32_t delayMs =
+        ProvisioningBackoff_GetDelayMs(baseSeconds, provisioningFailureCount, (uint32_t)rand());
+    provisioningFailureCount++;
+    scheduleProvisioningAttempt(delayMs);
+
+    LogMessage("INFO: next provisioning attempt in %u.%03u s (failure %u)\n", delayMs / 1000,
+               delayMs % 1000, provisioningFailureCount);
+}
+
+/// <summary>
+///     Returns whether the backoff delay before the next provisioning attempt has expired.
+/// </summary>
+static bool isProvisioningAttemptDue(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec > nextProvisioningAttempt.tv_sec) ||
+           ((now.tv_sec == nextProvisioningAttempt.tv_sec) &&
+            (now.tv_nsec >= nextProvisioningAttempt.tv_nsec));
+}
+
+/// <summary>
+///     Body of the provisioning thread: makes the blocking Device Provisioning Service call.
+/// </summary>
+static void *provisioningThreadMain(void *arg)
+{
+    provisioningThreadResult = IoTHubDeviceClient_LL_CreateWithAzureSphereDeviceAuthProvisioning(
+        scopeId, provisioningTimeoutMs, &provisionedClientHandle);
+    atomic_store(&provisioningDone, true);
+    return NULL;
+}
+
+/// <summary>
+///     Starts a provisioning attempt on the provisioning thread.
+/// </summary>
+/// <returns>'true' if the thread was started.</returns>
+static bool startProvisioning(void)
+{
+    provisionedClientHandle = NULL;
+    atomic_store(&provisioningDone, false);
+    if (pthread_create(&provisioningThread, NULL, provisioningThreadMain, NULL) != 0) {
+        LogMessage("ERROR: could not start the provisioning thread\n");
+        return false;
+    }
+    provisioningInProgress = true;
+    return true;
+}
+
+/// <summary>
+///     Waits for the provisioning thread, if one is running, and takes the client it created.
+/// </summary>
+/// <returns>The client, or NULL if none was created.</returns>
+static IOTHUB_DEVICE_CLIENT_LL_HANDLE joinProvisioning(void)
+{
+    if (!provisioningInProgress)
+        return NULL;
+
+    pthread_join(provisioningThread, NULL);
+    provisioningInProgress = false;
+    return provisionedClientHandle;
+}
+
 /// <summary>
 ///     Sets up the client in order to establish the communication channel to Azure IoT Hub.
 ///
@@ -168,36 +367,78 @@ static char *getAzureSphereProvisioningResultString(
 ///     The client is setup with the following options:
 ///     - MQTT procotol 'keepalive' value of 20 seconds; when no PINGRESP is received after
 ///       20 seconds, the connection is believed to be down;
+///     Provisioning attempts are rate limited: after a failure the next attempt is deferred with
+///     exponential backoff and jitter, and no attempt is made while the network is not ready.
+///     The provisioning call blocks for up to its timeout, so it runs on its own thread; the
+///     calls made meanwhile return at once.
 /// </summary>
 /// <returns>'true' if the client has been properly set up. 'false' when a fatal error occurred
-/// while setting up the client.</returns>
+/// while setting up the client, when no attempt was made because the retry delay has not
+/// expired yet, or while an attempt is in progress.</returns>
 /// <remarks>This function is a no-op when the client has already been set up, i.e. this
 /// function has already completed successfully.</remarks>
 bool AzureIoT_SetupClient(void)
 {
-    if (iothubAuthenticated && (iothubClientHandle != NULL))
+    if ((connectionState != ConnectionState_NotProvisioned) && (iothubClientHandle != NULL))
         return true;
 
-    if (iothubClientHandle != NULL)
-        IoTHubDeviceClient_LL_Destroy(iothubClientHandle);
+    if (!provisioningInProgress) {
+        if (!isProvisioningAttemptDue())
+            return false;
+
+        bool isNetworkingReady = false;
+        if ((Networking_IsNetworkingReady(&isNetworkingReady) < 0) || !isNetworkingReady) {
+            // Not a provisioning failure: check again shortly, whatever the backoff has grown
+            // to.
+            scheduleProvisioningAttempt(PROVISIONING_BACKOFF_NETWORK_RETRY_MS);
+            return false;
+        }
 
-    AZURE_SPHERE_PROV_RETURN_VALUE provResult =
-        IoTHubDeviceClient_LL_CreateWithAzureSphereDeviceAuthProvisioning(scopeId, 10000,
-                                                                          &iothubClientHandle);
+        if (iothubClientHandle != NULL) {
+            IoTHubDeviceClient_LL_Destroy(iothubClientHandle);
+            iothubClientHandle = NULL;
+        }
+
+        if (!startProvisioning())
+            scheduleProvisioningRetry(transientRetryBaseSeconds);
+        return false;
+    }
+
+    if (!atomic_load(&provisioningDone))
+        return false;
+
+    iothubClientHandle = joinProvisioning();
+    AZURE_SPHERE_PROV_RETURN_VALUE provResult = provisioningThreadResult;
     LogMessage("IoTHubDeviceClient_CreateWithAzureSphereDeviceAuthProvisioning returned '%s'.\n",
                getAzureSphereProvisioningResultString(provResult));
 
-    if (provResult.result != AZURE_SPHERE_PROV_RESULT_OK) {
+    if (provResult.result == AZURE_SPHERE_PROV_RESULT_NETWORK_NOT_READY) {
+        // The network went down since the check above; as there, this is not a failure.
+        scheduleProvisioningAttempt(PROVISIONING_BACKOFF_NETWORK_RETRY_MS);
         return false;
     }
 
-    // Provisioning and authentication succeeded.
-    iothubAuthenticated = true;
+    if (provResult.result != AZURE_SPHERE_PROV_RESULT_OK) {
+        scheduleProvisioningRetry(getProvisioningRetryBaseSeconds(provResult.result));
+        return false;
+    }
 
     if (iothubClientHandle == NULL) {
+        scheduleProvisioningRetry(serviceRetryBaseSeconds);
         return false;
     }
 
+    // Provisioning succeeded; the SDK authenticates with the hub on the next DoWork calls.
+    connectionState = ConnectionState_Connecting;
+
+    // Let the SDK reconnect transient drops itself, with its own exponential backoff and
+    // jitter, before the device falls back to provisioning again.
+    if (IoTHubDeviceClient_LL_SetRetryPolicy(iothubClientHandle,
+                                             IOTHUB_CLIENT_RETRY_EXPONENTIAL_BACKOFF_WITH_JITTER,
+                                             sdkRetryTimeoutSeconds) != IOTHUB_CLIENT_OK) {
+        LogMessage("WARNING: failure setting the retry policy\n");
+    }
+
     if (IoTHubDeviceClient_LL_SetOption(iothubClientHandle, "TrustedCerts",
                                         azureIoTCertificatesX) != IOTHUB_CLIENT_OK) {
         LogMessage("ERROR: failure to set option \"TrustedCerts\"\n");
@@ -230,6 +471,12 @@ bool AzureIoT_SetupClient(void)
 /// </summary>
 void AzureIoT_DestroyClient(void)
 {
+    // A provisioning attempt in progress finishes within its timeout.
+    IOTHUB_DEVICE_CLIENT_LL_HANDLE provisionedClient = joinProvisioning();
+    if (provisionedClient != NULL) {
+        IoTHubDeviceClient_LL_Destroy(provisionedClient);
+    }
+
     if (iothubClientHandle != NULL) {
         IoTHubDeviceClient_LL_Destroy(iothubClientHandle);
         iothubClientHandle = NULL;
@@ -274,7 +521,7 @@ void AzureIoT_DoPeriodicTasks(void)
 {
     static time_t lastTimeLogged = 0;
 
-    if (iothubAuthenticated) {
+    if ((connectionState != ConnectionState_NotProvisioned) && (iothubClientHandle != NULL)) {
         PeriodicLogVarArgs(&lastTimeLogged, 5, "INFO: %s calls in progress...\n", __func__);
 
         // DoWork - send some of the buffered events to the IoT Hub, and receive some of the
@@ -283,6 +530,58 @@ void AzureIoT_DoPeriodicTasks(void)
     }
 }
 
+/// <summary>
+///     Creates the IoT Hub message for a payload. When payload compression is enabled and the
+///     payload is large enough, the body is an LZ4 block and the message carries the
+///     'content-encoding' system property so that cloud consumers can decompress it.
+/// </summary>
+/// <param name="messagePayload">The payload of the message to send.</param>
+/// <returns>The message handle, or NULL on failure.</returns>
+static IOTHUB_MESSAGE_HANDLE createMessage(const char *messagePayload)
+{
+    size_t payloadSize = strlen(messagePayload);
+    if (!PayloadCompression_ShouldCompress(payloadSize)) {
+        return IoTHubMessage_CreateFromString(messagePayload);
+    }
+
+    size_t compressedCapacity = PayloadCompression_GetMaxCompressedSize(payloadSize);
+    uint8_t *compressed = malloc(compressedCapacity);
+    if (compressed == NULL) {
+        LogMessage("WARNING: could not allocate buffer for compressed payload\n");
+        return IoTHubMessage_CreateFromString(messagePayload);
+    }
+
+    size_t compressedSize = PayloadCompression_Compress((const uint8_t *)messagePayload,
+                                                        payloadSize, compressed, compressedCapacity);
+    if (compressedSize == 0) {
+        free(compressed);
+        return IoTHubMessage_CreateFromString(messagePayload);
+    }
+
+    IOTHUB_MESSAGE_HANDLE messageHandle =
+        IoTHubMessage_CreateFromByteArray(compressed, compressedSize);
+    free(compressed);
+    if (messageHandle == NULL) {
+        return NULL;
+    }
+
+    char originalSize[16];
+    snprintf(originalSize, sizeof(originalSize), "%zu", payloadSize);
+    if ((IoTHubMessage_SetContentEncodingSystemProperty(
+             messageHandle, PAYLOAD_COMPRESSION_CONTENT_ENCODING) != IOTHUB_MESSAGE_OK) ||
+        (Map_AddOrUpdate(IoTHubMessage_Properties(messageHandle),
+                         PAYLOAD_COMPRESSION_ORIGINAL_SIZE_PROPERTY,
+                         originalSize) != MAP_OK)) {
+        LogMessage("WARNING: could not set the compressed message properties\n");
+        IoTHubMessage_Destroy(messageHandle);
+        return IoTHubMessage_CreateFromString(messagePayload);
+    }
+
+    LogMessage("INFO: compressed message payload from %zu to %zu bytes\n", payloadSize,
+               compressedSize);
+    return messageHandle;
+}
+
 /// <summary>
 ///     Creates and enqueues a message to be delivered the IoT Hub. The message is not actually
 ///     sent immediately, but it is sent on the next invocation of AzureIoT_DoPeriodicTasks().
@@ -295,7 +594,7 @@ void AzureIoT_SendMessage(const char *messagePayload)
         return;
     }
 
-    IOTHUB_MESSAGE_HANDLE messageHandle = IoTHubMessage_CreateFromString(messagePayload);
+    IOTHUB_MESSAGE_HANDLE messageHandle = createMessage(messagePayload);
 
     if (messageHandle == 0) {
         LogMessage("WARNING: unable to create a new IoTHubMessage\n");
@@ -582,10 +881,22 @@ static void hubConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS result,
         hubConnectionStatusCb(iothubAuthenticated);
     }
     const char *reasonString = getReasonString(reason);
-    if (!iothubAuthenticated) {
+    if (iothubAuthenticated) {
+        connectionState = ConnectionState_Connected;
+        provisioningFailureCount = 0;
+        LogMessage("INFO: connection to the IoT Hub has been established (%s).\n", reasonString);
+        return;
+    }
+
+    unsigned int retryBaseSeconds = getConnectionRetryBaseSeconds(reason);
+    if (retryBaseSeconds == 0) {
+        connectionState = ConnectionState_Connecting;
         LogMessage("INFO: IoT Hub connection is down (%s), retrying connection...\n", reasonString);
     } else {
-        LogMessage("INFO: connection to the IoT Hub has been established (%s).\n", reasonString);
+        // The client is destroyed and the device provisioned again once the delay expires.
+        connectionState = ConnectionState_NotProvisioned;
+        LogMessage("INFO: IoT Hub connection is down (%s), provisioning again...\n", reasonString);
+        scheduleProvisioningRetry(retryBaseSeconds);
     }
 }
 
@@ -16,15 +16,20 @@
 ///     options:
 ///     - MQTT procotol 'keepalive' value of 20 seconds; when no PINGRESP is received after
 ///       20 seconds, the connection is believed to be down;
+///     - exponential backoff with jitter for reconnections handled by the SDK.
+///     Failed provisioning attempts are retried with exponential backoff and jitter; calls made
+///     before the retry delay expires return immediately. The blocking provisioning call runs
+///     on its own thread, and calls made while it runs return immediately as well.
 /// </summary>
 /// <returns>'true' if the client has been properly set up. 'false' when a fatal error occurred
-/// while setting up the client.</returns>
+/// while setting up the client, when the next attempt is not due yet, or while an attempt is
+/// in progress.</returns>
 /// <remarks>This function is a no-op when the client has already been set up, i.e. this
 /// function has already completed successfully.</remarks>
 bool AzureIoT_SetupClient(void);
 
 /// <summary>
-///     Destroys the Azure IoT Hub client.
+///     Destroys the Azure IoT Hub client, after waiting for a provisioning attempt in progress.
 /// </summary>
 void AzureIoT_DestroyClient(void);
 
@@ -41,6 +46,8 @@ void AzureIoT_TwinReportState(const char *propertyName, size_t propertyValue);
 /// <summary>
 ///     Creates and enqueues a message to be delivered the IoT Hub. The message is not actually sent
 ///     immediately, but it is sent on the next invocation of AzureIoT_DoPeriodicTasks().
+///     When payload compression is enabled (see payload_compression.h) large payloads are sent
+///     as an LZ4 block with the 'content-encoding' system property set.
 /// </summary>
 /// <param name="messagePayload">The payload of the message to send.</param>
 void AzureIoT_SendMessage(const char *messagePayload);
@@ -0,0 +1,347 @@
+#include <string.h>
+#include <time.h>
+#include <applibs/log.h>
+#include "command_channel.h"
+#include "coordinator_link.h"
+
+typedef struct {
+    uint8_t seq;
+    uint8_t commandId;
+    uint8_t argsSize;
+    uint8_t retries;
+    uint8_t args[COMMAND_CHANNEL_MAX_ARGS_SIZE];
+    /// <summary>Set once the last transmission left the link; sentTime is valid then.</summary>
+    bool sent;
+    /// <summary>Number of the last transmission among the frames the link accepted.</summary>
+    uint32_t linkFrame;
+    struct timespec queuedTime;
+    struct timespec sentTime;
+} Command;
+
+// Every queued command has its own sequence number, so there must be fewer queued commands
+// than sequence numbers.
+_Static_assert(COMMAND_CHANNEL_MAX_DESTINATIONS * COMMAND_CHANNEL_QUEUE_DEPTH < 256,
+               "too many queued commands for an 8-bit sequence number");
+
+/// <summary>
+///     FIFO of the commands for one end device. The command at the head is the one in flight
+///     when awaitingAck is set.
+/// </summary>
+typedef struct {
+    bool inUse;
+    bool awaitingAck;
+    uint16_t nwkAddr;
+    size_t head;
+    size_t count;
+    Command commands[COMMAND_CHANNEL_QUEUE_DEPTH];
+} DestinationQueue;
+
+static DestinationQueue destinations[COMMAND_CHANNEL_MAX_DESTINATIONS];
+static size_t nextDestination = 0;
+static size_t inFlightCount = 0;
+static uint8_t nextSeq = 0;
+
+static CommandChannel_WriteFnType writeCb = NULL;
+static CommandChannel_LinkProgressFnType linkProgressCb = NULL;
+static CommandChannel_CompletionFnType completionCb = NULL;
+static CommandChannel_Statistics statistics;
+
+// Frame being written to the link; the link may accept it in several pieces.
+static uint8_t pendingFrame[COORDINATOR_LINK_MAX_FRAME_SIZE];
+static size_t pendingFrameSize = 0;
+static size_t pendingFrameOffset = 0;
+static Command *pendingCommand = NULL;
+
+static uint32_t ElapsedMs(const struct timespec *since, const struct timespec *now)
+{
+    int64_t ms = (int64_t)(now->tv_sec - since->tv_sec) * 1000 +
+                 (now->tv_nsec - since->tv_nsec) / 1000000;
+    return (ms < 0) ? 0 : (uint32_t)ms;
+}
+
+static DestinationQueue *FindDestination(uint16_t nwkAddr, bool allocate)
+{
+    DestinationQueue *freeSlot = NULL;
+    for (size_t i = 0; i < COMMAND_CHANNEL_MAX_DESTINATIONS; i++) {
+        if (destinations[i].inUse) {
+            if (destinations[i].nwkAddr == nwkAddr) {
+                return &destinations[i];
+            }
+        } else if (freeSlot == NULL) {
+            freeSlot = &destinations[i];
+        }
+    }
+
+    if (allocate && (freeSlot != NULL)) {
+        memset(freeSlot, 0, sizeof(*freeSlot));
+        freeSlot->inUse = true;
+        freeSlot->nwkAddr = nwkAddr;
+        return freeSlot;
+    }
+    return NULL;
+}
+
+/// <summary>
+///     Writes as much of the pending frame as the link accepts.
+/// </summary>
+/// <returns>'true' once the whole frame has been written.</returns>
+static bool FlushPendingFrame(void)
+{
+    while (pendingFrameOffset < pendingFrameSize) {
+        ssize_t written =
+            writeCb(pendingFrame + pendingFrameOffset, pendingFrameSize - pendingFrameOffset);
+        if (written <= 0) {
+            // Link busy (or failed); retry on the next call. A failed link also stops acks
+            // from arriving, so the commands time out.
+            return false;
+        }
+        pendingFrameOffset += (size_t)written;
+    }
+    pendingFrameSize = 0;
+    pendingFrameOffset = 0;
+
+    if (pendingCommand != NULL) {
+        if (linkProgressCb != NULL) {
+            // The frame is now the last one the link accepted; it is sent once it leaves.
+            uint32_t framesDone;
+            linkProgressCb(&pendingCommand->linkFrame, &framesDone);
+        } else {
+            pendingCommand->sent = true;
+            clock_gettime(CLOCK_MONOTONIC, &pendingCommand->sentTime);
+        }
+        pendingCommand = NULL;
+    }
+    return true;
+}
+
+/// <summary>
+///     Returns whether the last transmission of an in-flight command left the link, and
+///     stamps its sent time when it just did.
+/// </summary>
+static bool IsSent(Command *command, const struct timespec *now)
+{
+    if (command->sent) {
+        return true;
+    }
+    if ((command == pendingCommand) || (linkProgressCb == NULL)) {
+        return false;
+    }
+
+    uint32_t framesAccepted;
+    uint32_t framesDone;
+    linkProgressCb(&framesAccepted, &framesDone);
+    if ((int32_t)(framesDone - command->linkFrame) < 0) {
+        return false;
+    }
+    command->sent = true;
+    command->sentTime = *now;
+    return true;
+}
+
+/// <summary>
+///     Returns whether a queued command, in flight or not, uses the given sequence number.
+/// </summary>
+static bool IsSeqQueued(uint8_t seq)
+{
+    for (size_t i = 0; i < COMMAND_CHANNEL_MAX_DESTINATIONS; i++) {
+        const DestinationQueue *destination = &destinations[i];
+        if (!destination->inUse) {
+            continue;
+        }
+        for (size_t n = 0; n < destination->count; n++) {
+            size_t index = (destination->head + n) % COMMAND_CHANNEL_QUEUE_DEPTH;
+            if (destination->commands[index].seq == seq) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void SendCommand(DestinationQueue *destination, Command *command)
+{
+    uint8_t data[3 + COMMAND_CHANNEL_MAX_ARGS_SIZE];
+    data[0] = (uint8_t)(destination->nwkAddr & 0xFF);
+    data[1] = (uint8_t)(destination->nwkAddr >> 8);
+    data[2] = command->commandId;
+    memcpy(&data[3], command->args, command->argsSize);
+
+    pendingFrameSize =
+        CoordinatorLink_EncodeFrame(CoordinatorLink_FrameType_Command, command->seq, data,
+                                    3u + command->argsSize, pendingFrame, sizeof(pendingFrame));
+    pendingFrameOffset = 0;
+    pendingCommand = command;
+
+    // The acknowledgement timeout starts once the frame has left the link.
+    command->sent = false;
+    statistics.framesSent++;
+    FlushPendingFrame();
+}
+
+static void CompleteHead(DestinationQueue *destination, int status, const struct timespec *now)
+{
+    Command *command = &destination->commands[destination->head];
+    uint32_t latencyMs = ElapsedMs(&command->queuedTime, now);
+    uint8_t seq = command->seq;
+
+    if (pendingCommand == command) {
+        // The rest of the frame is still written; its acknowledgement will be unmatched.
+        pendingCommand = NULL;
+    }
+    destination->awaitingAck = false;
+    destination->head = (destination->head + 1) % COMMAND_CHANNEL_QUEUE_DEPTH;
+    destination->count--;
+    inFlightCount--;
+
+    if (status == 0) {
+        statistics.delivered++;
+    } else if (status == COMMAND_CHANNEL_STATUS_TIMEOUT) {
+        statistics.timedOut++;
+    } else {
+        statistics.failed++;
+    }
+    statistics.totalLatencyMs += latencyMs;
+    if (latencyMs > statistics.maxLatencyMs) {
+        statistics.maxLatencyMs = latencyMs;
+    }
+
+    Log_Debug("INFO: Command %u to 0x%04x completed with status %d after %u ms.\n", seq,
+              destination->nwkAddr, status, latencyMs);
+
+    uint16_t nwkAddr = destination->nwkAddr;
+    if (destination->count == 0) {
+        destination->inUse = false;
+    }
+
+    if (completionCb != NULL) {
+        completionCb(seq, nwkAddr, status, latencyMs);
+    }
+}
+
+void CommandChannel_Init(CommandChannel_WriteFnType writeFn,
+                         CommandChannel_LinkProgressFnType linkProgressFn,
+                         CommandChannel_CompletionFnType completionFn)
+{
+    memset(destinations, 0, sizeof(destinations));
+    memset(&statistics, 0, sizeof(statistics));
+    nextDestination = 0;
+    inFlightCount = 0;
+    pendingFrameSize = 0;
+    pendingFrameOffset = 0;
+    pendingCommand = NULL;
+    writeCb = writeFn;
+    linkProgressCb = linkProgressFn;
+    completionCb = completionFn;
+}
+
+int CommandChannel_Enqueue(uint16_t nwkAddr, uint8_t commandId, const uint8_t *args,
+                           size_t argsSize)
+{
+    if (argsSize > COMMAND_CHANNEL_MAX_ARGS_SIZE) {
+        statistics.rejected++;
+        return -1;
+    }
+
+    DestinationQueue *destination = FindDestination(nwkAddr, true);
+    if ((destination == NULL) || (destination->count == COMMAND_CHANNEL_QUEUE_DEPTH)) {
+        statistics.rejected++;
+        return -1;
+    }
+
+    Command *command = &destination->commands[(destination->head + destination->count) %
+                                              COMMAND_CHANNEL_QUEUE_DEPTH];
+
+    // A late acknowledgement must not complete a newer command: skip the sequence numbers
+    // still queued. There are fewer queued commands than sequence numbers.
+    do {
+        command->seq = nextSeq++;
+    } while (IsSeqQueued(command->seq));
+    command->commandId = commandId;
+    command->argsSize = (uint8_t)argsSize;
+    command->retries = 0;
+    if (argsSize > 0) {
+        memcpy(command->args, args, argsSize);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &command->queuedTime);
+    destination->count++;
+    statistics.queued++;
+
+    return command->seq;
+}
+
+void CommandChannel_DoPeriodicTasks(void)
+{
+    if (writeCb == NULL) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    // Retransmit or give up on commands whose acknowledgement is overdue.
+    for (size_t i = 0; i < COMMAND_CHANNEL_MAX_DESTINATIONS; i++) {
+        DestinationQueue *destination = &destinations[i];
+        if (!destination->inUse || !destination->awaitingAck) {
+            continue;
+        }
+        Command *command = &destination->commands[destination->head];
+        if (!IsSent(command, &now) ||
+            (ElapsedMs(&command->sentTime, &now) < COMMAND_CHANNEL_ACK_TIMEOUT_MS)) {
+            continue;
+        }
+        if ((command->retries < COMMAND_CHANNEL_MAX_RETRIES) && (pendingFrameSize == 0)) {
+            command->retries++;
+            statistics.retransmissions++;
+            SendCommand(destination, command);
+        } else if (command->retries >= COMMAND_CHANNEL_MAX_RETRIES) {
+            CompleteHead(destination, COMMAND_CHANNEL_STATUS_TIMEOUT, &now);
+        }
+    }
+
+    if (!FlushPendingFrame()) {
+        return;
+    }
+
+    // Start the next command of each idle destination, round-robin, while the link keeps
+    // accepting whole frames.
+    for (size_t n = 0; n < COMMAND_CHANNEL_MAX_DESTINATIONS; n++) {
+        if (inFlightCount >= COMMAND_CHANNEL_MAX_IN_FLIGHT) {
+            break;
+        }
+        DestinationQueue *destination = &destinations[nextDestination];
+        nextDestination = (nextDestination + 1) % COMMAND_CHANNEL_MAX_DESTINATIONS;
+        if (!destination->inUse || destination->awaitingAck || (destination->count == 0)) {
+            continue;
+        }
+
+        destination->awaitingAck = true;
+        inFlightCount++;
+        SendCommand(destination, &destination->commands[destination->head]);
+        if (pendingFrameSize != 0) {
+            break;
+        }
+    }
+}
+
+void CommandChannel_HandleAck(uint16_t nwkAddr, uint8_t seq, uint8_t status)
+{
+    DestinationQueue *destination = FindDestination(nwkAddr, false);
+    if ((destination != NULL) && destination->awaitingAck &&
+        (destination->commands[destination->head].seq == seq)) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        CompleteHead(destination, status, &now);
+        // Start the next command without waiting for the timer.
+        CommandChannel_DoPeriodicTasks();
+        return;
+    }
+
+    // Late acknowledgement of a command that already timed out, a duplicate, or one for
+    // another destination.
+    statistics.unmatchedAcks++;
+}
+
+const CommandChannel_Statistics *CommandChannel_GetStatistics(void)
+{
+    return &statistics;
+}
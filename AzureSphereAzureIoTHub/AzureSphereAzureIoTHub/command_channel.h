@@ -0,0 +1,121 @@
+/// \file command_channel.h
+/// \brief Queues commands for ZigBee end devices and sends them to the coordinator over the
+/// serial link, matching the acknowledgements the coordinator sends back.
+///
+/// Commands are queued per destination device and sent in order, one at a time per device;
+/// destinations are served round-robin. A command completes when the coordinator reports the
+/// outcome of its delivery to the end device, or when no acknowledgement arrives after
+/// COMMAND_CHANNEL_MAX_RETRIES retransmissions. Acknowledgements are matched on destination and
+/// sequence number, and no two queued commands share a sequence number. The acknowledgement
+/// timeout runs from the time the frame left the serial link, not from the time it was queued
+/// for it.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define COMMAND_CHANNEL_MAX_DESTINATIONS 16
+#define COMMAND_CHANNEL_QUEUE_DEPTH 8
+#define COMMAND_CHANNEL_MAX_ARGS_SIZE 16
+#define COMMAND_CHANNEL_MAX_IN_FLIGHT 4
+#define COMMAND_CHANNEL_ACK_TIMEOUT_MS 5000
+#define COMMAND_CHANNEL_MAX_RETRIES 2
+
+/// <summary>
+///     Completion status reported when the coordinator never acknowledged the command. Other
+///     values are the status byte of the acknowledgement, 0 meaning delivered.
+/// </summary>
+#define COMMAND_CHANNEL_STATUS_TIMEOUT (-1)
+
+/// <summary>
+///     Function used to hand encoded bytes to the serial link without blocking.
+/// </summary>
+/// <param name="data">The bytes to write</param>
+/// <param name="size">The number of bytes to write</param>
+/// <returns>The number of bytes accepted, 0 if the link cannot take more data right now, or -1
+/// on error.</returns>
+typedef ssize_t (*CommandChannel_WriteFnType)(const uint8_t *data, size_t size);
+
+/// <summary>
+///     Function returning how far the serial link got with the frames handed to it: frames
+///     leave the link in the order it accepted them.
+/// </summary>
+/// <param name="framesAccepted">Set to the number of frames the link accepted so far</param>
+/// <param name="framesDone">Set to the number of those frames that left the link</param>
+typedef void (*CommandChannel_LinkProgressFnType)(uint32_t *framesAccepted,
+                                                  uint32_t *framesDone);
+
+/// <summary>
+///     Function invoked when a command completes.
+/// </summary>
+/// <param name="seq">The sequence number returned by CommandChannel_Enqueue</param>
+/// <param name="nwkAddr">The NWK address of the destination device</param>
+/// <param name="status">0 if delivered, the coordinator's error status, or
+/// COMMAND_CHANNEL_STATUS_TIMEOUT</param>
+/// <param name="latencyMs">Time from queueing to completion, in milliseconds</param>
+typedef void (*CommandChannel_CompletionFnType)(uint8_t seq, uint16_t nwkAddr, int status,
+                                                uint32_t latencyMs);
+
+/// <summary>
+///     Counters kept by the command channel.
+/// </summary>
+typedef struct {
+    uint32_t queued;
+    uint32_t rejected;
+    uint32_t framesSent;
+    uint32_t retransmissions;
+    uint32_t delivered;
+    uint32_t failed;
+    uint32_t timedOut;
+    uint32_t unmatchedAcks;
+    /// <summary>Queue-to-completion latency of the completed commands.</summary>
+    uint64_t totalLatencyMs;
+    uint32_t maxLatencyMs;
+} CommandChannel_Statistics;
+
+/// <summary>
+///     Initializes the command channel, discarding any queued command.
+/// </summary>
+/// <param name="writeFn">The function writing to the coordinator link</param>
+/// <param name="linkProgressFn">The function telling when a frame left the link; may be NULL
+/// if a frame leaves once writeFn accepted all of it</param>
+/// <param name="completionFn">The function invoked when a command completes; may be NULL</param>
+void CommandChannel_Init(CommandChannel_WriteFnType writeFn,
+                         CommandChannel_LinkProgressFnType linkProgressFn,
+                         CommandChannel_CompletionFnType completionFn);
+
+/// <summary>
+///     Queues a command for an end device. The command is sent by CommandChannel_DoPeriodicTasks.
+/// </summary>
+/// <param name="nwkAddr">The NWK address of the destination device</param>
+/// <param name="commandId">The command identifier understood by the end device</param>
+/// <param name="args">The command arguments</param>
+/// <param name="argsSize">The size of the arguments; at most
+/// COMMAND_CHANNEL_MAX_ARGS_SIZE</param>
+/// <returns>The sequence number identifying the command, or -1 if the queue for the device,
+/// or the table of destinations, is full. The number is not used by any other queued
+/// command.</returns>
+int CommandChannel_Enqueue(uint16_t nwkAddr, uint8_t commandId, const uint8_t *args,
+                           size_t argsSize);
+
+/// <summary>
+///     Sends queued commands as far as the link accepts them, and retransmits or fails the
+///     commands whose acknowledgement is overdue. Never blocks.
+/// </summary>
+void CommandChannel_DoPeriodicTasks(void);
+
+/// <summary>
+///     Completes the in-flight command for the given destination with the given sequence
+///     number.
+/// </summary>
+/// <param name="nwkAddr">The NWK address carried by the acknowledgement frame</param>
+/// <param name="seq">The sequence number carried by the acknowledgement frame</param>
+/// <param name="status">The status carried by the acknowledgement frame</param>
+void CommandChannel_HandleAck(uint16_t nwkAddr, uint8_t seq, uint8_t status);
+
+/// <summary>
+///     Returns the counters kept by the command channel.
+/// </summary>
+const CommandChannel_Statistics *CommandChannel_GetStatistics(void);
@@ -0,0 +1,152 @@
+#include <string.h>
+#include "coordinator_link.h"
+
+// Decoder states.
+#define STATE_IDLE 0
+#define STATE_FRAME 1
+#define STATE_LEGACY_REPORT 2
+
+// Offsets of the header fields in the frame buffer.
+#define POS_SOF 0
+#define POS_LEN 1
+#define POS_TYPE 2
+#define POS_SEQ 3
+
+static uint8_t CalculateFcs(const uint8_t *data, size_t size)
+{
+    uint8_t fcs = 0;
+    for (size_t i = 0; i < size; i++) {
+        fcs ^= data[i];
+    }
+    return fcs;
+}
+
+void CoordinatorLink_InitDecoder(CoordinatorLink_Decoder *decoder,
+                                 CoordinatorLink_FrameHandlerFnType frameHandler,
+                                 CoordinatorLink_LegacyReportHandlerFnType legacyReportHandler)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->frameHandler = frameHandler;
+    decoder->legacyReportHandler = legacyReportHandler;
+    decoder->state = STATE_IDLE;
+}
+
+void CoordinatorLink_ProcessBytes(CoordinatorLink_Decoder *decoder, const uint8_t *data,
+                                  size_t dataSize)
+{
+    for (size_t i = 0; i < dataSize; i++) {
+        uint8_t ch = data[i];
+
+        switch (decoder->state) {
+        case STATE_IDLE:
+            if (ch == COORDINATOR_LINK_SOF) {
+                decoder->state = STATE_FRAME;
+            } else if ((ch == COORDINATOR_LINK_LEGACY_REPORT_START) &&
+                       (decoder->legacyReportHandler != NULL)) {
+                decoder->state = STATE_LEGACY_REPORT;
+            } else {
+                // Noise or line terminators between reports.
+                break;
+            }
+            decoder->buffer[0] = ch;
+            decoder->position = 1;
+            break;
+
+        case STATE_FRAME:
+            if ((decoder->position == POS_LEN) && (ch > COORDINATOR_LINK_MAX_DATA_SIZE)) {
+                // Cannot be a valid frame; look for the next start byte.
+                decoder->state = STATE_IDLE;
+                break;
+            }
+            decoder->buffer[decoder->position++] = ch;
+            if (decoder->position ==
+                COORDINATOR_LINK_HEADER_SIZE + decoder->buffer[POS_LEN] + 1u) {
+                size_t dataLength = decoder->buffer[POS_LEN];
+                uint8_t fcs = CalculateFcs(&decoder->buffer[POS_LEN],
+                                           COORDINATOR_LINK_HEADER_SIZE - 1 + dataLength);
+                if (fcs == decoder->buffer[decoder->position - 1]) {
+                    decoder->frameHandler(decoder->buffer[POS_TYPE], decoder->buffer[POS_SEQ],
+                                          &decoder->buffer[COORDINATOR_LINK_HEADER_SIZE],
+                                          dataLength);
+                } else {
+                    decoder->fcsErrors++;
+                }
+                decoder->state = STATE_IDLE;
+            }
+            break;
+
+        case STATE_LEGACY_REPORT:
+            decoder->buffer[decoder->position++] = ch;
+            if (decoder->position == COORDINATOR_LINK_LEGACY_REPORT_SIZE) {
+                decoder->legacyReportHandler(decoder->buffer);
+                decoder->state = STATE_IDLE;
+            }
+            break;
+
+        default:
+            decoder->state = STATE_IDLE;
+            break;
+        }
+    }
+}
+
+size_t CoordinatorLink_EncodeFrame(uint8_t type, uint8_t seq, const uint8_t *data,
+                                   size_t dataSize, uint8_t *frame, size_t frameCapacity)
+{
+    size_t frameSize = COORDINATOR_LINK_HEADER_SIZE + dataSize + 1;
+    if ((dataSize > COORDINATOR_LINK_MAX_DATA_SIZE) || (frameSize > frameCapacity)) {
+        return 0;
+    }
+
+    frame[POS_SOF] = COORDINATOR_LINK_SOF;
+    frame[POS_LEN] = (uint8_t)dataSize;
+    frame[POS_TYPE] = type;
+    frame[POS_SEQ] = seq;
+    if (dataSize > 0) {
+        memcpy(&frame[COORDINATOR_LINK_HEADER_SIZE], data, dataSize);
+    }
+    frame[frameSize - 1] = CalculateFcs(&frame[POS_LEN], frameSize - 2);
+
+    return frameSize;
+}
+
+bool CoordinatorLink_ReadBatchRecord(const uint8_t *data, size_t dataSize, size_t *position,
+                                     CoordinatorLink_BatchRecord *record)
+{
+    size_t pos = *position;
+    if ((pos > dataSize) || (dataSize - pos < COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE)) {
+        return false;
+    }
+    size_t reportSize = data[pos + 4];
+    if (dataSize - pos - COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE < reportSize) {
+        return false;
+    }
+
+    record->nwkAddr = (uint16_t)(data[pos] | (data[pos + 1] << 8));
+    record->deviceIndex = data[pos + 2];
+    record->linkQuality = data[pos + 3];
+    record->report = &data[pos + COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE];
+    record->reportSize = reportSize;
+    *position = pos + COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE + reportSize;
+    return true;
+}
+
+bool CoordinatorLink_ReadRouteStats(const uint8_t *data, size_t dataSize,
+                                    CoordinatorLink_RouteStats *stats)
+{
+    if (dataSize < COORDINATOR_LINK_ROUTE_STATS_SIZE) {
+        return false;
+    }
+
+    uint16_t counters[COORDINATOR_LINK_ROUTE_STATS_SIZE / 2];
+    for (size_t i = 0; i < COORDINATOR_LINK_ROUTE_STATS_SIZE / 2; i++) {
+        counters[i] = (uint16_t)(data[2 * i] | (data[2 * i + 1] << 8));
+    }
+    stats->mtoRequests = counters[0];
+    stats->routeRecords = counters[1];
+    stats->cachedUnicasts = counters[2];
+    stats->stackCachedUnicasts = counters[3];
+    stats->discoveredUnicasts = counters[4];
+    stats->failedRoutes = counters[5];
+    return true;
+}
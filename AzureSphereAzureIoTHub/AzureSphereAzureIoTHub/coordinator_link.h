@@ -0,0 +1,193 @@
+/// \file coordinator_link.h
+/// \brief Framing of the serial link between the gateway and the ZigBee coordinator.
+///
+/// Every frame has the layout below, modelled on the MT frame used by Z-Stack:
+///
+///     | SOF  | LEN | TYPE | SEQ | DATA  | FCS |
+///     | 0xFE |  1  |  1   |  1  | 0-LEN |  1  |
+///
+/// LEN is the length of DATA, and FCS is the XOR of the LEN, TYPE, SEQ and DATA bytes. The
+/// coordinator side of the protocol lives in GatewayLink.h in the GenericApp sample.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define COORDINATOR_LINK_SOF 0xFE
+#define COORDINATOR_LINK_HEADER_SIZE 4 // SOF, LEN, TYPE, SEQ
+#define COORDINATOR_LINK_MAX_DATA_SIZE 128
+#define COORDINATOR_LINK_MAX_FRAME_SIZE \
+    (COORDINATOR_LINK_HEADER_SIZE + COORDINATOR_LINK_MAX_DATA_SIZE + 1)
+
+/// <summary>
+///     Frame types. Frames sent by the coordinator have the top bit set.
+/// </summary>
+typedef enum {
+    /// <summary>Gateway to coordinator: DATA = NWK address (2, little-endian), command id (1),
+    /// command arguments.</summary>
+    CoordinatorLink_FrameType_Command = 0x01,
+    /// <summary>Coordinator to gateway: SEQ = sequence number of the command, DATA = status
+    /// (1), 0 when the end device acknowledged delivery, and the NWK address of the command
+    /// (2, little-endian).</summary>
+    CoordinatorLink_FrameType_CommandAck = 0x81,
+    /// <summary>Coordinator to gateway: DATA = NWK address of the end device (2,
+    /// little-endian), sensor report frame (see sensor_frame.h).</summary>
+    CoordinatorLink_FrameType_SensorReport = 0x82,
+    /// <summary>Coordinator to gateway: DATA = NWK address of the end device (2,
+    /// little-endian), ASCII report of an older end device (COORDINATOR_LINK_LEGACY_REPORT_SIZE
+    /// bytes).</summary>
+    CoordinatorLink_FrameType_LegacyReport = 0x83,
+    /// <summary>Coordinator to gateway: DATA = one or more records, each the NWK address of
+    /// the end device (2, little-endian), its device index (1), the LQI of its report (1), the
+    /// report size (1) and the report, either a sensor report frame or an ASCII report.</summary>
+    CoordinatorLink_FrameType_ReportBatch = 0x84,
+    /// <summary>Coordinator to gateway: DATA = device index (1), NWK address (2,
+    /// little-endian), IEEE address (8, little-endian). Sent when the coordinator learns or
+    /// updates the addresses of a device.</summary>
+    CoordinatorLink_FrameType_DeviceEntry = 0x85,
+    /// <summary>Coordinator to gateway: DATA = the routing counters of the coordinator (see
+    /// CoordinatorLink_RouteStats), sent after each many-to-one route request.</summary>
+    CoordinatorLink_FrameType_RouteStats = 0x86
+} CoordinatorLink_FrameType;
+
+#define COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE 5 // NWK address, device index, LQI, report size
+
+/// <summary>
+///     A record of a CoordinatorLink_FrameType_ReportBatch frame.
+/// </summary>
+typedef struct {
+    uint16_t nwkAddr;
+    uint8_t deviceIndex;
+    uint8_t linkQuality;
+    /// <summary>The report, pointing into the frame data.</summary>
+    const uint8_t *report;
+    size_t reportSize;
+} CoordinatorLink_BatchRecord;
+
+/// <summary>
+///     Device indexes are allocated by the coordinator, one per IEEE address, and kept across
+///     restarts. A record carries COORDINATOR_LINK_NO_DEVICE_INDEX until the coordinator knows
+///     the IEEE address of the sender.
+/// </summary>
+#define COORDINATOR_LINK_NO_DEVICE_INDEX 0xFF
+#define COORDINATOR_LINK_DEVICE_ENTRY_SIZE 11
+#define COORDINATOR_LINK_IEEE_ADDRESS_SIZE 8
+
+/// <summary>
+///     The routing counters of a CoordinatorLink_FrameType_RouteStats frame, each 2 bytes,
+///     little-endian, in this order. They count from the start of the coordinator and wrap at
+///     65536. Unicasts sent on a relay list are route discoveries avoided.
+/// </summary>
+typedef struct {
+    /// <summary>Many-to-one route requests sent.</summary>
+    uint16_t mtoRequests;
+    /// <summary>Route records received.</summary>
+    uint16_t routeRecords;
+    /// <summary>Unicasts sent on a relay list of the coordinator's cache.</summary>
+    uint16_t cachedUnicasts;
+    /// <summary>Unicasts sent on a relay list of the stack's table.</summary>
+    uint16_t stackCachedUnicasts;
+    /// <summary>Unicasts left to route discovery.</summary>
+    uint16_t discoveredUnicasts;
+    /// <summary>Relay lists dropped after a delivery failure.</summary>
+    uint16_t failedRoutes;
+} CoordinatorLink_RouteStats;
+
+#define COORDINATOR_LINK_ROUTE_STATS_SIZE 12
+
+/// <summary>
+///     Size of the ASCII reports of older end devices: 'S', the device id and nine ASCII
+///     digits. Coordinators that predate the framed protocol send them unframed.
+/// </summary>
+#define COORDINATOR_LINK_LEGACY_REPORT_SIZE 11
+#define COORDINATOR_LINK_LEGACY_REPORT_START 'S'
+
+/// <summary>
+///     Function invoked for each valid frame received from the coordinator.
+/// </summary>
+/// <param name="type">The frame type</param>
+/// <param name="seq">The frame sequence number</param>
+/// <param name="data">The frame data</param>
+/// <param name="dataSize">The size of the frame data</param>
+typedef void (*CoordinatorLink_FrameHandlerFnType)(uint8_t type, uint8_t seq, const uint8_t *data,
+                                                   size_t dataSize);
+
+/// <summary>
+///     Function invoked for each unframed legacy sensor report received from the coordinator.
+/// </summary>
+/// <param name="report">The COORDINATOR_LINK_LEGACY_REPORT_SIZE bytes of the report</param>
+typedef void (*CoordinatorLink_LegacyReportHandlerFnType)(const uint8_t *report);
+
+/// <summary>
+///     State of the receive side of the link. Bytes may be fed in arbitrary chunks; the
+///     decoder resynchronizes on the next start byte after a corrupted frame.
+/// </summary>
+typedef struct {
+    CoordinatorLink_FrameHandlerFnType frameHandler;
+    CoordinatorLink_LegacyReportHandlerFnType legacyReportHandler;
+    int state;
+    size_t position;
+    uint8_t buffer[COORDINATOR_LINK_MAX_FRAME_SIZE];
+    /// <summary>Number of frames dropped because of a bad FCS.</summary>
+    uint32_t fcsErrors;
+} CoordinatorLink_Decoder;
+
+/// <summary>
+///     Initializes a decoder.
+/// </summary>
+/// <param name="decoder">The decoder to initialize</param>
+/// <param name="frameHandler">Function invoked for each valid frame</param>
+/// <param name="legacyReportHandler">Function invoked for each legacy report; may be NULL</param>
+void CoordinatorLink_InitDecoder(CoordinatorLink_Decoder *decoder,
+                                 CoordinatorLink_FrameHandlerFnType frameHandler,
+                                 CoordinatorLink_LegacyReportHandlerFnType legacyReportHandler);
+
+/// <summary>
+///     Feeds bytes received from the coordinator to a decoder, invoking the handlers for each
+///     complete frame or legacy report.
+/// </summary>
+/// <param name="decoder">The decoder</param>
+/// <param name="data">The received bytes</param>
+/// <param name="dataSize">The number of received bytes</param>
+void CoordinatorLink_ProcessBytes(CoordinatorLink_Decoder *decoder, const uint8_t *data,
+                                  size_t dataSize);
+
+/// <summary>
+///     Encodes a frame.
+/// </summary>
+/// <param name="type">The frame type</param>
+/// <param name="seq">The frame sequence number</param>
+/// <param name="data">The frame data</param>
+/// <param name="dataSize">The size of the frame data; at most
+/// COORDINATOR_LINK_MAX_DATA_SIZE</param>
+/// <param name="frame">The buffer receiving the frame</param>
+/// <param name="frameCapacity">The size of the frame buffer</param>
+/// <returns>The size of the encoded frame, or 0 if it does not fit.</returns>
+size_t CoordinatorLink_EncodeFrame(uint8_t type, uint8_t seq, const uint8_t *data,
+                                   size_t dataSize, uint8_t *frame, size_t frameCapacity);
+
+/// <summary>
+///     Reads the next record of a CoordinatorLink_FrameType_ReportBatch frame.
+/// </summary>
+/// <param name="data">The frame data</param>
+/// <param name="dataSize">The size of the frame data</param>
+/// <param name="position">The offset of the record in data, 0 for the first; advanced past the
+/// record read</param>
+/// <param name="record">The record read</param>
+/// <returns>true if a record was read; false at the end of the data, or if the record is
+/// truncated, in which case position is left short of dataSize.</returns>
+bool CoordinatorLink_ReadBatchRecord(const uint8_t *data, size_t dataSize, size_t *position,
+                                     CoordinatorLink_BatchRecord *record);
+
+/// <summary>
+///     Reads the counters of a CoordinatorLink_FrameType_RouteStats frame. Data past the
+///     counters, which later coordinators may add, is ignored.
+/// </summary>
+/// <param name="data">The frame data</param>
+/// <param name="dataSize">The size of the frame data</param>
+/// <param name="stats">The counters read</param>
+/// <returns>true on success, false if the data is shorter than
+/// COORDINATOR_LINK_ROUTE_STATS_SIZE.</returns>
+bool CoordinatorLink_ReadRouteStats(const uint8_t *data, size_t dataSize,
+                                    CoordinatorLink_RouteStats *stats);
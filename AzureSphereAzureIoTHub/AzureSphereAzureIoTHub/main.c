@@ -11,8 +11,14 @@
 #include <applibs/log.h>
 #include <applibs/wificonfig.h>
 
+#include "command_channel.h"
+#include "coordinator_link.h"
 #include "mt3620_rdb.h"
+#include "payload_compression.h"
 #include "rgbled_utility.h"
+#include "sensor_calibration.h"
+#include "sensor_frame.h"
+#include "uart_tx_queue.h"
 
 // This sample C application for a MT3620 Reference Development Board (Azure Sphere) demonstrates how to
 // connect an Azure Sphere device to an Azure IoT Hub. To use this sample, you must first
@@ -39,6 +45,14 @@
 // Direct Method related notes:
 // - Invoking the method named "LedColorControlMethod" with a payload containing '{"color":"red"}'
 //   will set the color of LED 1 to red;
+// - Invoking the method named "DeviceCommandMethod" with a payload such as
+//   '{"device":1234,"command":"setReportInterval","value":10}' queues a command for the ZigBee
+//   end device with NWK address 1234 and returns its sequence number; cloud-to-device messages
+//   with the same payload do the same. The outcome is sent as a telemetry message once the
+//   coordinator acknowledges the command. Supported commands are "reportNow",
+//   "setReportInterval" (longest time between reports, value in seconds), "setSampleInterval"
+//   (value in milliseconds) and "setDeadband", which also takes a "channel" such as
+//   "Temperature" and sets the change in that channel that triggers a report.
 //
 // Device Twin related notes:
 // - Setting LedBlinkRateProperty in the Device Twin to a value from 0 to 2 causes the sample to
@@ -47,6 +61,9 @@
 //   the device twin on the IoT hub with the new value for LedBlinkRateProperty.
 // - Pressing button A causes the sample to report the blink rate to the device
 //   twin on the IoT Hub.
+// - Setting PayloadCompressionProperty in the Device Twin to 1 enables LZ4 compression of large
+//   telemetry payloads, and 0 disables it, e.g '{"PayloadCompressionProperty": 1}'; the applied
+//   value is reported back to the device twin.
 
 // This sample uses the API for the following Azure Sphere application libraries:
 // - gpio (digital input for button);
@@ -80,6 +97,7 @@ static int gpioButtonsManagementTimerFd = -1;
 static int gpioLed1TimerFd = -1;
 static int gpioLed2TimerFd = -1;
 static int azureIotDoWorkTimerFd = -1;
+static int commandChannelTimerFd = -1;
 
 // LED state
 static RgbLed led1 = RGBLED_INIT_VALUE;
@@ -105,6 +123,23 @@ static volatile sig_atomic_t terminationRequired = false;
 //Uart jiongshi
 static int uartFd = -1;
 
+// Receive side of the serial link to the ZigBee coordinator
+static CoordinatorLink_Decoder coordinatorLinkDecoder;
+
+// Commands understood by the GenericApp end device (GENERICAPP_CMD_* in GenericApp.h).
+typedef struct {
+    const char *name;
+    uint8_t commandId;
+    bool hasChannel;
+    bool hasValue;
+} DeviceCommand;
+
+static const DeviceCommand deviceCommands[] = {{"reportNow", 0x01, false, false},
+                                               {"setReportInterval", 0x02, false, true},
+                                               {"setDeadband", 0x03, true, true},
+                                               {"setSampleInterval", 0x04, false, true}};
+static const size_t deviceCommandsCount = sizeof(deviceCommands) / sizeof(*deviceCommands);
+
 /// <summary>
 ///     Signal handler for termination requests. This handler must be async-signal-safe.
 /// </summary>
@@ -116,101 +151,434 @@ static void TerminationHandler(int signalNumber)
 
 //Uart shijiong
 /// <summary>
-///     Helper function to send a fixed message via the given UART.
-/// </summary>
-/// <param name="uartFd">The open file descriptor of the UART to write to</param>
-/// <param name="dataToSend">The data to send over the UART</param>
-static void SendUartMessage(int uartFd, const char *dataToSend)
-{
-	size_t totalBytesSent = 0;
-	size_t totalBytesToSend = strlen(dataToSend);
-	int sendIterations = 0;
-	while (totalBytesSent < totalBytesToSend) {
-		sendIterations++;
-
-		// Send as much of the remaining data as possible
-		size_t bytesLeftToSend = totalBytesToSend - totalBytesSent;
-		const char *remainingMessageToSend = dataToSend + totalBytesSent;
-		ssize_t bytesSent = write(uartFd, remainingMessageToSend, bytesLeftToSend);
-		if (bytesSent < 0) {
-			Log_Debug("ERROR: Could not write to UART: %s (%d).\n", strerror(errno), errno);
-			terminationRequired = true;
-			return;
-		}
-
-		totalBytesSent += (size_t)bytesSent;
-	}
+///     Queues a frame for the coordinator UART without blocking.
+/// </summary>
+/// <param name="data">The bytes to write</param>
+/// <param name="size">The number of bytes to write</param>
+/// <returns>The number of bytes queued, or 0 if the transmit queue is full.</returns>
+static ssize_t WriteCoordinatorLink(const uint8_t *data, size_t size)
+{
+    return UartTxQueue_Enqueue(data, size) ? (ssize_t)size : 0;
+}
 
-	Log_Debug("Sent %zu bytes over UART in %d calls\n", totalBytesSent, sendIterations);
+/// <summary>
+///     Tells the command channel how many frames the UART transmit queue took, and how many of
+///     them it wrote out or dropped.
+/// </summary>
+static void GetCoordinatorLinkProgress(uint32_t *framesAccepted, uint32_t *framesDone)
+{
+    const UartTxQueue_Statistics *txStatistics = UartTxQueue_GetStatistics();
+    *framesAccepted = txStatistics->framesQueued;
+    *framesDone = txStatistics->framesWritten + txStatistics->framesDropped;
 }
 
-//Uart Shijiong
+// Report values of the calibrated channels, in SensorCalibration_Channel order.
+static const SensorFrame_Tlv calibratedValues[SensorCalibration_Channel_Count] = {
+    SensorFrame_Tlv_Temperature, SensorFrame_Tlv_Humidity, SensorFrame_Tlv_Light,
+    SensorFrame_Tlv_Gas};
+
+// Report values in hundredths of the calibrated channels that have them, or 0; they are used
+// instead of the whole values when present.
+static const SensorFrame_Tlv calibratedCentiValues[SensorCalibration_Channel_Count] = {
+    SensorFrame_Tlv_TemperatureCenti, SensorFrame_Tlv_HumidityCenti, 0, 0};
+
 /// <summary>
-///     Handle UART event: if there is incoming data, print it, and blink the LED.
+///     Calibrates a sensor report (see sensor_calibration.h) and sends it to the IoT Hub.
 /// </summary>
-static void UARTEventHandler()
+/// <param name="report">The decoded report</param>
+/// <param name="nwkAddr">The NWK address of the reporting device, or -1 if unknown</param>
+/// <param name="deviceIndex">The coordinator's index of the reporting device, or -1 if unknown.
+/// When known, it selects the "index:" calibration table of the device instead of the table of
+/// the device id of the report, which older end devices do not set per device.</param>
+/// <param name="linkQuality">The LQI of the report as received by the coordinator, or -1 if
+/// unknown</param>
+static void SendSensorReport(const SensorFrame_Report *report, int nwkAddr, int deviceIndex,
+                             int linkQuality)
 {
-	const size_t receiveBufferSize = 64;
-	uint8_t receiveBuffer[receiveBufferSize + 1]; // allow extra byte for string termination
-	ssize_t bytesRead;
+    JSON_Value *root_value = json_value_init_object();
+    JSON_Object *root_object = json_value_get_object(root_value);
+    uint32_t calibrationId =
+        (deviceIndex >= 0) ? SENSOR_CALIBRATION_INDEX_ID(deviceIndex) : report->deviceId;
+
+    json_object_set_number(root_object, "Device ID", report->deviceId);
+    if (deviceIndex >= 0) {
+        json_object_set_number(root_object, "DeviceIndex", deviceIndex);
+    }
+    if (report->version != 0) {
+        json_object_set_number(root_object, "Sequence", report->seq);
+    }
+    if (nwkAddr >= 0) {
+        json_object_set_number(root_object, "NwkAddr", nwkAddr);
+    }
+    if (linkQuality >= 0) {
+        json_object_set_number(root_object, "LinkQuality", linkQuality);
+    }
+    for (size_t channel = 0; channel < SensorCalibration_Channel_Count; channel++) {
+        int32_t value;
+        if ((calibratedCentiValues[channel] != 0) &&
+            SensorFrame_HasValue(report, calibratedCentiValues[channel])) {
+            value = SensorCalibration_ApplyCenti(calibrationId, (SensorCalibration_Channel)channel,
+                                                 report->values[calibratedCentiValues[channel]]);
+        } else if (SensorFrame_HasValue(report, calibratedValues[channel])) {
+            value = SensorCalibration_Apply(calibrationId, (SensorCalibration_Channel)channel,
+                                            report->values[calibratedValues[channel]]);
+        } else {
+            continue;
+        }
+        json_object_set_number(root_object,
+                               SensorCalibration_GetChannelName((SensorCalibration_Channel)channel),
+                               (double)value / SENSOR_CALIBRATION_SCALE);
+    }
+    if (SensorFrame_HasValue(report, SensorFrame_Tlv_Pir)) {
+        json_object_set_number(root_object, "PIR", report->values[SensorFrame_Tlv_Pir]);
+    }
 
-	// Read UART message
-	bytesRead = read(uartFd, receiveBuffer, receiveBufferSize);
-	if (bytesRead < 0) {
-		Log_Debug("ERROR: Could not read UART: %s (%d).\n", strerror(errno), errno);
-		terminationRequired = true;
-		return;
-	}
+    char *serialized_string = json_serialize_to_string_pretty(root_value);
+    AzureIoT_SendMessage(serialized_string);
 
-	if (bytesRead > 0) {
-		// Null terminate the buffer to make it a valid string, and print it
-		receiveBuffer[bytesRead] = 0;
-		Log_Debug("UART received %d bytes: '%s'\n", bytesRead, (char *)receiveBuffer);
+    json_free_serialized_string(serialized_string);
+    json_value_free(root_value);
+}
 
+/// <summary>
+///     Handle a sensor report in the unframed ASCII format sent by older end devices.
+/// </summary>
+/// <param name="report">The COORDINATOR_LINK_LEGACY_REPORT_SIZE bytes of the report</param>
+static void LegacyReportHandler(const uint8_t *report)
+{
+    Log_Debug("UART received report: '%.*s'\n", COORDINATOR_LINK_LEGACY_REPORT_SIZE,
+              (const char *)report);
 
-		char deviceID[1];
-		strncpy(deviceID, &receiveBuffer[1], 1);
-		int id = deviceID[0] - 48;
+    SensorFrame_Report decodedReport;
+    if (SensorFrame_DecodeLegacy(report, &decodedReport)) {
+        SendSensorReport(&decodedReport, -1, -1, -1);
+    }
+}
 
-		char tempValue[2];
-		strncpy(tempValue, &receiveBuffer[2], 2);
-		int temp = (tempValue[0] - 48) * 10 + (tempValue[1] - 48);
+/// <summary>
+///     Handle a binary sensor report forwarded by the coordinator.
+/// </summary>
+/// <param name="data">The NWK address of the end device (2, little-endian), then the frame
+/// described in sensor_frame.h</param>
+/// <param name="dataSize">The size of the data</param>
+static void SensorReportHandler(const uint8_t *data, size_t dataSize)
+{
+    if (dataSize < 2) {
+        return;
+    }
 
+    uint16_t nwkAddr = (uint16_t)(data[0] | (data[1] << 8));
+    SensorFrame_Report report;
+    SensorFrame_Result result = SensorFrame_Decode(&data[2], dataSize - 2, &report);
+    if (result != SensorFrame_Result_Ok) {
+        Log_Debug("WARNING: Dropping sensor report from 0x%04x (error %d).\n", nwkAddr, result);
+        return;
+    }
+    SendSensorReport(&report, nwkAddr, -1, -1);
+}
 
-		char humiValue[2];
-		strncpy(humiValue, &receiveBuffer[4], 2);
-		int humi = (humiValue[0] - 48) * 10 + (humiValue[1] - 48);
+/// <summary>
+///     Handle an ASCII sensor report forwarded in a frame by the coordinator.
+/// </summary>
+/// <param name="data">The NWK address of the end device (2, little-endian), then the
+/// COORDINATOR_LINK_LEGACY_REPORT_SIZE bytes of the report</param>
+/// <param name="dataSize">The size of the data</param>
+static void FramedLegacyReportHandler(const uint8_t *data, size_t dataSize)
+{
+    if (dataSize != 2 + COORDINATOR_LINK_LEGACY_REPORT_SIZE) {
+        return;
+    }
 
+    uint16_t nwkAddr = (uint16_t)(data[0] | (data[1] << 8));
+    SensorFrame_Report report;
+    if (SensorFrame_DecodeLegacy(&data[2], &report)) {
+        SendSensorReport(&report, nwkAddr, -1, -1);
+    }
+}
 
-		char lightValue[2];
-		strncpy(lightValue, &receiveBuffer[6], 2);
-		int light = (lightValue[0] - 48) * 10 + (lightValue[1] - 48);
+/// <summary>
+///     Handle a batch of sensor reports collected by the coordinator.
+/// </summary>
+/// <param name="data">The records described in coordinator_link.h</param>
+/// <param name="dataSize">The size of the data</param>
+static void ReportBatchHandler(const uint8_t *data, size_t dataSize)
+{
+    size_t pos = 0;
+    CoordinatorLink_BatchRecord record;
+    while (CoordinatorLink_ReadBatchRecord(data, dataSize, &pos, &record)) {
+        SensorFrame_Report report;
+        if ((record.reportSize == COORDINATOR_LINK_LEGACY_REPORT_SIZE) &&
+            (record.report[0] == COORDINATOR_LINK_LEGACY_REPORT_START)) {
+            if (!SensorFrame_DecodeLegacy(record.report, &report)) {
+                continue;
+            }
+        } else {
+            SensorFrame_Result result =
+                SensorFrame_Decode(record.report, record.reportSize, &report);
+            if (result != SensorFrame_Result_Ok) {
+                Log_Debug("WARNING: Dropping sensor report from 0x%04x (error %d).\n",
+                          record.nwkAddr, result);
+                continue;
+            }
+        }
+        SendSensorReport(&report, record.nwkAddr,
+                         (record.deviceIndex == COORDINATOR_LINK_NO_DEVICE_INDEX)
+                             ? -1
+                             : record.deviceIndex,
+                         record.linkQuality);
+    }
+    if (pos < dataSize) {
+        Log_Debug("WARNING: Dropping truncated report batch record at offset %zu.\n", pos);
+    }
+}
 
-		char gasValue[2];
-		strncpy(gasValue, &receiveBuffer[8], 2);
-		int gas = (gasValue[0] - 48) * 10 + (gasValue[1] - 48);
+/// <summary>
+///     Handle the addresses of a device as recorded by the coordinator, and pass them on to
+///     the IoT Hub so that device indexes can be traced to IEEE addresses.
+/// </summary>
+/// <param name="data">The device entry described in coordinator_link.h</param>
+/// <param name="dataSize">The size of the data</param>
+static void DeviceEntryHandler(const uint8_t *data, size_t dataSize)
+{
+    if (dataSize < COORDINATOR_LINK_DEVICE_ENTRY_SIZE) {
+        return;
+    }
 
-		char pirValue[1];
-		strncpy(pirValue, &receiveBuffer[10], 1);
-		int pir = pirValue[0] - 48;
+    uint16_t nwkAddr = (uint16_t)(data[1] | (data[2] << 8));
+    char ieeeAddr[2 * COORDINATOR_LINK_IEEE_ADDRESS_SIZE + 1];
+    for (size_t i = 0; i < COORDINATOR_LINK_IEEE_ADDRESS_SIZE; i++) {
+        // Most significant byte first, as IEEE addresses are usually written.
+        snprintf(&ieeeAddr[2 * i], 3, "%02X", data[3 + COORDINATOR_LINK_IEEE_ADDRESS_SIZE - 1 - i]);
+    }
+    Log_Debug("Device %u is %s at 0x%04x.\n", data[0], ieeeAddr, nwkAddr);
 
-		//AzureIoT_SendMessage(receiveBuffer);
-		JSON_Value *root_value = json_value_init_object();
-		JSON_Object *root_object = json_value_get_object(root_value);
+    JSON_Value *root_value = json_value_init_object();
+    JSON_Object *root_object = json_value_get_object(root_value);
+    json_object_set_number(root_object, "DeviceIndex", data[0]);
+    json_object_set_number(root_object, "NwkAddr", nwkAddr);
+    json_object_set_string(root_object, "IEEEAddr", ieeeAddr);
 
-		json_object_set_number(root_object, "Device ID", id);
-		json_object_set_number(root_object, "Temperature", temp);
-		json_object_set_number(root_object, "Humidity", humi);
-		json_object_set_number(root_object, "Light", light);
-		json_object_set_number(root_object, "Gas", gas);
-		json_object_set_number(root_object, "PIR", pir);
+    char *serialized_string = json_serialize_to_string_pretty(root_value);
+    AzureIoT_SendMessage(serialized_string);
 
-		char *serialized_string = json_serialize_to_string_pretty(root_value);
-		AzureIoT_SendMessage(serialized_string);
+    json_free_serialized_string(serialized_string);
+    json_value_free(root_value);
+}
 
-		json_free_serialized_string(serialized_string);
-		json_value_free(root_value);
-	}
+/// <summary>
+///     Handle the routing counters of the coordinator, and pass them on to the IoT Hub.
+/// </summary>
+/// <param name="data">The counters described in coordinator_link.h</param>
+/// <param name="dataSize">The size of the data</param>
+static void RouteStatsHandler(const uint8_t *data, size_t dataSize)
+{
+    CoordinatorLink_RouteStats stats;
+    if (!CoordinatorLink_ReadRouteStats(data, dataSize, &stats)) {
+        return;
+    }
+
+    JSON_Value *root_value = json_value_init_object();
+    JSON_Object *root_object = json_value_get_object(root_value);
+    json_object_dotset_number(root_object, "RouteStats.MtoRequests", stats.mtoRequests);
+    json_object_dotset_number(root_object, "RouteStats.RouteRecords", stats.routeRecords);
+    json_object_dotset_number(root_object, "RouteStats.CachedUnicasts", stats.cachedUnicasts);
+    json_object_dotset_number(root_object, "RouteStats.StackCachedUnicasts",
+                              stats.stackCachedUnicasts);
+    json_object_dotset_number(root_object, "RouteStats.DiscoveredUnicasts",
+                              stats.discoveredUnicasts);
+    json_object_dotset_number(root_object, "RouteStats.FailedRoutes", stats.failedRoutes);
+
+    char *serialized_string = json_serialize_to_string_pretty(root_value);
+    AzureIoT_SendMessage(serialized_string);
+
+    json_free_serialized_string(serialized_string);
+    json_value_free(root_value);
+}
+
+/// <summary>
+///     Handle a frame received from the coordinator.
+/// </summary>
+static void CoordinatorFrameHandler(uint8_t type, uint8_t seq, const uint8_t *data,
+                                    size_t dataSize)
+{
+    switch (type) {
+    case CoordinatorLink_FrameType_CommandAck:
+        if (dataSize >= 3) {
+            CommandChannel_HandleAck((uint16_t)(data[1] | (data[2] << 8)), seq, data[0]);
+        }
+        break;
+    case CoordinatorLink_FrameType_SensorReport:
+        SensorReportHandler(data, dataSize);
+        break;
+    case CoordinatorLink_FrameType_LegacyReport:
+        FramedLegacyReportHandler(data, dataSize);
+        break;
+    case CoordinatorLink_FrameType_ReportBatch:
+        ReportBatchHandler(data, dataSize);
+        break;
+    case CoordinatorLink_FrameType_DeviceEntry:
+        DeviceEntryHandler(data, dataSize);
+        break;
+    case CoordinatorLink_FrameType_RouteStats:
+        RouteStatsHandler(data, dataSize);
+        break;
+    default:
+        Log_Debug("WARNING: Ignoring coordinator frame of unknown type 0x%02x.\n", type);
+        break;
+    }
+}
+
+//Uart Shijiong
+/// <summary>
+///     Handle UART event: write the queued frames the UART accepts, and feed the incoming data
+///     to the coordinator link decoder.
+/// </summary>
+static void UARTEventHandler(event_data_t *eventData)
+{
+    const size_t receiveBufferSize = 64;
+    uint8_t receiveBuffer[receiveBufferSize];
+    ssize_t bytesRead;
+
+    if (UartTxQueue_Drain() != 0) {
+        terminationRequired = true;
+        return;
+    }
+
+    // Read UART message
+    bytesRead = read(uartFd, receiveBuffer, receiveBufferSize);
+    if (bytesRead < 0) {
+        if (errno == EAGAIN) {
+            return;
+        }
+        Log_Debug("ERROR: Could not read UART: %s (%d).\n", strerror(errno), errno);
+        terminationRequired = true;
+        return;
+    }
+
+    CoordinatorLink_ProcessBytes(&coordinatorLinkDecoder, receiveBuffer, (size_t)bytesRead);
+}
+
+/// <summary>
+///     Parses a device command request and queues the command for the end device.
+/// </summary>
+/// <param name="payload">The JSON request, e.g. '{"device":1234,"command":"reportNow"}'; it
+/// does not need to be null terminated.</param>
+/// <param name="payloadSize">The size of the request</param>
+/// <param name="outSeq">The sequence number of the queued command</param>
+/// <returns>200 if the command was queued, 400 if the request is malformed, 503 if the
+/// command queue is full.</returns>
+static int QueueDeviceCommand(const char *payload, size_t payloadSize, int *outSeq)
+{
+    int result = 400;
+    char *request = malloc(payloadSize + 1);
+    if (request == NULL) {
+        Log_Debug("ERROR: Could not allocate buffer for device command request.\n");
+        abort();
+    }
+    memcpy(request, payload, payloadSize);
+    request[payloadSize] = 0;
+
+    JSON_Value *requestJson = json_parse_string(request);
+    JSON_Object *requestObject = json_value_get_object(requestJson);
+    if (requestObject == NULL) {
+        goto cleanup;
+    }
+
+    JSON_Value *deviceJson = json_object_get_value(requestObject, "device");
+    const char *commandName = json_object_get_string(requestObject, "command");
+    if ((json_value_get_type(deviceJson) != JSONNumber) || (commandName == NULL)) {
+        goto cleanup;
+    }
+    double device = json_value_get_number(deviceJson);
+    if ((device < 0) || (device > 0xFFFF)) {
+        goto cleanup;
+    }
+
+    const DeviceCommand *command = NULL;
+    for (size_t i = 0; i < deviceCommandsCount; i++) {
+        if (strcmp(deviceCommands[i].name, commandName) == 0) {
+            command = &deviceCommands[i];
+            break;
+        }
+    }
+    if (command == NULL) {
+        goto cleanup;
+    }
+
+    uint8_t args[3];
+    size_t argsSize = 0;
+    if (command->hasChannel) {
+        // Sent as the sensor frame TLV type of the channel.
+        const char *channelName = json_object_get_string(requestObject, "channel");
+        if (channelName == NULL) {
+            goto cleanup;
+        }
+        size_t channel;
+        for (channel = 0; channel < SensorCalibration_Channel_Count; channel++) {
+            if (strcmp(channelName, SensorCalibration_GetChannelName(
+                                        (SensorCalibration_Channel)channel)) == 0) {
+                break;
+            }
+        }
+        if (channel == SensorCalibration_Channel_Count) {
+            goto cleanup;
+        }
+        args[argsSize++] = (uint8_t)calibratedValues[channel];
+    }
+    if (command->hasValue) {
+        JSON_Value *valueJson = json_object_get_value(requestObject, "value");
+        if (json_value_get_type(valueJson) != JSONNumber) {
+            goto cleanup;
+        }
+        double value = json_value_get_number(valueJson);
+        if ((value < 0) || (value > 0xFFFF)) {
+            goto cleanup;
+        }
+        args[argsSize++] = (uint8_t)((uint16_t)value & 0xFF);
+        args[argsSize++] = (uint8_t)((uint16_t)value >> 8);
+    }
+
+    *outSeq = CommandChannel_Enqueue((uint16_t)device, command->commandId, args, argsSize);
+    if (*outSeq < 0) {
+        result = 503;
+        goto cleanup;
+    }
+
+    Log_Debug("INFO: Queued command '%s' for device 0x%04x as #%d.\n", commandName,
+              (unsigned int)device, *outSeq);
+    CommandChannel_DoPeriodicTasks();
+    result = 200;
+
+cleanup:
+    json_value_free(requestJson);
+    free(request);
+    return result;
+}
+
+/// <summary>
+///     Command completion callback: reports the outcome of a device command to the IoT Hub.
+/// </summary>
+static void DeviceCommandCompleted(uint8_t seq, uint16_t nwkAddr, int status,
+                                   uint32_t latencyMs)
+{
+    if (!connectedToIoTHub) {
+        return;
+    }
+
+    JSON_Value *rootValue = json_value_init_object();
+    JSON_Object *rootObject = json_value_get_object(rootValue);
+    json_object_set_number(rootObject, "CommandSeq", seq);
+    json_object_set_number(rootObject, "Device", nwkAddr);
+    json_object_set_boolean(rootObject, "Delivered", status == 0);
+    json_object_set_number(rootObject, "Status", status);
+    json_object_set_number(rootObject, "LatencyMs", latencyMs);
+
+    char *serializedString = json_serialize_to_string(rootValue);
+    if (serializedString != NULL) {
+        AzureIoT_SendMessage(serializedString);
+        json_free_serialized_string(serializedString);
+    }
+    json_value_free(rootValue);
 }
 
 /// <summary>
@@ -302,6 +670,13 @@ static void MessageReceived(const char *payload)
 {
     // Set the send/receive LED2 to blink once immediately to indicate a message has been received.
     BlinkLed2Once();
+
+    int seq;
+    int result = QueueDeviceCommand(payload, strlen(payload), &seq);
+    if (result != 200) {
+        Log_Debug("WARNING: Cloud-to-device message is not a valid device command (%d).\n",
+                  result);
+    }
 }
 
 /// <summary>
@@ -336,6 +711,43 @@ static void DeviceTwinUpdate(JSON_Object *desiredProperties)
         blinkingLedPeriod = blinkIntervals[blinkIntervalIndex];
         SetLedRate(&blinkIntervals[blinkIntervalIndex]);
     }
+
+    JSON_Value *compressionJson =
+        json_object_get_value(desiredProperties, "PayloadCompressionProperty");
+    if (compressionJson == NULL) {
+        // The property is optional; compression stays in its current state.
+    } else if (json_value_get_type(compressionJson) != JSONNumber) {
+        Log_Debug(
+            "INFO: Device twin desired property \"PayloadCompressionProperty\" was received with "
+            "incorrect type; it must be 0 or 1.\n");
+    } else {
+        bool enableCompression = json_value_get_number(compressionJson) != 0;
+        PayloadCompression_SetEnabled(enableCompression);
+        Log_Debug("INFO: Payload compression %s.\n", enableCompression ? "enabled" : "disabled");
+
+        if (connectedToIoTHub) {
+            AzureIoT_TwinReportState("PayloadCompressionProperty", enableCompression ? 1 : 0);
+        }
+    }
+
+    JSON_Value *calibrationJson = json_object_get_value(desiredProperties, "SensorCalibration");
+    if (calibrationJson == NULL) {
+        // The property is optional; the current calibration tables are kept.
+    } else if (json_value_get_type(calibrationJson) != JSONObject) {
+        Log_Debug(
+            "INFO: Device twin desired property \"SensorCalibration\" was received with "
+            "incorrect type; it must be an object.\n");
+    } else {
+        int tableCount = SensorCalibration_LoadFromJson(json_value_get_object(calibrationJson));
+        if (tableCount < 0) {
+            Log_Debug("INFO: Ignoring invalid sensor calibration; keeping the previous one.\n");
+        } else {
+            Log_Debug("INFO: Loaded %d sensor calibration tables.\n", tableCount);
+            if (connectedToIoTHub) {
+                AzureIoT_TwinReportState("SensorCalibrationTables", (size_t)tableCount);
+            }
+        }
+    }
 }
 
 /// <summary>
@@ -380,6 +792,22 @@ static int DirectMethodCall(const char *methodName, const char *payload, size_t
 
     int result = 404; // HTTP status code.
 
+    if (strcmp(methodName, "DeviceCommandMethod") == 0) {
+        int seq = -1;
+        result = QueueDeviceCommand(payload, payloadSize, &seq);
+
+        static const char commandQueuedResponse[] = "{ \"success\" : %s, \"seq\" : %d }";
+        size_t responseMaxLength = sizeof(commandQueuedResponse) + 16;
+        *responsePayload = SetupHeapMessage(commandQueuedResponse, responseMaxLength,
+                                            (result == 200) ? "true" : "false", seq);
+        if (*responsePayload == NULL) {
+            Log_Debug("ERROR: Could not allocate buffer for direct method response payload.\n");
+            abort();
+        }
+        *responsePayloadSize = strlen(*responsePayload);
+        return result;
+    }
+
     if (strcmp(methodName, "LedColorControlMethod") != 0) {
         result = 404;
         Log_Debug("INFO: Method not found called: '%s'.\n", methodName);
@@ -553,6 +981,19 @@ static void ButtonsHandler(event_data_t *eventData)
     }
 }
 
+/// <summary>
+///     Send queued device commands and handle overdue acknowledgements.
+/// </summary>
+static void CommandChannelTimerHandler(event_data_t *eventData)
+{
+    if (ConsumeTimerFdEvent(commandChannelTimerFd) != 0) {
+        terminationRequired = true;
+        return;
+    }
+
+    CommandChannel_DoPeriodicTasks();
+}
+
 /// <summary>
 ///     Hand over control periodically to the Azure IoT SDK's DoWork.
 /// </summary>
@@ -578,6 +1019,8 @@ static event_data_t buttonsEventData = {.eventHandler = &ButtonsHandler};
 static event_data_t led1EventData = {.eventHandler = &Led1UpdateHandler};
 static event_data_t led2EventData = {.eventHandler = &Led2UpdateHandler};
 static event_data_t azureIotEventData = {.eventHandler = &AzureIotDoWorkHandler};
+static event_data_t uartEventData = {.eventHandler = &UARTEventHandler};
+static event_data_t commandChannelEventData = {.eventHandler = &CommandChannelTimerHandler};
 
 /// <summary>
 ///     Initialize peripherals, termination handler, and Azure IoT
@@ -602,6 +1045,11 @@ static int InitPeripheralsAndHandlers(void)
 		Log_Debug("ERROR: Could not open UART: %s (%d).\n", strerror(errno), errno);
 		return -1;
 	}
+	SensorCalibration_Init();
+	CoordinatorLink_InitDecoder(&coordinatorLinkDecoder, &CoordinatorFrameHandler,
+	                            &LegacyReportHandler);
+	CommandChannel_Init(&WriteCoordinatorLink, &GetCoordinatorLinkProgress,
+	                    &DeviceCommandCompleted);
 
     // Open button A
     Log_Debug("INFO: Opening MT3620_RDB_BUTTON_A.\n");
@@ -668,6 +1116,23 @@ static int InitPeripheralsAndHandlers(void)
         return -1;
     }
 
+    // Receive data from the coordinator as it arrives.
+    if (RegisterEventHandlerToEpoll(epollFd, uartFd, &uartEventData, EPOLLIN) != 0) {
+        return -1;
+    }
+    // Frames for the coordinator are queued and written as the UART drains; the command
+    // channel retries frames the full queue refuses.
+    UartTxQueue_Init(uartFd, epollFd, &uartEventData, EPOLLIN,
+                     UartTxQueue_OverflowPolicy_Reject);
+
+    // Set up a timer for sending device commands and retransmitting unacknowledged ones.
+    static struct timespec commandChannelPeriod = {0, 100 * 1000 * 1000};
+    commandChannelTimerFd = CreateTimerFdAndAddToEpoll(epollFd, &commandChannelPeriod,
+                                                       &commandChannelEventData, EPOLLIN);
+    if (commandChannelTimerFd < 0) {
+        return -1;
+    }
+
     return 0;
 }
 
@@ -683,11 +1148,24 @@ static void ClosePeripheralsAndHandlers(void)
     CloseFdAndPrintError(gpioSendMessageButtonFd, "SendMessageButton");
     CloseFdAndPrintError(gpioButtonsManagementTimerFd, "ButtonsManagementTimer");
     CloseFdAndPrintError(azureIotDoWorkTimerFd, "IotDoWorkTimer");
+    CloseFdAndPrintError(commandChannelTimerFd, "CommandChannelTimer");
     CloseFdAndPrintError(gpioLed1TimerFd, "Led1Timer");
     CloseFdAndPrintError(gpioLed2TimerFd, "Led2Timer");
     CloseFdAndPrintError(epollFd, "Epoll");
 
 	//Uart shijiong
+	const UartTxQueue_Statistics *txStatistics = UartTxQueue_GetStatistics();
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	double elapsedSeconds = (double)(now.tv_sec - txStatistics->startTime.tv_sec) +
+	                        (double)(now.tv_nsec - txStatistics->startTime.tv_nsec) / 1e9;
+	Log_Debug("INFO: UART sent %llu bytes in %u writes (%u partial), %.1f bytes/s; %u frames "
+	          "queued, %u rejected, %u dropped, max depth %zu.\n",
+	          (unsigned long long)txStatistics->bytesWritten, txStatistics->writeCalls,
+	          txStatistics->partialWrites,
+	          (elapsedSeconds > 0) ? (double)txStatistics->bytesWritten / elapsedSeconds : 0.0,
+	          txStatistics->framesQueued, txStatistics->framesRejected,
+	          txStatistics->framesDropped, txStatistics->maxDepth);
 	CloseFdAndPrintError(uartFd, "Uart");
 
     // Close the LEDs and leave then off
@@ -714,8 +1192,6 @@ int main(int argc, char *argv[])
         if (WaitForEventAndCallHandler(epollFd) != 0) {
             terminationRequired = true;
         }
-		//uart shijiong
-		UARTEventHandler();
     }
 
     ClosePeripheralsAndHandlers();
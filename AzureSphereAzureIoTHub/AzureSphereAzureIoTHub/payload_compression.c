@@ -0,0 +1,183 @@
+#include <string.h>
+#include "payload_compression.h"
+
+// The compressor emits the LZ4 block format (see lz4_Block_format.md in the LZ4 distribution),
+// so cloud consumers can decode the payload with any stock LZ4 library.
+
+#define HASH_LOG 12
+#define HASH_TABLE_SIZE (1 << HASH_LOG)
+#define MIN_MATCH 4
+#define MAX_OFFSET 0xFFFF
+#define LAST_LITERALS 5  // The last 5 bytes of a block are always literals.
+#define MATCH_FIND_LIMIT 12 // The last match must start at least 12 bytes before the end.
+#define RUN_MASK 15
+
+static bool compressionEnabled = false;
+static size_t minimumPayloadSize = PAYLOAD_COMPRESSION_DEFAULT_MIN_SIZE;
+
+/// <summary>
+///     Positions of the most recent occurrence of each hashed 4-byte sequence. This is the only
+///     working memory of the compressor (8 KiB).
+/// </summary>
+static uint16_t hashTable[HASH_TABLE_SIZE];
+
+void PayloadCompression_SetEnabled(bool enabled)
+{
+    compressionEnabled = enabled;
+}
+
+bool PayloadCompression_IsEnabled(void)
+{
+    return compressionEnabled;
+}
+
+void PayloadCompression_SetMinPayloadSize(size_t minPayloadSize)
+{
+    minimumPayloadSize = minPayloadSize;
+}
+
+bool PayloadCompression_ShouldCompress(size_t payloadSize)
+{
+    return compressionEnabled && (payloadSize >= minimumPayloadSize) &&
+           (payloadSize > MATCH_FIND_LIMIT) && (payloadSize <= PAYLOAD_COMPRESSION_MAX_INPUT_SIZE);
+}
+
+size_t PayloadCompression_GetMaxCompressedSize(size_t inputSize)
+{
+    return inputSize + (inputSize / 255) + 16;
+}
+
+size_t PayloadCompression_GetWorkingMemorySize(void)
+{
+    return sizeof(hashTable);
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t HashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+/// <summary>
+///     Writes the 255-byte continuation of a literal or match length field.
+/// </summary>
+/// <returns>The new output position, or 0 if the output buffer is too small.</returns>
+static size_t WriteLengthExtension(uint8_t *output, size_t op, size_t outputCapacity,
+                                   size_t length)
+{
+    while (length >= 255) {
+        if (op >= outputCapacity) {
+            return 0;
+        }
+        output[op++] = 255;
+        length -= 255;
+    }
+    if (op >= outputCapacity) {
+        return 0;
+    }
+    output[op++] = (uint8_t)length;
+    return op;
+}
+
+/// <summary>
+///     Writes one sequence: a token, the literals, and, when matchLength is not 0, the match
+///     offset and length.
+/// </summary>
+/// <returns>The new output position, or 0 if the output buffer is too small.</returns>
+static size_t WriteSequence(uint8_t *output, size_t op, size_t outputCapacity,
+                            const uint8_t *literals, size_t literalLength, size_t offset,
+                            size_t matchLength)
+{
+    size_t matchCode = (matchLength != 0) ? (matchLength - MIN_MATCH) : 0;
+
+    if (op >= outputCapacity) {
+        return 0;
+    }
+    size_t tokenOp = op++;
+    output[tokenOp] = (uint8_t)(((literalLength < RUN_MASK) ? literalLength : RUN_MASK) << 4);
+    if (literalLength >= RUN_MASK) {
+        op = WriteLengthExtension(output, op, outputCapacity, literalLength - RUN_MASK);
+        if (op == 0) {
+            return 0;
+        }
+    }
+
+    if (op + literalLength > outputCapacity) {
+        return 0;
+    }
+    memcpy(output + op, literals, literalLength);
+    op += literalLength;
+
+    if (matchLength == 0) {
+        return op;
+    }
+
+    if (op + 2 > outputCapacity) {
+        return 0;
+    }
+    output[op++] = (uint8_t)(offset & 0xFF);
+    output[op++] = (uint8_t)(offset >> 8);
+
+    output[tokenOp] |= (uint8_t)((matchCode < RUN_MASK) ? matchCode : RUN_MASK);
+    if (matchCode >= RUN_MASK) {
+        op = WriteLengthExtension(output, op, outputCapacity, matchCode - RUN_MASK);
+    }
+    return op;
+}
+
+size_t PayloadCompression_Compress(const uint8_t *input, size_t inputSize, uint8_t *output,
+                                   size_t outputCapacity)
+{
+    if ((inputSize <= MATCH_FIND_LIMIT) || (inputSize > PAYLOAD_COMPRESSION_MAX_INPUT_SIZE)) {
+        return 0;
+    }
+
+    memset(hashTable, 0, sizeof(hashTable));
+
+    const size_t matchFindLimit = inputSize - MATCH_FIND_LIMIT;
+    const size_t matchEndLimit = inputSize - LAST_LITERALS;
+    size_t anchor = 0;
+    size_t ip = 1;
+    size_t op = 0;
+
+    while (ip < matchFindLimit) {
+        uint32_t sequence = Read32(input + ip);
+        uint32_t hash = HashSequence(sequence);
+        size_t candidate = hashTable[hash];
+        hashTable[hash] = (uint16_t)ip;
+
+        if ((ip - candidate > MAX_OFFSET) || (Read32(input + candidate) != sequence)) {
+            ip++;
+            continue;
+        }
+
+        size_t matchLength = MIN_MATCH;
+        while ((ip + matchLength < matchEndLimit) &&
+               (input[candidate + matchLength] == input[ip + matchLength])) {
+            matchLength++;
+        }
+
+        op = WriteSequence(output, op, outputCapacity, input + anchor, ip - anchor,
+                           ip - candidate, matchLength);
+        if (op == 0) {
+            return 0;
+        }
+
+        ip += matchLength;
+        anchor = ip;
+    }
+
+    op = WriteSequence(output, op, outputCapacity, input + anchor, inputSize - anchor, 0, 0);
+    if ((op == 0) || (op >= inputSize)) {
+        // Overflowed the buffer, or not worth sending compressed.
+        return 0;
+    }
+
+    return op;
+}
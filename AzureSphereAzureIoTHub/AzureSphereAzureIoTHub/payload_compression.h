@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+///     Value of the 'content-encoding' system property set on compressed messages. The payload
+///     is a single raw LZ4 block; the uncompressed size is carried in the application property
+///     named by PAYLOAD_COMPRESSION_ORIGINAL_SIZE_PROPERTY.
+/// </summary>
+#define PAYLOAD_COMPRESSION_CONTENT_ENCODING "lz4"
+
+/// <summary>
+///     Name of the application property holding the uncompressed payload size in bytes.
+/// </summary>
+#define PAYLOAD_COMPRESSION_ORIGINAL_SIZE_PROPERTY "lz4-original-size"
+
+/// <summary>
+///     Payloads shorter than this are sent as they are, as the block overhead would outweigh
+///     any savings.
+/// </summary>
+#define PAYLOAD_COMPRESSION_DEFAULT_MIN_SIZE 256
+
+/// <summary>
+///     Largest payload that is compressed. Match offsets are 16 bits wide, so a single block
+///     never spans more than 64 KiB; larger payloads are sent uncompressed.
+/// </summary>
+#define PAYLOAD_COMPRESSION_MAX_INPUT_SIZE 0xFFFF
+
+/// <summary>
+///     Enables or disables payload compression at runtime. Compression is disabled by default.
+/// </summary>
+/// <param name="enabled">'true' to compress eligible payloads.</param>
+void PayloadCompression_SetEnabled(bool enabled);
+
+/// <summary>
+///     Returns whether payload compression is currently enabled.
+/// </summary>
+bool PayloadCompression_IsEnabled(void);
+
+/// <summary>
+///     Sets the minimum payload size, in bytes, for which compression is attempted.
+/// </summary>
+/// <param name="minPayloadSize">The threshold below which payloads are left as they are.</param>
+void PayloadCompression_SetMinPayloadSize(size_t minPayloadSize);
+
+/// <summary>
+///     Returns whether a payload of the given size should go through the compressor, based on
+///     the enabled state and the size thresholds.
+/// </summary>
+/// <param name="payloadSize">The size of the payload in bytes.</param>
+bool PayloadCompression_ShouldCompress(size_t payloadSize);
+
+/// <summary>
+///     Returns the worst case size of the compressed output for an input of the given size.
+/// </summary>
+/// <param name="inputSize">The size of the uncompressed input in bytes.</param>
+size_t PayloadCompression_GetMaxCompressedSize(size_t inputSize);
+
+/// <summary>
+///     Returns the size of the static working memory of the compressor, in bytes.
+/// </summary>
+size_t PayloadCompression_GetWorkingMemorySize(void);
+
+/// <summary>
+///     Compresses a payload into a single LZ4 block. Working memory is a fixed-size static hash
+///     table, so memory use does not depend on the payload size.
+/// </summary>
+/// <param name="input">The payload to compress.</param>
+/// <param name="inputSize">The size of the payload in bytes.</param>
+/// <param name="output">The buffer receiving the compressed block.</param>
+/// <param name="outputCapacity">The size of the output buffer in bytes.</param>
+/// <returns>The size of the compressed block, or 0 if the payload could not be made smaller or
+/// the block would not fit in the output buffer.</returns>
+size_t PayloadCompression_Compress(const uint8_t *input, size_t inputSize, uint8_t *output,
+                                   size_t outputCapacity);
@@ -0,0 +1,18 @@
+#include "provisioning_backoff.h"
+
+uint32_t ProvisioningBackoff_GetDelayMs(unsigned int baseSeconds, unsigned int failureCount,
+                                        uint32_t random)
+{
+    uint32_t delaySeconds = baseSeconds;
+    for (unsigned int i = 0;
+         (i < failureCount) && (delaySeconds < PROVISIONING_BACKOFF_MAX_DELAY_SECONDS); i++) {
+        delaySeconds *= 2;
+    }
+    if (delaySeconds > PROVISIONING_BACKOFF_MAX_DELAY_SECONDS) {
+        delaySeconds = PROVISIONING_BACKOFF_MAX_DELAY_SECONDS;
+    }
+
+    // Pick a uniformly distributed delay in [delay/2, delay], with millisecond granularity.
+    uint32_t delayMs = delaySeconds * 500u;
+    return delayMs + random % (delayMs + 1);
+}
@@ -0,0 +1,33 @@
+/// \file provisioning_backoff.h
+/// \brief Retry delays of the provisioning of the device with the IoT hub.
+///
+/// Failed provisioning attempts are retried with exponential backoff and full jitter over the
+/// upper half of the delay, so that a fleet of devices recovering from the same outage spreads
+/// its retries instead of hitting the Device Provisioning Service in lockstep. Waiting for the
+/// network is not a provisioning failure: it is retried after a short fixed delay, whatever the
+/// number of earlier failures.
+#pragma once
+
+#include <stdint.h>
+
+/// <summary>
+///     Longest delay between two provisioning attempts, before jitter.
+/// </summary>
+#define PROVISIONING_BACKOFF_MAX_DELAY_SECONDS 1800
+
+/// <summary>
+///     Delay before checking again whether the network is ready.
+/// </summary>
+#define PROVISIONING_BACKOFF_NETWORK_RETRY_MS 1000
+
+/// <summary>
+///     Returns the delay before the next provisioning attempt after a failure: the base delay,
+///     doubled for each earlier consecutive failure up to PROVISIONING_BACKOFF_MAX_DELAY_SECONDS,
+///     then scaled to a point of [delay/2, delay] picked by the random value.
+/// </summary>
+/// <param name="baseSeconds">The delay after the first failure</param>
+/// <param name="failureCount">The number of consecutive failures before this one</param>
+/// <param name="random">A uniformly distributed random value</param>
+/// <returns>The delay in milliseconds.</returns>
+uint32_t ProvisioningBackoff_GetDelayMs(unsigned int baseSeconds, unsigned int failureCount,
+                                        uint32_t random);
@@ -0,0 +1,279 @@
+#include <stdlib.h>
+#include <string.h>
+#include <applibs/log.h>
+#include "sensor_calibration.h"
+
+// Slopes are kept in Q16.16 calibrated units per raw unit.
+#define SLOPE_SHIFT 16
+#define MAX_SLOPE ((int64_t)INT32_MAX)
+
+/// <summary>
+///     A calibration table. pointCount is 0 when the table is not set.
+/// </summary>
+typedef struct {
+    size_t pointCount;
+    int32_t raw[SENSOR_CALIBRATION_MAX_POINTS];
+    int32_t value[SENSOR_CALIBRATION_MAX_POINTS];
+    int32_t slope[SENSOR_CALIBRATION_MAX_POINTS - 1];
+} Table;
+
+typedef struct {
+    bool inUse;
+    uint32_t id;
+    Table tables[SensorCalibration_Channel_Count];
+} DeviceTables;
+
+typedef struct {
+    Table defaults[SensorCalibration_Channel_Count];
+    DeviceTables devices[SENSOR_CALIBRATION_MAX_DEVICES];
+} CalibrationTables;
+
+static CalibrationTables calibration;
+
+// Tables being loaded from the device twin; they replace the active ones once all are valid.
+static CalibrationTables staging;
+
+static const char *channelNames[SensorCalibration_Channel_Count] = {"Temperature", "Humidity",
+                                                                   "Light", "Gas"};
+
+static Table *FindTable(CalibrationTables *tables, bool isDefault, uint32_t id,
+                        SensorCalibration_Channel channel, bool allocate)
+{
+    if (isDefault) {
+        return &tables->defaults[channel];
+    }
+
+    DeviceTables *freeSlot = NULL;
+    for (size_t i = 0; i < SENSOR_CALIBRATION_MAX_DEVICES; i++) {
+        if (tables->devices[i].inUse) {
+            if (tables->devices[i].id == id) {
+                return &tables->devices[i].tables[channel];
+            }
+        } else if (freeSlot == NULL) {
+            freeSlot = &tables->devices[i];
+        }
+    }
+
+    if (!allocate || (freeSlot == NULL)) {
+        return NULL;
+    }
+    memset(freeSlot, 0, sizeof(*freeSlot));
+    freeSlot->inUse = true;
+    freeSlot->id = id;
+    return &freeSlot->tables[channel];
+}
+
+static bool SetTable(CalibrationTables *tables, bool isDefault, uint32_t id,
+                     SensorCalibration_Channel channel, const SensorCalibration_Point *points,
+                     size_t pointCount)
+{
+    if ((channel >= SensorCalibration_Channel_Count) || (pointCount == 0) ||
+        (pointCount > SENSOR_CALIBRATION_MAX_POINTS)) {
+        return false;
+    }
+
+    // Validate before touching the table, so that a bad table leaves the previous one in place.
+    int32_t slopes[SENSOR_CALIBRATION_MAX_POINTS - 1];
+    for (size_t i = 1; i < pointCount; i++) {
+        if (points[i].raw <= points[i - 1].raw) {
+            return false;
+        }
+        int64_t slope = (((int64_t)points[i].value - points[i - 1].value) * (1 << SLOPE_SHIFT)) /
+                        ((int64_t)points[i].raw - points[i - 1].raw);
+        if ((slope > MAX_SLOPE) || (slope < -MAX_SLOPE)) {
+            return false;
+        }
+        slopes[i - 1] = (int32_t)slope;
+    }
+
+    Table *table = FindTable(tables, isDefault, id, channel, true);
+    if (table == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < pointCount; i++) {
+        table->raw[i] = points[i].raw;
+        table->value[i] = points[i].value;
+        if (i > 0) {
+            table->slope[i - 1] = slopes[i - 1];
+        }
+    }
+    table->pointCount = pointCount;
+    return true;
+}
+
+/// <summary>
+///     Clamps a calibrated value to the range of the result; raw readings come from 4-byte TLVs,
+///     so any of them may be scaled out of range.
+/// </summary>
+static int32_t Saturate(int64_t value)
+{
+    if (value > INT32_MAX) {
+        return INT32_MAX;
+    }
+    if (value < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (int32_t)value;
+}
+
+/// <summary>
+///     Evaluates a table at a raw reading given in 1/rawDivisor of the unit of its raw readings.
+/// </summary>
+static int32_t Interpolate(const Table *table, int32_t raw, int32_t rawDivisor)
+{
+    if (table->pointCount == 1) {
+        // A single point is an offset.
+        return Saturate(table->value[0] +
+                        ((int64_t)raw - (int64_t)table->raw[0] * rawDivisor) *
+                            SENSOR_CALIBRATION_SCALE / rawDivisor);
+    }
+
+    // Segment containing raw; the first and last segments extend beyond the table.
+    size_t segment = 0;
+    while ((segment + 2 < table->pointCount) &&
+           (raw > (int64_t)table->raw[segment + 1] * rawDivisor)) {
+        segment++;
+    }
+
+    // The whole raw units and the fraction separately, so that the product stays in range.
+    int64_t delta = (int64_t)raw - (int64_t)table->raw[segment] * rawDivisor;
+    int64_t offset = (delta / rawDivisor) * table->slope[segment] +
+                     (delta % rawDivisor) * table->slope[segment] / rawDivisor;
+    return Saturate(table->value[segment] + ((offset + (1 << (SLOPE_SHIFT - 1))) >> SLOPE_SHIFT));
+}
+
+static int32_t Apply(uint32_t id, SensorCalibration_Channel channel, int32_t raw,
+                     int32_t rawDivisor)
+{
+    if (channel >= SensorCalibration_Channel_Count) {
+        return Saturate((int64_t)raw * SENSOR_CALIBRATION_SCALE / rawDivisor);
+    }
+
+    const Table *table = FindTable(&calibration, false, id, channel, false);
+    if ((table == NULL) || (table->pointCount == 0)) {
+        table = &calibration.defaults[channel];
+    }
+    if (table->pointCount == 0) {
+        return Saturate((int64_t)raw * SENSOR_CALIBRATION_SCALE / rawDivisor);
+    }
+    return Interpolate(table, raw, rawDivisor);
+}
+
+void SensorCalibration_Init(void)
+{
+    memset(&calibration, 0, sizeof(calibration));
+}
+
+bool SensorCalibration_SetTable(bool isDefault, uint32_t id, SensorCalibration_Channel channel,
+                                const SensorCalibration_Point *points, size_t pointCount)
+{
+    return SetTable(&calibration, isDefault, id, channel, points, pointCount);
+}
+
+/// <summary>
+///     Converts a calibrated value from the device twin to fixed point.
+/// </summary>
+static bool ToFixedPoint(double value, int32_t *fixedPoint)
+{
+    double scaled = value * SENSOR_CALIBRATION_SCALE;
+    if ((scaled > (double)INT32_MAX) || (scaled < (double)INT32_MIN)) {
+        return false;
+    }
+    *fixedPoint = (int32_t)((scaled < 0) ? (scaled - 0.5) : (scaled + 0.5));
+    return true;
+}
+
+static bool LoadChannelTable(bool isDefault, uint32_t id,
+                             SensorCalibration_Channel channel, const JSON_Array *pointsJson)
+{
+    SensorCalibration_Point points[SENSOR_CALIBRATION_MAX_POINTS];
+    size_t pointCount = json_array_get_count(pointsJson);
+    if ((pointCount == 0) || (pointCount > SENSOR_CALIBRATION_MAX_POINTS)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < pointCount; i++) {
+        const JSON_Array *pointJson = json_array_get_array(pointsJson, i);
+        if ((pointJson == NULL) || (json_array_get_count(pointJson) != 2) ||
+            (json_value_get_type(json_array_get_value(pointJson, 0)) != JSONNumber) ||
+            (json_value_get_type(json_array_get_value(pointJson, 1)) != JSONNumber)) {
+            return false;
+        }
+        double raw = json_array_get_number(pointJson, 0);
+        if ((raw > (double)INT32_MAX) || (raw < (double)INT32_MIN)) {
+            return false;
+        }
+        points[i].raw = (int32_t)raw;
+        if (!ToFixedPoint(json_array_get_number(pointJson, 1), &points[i].value)) {
+            return false;
+        }
+    }
+
+    return SetTable(&staging, isDefault, id, channel, points, pointCount);
+}
+
+int SensorCalibration_LoadFromJson(const JSON_Object *calibrationJson)
+{
+    int tableCount = 0;
+    memset(&staging, 0, sizeof(staging));
+
+    for (size_t i = 0; i < json_object_get_count(calibrationJson); i++) {
+        const char *key = json_object_get_name(calibrationJson, i);
+        const JSON_Object *channelsJson =
+            json_value_get_object(json_object_get_value_at(calibrationJson, i));
+        bool isDefault = (strcmp(key, "default") == 0);
+        uint32_t id = 0;
+
+        if (!isDefault) {
+            const size_t prefixLength = strlen(SENSOR_CALIBRATION_INDEX_KEY_PREFIX);
+            bool isIndex = (strncmp(key, SENSOR_CALIBRATION_INDEX_KEY_PREFIX, prefixLength) == 0);
+            const char *number = isIndex ? key + prefixLength : key;
+            char *end;
+            unsigned long value = strtoul(number, &end, 10);
+            if ((*number < '0') || (*number > '9') || (*end != '\0') ||
+                (value > (isIndex ? UINT8_MAX - 1 : UINT16_MAX))) {
+                Log_Debug("WARNING: Calibration for unknown device \"%s\".\n", key);
+                return -1;
+            }
+            id = isIndex ? SENSOR_CALIBRATION_INDEX_ID(value) : (uint32_t)value;
+        }
+        if (channelsJson == NULL) {
+            Log_Debug("WARNING: Calibration for device \"%s\" is not an object.\n", key);
+            return -1;
+        }
+
+        for (size_t channel = 0; channel < SensorCalibration_Channel_Count; channel++) {
+            const JSON_Value *pointsJson =
+                json_object_get_value(channelsJson, channelNames[channel]);
+            if (pointsJson == NULL) {
+                continue;
+            }
+            if (!LoadChannelTable(isDefault, id, (SensorCalibration_Channel)channel,
+                                  json_value_get_array(pointsJson))) {
+                Log_Debug("WARNING: Invalid %s calibration for device \"%s\".\n",
+                          channelNames[channel], key);
+                return -1;
+            }
+            tableCount++;
+        }
+    }
+
+    calibration = staging;
+    return tableCount;
+}
+
+int32_t SensorCalibration_Apply(uint32_t id, SensorCalibration_Channel channel, int32_t raw)
+{
+    return Apply(id, channel, raw, 1);
+}
+
+int32_t SensorCalibration_ApplyCenti(uint32_t id, SensorCalibration_Channel channel,
+                                     int32_t rawCenti)
+{
+    return Apply(id, channel, rawCenti, 100);
+}
+
+const char *SensorCalibration_GetChannelName(SensorCalibration_Channel channel)
+{
+    return (channel < SensorCalibration_Channel_Count) ? channelNames[channel] : "Unknown";
+}
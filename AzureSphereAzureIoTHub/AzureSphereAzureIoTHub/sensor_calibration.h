@@ -0,0 +1,118 @@
+/// \file sensor_calibration.h
+/// \brief Per-device, per-channel calibration of the raw sensor readings reported by the
+/// ZigBee end devices.
+///
+/// Each table is a piecewise-linear curve through up to SENSOR_CALIBRATION_MAX_POINTS points
+/// (raw reading, calibrated value), evaluated in fixed-point arithmetic. Readings outside the
+/// table are extrapolated from the first or last segment. Calibrated values are integers in
+/// 1/SENSOR_CALIBRATION_SCALE of the channel's unit. A device without a table of its own uses
+/// the default table of the channel, if any; otherwise the reading is passed through unchanged.
+///
+/// Devices are identified either by the device id of their reports or by the index the
+/// coordinator's directory gives them. The two are distinct ids here, and distinct keys in the
+/// device twin, so that the table of one device is never applied to another whose index
+/// happens to equal its device id.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "parson.h"
+
+#define SENSOR_CALIBRATION_MAX_DEVICES 16
+#define SENSOR_CALIBRATION_MAX_POINTS 8
+#define SENSOR_CALIBRATION_SCALE 1000
+
+/// <summary>
+///     The calibration id of the device with a coordinator directory index. Device ids of the
+///     reports are their own calibration ids, from 0 to UINT16_MAX.
+/// </summary>
+#define SENSOR_CALIBRATION_INDEX_ID(index) (0x10000u | (uint8_t)(index))
+
+/// <summary>
+///     The prefix of the device twin keys of the tables of directory indexes.
+/// </summary>
+#define SENSOR_CALIBRATION_INDEX_KEY_PREFIX "index:"
+
+/// <summary>
+///     The calibrated channels of a sensor report.
+/// </summary>
+typedef enum {
+    SensorCalibration_Channel_Temperature = 0,
+    SensorCalibration_Channel_Humidity,
+    SensorCalibration_Channel_Light,
+    SensorCalibration_Channel_Gas,
+    SensorCalibration_Channel_Count
+} SensorCalibration_Channel;
+
+/// <summary>
+///     A point of a calibration table.
+/// </summary>
+typedef struct {
+    /// <summary>The raw reading.</summary>
+    int32_t raw;
+    /// <summary>The calibrated value, in 1/SENSOR_CALIBRATION_SCALE units.</summary>
+    int32_t value;
+} SensorCalibration_Point;
+
+/// <summary>
+///     Removes all calibration tables.
+/// </summary>
+void SensorCalibration_Init(void);
+
+/// <summary>
+///     Sets the calibration table of a device, or the default table, for one channel.
+/// </summary>
+/// <param name="isDefault">'true' to set the table used by devices without one of their
+/// own</param>
+/// <param name="id">The calibration id of the device: its device id or
+/// SENSOR_CALIBRATION_INDEX_ID; ignored when isDefault is 'true'</param>
+/// <param name="channel">The channel</param>
+/// <param name="points">The points, sorted by strictly increasing raw reading</param>
+/// <param name="pointCount">The number of points, 1 to SENSOR_CALIBRATION_MAX_POINTS; a
+/// single point defines an offset</param>
+/// <returns>'true' on success, 'false' if the points are invalid or the table of devices is
+/// full.</returns>
+bool SensorCalibration_SetTable(bool isDefault, uint32_t id,
+                                SensorCalibration_Channel channel,
+                                const SensorCalibration_Point *points, size_t pointCount);
+
+/// <summary>
+///     Replaces all calibration tables with the ones described by a device twin property:
+///     '{ "default": { "Light": [[0, 0], [255, 1000.5]] }, "3": { "Gas": [[0, 0], [99, 50]] },
+///     "index:0": { "Temperature": [[0, -500]] } }'. Keys are "default", a device id, or
+///     SENSOR_CALIBRATION_INDEX_KEY_PREFIX and a directory index; channel names are those of
+///     SensorCalibration_GetChannelName; each point is [raw reading, calibrated value].
+/// </summary>
+/// <param name="calibration">The property value</param>
+/// <returns>The number of tables loaded, or -1 if the property is malformed, in which case the
+/// previous tables are kept.</returns>
+int SensorCalibration_LoadFromJson(const JSON_Object *calibration);
+
+/// <summary>
+///     Calibrates a raw reading.
+/// </summary>
+/// <param name="id">The calibration id of the reporting device: SENSOR_CALIBRATION_INDEX_ID of
+/// its directory index when the coordinator knows it, or else its device id</param>
+/// <param name="channel">The channel of the reading</param>
+/// <param name="raw">The raw reading</param>
+/// <returns>The calibrated value, in 1/SENSOR_CALIBRATION_SCALE units.</returns>
+int32_t SensorCalibration_Apply(uint32_t id, SensorCalibration_Channel channel, int32_t raw);
+
+/// <summary>
+///     Calibrates a raw reading given in hundredths of the unit of the table's raw readings, as
+///     the temperature and humidity of ZCL end devices are; the tables are the same as for
+///     SensorCalibration_Apply.
+/// </summary>
+/// <param name="id">The calibration id of the reporting device, as for
+/// SensorCalibration_Apply</param>
+/// <param name="channel">The channel of the reading</param>
+/// <param name="rawCenti">The raw reading, in hundredths</param>
+/// <returns>The calibrated value, in 1/SENSOR_CALIBRATION_SCALE units.</returns>
+int32_t SensorCalibration_ApplyCenti(uint32_t id, SensorCalibration_Channel channel,
+                                     int32_t rawCenti);
+
+/// <summary>
+///     Returns the name of a channel, as used in device twin properties and telemetry.
+/// </summary>
+const char *SensorCalibration_GetChannelName(SensorCalibration_Channel channel);
@@ -0,0 +1,125 @@
+#include <string.h>
+#include "sensor_frame.h"
+
+#define CRC16_POLYNOMIAL 0x1021
+#define CRC16_INIT 0xFFFF
+
+static uint16_t crcTable[256];
+static bool crcTableReady = false;
+
+static void BuildCrcTable(void)
+{
+    for (unsigned int byte = 0; byte < 256; byte++) {
+        uint16_t crc = (uint16_t)(byte << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ CRC16_POLYNOMIAL) : (uint16_t)(crc << 1);
+        }
+        crcTable[byte] = crc;
+    }
+    crcTableReady = true;
+}
+
+uint16_t SensorFrame_Crc16(const uint8_t *data, size_t size)
+{
+    if (!crcTableReady) {
+        BuildCrcTable();
+    }
+
+    uint16_t crc = CRC16_INIT;
+    for (size_t i = 0; i < size; i++) {
+        crc = (uint16_t)((crc << 8) ^ crcTable[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+static void SetValue(SensorFrame_Report *report, SensorFrame_Tlv type, int32_t value)
+{
+    report->values[type] = value;
+    report->present |= 1u << type;
+}
+
+bool SensorFrame_HasValue(const SensorFrame_Report *report, SensorFrame_Tlv type)
+{
+    return (type <= SensorFrame_Tlv_Max) && ((report->present & (1u << type)) != 0);
+}
+
+SensorFrame_Result SensorFrame_Decode(const uint8_t *frame, size_t frameSize,
+                                      SensorFrame_Report *report)
+{
+    if (frameSize < SENSOR_FRAME_HEADER_SIZE + SENSOR_FRAME_CRC_SIZE) {
+        return SensorFrame_Result_Truncated;
+    }
+    if (frame[0] != SENSOR_FRAME_VERSION) {
+        return SensorFrame_Result_UnknownVersion;
+    }
+
+    size_t end = frameSize - SENSOR_FRAME_CRC_SIZE;
+    uint16_t crc = (uint16_t)(frame[end] | (frame[end + 1] << 8));
+    if (SensorFrame_Crc16(frame, end) != crc) {
+        return SensorFrame_Result_BadCrc;
+    }
+
+    memset(report, 0, sizeof(*report));
+    report->version = frame[0];
+    report->seq = (uint16_t)(frame[1] | (frame[2] << 8));
+    report->deviceId = frame[3];
+
+    size_t pos = SENSOR_FRAME_HEADER_SIZE;
+    while (pos < end) {
+        if (pos + 2 > end) {
+            return SensorFrame_Result_BadTlv;
+        }
+        uint8_t type = frame[pos];
+        size_t length = frame[pos + 1];
+        const uint8_t *value = &frame[pos + 2];
+        pos += 2 + length;
+        if (pos > end) {
+            return SensorFrame_Result_BadTlv;
+        }
+        if ((type == 0) || (type > SensorFrame_Tlv_Max)) {
+            // Added by a later version of the end device; skip it.
+            continue;
+        }
+
+        switch (length) {
+        case 1:
+            SetValue(report, type, value[0]);
+            break;
+        case 2: {
+            uint16_t raw = (uint16_t)(value[0] | (value[1] << 8));
+            // Only the temperature is signed.
+            bool isSigned = (type == SensorFrame_Tlv_Temperature) ||
+                            (type == SensorFrame_Tlv_TemperatureCenti);
+            SetValue(report, type, isSigned ? (int32_t)(int16_t)raw : (int32_t)raw);
+            break;
+        }
+        case 4:
+            SetValue(report, type,
+                     (int32_t)((uint32_t)value[0] | ((uint32_t)value[1] << 8) |
+                               ((uint32_t)value[2] << 16) | ((uint32_t)value[3] << 24)));
+            break;
+        default:
+            return SensorFrame_Result_BadTlv;
+        }
+    }
+
+    return SensorFrame_Result_Ok;
+}
+
+bool SensorFrame_DecodeLegacy(const uint8_t *legacyReport, SensorFrame_Report *report)
+{
+    if (legacyReport[0] != SENSOR_FRAME_LEGACY_START) {
+        return false;
+    }
+
+    // The digits are not validated: the light level of these end devices overflows its second
+    // digit, and the value has always been taken as the character code minus '0'.
+    memset(report, 0, sizeof(*report));
+    report->deviceId = (uint8_t)(legacyReport[1] - '0');
+    for (int type = SensorFrame_Tlv_Temperature; type <= SensorFrame_Tlv_Gas; type++) {
+        const uint8_t *digits = &legacyReport[2 + 2 * (type - SensorFrame_Tlv_Temperature)];
+        SetValue(report, type, (digits[0] - '0') * 10 + (digits[1] - '0'));
+    }
+    SetValue(report, SensorFrame_Tlv_Pir, legacyReport[10] - '0');
+    return true;
+}
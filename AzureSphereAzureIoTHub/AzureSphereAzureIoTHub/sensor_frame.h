@@ -0,0 +1,103 @@
+/// \file sensor_frame.h
+/// \brief Decoding of the sensor reports of the ZigBee end devices.
+///
+/// Current end devices send a binary frame, all fields little-endian:
+///
+///     | VER | SEQ | DEVICE | TLV ... | CRC |
+///     |  1  |  2  |   1    |         |  2  |
+///
+/// Each TLV is a type byte, a length byte and the value; CRC is the CRC-16/CCITT-FALSE of the
+/// preceding bytes. Older end devices send an 11-byte ASCII report, which
+/// SensorFrame_DecodeLegacy converts to the same representation. The coordinator builds these
+/// frames from the ZCL reports of the end devices, with the temperature and humidity in
+/// hundredths; the Z-Stack side is SensorFrame.h in the GenericApp sample.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SENSOR_FRAME_VERSION 0x01
+#define SENSOR_FRAME_HEADER_SIZE 4 // VER, SEQ, DEVICE
+#define SENSOR_FRAME_CRC_SIZE 2
+
+/// <summary>
+///     Size and start byte of the ASCII reports of older end devices.
+/// </summary>
+#define SENSOR_FRAME_LEGACY_SIZE 11
+#define SENSOR_FRAME_LEGACY_START 'S'
+
+/// <summary>
+///     TLV types; also the indexes of SensorFrame_Report.values.
+/// </summary>
+typedef enum {
+    /// <summary>int16, degrees C</summary>
+    SensorFrame_Tlv_Temperature = 0x01,
+    /// <summary>uint16, %RH</summary>
+    SensorFrame_Tlv_Humidity = 0x02,
+    /// <summary>uint16, ADC reading</summary>
+    SensorFrame_Tlv_Light = 0x03,
+    /// <summary>uint16, ADC reading</summary>
+    SensorFrame_Tlv_Gas = 0x04,
+    /// <summary>uint8, 1 when motion is detected</summary>
+    SensorFrame_Tlv_Pir = 0x05,
+    /// <summary>int16, 0.01 degrees C</summary>
+    SensorFrame_Tlv_TemperatureCenti = 0x06,
+    /// <summary>uint16, 0.01 %RH</summary>
+    SensorFrame_Tlv_HumidityCenti = 0x07,
+    SensorFrame_Tlv_Max = SensorFrame_Tlv_HumidityCenti
+} SensorFrame_Tlv;
+
+/// <summary>
+///     A decoded sensor report.
+/// </summary>
+typedef struct {
+    /// <summary>The frame version, or 0 for a legacy ASCII report.</summary>
+    uint8_t version;
+    /// <summary>The report sequence number; always 0 for legacy reports.</summary>
+    uint16_t seq;
+    uint8_t deviceId;
+    /// <summary>Bit (1 << type) is set for each TLV type present in the report.</summary>
+    uint32_t present;
+    int32_t values[SensorFrame_Tlv_Max + 1];
+} SensorFrame_Report;
+
+/// <summary>
+///     Outcome of decoding a frame.
+/// </summary>
+typedef enum {
+    SensorFrame_Result_Ok = 0,
+    SensorFrame_Result_Truncated,
+    SensorFrame_Result_UnknownVersion,
+    SensorFrame_Result_BadCrc,
+    SensorFrame_Result_BadTlv
+} SensorFrame_Result;
+
+/// <summary>
+///     Decodes a binary frame. TLVs of unknown types are skipped.
+/// </summary>
+/// <param name="frame">The frame</param>
+/// <param name="frameSize">The size of the frame</param>
+/// <param name="report">Receives the decoded report</param>
+/// <returns>SensorFrame_Result_Ok if the frame was decoded.</returns>
+SensorFrame_Result SensorFrame_Decode(const uint8_t *frame, size_t frameSize,
+                                      SensorFrame_Report *report);
+
+/// <summary>
+///     Decodes a legacy ASCII report: 'S', the device id, then two digits each for
+///     temperature, humidity, light and gas, and one for the PIR sensor.
+/// </summary>
+/// <param name="legacyReport">The SENSOR_FRAME_LEGACY_SIZE bytes of the report</param>
+/// <param name="report">Receives the decoded report</param>
+/// <returns>'true' if the report was decoded, 'false' if it is not a legacy report.</returns>
+bool SensorFrame_DecodeLegacy(const uint8_t *legacyReport, SensorFrame_Report *report);
+
+/// <summary>
+///     Returns whether a report has a value of the given type.
+/// </summary>
+bool SensorFrame_HasValue(const SensorFrame_Report *report, SensorFrame_Tlv type);
+
+/// <summary>
+///     Computes the CRC-16/CCITT-FALSE of a buffer.
+/// </summary>
+uint16_t SensorFrame_Crc16(const uint8_t *data, size_t size);
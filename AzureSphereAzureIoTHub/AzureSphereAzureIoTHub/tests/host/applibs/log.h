@@ -0,0 +1,22 @@
+/// \file log.h
+/// \brief Host stand-in for the applibs logging API, for the tests. Output goes to stderr
+/// when the TEST_LOG environment variable is set, and is discarded otherwise.
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline int Log_DebugVarArgs(const char *fmt, va_list args)
+{
+    return getenv("TEST_LOG") ? vfprintf(stderr, fmt, args) : 0;
+}
+
+static inline int Log_Debug(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int result = Log_DebugVarArgs(fmt, args);
+    va_end(args);
+    return result;
+}
@@ -0,0 +1,194 @@
+/// \file sim_provisioning_backoff.c
+/// \brief Simulates a fleet of devices provisioning again after an outage of the Device
+/// Provisioning Service, with the retry delays of provisioning_backoff.c, and checks them.
+///
+/// All devices lose their hub connection when the outage starts and retry until the service
+/// is back. The recovered service accepts a limited number of attempts per second; attempts
+/// beyond that fail as throttled and back off like any other failure. Each strategy is run on
+/// the same fleet:
+///
+///     lockstep    the backoff without jitter: every device waits the full delay
+///     jitter      ProvisioningBackoff_GetDelayMs
+///
+/// The second table is the wait for the first attempt after a Wi-Fi gap ends, for a device
+/// that had already failed to provision a number of times: with the network-not-ready retry
+/// scaled by the failure count, as it was, and with the fixed retry it has now.
+///
+/// Usage: sim_provisioning_backoff [devices [outage seconds [attempts per second]]]
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "provisioning_backoff.h"
+#include "test.h"
+
+#define SERVICE_RETRY_BASE_SECONDS 10   // serviceRetryBaseSeconds of azure_iot_utilities.c
+#define TRANSIENT_RETRY_BASE_SECONDS 2  // transientRetryBaseSeconds
+#define HORIZON_SECONDS (6 * 3600)
+
+typedef struct {
+    uint64_t nextAttemptMs;
+    unsigned int failureCount;
+    bool provisioned;
+} Device;
+
+typedef struct {
+    unsigned long attempts;
+    unsigned long throttled;
+    unsigned int peakAttemptsPerSecond;
+    /// <summary>Seconds after the end of the outage until half, 99% and all of the fleet was
+    /// provisioned; 0 if that did not happen within HORIZON_SECONDS.</summary>
+    unsigned int half, most, all;
+} Outcome;
+
+static uint32_t Random32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static uint32_t GetDelayMs(bool jitter, unsigned int failureCount)
+{
+    return jitter ? ProvisioningBackoff_GetDelayMs(SERVICE_RETRY_BASE_SECONDS, failureCount,
+                                                   Random32())
+                  : ProvisioningBackoff_GetDelayMs(SERVICE_RETRY_BASE_SECONDS, failureCount, 0) *
+                        2;
+}
+
+static int CompareAttempts(const void *a, const void *b)
+{
+    const Device *deviceA = *(Device *const *)a;
+    const Device *deviceB = *(Device *const *)b;
+    return (deviceA->nextAttemptMs > deviceB->nextAttemptMs) -
+           (deviceA->nextAttemptMs < deviceB->nextAttemptMs);
+}
+
+static Outcome RunFleet(unsigned int deviceCount, unsigned int outageSeconds,
+                        unsigned int capacity, bool jitter)
+{
+    Device *devices = calloc(deviceCount, sizeof(Device));
+    Device **due = calloc(deviceCount, sizeof(Device *));
+    Outcome outcome = {0};
+    unsigned int provisionedCount = 0;
+
+    // The hub connections drop over the first second of the outage.
+    srand(1);
+    for (unsigned int i = 0; i < deviceCount; i++) {
+        devices[i].nextAttemptMs = Random32() % 1000;
+    }
+
+    for (unsigned int second = 0; (second < HORIZON_SECONDS) && (provisionedCount < deviceCount);
+         second++) {
+        uint64_t secondEndMs = (uint64_t)(second + 1) * 1000;
+        size_t dueCount = 0;
+        for (unsigned int i = 0; i < deviceCount; i++) {
+            if (!devices[i].provisioned && (devices[i].nextAttemptMs < secondEndMs)) {
+                due[dueCount++] = &devices[i];
+            }
+        }
+        qsort(due, dueCount, sizeof(due[0]), CompareAttempts);
+
+        unsigned int accepted = 0;
+        for (size_t i = 0; i < dueCount; i++) {
+            Device *device = due[i];
+            outcome.attempts++;
+            if ((second >= outageSeconds) && (accepted < capacity)) {
+                accepted++;
+                device->provisioned = true;
+                provisionedCount++;
+                continue;
+            }
+            if (second >= outageSeconds) {
+                outcome.throttled++;
+            }
+            device->nextAttemptMs += GetDelayMs(jitter, device->failureCount);
+            device->failureCount++;
+        }
+
+        if (second >= outageSeconds) {
+            unsigned int sinceRecovery = second + 1 - outageSeconds;
+            if (dueCount > outcome.peakAttemptsPerSecond) {
+                outcome.peakAttemptsPerSecond = (unsigned int)dueCount;
+            }
+            if ((outcome.half == 0) && (provisionedCount * 2 >= deviceCount)) {
+                outcome.half = sinceRecovery;
+            }
+            if ((outcome.most == 0) && (provisionedCount * 100 >= deviceCount * 99)) {
+                outcome.most = sinceRecovery;
+            }
+            if (provisionedCount == deviceCount) {
+                outcome.all = sinceRecovery;
+            }
+        }
+    }
+
+    free(due);
+    free(devices);
+    return outcome;
+}
+
+static void PrintSeconds(unsigned int seconds)
+{
+    if (seconds == 0) {
+        printf(" %8s", "-");
+    } else {
+        printf(" %8u", seconds);
+    }
+}
+
+static void TestDelays(void)
+{
+    // The delay doubles per failure, within [delay/2, delay], up to the maximum.
+    TEST_CHECK_EQUAL(5000, ProvisioningBackoff_GetDelayMs(10, 0, 0));
+    TEST_CHECK_EQUAL(10000, ProvisioningBackoff_GetDelayMs(10, 0, 5000));
+    TEST_CHECK_EQUAL(5000, ProvisioningBackoff_GetDelayMs(10, 0, 5001));
+    TEST_CHECK_EQUAL(40000, ProvisioningBackoff_GetDelayMs(10, 3, 0));
+    TEST_CHECK_EQUAL(PROVISIONING_BACKOFF_MAX_DELAY_SECONDS * 500u,
+                     ProvisioningBackoff_GetDelayMs(10, 8, 0));
+    TEST_CHECK_EQUAL(PROVISIONING_BACKOFF_MAX_DELAY_SECONDS * 500u,
+                     ProvisioningBackoff_GetDelayMs(10, 1000, 0));
+    TEST_CHECK_EQUAL(PROVISIONING_BACKOFF_MAX_DELAY_SECONDS * 1000u,
+                     ProvisioningBackoff_GetDelayMs(60, 1000, 900000));
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int deviceCount = (argc > 1) ? (unsigned int)atoi(argv[1]) : 1000;
+    unsigned int outageSeconds = (argc > 2) ? (unsigned int)atoi(argv[2]) : 600;
+    unsigned int capacity = (argc > 3) ? (unsigned int)atoi(argv[3]) : 50;
+
+    TestDelays();
+
+    printf("%u devices, %u s outage, %u attempts/s after it\n\n", deviceCount, outageSeconds,
+           capacity);
+    printf("%-9s %9s %9s %9s %8s %8s %8s\n", "backoff", "attempts", "throttled", "peak/s",
+           "50% s", "99% s", "100% s");
+    Outcome outcomes[2];
+    for (int jitter = 0; jitter < 2; jitter++) {
+        Outcome *outcome = &outcomes[jitter];
+        *outcome = RunFleet(deviceCount, outageSeconds, capacity, jitter != 0);
+        printf("%-9s %9lu %9lu %9u", jitter ? "jitter" : "lockstep", outcome->attempts,
+               outcome->throttled, outcome->peakAttemptsPerSecond);
+        PrintSeconds(outcome->half);
+        PrintSeconds(outcome->most);
+        PrintSeconds(outcome->all);
+        printf("\n");
+    }
+    // Spreading the retries must flatten the peak the recovered service sees, and bring the
+    // whole fleet back.
+    TEST_CHECK(outcomes[1].peakAttemptsPerSecond < outcomes[0].peakAttemptsPerSecond);
+    TEST_CHECK(outcomes[1].all != 0);
+    printf("(- : not within %u s)\n", HORIZON_SECONDS);
+
+    printf("\nfirst attempt after a Wi-Fi gap, by earlier provisioning failures\n\n");
+    printf("%8s %16s %12s\n", "failures", "scaled s (mean)", "fixed s");
+    for (unsigned int failures = 0; failures <= 8; failures++) {
+        // Waiting for the network neither counted as a failure nor reset the count, so the
+        // check ran at the scaled delay of the failures before the gap; its mean is 3/4 of the
+        // delay before jitter.
+        uint32_t scaledMs =
+            ProvisioningBackoff_GetDelayMs(TRANSIENT_RETRY_BASE_SECONDS, failures, 0) * 3 / 2;
+        printf("%8u %16.1f %12.1f\n", failures, scaledMs / 1000.0,
+               PROVISIONING_BACKOFF_NETWORK_RETRY_MS / 1000.0);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,426 @@
+/// \file test_command_channel.c
+/// \brief Tests the command channel against a simulated coordinator link: ordering per
+/// destination, the in-flight limit, partial writes, acknowledgement matching across a
+/// sequence number wrap, the timeout of frames held in the link, and retransmission and
+/// timeout when frames or acknowledgements are lost.
+///
+/// The channel reads CLOCK_MONOTONIC; the test links with --wrap=clock_gettime and advances
+/// that clock itself.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "command_channel.h"
+#include "coordinator_link.h"
+#include "test.h"
+
+#define MAX_COMMANDS 4096
+
+int __real_clock_gettime(clockid_t clock, struct timespec *ts);
+
+static uint64_t nowMs = 1000;
+
+int __wrap_clock_gettime(clockid_t clock, struct timespec *ts)
+{
+    if (clock != CLOCK_MONOTONIC) {
+        return __real_clock_gettime(clock, ts);
+    }
+    ts->tv_sec = (time_t)(nowMs / 1000);
+    ts->tv_nsec = (long)(nowMs % 1000) * 1000000L;
+    return 0;
+}
+
+// The link: how many bytes it takes per write call, and the frames it carried.
+static size_t linkChunkSize;
+static bool linkBusy;
+static CoordinatorLink_Decoder linkDecoder;
+
+// Frames of the link that left it, for the tests that hold frames in the link.
+static uint32_t linkFramesDone;
+
+typedef struct {
+    uint8_t seq;
+    uint16_t nwkAddr;
+    uint8_t commandId;
+    uint8_t args[COMMAND_CHANNEL_MAX_ARGS_SIZE];
+    size_t argsSize;
+} SentFrame;
+
+static SentFrame sent[MAX_COMMANDS * (COMMAND_CHANNEL_MAX_RETRIES + 1)];
+static size_t sentCount;
+
+typedef struct {
+    bool completed;
+    unsigned int completions;
+    uint16_t nwkAddr;
+    int status;
+    uint32_t latencyMs;
+} Completion;
+
+// Indexed by sequence number; sequence numbers are reused after 256 commands.
+static Completion completions[256];
+static unsigned int completionCount;
+
+// For the lossy link test: the command id queued under each sequence number, and the last
+// command completed per device; command ids count up per device.
+#define LOSSY_DEVICES 6
+#define LOSSY_BASE_ADDR 0x0100
+static uint8_t commandOfSeq[256];
+static uint8_t lastCompleted[LOSSY_DEVICES];
+static bool outOfOrder;
+
+static void OnFrame(uint8_t type, uint8_t seq, const uint8_t *data, size_t dataSize)
+{
+    TEST_CHECK_EQUAL(CoordinatorLink_FrameType_Command, type);
+    TEST_CHECK(dataSize >= 3);
+    if ((type != CoordinatorLink_FrameType_Command) || (dataSize < 3) ||
+        (sentCount == sizeof(sent) / sizeof(sent[0]))) {
+        return;
+    }
+    SentFrame *frame = &sent[sentCount++];
+    frame->seq = seq;
+    frame->nwkAddr = (uint16_t)(data[0] | (data[1] << 8));
+    frame->commandId = data[2];
+    frame->argsSize = dataSize - 3;
+    memcpy(frame->args, data + 3, frame->argsSize);
+}
+
+static ssize_t LinkWrite(const uint8_t *data, size_t size)
+{
+    if (linkBusy) {
+        return 0;
+    }
+    size_t accepted = (linkChunkSize != 0 && size > linkChunkSize) ? linkChunkSize : size;
+    CoordinatorLink_ProcessBytes(&linkDecoder, data, accepted);
+    return (ssize_t)accepted;
+}
+
+static void LinkProgress(uint32_t *framesAccepted, uint32_t *framesDone)
+{
+    *framesAccepted = (uint32_t)sentCount;
+    *framesDone = linkFramesDone;
+}
+
+static void OnCompletion(uint8_t seq, uint16_t nwkAddr, int status, uint32_t latencyMs)
+{
+    Completion *completion = &completions[seq];
+    completion->completed = true;
+    completion->completions++;
+    completion->nwkAddr = nwkAddr;
+    completion->status = status;
+    completion->latencyMs = latencyMs;
+    completionCount++;
+
+    if ((nwkAddr >= LOSSY_BASE_ADDR) && (nwkAddr < LOSSY_BASE_ADDR + LOSSY_DEVICES)) {
+        uint8_t *last = &lastCompleted[nwkAddr - LOSSY_BASE_ADDR];
+        if (commandOfSeq[seq] != (uint8_t)(*last + 1)) {
+            outOfOrder = true;
+        }
+        *last = commandOfSeq[seq];
+    }
+}
+
+static void Reset(void)
+{
+    nowMs = 1000;
+    linkChunkSize = 0;
+    linkBusy = false;
+    linkFramesDone = 0;
+    sentCount = 0;
+    completionCount = 0;
+    memset(completions, 0, sizeof(completions));
+    memset(lastCompleted, 0, sizeof(lastCompleted));
+    outOfOrder = false;
+    CoordinatorLink_InitDecoder(&linkDecoder, OnFrame, NULL);
+    CommandChannel_Init(LinkWrite, NULL, OnCompletion);
+}
+
+static void TestDeliveryAndAck(void)
+{
+    Reset();
+    static const uint8_t args[] = {0x11, 0x22, 0x33};
+    int seq = CommandChannel_Enqueue(0x1234, 0x07, args, sizeof(args));
+    TEST_CHECK(seq >= 0);
+    TEST_CHECK_EQUAL(0, sentCount);
+
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1, sentCount);
+    TEST_CHECK_EQUAL(seq, sent[0].seq);
+    TEST_CHECK_EQUAL(0x1234, sent[0].nwkAddr);
+    TEST_CHECK_EQUAL(0x07, sent[0].commandId);
+    TEST_CHECK(sent[0].argsSize == sizeof(args) && memcmp(sent[0].args, args, sizeof(args)) == 0);
+
+    nowMs += 120;
+    CommandChannel_HandleAck(0x1234, (uint8_t)seq, 0);
+    TEST_CHECK_EQUAL(1, completions[seq].completions);
+    TEST_CHECK_EQUAL(0, completions[seq].status);
+    TEST_CHECK_EQUAL(120, completions[seq].latencyMs);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->delivered);
+
+    // A duplicate acknowledgement matches nothing.
+    CommandChannel_HandleAck(0x1234, (uint8_t)seq, 0);
+    TEST_CHECK_EQUAL(1, completions[seq].completions);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->unmatchedAcks);
+
+    // An error status completes the command as failed.
+    seq = CommandChannel_Enqueue(0x1234, 0x08, NULL, 0);
+    CommandChannel_DoPeriodicTasks();
+    CommandChannel_HandleAck(0x1234, (uint8_t)seq, 0xCD);
+    TEST_CHECK_EQUAL(0xCD, completions[seq].status);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->failed);
+}
+
+static void TestRetransmissionAndTimeout(void)
+{
+    Reset();
+    int seq = CommandChannel_Enqueue(0x0001, 0x01, NULL, 0);
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1, sentCount);
+
+    // Nothing happens before the acknowledgement is due.
+    nowMs += COMMAND_CHANNEL_ACK_TIMEOUT_MS - 1;
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1, sentCount);
+
+    // Each overdue acknowledgement retransmits the same command, up to the limit...
+    for (unsigned int retry = 1; retry <= COMMAND_CHANNEL_MAX_RETRIES; retry++) {
+        nowMs += 1;
+        CommandChannel_DoPeriodicTasks();
+        TEST_CHECK_EQUAL(1 + retry, sentCount);
+        TEST_CHECK_EQUAL(seq, sent[sentCount - 1].seq);
+        TEST_CHECK(!completions[seq].completed);
+        nowMs += COMMAND_CHANNEL_ACK_TIMEOUT_MS - 1;
+    }
+
+    // ...then the command times out.
+    nowMs += 1;
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1 + COMMAND_CHANNEL_MAX_RETRIES, sentCount);
+    TEST_CHECK_EQUAL(COMMAND_CHANNEL_STATUS_TIMEOUT, completions[seq].status);
+    TEST_CHECK_EQUAL((COMMAND_CHANNEL_MAX_RETRIES + 1) * COMMAND_CHANNEL_ACK_TIMEOUT_MS,
+                     completions[seq].latencyMs);
+    TEST_CHECK_EQUAL(COMMAND_CHANNEL_MAX_RETRIES, CommandChannel_GetStatistics()->retransmissions);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->timedOut);
+
+    // An acknowledgement of the retransmission, arriving late, is unmatched.
+    CommandChannel_HandleAck(0x0001, (uint8_t)seq, 0);
+    TEST_CHECK_EQUAL(1, completions[seq].completions);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->unmatchedAcks);
+}
+
+static void TestOrderingAndInFlightLimit(void)
+{
+    Reset();
+    // Two commands for each of more destinations than may be in flight.
+    for (uint16_t addr = 1; addr <= COMMAND_CHANNEL_MAX_IN_FLIGHT + 2; addr++) {
+        TEST_CHECK(CommandChannel_Enqueue(addr, 0x01, NULL, 0) >= 0);
+        TEST_CHECK(CommandChannel_Enqueue(addr, 0x02, NULL, 0) >= 0);
+    }
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(COMMAND_CHANNEL_MAX_IN_FLIGHT, sentCount);
+    for (size_t i = 0; i < sentCount; i++) {
+        // One command per destination, the first queued.
+        TEST_CHECK_EQUAL(0x01, sent[i].commandId);
+        for (size_t j = 0; j < i; j++) {
+            TEST_CHECK(sent[i].nwkAddr != sent[j].nwkAddr);
+        }
+    }
+
+    // Completing a command starts the next one right away, for the destination served next.
+    size_t before = sentCount;
+    CommandChannel_HandleAck(sent[0].nwkAddr, sent[0].seq, 0);
+    TEST_CHECK_EQUAL(before + 1, sentCount);
+    TEST_CHECK_EQUAL(COMMAND_CHANNEL_MAX_IN_FLIGHT + 1, sent[sentCount - 1].nwkAddr);
+}
+
+static void TestQueueLimits(void)
+{
+    Reset();
+    for (unsigned int i = 0; i < COMMAND_CHANNEL_QUEUE_DEPTH; i++) {
+        TEST_CHECK(CommandChannel_Enqueue(0x0001, 0x01, NULL, 0) >= 0);
+    }
+    TEST_CHECK_EQUAL(-1, CommandChannel_Enqueue(0x0001, 0x01, NULL, 0));
+
+    for (uint16_t addr = 2; addr <= COMMAND_CHANNEL_MAX_DESTINATIONS; addr++) {
+        TEST_CHECK(CommandChannel_Enqueue(addr, 0x01, NULL, 0) >= 0);
+    }
+    TEST_CHECK_EQUAL(-1, CommandChannel_Enqueue(0xFFFE, 0x01, NULL, 0));
+
+    uint8_t args[COMMAND_CHANNEL_MAX_ARGS_SIZE + 1] = {0};
+    TEST_CHECK_EQUAL(-1, CommandChannel_Enqueue(0x0002, 0x01, args, sizeof(args)));
+    TEST_CHECK_EQUAL(3, CommandChannel_GetStatistics()->rejected);
+}
+
+static void TestPartialAndBusyWrites(void)
+{
+    Reset();
+    static const uint8_t args[COMMAND_CHANNEL_MAX_ARGS_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8,
+                                                                 9, 10, 11, 12, 13, 14, 15, 16};
+
+    // The link is busy: nothing is written and nothing is lost.
+    linkBusy = true;
+    int seq = CommandChannel_Enqueue(0x4321, 0x09, args, sizeof(args));
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(0, sentCount);
+
+    // It then takes three bytes per write; the frame is finished over several calls.
+    linkBusy = false;
+    linkChunkSize = 3;
+    for (int i = 0; (i < 16) && (sentCount == 0); i++) {
+        CommandChannel_DoPeriodicTasks();
+    }
+    TEST_CHECK_EQUAL(1, sentCount);
+    TEST_CHECK_EQUAL(seq, sent[0].seq);
+    TEST_CHECK(sent[0].argsSize == sizeof(args) && memcmp(sent[0].args, args, sizeof(args)) == 0);
+    TEST_CHECK_EQUAL(0, linkDecoder.fcsErrors);
+}
+
+static void TestSeqWrap(void)
+{
+    Reset();
+    int held = CommandChannel_Enqueue(0x0001, 0x01, NULL, 0);
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1, sentCount);
+
+    // An acknowledgement with the right sequence number for another device matches nothing.
+    CommandChannel_HandleAck(0x0002, (uint8_t)held, 0);
+    TEST_CHECK(!completions[held].completed);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->unmatchedAcks);
+
+    // Over more commands than there are sequence numbers, none reuses the one in flight.
+    bool reused = false;
+    for (unsigned int i = 0; i < 600; i++) {
+        int seq = CommandChannel_Enqueue(0x0002, 0x02, NULL, 0);
+        reused |= (seq == held);
+        CommandChannel_DoPeriodicTasks();
+        CommandChannel_HandleAck(0x0002, (uint8_t)seq, 0);
+    }
+    TEST_CHECK(!reused);
+    TEST_CHECK_EQUAL(600, CommandChannel_GetStatistics()->delivered);
+
+    // The command in flight all along still takes its acknowledgement.
+    CommandChannel_HandleAck(0x0001, (uint8_t)held, 0);
+    TEST_CHECK_EQUAL(1, completions[held].completions);
+    TEST_CHECK_EQUAL(0x0001, completions[held].nwkAddr);
+    TEST_CHECK_EQUAL(601, CommandChannel_GetStatistics()->delivered);
+}
+
+static void TestTimeoutFromFlush(void)
+{
+    Reset();
+    CommandChannel_Init(LinkWrite, LinkProgress, OnCompletion);
+    int seq = CommandChannel_Enqueue(0x0001, 0x01, NULL, 0);
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1, sentCount);
+
+    // The link holds the frame for longer than the acknowledgement timeout: the command is
+    // neither retransmitted nor timed out.
+    nowMs += 2 * COMMAND_CHANNEL_ACK_TIMEOUT_MS;
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1, sentCount);
+    TEST_CHECK(!completions[seq].completed);
+
+    // The timeout runs once the frame has left the link.
+    linkFramesDone = 1;
+    CommandChannel_DoPeriodicTasks();
+    nowMs += COMMAND_CHANNEL_ACK_TIMEOUT_MS - 1;
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(1, sentCount);
+    nowMs += 1;
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(2, sentCount);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->retransmissions);
+
+    // The retransmission is held as well.
+    nowMs += 2 * COMMAND_CHANNEL_ACK_TIMEOUT_MS;
+    CommandChannel_DoPeriodicTasks();
+    TEST_CHECK_EQUAL(2, sentCount);
+    TEST_CHECK_EQUAL(1, CommandChannel_GetStatistics()->retransmissions);
+}
+
+/// <summary>
+///     Sends commands to a few devices over a link that loses frames and acknowledgements, and
+///     checks that every command completes exactly once, in order per device, as delivered if
+///     one of its transmissions was acknowledged and as timed out otherwise.
+/// </summary>
+static void TestLossyLink(unsigned int lossPercent)
+{
+    enum { Commands = 200 };
+    Reset();
+    srand(lossPercent + 1);
+
+    uint8_t nextCommand[LOSSY_DEVICES] = {0};
+    unsigned int queued = 0;
+    unsigned int expectedDelivered = 0;
+    size_t handled = 0;
+
+    while (completionCount < Commands) {
+        // Keep commands trickling in to random devices.
+        if ((queued < Commands) && (rand() % 4 == 0)) {
+            unsigned int device = (unsigned int)rand() % LOSSY_DEVICES;
+            int seq = CommandChannel_Enqueue((uint16_t)(LOSSY_BASE_ADDR + device),
+                                             (uint8_t)(nextCommand[device] + 1), NULL, 0);
+            if (seq >= 0) {
+                commandOfSeq[seq] = ++nextCommand[device];
+                queued++;
+            }
+        }
+
+        CommandChannel_DoPeriodicTasks();
+
+        // The coordinator acknowledges the frames that got through, unless the
+        // acknowledgement itself is lost.
+        for (; handled < sentCount; handled++) {
+            if ((unsigned int)(rand() % 100) < lossPercent) {
+                continue; // Frame lost.
+            }
+            if ((unsigned int)(rand() % 100) < lossPercent) {
+                continue; // Acknowledgement lost.
+            }
+            unsigned int before = completionCount;
+            CommandChannel_HandleAck(sent[handled].nwkAddr, sent[handled].seq, 0);
+            expectedDelivered += completionCount - before;
+        }
+
+        nowMs += 50;
+    }
+
+    const CommandChannel_Statistics *stats = CommandChannel_GetStatistics();
+    unsigned int repeated = 0;
+    for (size_t i = 0; i < 256; i++) {
+        repeated += completions[i].completions > 1;
+    }
+    TEST_CHECK_EQUAL(0, repeated);
+    TEST_CHECK(!outOfOrder);
+    TEST_CHECK_EQUAL(Commands, stats->delivered + stats->timedOut);
+    TEST_CHECK_EQUAL(expectedDelivered, stats->delivered);
+    if (lossPercent == 0) {
+        TEST_CHECK_EQUAL(0, stats->retransmissions);
+        TEST_CHECK_EQUAL(Commands, stats->delivered);
+    }
+
+    printf("%5u%% %9u %9u %9u %9u %12.0f %8u\n", lossPercent, stats->framesSent,
+           stats->retransmissions, stats->delivered, stats->timedOut,
+           (double)stats->totalLatencyMs / (stats->delivered + stats->timedOut),
+           stats->maxLatencyMs);
+}
+
+int main(void)
+{
+    TestDeliveryAndAck();
+    TestRetransmissionAndTimeout();
+    TestOrderingAndInFlightLimit();
+    TestQueueLimits();
+    TestPartialAndBusyWrites();
+    TestSeqWrap();
+    TestTimeoutFromFlush();
+
+    printf("%6s %9s %9s %9s %9s %12s %8s\n", "loss", "frames", "retrans", "delivered",
+           "timed out", "latency ms", "max ms");
+    static const unsigned int lossPercents[] = {0, 5, 20, 50};
+    for (size_t i = 0; i < sizeof(lossPercents) / sizeof(lossPercents[0]); i++) {
+        TestLossyLink(lossPercents[i]);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,363 @@
+/// \file test_coordinator_link.c
+/// \brief Tests the framing of the serial link between the gateway and the coordinator, both
+/// ways, against GatewayLink.c of the coordinator, and fuzzes the two decoders with noise and
+/// corrupted frames.
+
+#include <stdlib.h>
+#include <string.h>
+#include "coordinator_link.h"
+#include "test.h"
+#include "zstack_gateway_link.h"
+
+#define MAX_FRAMES 20000
+
+typedef struct {
+    bool legacy;
+    uint8_t type;
+    uint8_t seq;
+    uint8_t size;
+    uint8_t data[COORDINATOR_LINK_MAX_DATA_SIZE];
+} Frame;
+
+// Frames sent, and frames delivered by the decoder under test.
+static Frame sent[MAX_FRAMES];
+static size_t sentCount;
+static Frame received[MAX_FRAMES * 2];
+static size_t receivedCount;
+
+static void Record(bool legacy, uint8_t type, uint8_t seq, const uint8_t *data, size_t size)
+{
+    if (receivedCount == sizeof(received) / sizeof(received[0])) {
+        return;
+    }
+    Frame *frame = &received[receivedCount++];
+    frame->legacy = legacy;
+    frame->type = type;
+    frame->seq = seq;
+    frame->size = (uint8_t)size;
+    memcpy(frame->data, data, size);
+}
+
+static void OnFrame(uint8_t type, uint8_t seq, const uint8_t *data, size_t dataSize)
+{
+    Record(false, type, seq, data, dataSize);
+}
+
+static void OnLegacyReport(const uint8_t *report)
+{
+    Record(true, 0, 0, report, COORDINATOR_LINK_LEGACY_REPORT_SIZE);
+}
+
+static bool SameFrame(const Frame *a, const Frame *b)
+{
+    return (a->legacy == b->legacy) && (a->type == b->type) && (a->seq == b->seq) &&
+           (a->size == b->size) && (memcmp(a->data, b->data, a->size) == 0);
+}
+
+/// <summary>
+///     Makes a random frame, or legacy report, numbered so that no two are alike.
+/// </summary>
+static void MakeFrame(Frame *frame, unsigned int number, bool allowLegacy)
+{
+    memset(frame, 0, sizeof(*frame));
+    if (allowLegacy && (rand() % 8 == 0)) {
+        frame->legacy = true;
+        frame->size = COORDINATOR_LINK_LEGACY_REPORT_SIZE;
+        frame->data[0] = COORDINATOR_LINK_LEGACY_REPORT_START;
+        for (int i = 1; i < COORDINATOR_LINK_LEGACY_REPORT_SIZE; i++) {
+            frame->data[i] = (uint8_t)('0' + (number + (unsigned int)rand()) % 10);
+        }
+        frame->data[1] = (uint8_t)('0' + number % 10);
+        frame->data[2] = (uint8_t)('0' + (number / 10) % 10);
+        return;
+    }
+    frame->type = (uint8_t)(0x80 + rand() % 6);
+    frame->seq = (uint8_t)number;
+    frame->size = (uint8_t)(2 + rand() % (COORDINATOR_LINK_MAX_DATA_SIZE - 1));
+    frame->data[0] = (uint8_t)number;
+    frame->data[1] = (uint8_t)(number >> 8);
+    for (size_t i = 2; i < frame->size; i++) {
+        frame->data[i] = (uint8_t)rand();
+    }
+}
+
+static size_t Encode(const Frame *frame, uint8_t *buffer, size_t capacity)
+{
+    if (frame->legacy) {
+        memcpy(buffer, frame->data, frame->size);
+        return frame->size;
+    }
+    return CoordinatorLink_EncodeFrame(frame->type, frame->seq, frame->data, frame->size, buffer,
+                                       capacity);
+}
+
+static void TestEncodeDecode(void)
+{
+    CoordinatorLink_Decoder decoder;
+    uint8_t buffer[COORDINATOR_LINK_MAX_FRAME_SIZE];
+    uint8_t data[COORDINATOR_LINK_MAX_DATA_SIZE + 1];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(0xF0 + i); // Includes the start byte.
+    }
+
+    CoordinatorLink_InitDecoder(&decoder, OnFrame, OnLegacyReport);
+    receivedCount = 0;
+    for (size_t size = 0; size <= COORDINATOR_LINK_MAX_DATA_SIZE; size++) {
+        size_t frameSize =
+            CoordinatorLink_EncodeFrame(0x82, (uint8_t)size, data, size, buffer, sizeof(buffer));
+        TEST_CHECK_EQUAL(COORDINATOR_LINK_HEADER_SIZE + size + 1, frameSize);
+        // Byte by byte for odd sizes, whole for even ones.
+        if (size % 2) {
+            for (size_t i = 0; i < frameSize; i++) {
+                CoordinatorLink_ProcessBytes(&decoder, &buffer[i], 1);
+            }
+        } else {
+            CoordinatorLink_ProcessBytes(&decoder, buffer, frameSize);
+        }
+        TEST_CHECK_EQUAL(size + 1, receivedCount);
+        TEST_CHECK_EQUAL(size, received[receivedCount - 1].size);
+        TEST_CHECK(memcmp(received[receivedCount - 1].data, data, size) == 0);
+    }
+    TEST_CHECK_EQUAL(0, decoder.fcsErrors);
+
+    TEST_CHECK_EQUAL(0, CoordinatorLink_EncodeFrame(0x82, 0, data, COORDINATOR_LINK_MAX_DATA_SIZE + 1,
+                                                    buffer, sizeof(buffer)));
+    TEST_CHECK_EQUAL(0, CoordinatorLink_EncodeFrame(0x82, 0, data, 10, buffer, 14));
+    TEST_CHECK_EQUAL(15, CoordinatorLink_EncodeFrame(0x82, 0, data, 10, buffer, 15));
+}
+
+/// <summary>
+///     The routing counters as GenericApp_SendRouteStats of coordinator.c lays them out.
+/// </summary>
+static void TestRouteStats(void)
+{
+    static const uint8_t data[COORDINATOR_LINK_ROUTE_STATS_SIZE + 2] = {
+        0x01, 0x00, 0x34, 0x12, 0xFF, 0xFF, 0x00, 0x80, 0x07, 0x00, 0x00, 0x01, 0xAA, 0xBB};
+    CoordinatorLink_RouteStats stats;
+    TEST_CHECK(CoordinatorLink_ReadRouteStats(data, COORDINATOR_LINK_ROUTE_STATS_SIZE, &stats));
+    TEST_CHECK_EQUAL(1, stats.mtoRequests);
+    TEST_CHECK_EQUAL(0x1234, stats.routeRecords);
+    TEST_CHECK_EQUAL(0xFFFF, stats.cachedUnicasts);
+    TEST_CHECK_EQUAL(0x8000, stats.stackCachedUnicasts);
+    TEST_CHECK_EQUAL(7, stats.discoveredUnicasts);
+    TEST_CHECK_EQUAL(0x100, stats.failedRoutes);
+
+    // Later counters are ignored; missing ones fail.
+    TEST_CHECK(CoordinatorLink_ReadRouteStats(data, sizeof(data), &stats));
+    TEST_CHECK_EQUAL(0x100, stats.failedRoutes);
+    TEST_CHECK(
+        !CoordinatorLink_ReadRouteStats(data, COORDINATOR_LINK_ROUTE_STATS_SIZE - 1, &stats));
+}
+
+/// <summary>
+///     The coordinator queues frames and legacy reports faster than its UART sends them; the
+///     gateway must decode exactly the ones the coordinator accepted, in order.
+/// </summary>
+static void TestCoordinatorToGateway(void)
+{
+    static uint8_t wire[COORDINATOR_LINK_MAX_FRAME_SIZE * MAX_FRAMES];
+    size_t wireSize = 0;
+    unsigned int refused = 0;
+    CoordinatorLink_Decoder decoder;
+
+    srand(1);
+    sentCount = 0;
+    receivedCount = 0;
+    ZStackGatewayLink_Init(NULL);
+    for (unsigned int number = 0; sentCount < MAX_FRAMES / 2; number++) {
+        Frame frame;
+        MakeFrame(&frame, number, true);
+        bool accepted = frame.legacy
+                            ? ZStackGatewayLink_SendRaw(frame.data, frame.size)
+                            : ZStackGatewayLink_SendFrame(frame.type, frame.seq, frame.data,
+                                                          frame.size);
+        if (accepted) {
+            sent[sentCount++] = frame;
+        } else {
+            refused++;
+        }
+        wireSize += ZStackGatewayLink_Transmit(&wire[wireSize], (size_t)rand() % 160);
+    }
+    size_t shifted;
+    while ((shifted = ZStackGatewayLink_Transmit(&wire[wireSize], 64)) != 0) {
+        wireSize += shifted;
+    }
+    TEST_CHECK(refused > 0);
+    TEST_CHECK_EQUAL(refused, ZStackGatewayLink_GetTxDropped());
+
+    CoordinatorLink_InitDecoder(&decoder, OnFrame, OnLegacyReport);
+    for (size_t position = 0; position < wireSize;) {
+        size_t chunk = 1 + (size_t)rand() % 64;
+        if (chunk > wireSize - position) {
+            chunk = wireSize - position;
+        }
+        CoordinatorLink_ProcessBytes(&decoder, &wire[position], chunk);
+        position += chunk;
+    }
+
+    TEST_CHECK_EQUAL(sentCount, receivedCount);
+    size_t mismatches = 0;
+    for (size_t i = 0; (i < sentCount) && (i < receivedCount); i++) {
+        mismatches += !SameFrame(&sent[i], &received[i]);
+    }
+    TEST_CHECK_EQUAL(0, mismatches);
+    TEST_CHECK_EQUAL(0, decoder.fcsErrors);
+}
+
+/// <summary>
+///     The gateway sends commands; the coordinator must hand each to its task intact.
+/// </summary>
+static void TestGatewayToCoordinator(void)
+{
+    uint8_t buffer[COORDINATOR_LINK_MAX_FRAME_SIZE];
+
+    srand(2);
+    sentCount = 0;
+    receivedCount = 0;
+    ZStackGatewayLink_Init(OnFrame);
+    for (unsigned int number = 0; number < 5000; number++) {
+        Frame *frame = &sent[sentCount++];
+        MakeFrame(frame, number, false);
+        frame->type = CoordinatorLink_FrameType_Command;
+        size_t frameSize = Encode(frame, buffer, sizeof(buffer));
+        // Split at a random point, as the UART's idle timeout would.
+        size_t split = (size_t)rand() % frameSize;
+        ZStackGatewayLink_Receive(buffer, split);
+        ZStackGatewayLink_Receive(&buffer[split], frameSize - split);
+    }
+
+    TEST_CHECK_EQUAL(sentCount, receivedCount);
+    size_t mismatches = 0;
+    for (size_t i = 0; (i < sentCount) && (i < receivedCount); i++) {
+        mismatches += !SameFrame(&sent[i], &received[i]);
+    }
+    TEST_CHECK_EQUAL(0, mismatches);
+}
+
+/// <summary>
+///     Classifies the received frames against the sent ones: intact frames must come in the
+///     order sent; anything else is a phantom, a frame made of noise that passed the FCS.
+/// </summary>
+static void Classify(size_t *intact, size_t *phantoms)
+{
+    size_t next = 0;
+    *intact = 0;
+    *phantoms = 0;
+    for (size_t i = 0; i < receivedCount; i++) {
+        size_t match = next;
+        while ((match < sentCount) && !SameFrame(&sent[match], &received[i])) {
+            match++;
+        }
+        if (match < sentCount) {
+            (*intact)++;
+            next = match + 1;
+        } else {
+            (*phantoms)++;
+        }
+    }
+}
+
+/// <summary>
+///     Sends frames and legacy reports through a line that corrupts bytes, and reports what the
+///     gateway decoder made of them. Runs under ASan, so decoding noise must stay within
+///     bounds.
+/// </summary>
+static void FuzzGatewayDecoder(unsigned int errorsPerMillion)
+{
+    static uint8_t wire[COORDINATOR_LINK_MAX_FRAME_SIZE * MAX_FRAMES];
+    size_t wireSize = 0;
+    unsigned long corrupted = 0;
+    CoordinatorLink_Decoder decoder;
+
+    srand(errorsPerMillion + 3);
+    sentCount = 0;
+    receivedCount = 0;
+    for (unsigned int number = 0; number < MAX_FRAMES / 2; number++) {
+        MakeFrame(&sent[sentCount], number, true);
+        wireSize += Encode(&sent[sentCount], &wire[wireSize], COORDINATOR_LINK_MAX_FRAME_SIZE);
+        sentCount++;
+    }
+    for (size_t i = 0; i < wireSize; i++) {
+        if ((unsigned int)(rand() % 1000000) < errorsPerMillion) {
+            wire[i] ^= (uint8_t)(1 + rand() % 255);
+            corrupted++;
+        }
+    }
+
+    CoordinatorLink_InitDecoder(&decoder, OnFrame, OnLegacyReport);
+    for (size_t position = 0; position < wireSize;) {
+        size_t chunk = 1 + (size_t)rand() % 200;
+        if (chunk > wireSize - position) {
+            chunk = wireSize - position;
+        }
+        CoordinatorLink_ProcessBytes(&decoder, &wire[position], chunk);
+        position += chunk;
+    }
+
+    size_t intact, phantoms;
+    Classify(&intact, &phantoms);
+    if (errorsPerMillion == 0) {
+        TEST_CHECK_EQUAL(sentCount, intact);
+        TEST_CHECK_EQUAL(0, phantoms);
+    }
+    // A corrupted byte costs the frame it hits, and at most the frames a corrupted length
+    // then swallows.
+    TEST_CHECK(sentCount - intact <= corrupted * 3);
+    printf("%8u %9zu %9lu %9zu %9zu %9u\n", errorsPerMillion, sentCount, corrupted,
+           sentCount - intact, phantoms, decoder.fcsErrors);
+}
+
+/// <summary>
+///     Feeds random bytes to both decoders.
+/// </summary>
+static void FuzzNoise(void)
+{
+    static uint8_t noise[1 << 20];
+    CoordinatorLink_Decoder decoder;
+    size_t gatewayFrames = 0;
+    size_t gatewayLegacy = 0;
+
+    srand(4);
+    for (size_t i = 0; i < sizeof(noise); i++) {
+        noise[i] = (uint8_t)rand();
+    }
+
+    sentCount = 0;
+    receivedCount = 0;
+    CoordinatorLink_InitDecoder(&decoder, OnFrame, OnLegacyReport);
+    for (size_t position = 0; position < sizeof(noise); position += 256) {
+        CoordinatorLink_ProcessBytes(&decoder, &noise[position], 256);
+        for (size_t i = 0; i < receivedCount; i++) {
+            gatewayFrames += !received[i].legacy;
+            gatewayLegacy += received[i].legacy;
+        }
+        receivedCount = 0;
+    }
+
+    ZStackGatewayLink_Init(OnFrame);
+    for (size_t position = 0; position < sizeof(noise); position += 256) {
+        ZStackGatewayLink_Receive(&noise[position], 256);
+    }
+
+    printf("\n1 MiB of noise: gateway %zu frames and %zu legacy reports, coordinator %zu "
+           "frames\n",
+           gatewayFrames, gatewayLegacy, receivedCount);
+}
+
+int main(void)
+{
+    TestEncodeDecode();
+    TestRouteStats();
+    TestCoordinatorToGateway();
+    TestGatewayToCoordinator();
+
+    printf("%8s %9s %9s %9s %9s %9s\n", "errors/M", "frames", "corrupted", "lost", "phantoms",
+           "fcs err");
+    static const unsigned int errorRates[] = {0, 10, 100, 1000, 10000};
+    for (size_t i = 0; i < sizeof(errorRates) / sizeof(errorRates[0]); i++) {
+        FuzzGatewayDecoder(errorRates[i]);
+    }
+    FuzzNoise();
+
+    return TEST_RESULT();
+}
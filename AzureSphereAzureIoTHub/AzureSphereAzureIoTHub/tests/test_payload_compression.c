@@ -0,0 +1,372 @@
+/// \file test_payload_compression.c
+/// \brief Round-trips payloads through PayloadCompression_Compress and a reference LZ4 block
+/// decoder, and reports the compression ratio, throughput and peak working memory on batches
+/// of telemetry messages.
+///
+/// fixtures/telemetry.json holds 256 messages of 6 end devices, one after the other, as
+/// SendSensorReport in main.c serializes them with parson: pretty-printed, with the values of
+/// calibrated channels printed to 17 significant digits. A batch is a JSON array of
+/// consecutive messages.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "payload_compression.h"
+#include "test.h"
+
+#define TELEMETRY_FIXTURE "fixtures/telemetry.json"
+#define MAX_MESSAGES 256
+#define STACK_SIZE (64 * 1024)
+#define STACK_PAINT 0xA5
+
+#define MAX_INPUT_SIZE PAYLOAD_COMPRESSION_MAX_INPUT_SIZE
+
+static uint8_t input[MAX_INPUT_SIZE + 1];
+static uint8_t compressed[MAX_INPUT_SIZE + MAX_INPUT_SIZE / 255 + 16];
+static uint8_t decompressed[MAX_INPUT_SIZE + 1];
+
+// The messages of the fixture, each ending with the '}' of its object.
+static char telemetry[MAX_INPUT_SIZE];
+static size_t messageStart[MAX_MESSAGES];
+static size_t messageEnd[MAX_MESSAGES];
+static unsigned int messageCount;
+
+/// <summary>
+///     Decodes an LZ4 block, checking the end-of-block rules of lz4_Block_format.md: the last
+///     sequence has literals only, the last 5 bytes are literals, and the last match starts at
+///     least 12 bytes before the end.
+/// </summary>
+/// <returns>The decoded size, or -1 if the block is malformed.</returns>
+static long DecodeBlock(const uint8_t *block, size_t blockSize, uint8_t *output,
+                        size_t outputCapacity)
+{
+    size_t ip = 0;
+    size_t op = 0;
+    size_t lastMatchStart = 0;
+    size_t lastMatchEnd = 0;
+
+    while (ip < blockSize) {
+        uint8_t token = block[ip++];
+        size_t length = token >> 4;
+        if (length == 15) {
+            uint8_t extension;
+            do {
+                if (ip >= blockSize) {
+                    return -1;
+                }
+                extension = block[ip++];
+                length += extension;
+            } while (extension == 255);
+        }
+        if ((ip + length > blockSize) || (op + length > outputCapacity)) {
+            return -1;
+        }
+        memcpy(output + op, block + ip, length);
+        ip += length;
+        op += length;
+
+        if (ip == blockSize) {
+            // The last sequence; it must carry no match.
+            if ((token & 0x0F) != 0) {
+                return -1;
+            }
+            break;
+        }
+
+        if (ip + 2 > blockSize) {
+            return -1;
+        }
+        size_t offset = block[ip] | ((size_t)block[ip + 1] << 8);
+        ip += 2;
+        if ((offset == 0) || (offset > op)) {
+            return -1;
+        }
+        length = token & 0x0F;
+        if (length == 15) {
+            uint8_t extension;
+            do {
+                if (ip >= blockSize) {
+                    return -1;
+                }
+                extension = block[ip++];
+                length += extension;
+            } while (extension == 255);
+        }
+        length += 4;
+        if (op + length > outputCapacity) {
+            return -1;
+        }
+        lastMatchStart = op;
+        // Byte by byte, as matches may overlap their own output.
+        for (size_t i = 0; i < length; i++, op++) {
+            output[op] = output[op - offset];
+        }
+        lastMatchEnd = op;
+    }
+
+    if ((lastMatchEnd != 0) && ((op - lastMatchEnd < 5) || (op - lastMatchStart < 12))) {
+        return -1;
+    }
+    return (long)op;
+}
+
+/// <summary>
+///     Compresses a payload and checks that the block decodes back to it. Returns the
+///     compressed size, 0 if the payload was left uncompressed.
+/// </summary>
+static size_t RoundTrip(const uint8_t *payload, size_t payloadSize)
+{
+    size_t compressedSize =
+        PayloadCompression_Compress(payload, payloadSize, compressed, sizeof(compressed));
+    TEST_CHECK(compressedSize <= PayloadCompression_GetMaxCompressedSize(payloadSize));
+    if (compressedSize == 0) {
+        return 0;
+    }
+    TEST_CHECK(compressedSize < payloadSize);
+
+    long decodedSize = DecodeBlock(compressed, compressedSize, decompressed, sizeof(decompressed));
+    TEST_CHECK_EQUAL(payloadSize, decodedSize);
+    TEST_CHECK((decodedSize == (long)payloadSize) &&
+               (memcmp(payload, decompressed, payloadSize) == 0));
+    return compressedSize;
+}
+
+/// <summary>
+///     Loads the messages of the telemetry fixture.
+/// </summary>
+static bool LoadTelemetry(void)
+{
+    FILE *file = fopen(TELEMETRY_FIXTURE, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    size_t size = fread(telemetry, 1, sizeof(telemetry) - 1, file);
+    fclose(file);
+    telemetry[size] = '\0';
+
+    // Each pretty-printed message starts with '{' and ends with '}' at the start of a line.
+    messageCount = 0;
+    for (size_t pos = 0; (pos < size) && (messageCount < MAX_MESSAGES); pos++) {
+        if ((telemetry[pos] == '{') && ((pos == 0) || (telemetry[pos - 1] == '\n'))) {
+            messageStart[messageCount] = pos;
+        } else if ((telemetry[pos] == '}') && (telemetry[pos - 1] == '\n')) {
+            messageEnd[messageCount++] = pos + 1;
+        }
+    }
+    return messageCount == MAX_MESSAGES;
+}
+
+/// <summary>
+///     Fills the input with a batch of consecutive messages of the fixture, as a JSON array,
+///     and returns its size.
+/// </summary>
+static size_t MakeBatch(unsigned int first, unsigned int messages)
+{
+    size_t size = 0;
+    input[size++] = '[';
+    for (unsigned int i = first; (i < first + messages) && (i < messageCount); i++) {
+        size_t length = messageEnd[i] - messageStart[i];
+        if (size + length + 2 > sizeof(input)) {
+            break;
+        }
+        if (i != first) {
+            input[size++] = ',';
+        }
+        memcpy(input + size, telemetry + messageStart[i], length);
+        size += length;
+    }
+    input[size++] = ']';
+    return size;
+}
+
+typedef struct {
+    size_t size;
+    size_t compressedSize;
+} StackProbe;
+
+static void *CompressOnThread(void *context)
+{
+    StackProbe *probe = context;
+    probe->compressedSize =
+        PayloadCompression_Compress(input, probe->size, compressed, sizeof(compressed));
+    return NULL;
+}
+
+/// <summary>
+///     Compresses the input on a thread whose stack is painted beforehand, and returns how many
+///     bytes of that stack the compressor used.
+/// </summary>
+static size_t MeasureStack(size_t size)
+{
+    static uint8_t stack[STACK_SIZE] __attribute__((aligned(16)));
+    memset(stack, STACK_PAINT, sizeof(stack));
+
+    pthread_attr_t attr;
+    pthread_t thread;
+    StackProbe probe = {.size = size};
+    TEST_CHECK(pthread_attr_init(&attr) == 0);
+    TEST_CHECK(pthread_attr_setstack(&attr, stack, sizeof(stack)) == 0);
+    TEST_CHECK(pthread_create(&thread, &attr, CompressOnThread, &probe) == 0);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    // The stack grows down: the lowest byte written marks the deepest use, thread start-up
+    // included.
+    size_t untouched = 0;
+    while ((untouched < sizeof(stack)) && (stack[untouched] == STACK_PAINT)) {
+        untouched++;
+    }
+    return sizeof(stack) - untouched;
+}
+
+static void TestThresholds(void)
+{
+    PayloadCompression_SetEnabled(false);
+    TEST_CHECK(!PayloadCompression_ShouldCompress(4096));
+
+    PayloadCompression_SetEnabled(true);
+    PayloadCompression_SetMinPayloadSize(PAYLOAD_COMPRESSION_DEFAULT_MIN_SIZE);
+    TEST_CHECK(!PayloadCompression_ShouldCompress(PAYLOAD_COMPRESSION_DEFAULT_MIN_SIZE - 1));
+    TEST_CHECK(PayloadCompression_ShouldCompress(PAYLOAD_COMPRESSION_DEFAULT_MIN_SIZE));
+    TEST_CHECK(PayloadCompression_ShouldCompress(MAX_INPUT_SIZE));
+    TEST_CHECK(!PayloadCompression_ShouldCompress(MAX_INPUT_SIZE + 1));
+
+    // Even with no threshold, blocks too short to hold a match are never attempted.
+    PayloadCompression_SetMinPayloadSize(0);
+    TEST_CHECK(!PayloadCompression_ShouldCompress(12));
+    TEST_CHECK(PayloadCompression_ShouldCompress(13));
+    PayloadCompression_SetMinPayloadSize(PAYLOAD_COMPRESSION_DEFAULT_MIN_SIZE);
+    PayloadCompression_SetEnabled(false);
+}
+
+static void TestEdgeSizes(void)
+{
+    memset(input, 'a', sizeof(input));
+    TEST_CHECK_EQUAL(0, PayloadCompression_Compress(input, 12, compressed, sizeof(compressed)));
+    TEST_CHECK_EQUAL(0, PayloadCompression_Compress(input, MAX_INPUT_SIZE + 1, compressed,
+                                                    sizeof(compressed)));
+
+    // Every size from the shortest block that can hold a match up, around the 15 and 255 length
+    // extensions, and the largest block. A 13-byte block is accepted but sent as it is: its only
+    // match candidate would start at 0.
+    TEST_CHECK_EQUAL(0, RoundTrip(input, 13));
+    for (size_t size = 14; size < 600; size++) {
+        TEST_CHECK(RoundTrip(input, size) != 0);
+    }
+    TEST_CHECK(RoundTrip(input, MAX_INPUT_SIZE) != 0);
+
+    // Matches at the largest offset.
+    srand(1);
+    for (size_t i = 0; i < MAX_INPUT_SIZE; i++) {
+        input[i] = (uint8_t)rand();
+    }
+    memcpy(input + MAX_INPUT_SIZE - 64, input + 1, 40);
+    RoundTrip(input, MAX_INPUT_SIZE);
+}
+
+static void TestIncompressible(void)
+{
+    srand(2);
+    for (size_t i = 0; i < 4096; i++) {
+        input[i] = (uint8_t)rand();
+    }
+    TEST_CHECK_EQUAL(0, RoundTrip(input, 4096));
+}
+
+static void TestOutputCapacity(void)
+{
+    size_t size = MakeBatch(0, 2);
+    size_t compressedSize = RoundTrip(input, size);
+    TEST_CHECK(compressedSize != 0);
+
+    // Any buffer smaller than the block fails cleanly, without writing past its end.
+    for (size_t capacity = 0; capacity < compressedSize; capacity++) {
+        uint8_t *output = malloc(capacity + 1);
+        TEST_CHECK_EQUAL(0, PayloadCompression_Compress(input, size, output, capacity));
+        free(output);
+    }
+    TEST_CHECK_EQUAL(compressedSize,
+                     PayloadCompression_Compress(input, size, compressed, compressedSize));
+}
+
+static void TestRandomPayloads(void)
+{
+    // Text over a small alphabet, so that matches of every length and offset turn up.
+    srand(4);
+    for (int run = 0; run < 200; run++) {
+        size_t size = 13 + (size_t)rand() % 8192;
+        int alphabet = 2 + rand() % 16;
+        for (size_t i = 0; i < size; i++) {
+            input[i] = (uint8_t)('a' + rand() % alphabet);
+        }
+        RoundTrip(input, size);
+    }
+}
+
+/// <summary>
+///     Prints the ratio, throughput and peak working memory of the compressor on batches of
+///     the fixture's messages: each batch size over the whole fixture, and the largest
+///     batch. The peak memory is the static hash table, the output buffer createMessage
+///     allocates, and the stack.
+/// </summary>
+static void ReportRatioAndThroughput(void)
+{
+    static const unsigned int messageCounts[] = {1, 2, 4, 16, 64, 256};
+
+    printf("%8s %8s %8s %8s %8s %8s %8s %8s\n", "messages", "batches", "bytes", "ratio", "MB/s",
+           "table", "output", "stack");
+    for (size_t i = 0; i < sizeof(messageCounts) / sizeof(messageCounts[0]); i++) {
+        // The ratio over every batch of this size in the fixture.
+        unsigned int batches = 0;
+        size_t totalSize = 0;
+        size_t totalCompressed = 0;
+        for (unsigned int first = 0; first + messageCounts[i] <= messageCount;
+             first += messageCounts[i]) {
+            size_t batchSize = MakeBatch(first, messageCounts[i]);
+            size_t batchCompressed = RoundTrip(input, batchSize);
+            totalSize += batchSize;
+            totalCompressed += batchCompressed ? batchCompressed : batchSize;
+            batches++;
+        }
+
+        size_t size = MakeBatch(0, messageCounts[i]);
+        size_t stackUsed = MeasureStack(size);
+
+        struct timespec start, end;
+        unsigned int runs = 0;
+        size_t total = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            PayloadCompression_Compress(input, size, compressed, sizeof(compressed));
+            total += size;
+            runs++;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+        } while ((end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec) <
+                 50000000L);
+        double seconds =
+            (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+        printf("%8u %8u %8zu %8.2f %8.1f %8zu %8zu %8zu\n", messageCounts[i], batches,
+               totalSize / batches, (double)totalSize / (double)totalCompressed,
+               (double)total / seconds / 1e6, PayloadCompression_GetWorkingMemorySize(),
+               PayloadCompression_GetMaxCompressedSize(size), stackUsed);
+    }
+    printf("Bytes are per batch; table, output and stack are the peak working memory. The\n"
+           "stack includes the thread's start-up, and the sanitizers of a test build.\n");
+}
+
+int main(void)
+{
+    TEST_CHECK(LoadTelemetry());
+    if (messageCount != MAX_MESSAGES) {
+        return TEST_RESULT();
+    }
+    TestThresholds();
+    TestEdgeSizes();
+    TestIncompressible();
+    TestOutputCapacity();
+    TestRandomPayloads();
+    ReportRatioAndThroughput();
+    return TEST_RESULT();
+}
@@ -0,0 +1,200 @@
+/// \file test_report_batch.c
+/// \brief Tests the reader of the report batches of the coordinator against the record layout of
+/// coordinator.c: batches filled as the coordinator fills them, with sensor report frames of the
+/// end device and legacy reports, and batches cut short at every length.
+
+#include <stdlib.h>
+#include <string.h>
+#include "coordinator_link.h"
+#include "sensor_frame.h"
+#include "test.h"
+#include "zstack_gateway_link.h"
+#include "zstack_sensor_frame.h"
+
+#define MAX_RECORDS 32
+#define MAX_REPORT_SIZE 48 // SENSORFRAME_MAX_LEN
+
+typedef struct {
+    uint16_t nwkAddr;
+    uint8_t deviceIndex;
+    uint8_t linkQuality;
+    uint8_t report[MAX_REPORT_SIZE];
+    size_t reportSize;
+} Record;
+
+typedef struct {
+    uint8_t data[COORDINATOR_LINK_MAX_DATA_SIZE];
+    size_t size;
+    Record records[MAX_RECORDS];
+    size_t count;
+} Batch;
+
+/// <summary>
+///     Makes a random report: mostly sensor report frames as the coordinator builds them, some
+///     legacy.
+/// </summary>
+static size_t MakeReport(uint8_t *report, unsigned int number)
+{
+    if (rand() % 4 == 0) {
+        report[0] = COORDINATOR_LINK_LEGACY_REPORT_START;
+        report[1] = (uint8_t)('0' + number % 10);
+        for (size_t i = 2; i < COORDINATOR_LINK_LEGACY_REPORT_SIZE; i++) {
+            report[i] = (uint8_t)('0' + rand() % 10);
+        }
+        return COORDINATOR_LINK_LEGACY_REPORT_SIZE;
+    }
+
+    int32_t values[SensorFrame_Tlv_Max + 1];
+    for (size_t i = 0; i <= SensorFrame_Tlv_Max; i++) {
+        values[i] = rand() & 0x7FFF;
+    }
+    values[SensorFrame_Tlv_Pir] &= 1;
+    uint32_t present = (uint32_t)rand() & 0xFE; // types 1 to 7
+    return ZStackSensorFrame_Encode(report, MAX_REPORT_SIZE, (uint16_t)number,
+                                    (uint8_t)number, present, values);
+}
+
+/// <summary>
+///     Fills a batch as GenericApp_AddReportRecord does: records are added while they fit in
+///     GATEWAYLINK_MAX_DATA_LEN bytes.
+/// </summary>
+static void FillBatch(Batch *batch, unsigned int *number)
+{
+    batch->size = 0;
+    batch->count = 0;
+    for (;;) {
+        Record *record = &batch->records[batch->count];
+        record->nwkAddr = (uint16_t)rand();
+        record->deviceIndex = (rand() % 8 == 0) ? COORDINATOR_LINK_NO_DEVICE_INDEX
+                                                : (uint8_t)(rand() % 128);
+        record->linkQuality = (uint8_t)rand();
+        record->reportSize = MakeReport(record->report, (*number)++);
+        if (batch->size + COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE + record->reportSize >
+            sizeof(batch->data)) {
+            return;
+        }
+        batch->size = ZStackGatewayLink_AddBatchRecord(
+            batch->data, batch->size, record->nwkAddr, record->deviceIndex,
+            record->linkQuality, record->report, record->reportSize);
+        batch->count++;
+    }
+}
+
+static bool SameRecord(const Record *expected, const CoordinatorLink_BatchRecord *actual)
+{
+    return (expected->nwkAddr == actual->nwkAddr) &&
+           (expected->deviceIndex == actual->deviceIndex) &&
+           (expected->linkQuality == actual->linkQuality) &&
+           (expected->reportSize == actual->reportSize) &&
+           (memcmp(expected->report, actual->report, actual->reportSize) == 0);
+}
+
+static void TestLayout(void)
+{
+    // A record as coordinator.c writes it: NWK address LSB first, index, LQI, size, report.
+    static const uint8_t report[] = {1, 2, 3};
+    uint8_t data[16];
+    size_t size = ZStackGatewayLink_AddBatchRecord(data, 0, 0x1234, 7, 200, report, 3);
+    TEST_CHECK_EQUAL(COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE + 3, size);
+
+    size_t pos = 0;
+    CoordinatorLink_BatchRecord record;
+    TEST_CHECK(CoordinatorLink_ReadBatchRecord(data, size, &pos, &record));
+    TEST_CHECK_EQUAL(0x1234, record.nwkAddr);
+    TEST_CHECK_EQUAL(7, record.deviceIndex);
+    TEST_CHECK_EQUAL(200, record.linkQuality);
+    TEST_CHECK_EQUAL(3, record.reportSize);
+    TEST_CHECK(record.report == &data[COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE]);
+    TEST_CHECK_EQUAL(size, pos);
+    TEST_CHECK(!CoordinatorLink_ReadBatchRecord(data, size, &pos, &record));
+    TEST_CHECK_EQUAL(size, pos);
+
+    // An empty batch, and a record with an empty report.
+    pos = 0;
+    TEST_CHECK(!CoordinatorLink_ReadBatchRecord(data, 0, &pos, &record));
+    TEST_CHECK_EQUAL(0, pos);
+    size = ZStackGatewayLink_AddBatchRecord(data, 0, 1, 2, 3, report, 0);
+    TEST_CHECK(CoordinatorLink_ReadBatchRecord(data, size, &pos, &record));
+    TEST_CHECK_EQUAL(0, record.reportSize);
+    TEST_CHECK_EQUAL(size, pos);
+
+    // A size byte that runs past the end of the data.
+    data[4] = 0xFF;
+    pos = 0;
+    TEST_CHECK(!CoordinatorLink_ReadBatchRecord(data, sizeof(data), &pos, &record));
+    TEST_CHECK_EQUAL(0, pos);
+}
+
+static void TestFullBatches(void)
+{
+    Batch batch;
+    unsigned int number = 0;
+    size_t records = 0;
+    srand(1);
+    for (int run = 0; run < 10000; run++) {
+        FillBatch(&batch, &number);
+
+        size_t pos = 0;
+        size_t count = 0;
+        CoordinatorLink_BatchRecord record;
+        while (CoordinatorLink_ReadBatchRecord(batch.data, batch.size, &pos, &record)) {
+            TEST_CHECK(count < batch.count && SameRecord(&batch.records[count], &record));
+            SensorFrame_Report report;
+            if (record.report[0] == COORDINATOR_LINK_LEGACY_REPORT_START) {
+                TEST_CHECK(SensorFrame_DecodeLegacy(record.report, &report));
+            } else {
+                TEST_CHECK_EQUAL(SensorFrame_Result_Ok,
+                                 SensorFrame_Decode(record.report, record.reportSize, &report));
+            }
+            count++;
+        }
+        TEST_CHECK_EQUAL(batch.count, count);
+        TEST_CHECK_EQUAL(batch.size, pos);
+        records += count;
+    }
+    printf("%zu records in 10000 batches, %.1f per batch\n", records, records / 10000.0);
+}
+
+static void TestTruncatedBatches(void)
+{
+    Batch batch;
+    unsigned int number = 0;
+    srand(2);
+    for (int run = 0; run < 1000; run++) {
+        FillBatch(&batch, &number);
+
+        // Cut short, the batch yields the records it holds whole, and stops short of the cut
+        // unless the cut falls between records.
+        size_t boundary = 0;
+        size_t whole = 0;
+        for (size_t cut = 0; cut <= batch.size; cut++) {
+            if ((whole < batch.count) &&
+                (cut == boundary + COORDINATOR_LINK_BATCH_RECORD_HEADER_SIZE +
+                            batch.records[whole].reportSize)) {
+                boundary = cut;
+                whole++;
+            }
+            uint8_t *data = malloc(cut ? cut : 1);
+            memcpy(data, batch.data, cut);
+
+            size_t pos = 0;
+            size_t count = 0;
+            CoordinatorLink_BatchRecord record;
+            while (CoordinatorLink_ReadBatchRecord(data, cut, &pos, &record)) {
+                TEST_CHECK(SameRecord(&batch.records[count], &record));
+                count++;
+            }
+            TEST_CHECK_EQUAL(whole, count);
+            TEST_CHECK_EQUAL(boundary, pos);
+            free(data);
+        }
+    }
+}
+
+int main(void)
+{
+    TestLayout();
+    TestFullBatches();
+    TestTruncatedBatches();
+    return TEST_RESULT();
+}
@@ -0,0 +1,178 @@
+/// \file test_sensor_calibration.c
+/// \brief Tests the fixed-point calibration tables: interpolation, extrapolation, the table a
+/// device falls back to, loading from the device twin, saturation of readings that scale out of
+/// range, and readings in hundredths.
+
+#include <stdlib.h>
+#include "sensor_calibration.h"
+#include "test.h"
+
+#define SCALE SENSOR_CALIBRATION_SCALE
+
+static void TestPassThroughAndOffset(void)
+{
+    SensorCalibration_Init();
+    TEST_CHECK_EQUAL(25 * SCALE,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Temperature, 25));
+    TEST_CHECK_EQUAL(-40 * SCALE,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Temperature, -40));
+
+    // One point is an offset: raw 20 reads 21.5.
+    SensorCalibration_Point offset = {20, 21500};
+    TEST_CHECK(SensorCalibration_SetTable(false, 1, SensorCalibration_Channel_Temperature,
+                                          &offset, 1));
+    TEST_CHECK_EQUAL(26500, SensorCalibration_Apply(1, SensorCalibration_Channel_Temperature, 25));
+    // Other devices and channels are unaffected.
+    TEST_CHECK_EQUAL(25 * SCALE,
+                     SensorCalibration_Apply(2, SensorCalibration_Channel_Temperature, 25));
+    TEST_CHECK_EQUAL(25 * SCALE,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Humidity, 25));
+}
+
+static void TestSaturation(void)
+{
+    // Raw readings from 4-byte TLVs scale out of the int32 range; they saturate instead of
+    // overflowing.
+    SensorCalibration_Init();
+    TEST_CHECK_EQUAL(INT32_MAX,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Light, 3000000));
+    TEST_CHECK_EQUAL(INT32_MIN,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Light, -3000000));
+    TEST_CHECK_EQUAL(INT32_MAX,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Light, INT32_MAX));
+    TEST_CHECK_EQUAL(INT32_MIN,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Count, INT32_MIN));
+    TEST_CHECK_EQUAL(2147483000,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Light, 2147483));
+
+    SensorCalibration_Point offset = {-100, INT32_MAX - 5};
+    TEST_CHECK(SensorCalibration_SetTable(false, 1, SensorCalibration_Channel_Light, &offset, 1));
+    TEST_CHECK_EQUAL(INT32_MAX, SensorCalibration_Apply(1, SensorCalibration_Channel_Light, 0));
+    TEST_CHECK_EQUAL(INT32_MAX,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Light, INT32_MAX));
+    TEST_CHECK_EQUAL(INT32_MIN,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Light, INT32_MIN));
+    TEST_CHECK_EQUAL(INT32_MAX - 5,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Light, -100));
+
+    // The steepest slope, extrapolated over the whole raw range.
+    SensorCalibration_Point steep[] = {{0, 0}, {1, 32767}};
+    TEST_CHECK(SensorCalibration_SetTable(false, 1, SensorCalibration_Channel_Gas, steep, 2));
+    TEST_CHECK_EQUAL(INT32_MAX,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Gas, INT32_MAX));
+    TEST_CHECK_EQUAL(INT32_MIN,
+                     SensorCalibration_Apply(1, SensorCalibration_Channel_Gas, INT32_MIN));
+}
+
+static void TestPiecewise(void)
+{
+    SensorCalibration_Init();
+    SensorCalibration_Point points[] = {{0, 0}, {100, 50000}, {200, 60000}};
+    TEST_CHECK(SensorCalibration_SetTable(true, 0, SensorCalibration_Channel_Light, points, 3));
+
+    // Every device without a table of its own uses the default one.
+    TEST_CHECK_EQUAL(25000, SensorCalibration_Apply(7, SensorCalibration_Channel_Light, 50));
+    TEST_CHECK_EQUAL(50000, SensorCalibration_Apply(8, SensorCalibration_Channel_Light, 100));
+    TEST_CHECK_EQUAL(55000, SensorCalibration_Apply(7, SensorCalibration_Channel_Light, 150));
+    // Extrapolated from the first and last segments.
+    TEST_CHECK_EQUAL(-5000, SensorCalibration_Apply(7, SensorCalibration_Channel_Light, -10));
+    TEST_CHECK_EQUAL(70000, SensorCalibration_Apply(7, SensorCalibration_Channel_Light, 300));
+    // Rounded to the nearest unit: 1/3 of the way along a 1000-unit rise.
+    SensorCalibration_Point thirds[] = {{0, 0}, {3, 1000}};
+    TEST_CHECK(SensorCalibration_SetTable(false, 9, SensorCalibration_Channel_Light, thirds, 2));
+    TEST_CHECK_EQUAL(333, SensorCalibration_Apply(9, SensorCalibration_Channel_Light, 1));
+    TEST_CHECK_EQUAL(667, SensorCalibration_Apply(9, SensorCalibration_Channel_Light, 2));
+
+    // Tables must be sorted by strictly increasing raw reading.
+    SensorCalibration_Point unsorted[] = {{10, 0}, {10, 5}};
+    TEST_CHECK(
+        !SensorCalibration_SetTable(false, 1, SensorCalibration_Channel_Light, unsorted, 2));
+}
+
+static void TestCenti(void)
+{
+    // Readings in hundredths, from ZCL end devices, go through the same tables as whole ones
+    // and keep their resolution.
+    SensorCalibration_Init();
+    TEST_CHECK_EQUAL(21370,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Temperature, 2137));
+    TEST_CHECK_EQUAL(-2450,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Temperature, -245));
+    SensorCalibration_Point offset = {20, 21500};
+    TEST_CHECK(SensorCalibration_SetTable(false, 1, SensorCalibration_Channel_Temperature,
+                                          &offset, 1));
+    TEST_CHECK_EQUAL(26500,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Temperature, 2500));
+    TEST_CHECK_EQUAL(26510,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Temperature, 2501));
+
+    SensorCalibration_Point points[] = {{0, 0}, {100, 50000}, {200, 60000}};
+    TEST_CHECK(SensorCalibration_SetTable(false, 1, SensorCalibration_Channel_Humidity, points, 3));
+    for (int32_t raw = -300; raw <= 300; raw++) {
+        TEST_CHECK_EQUAL(SensorCalibration_Apply(1, SensorCalibration_Channel_Humidity, raw),
+                         SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Humidity,
+                                                      raw * 100));
+    }
+    TEST_CHECK_EQUAL(5,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Humidity, 1));
+    TEST_CHECK_EQUAL(50005,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Humidity, 10005));
+    TEST_CHECK_EQUAL(-5,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Humidity, -1));
+    TEST_CHECK_EQUAL(INT32_MIN,
+                     SensorCalibration_ApplyCenti(1, SensorCalibration_Channel_Humidity,
+                                                  INT32_MIN));
+}
+
+static void TestLoadFromJson(void)
+{
+    SensorCalibration_Init();
+    JSON_Value *value = json_parse_string(
+        "{ \"default\": { \"Light\": [[0, 0], [255, 1000.5]] },"
+        "  \"3\": { \"Gas\": [[0, 0], [99, 50]], \"Temperature\": [[20, 21.5]] } }");
+    TEST_CHECK_EQUAL(3, SensorCalibration_LoadFromJson(json_value_get_object(value)));
+    json_value_free(value);
+    TEST_CHECK_EQUAL(1000500, SensorCalibration_Apply(1, SensorCalibration_Channel_Light, 255));
+    TEST_CHECK_EQUAL(50000, SensorCalibration_Apply(3, SensorCalibration_Channel_Gas, 99));
+    TEST_CHECK_EQUAL(26500, SensorCalibration_Apply(3, SensorCalibration_Channel_Temperature, 25));
+
+    // A malformed property keeps the tables in place.
+    value = json_parse_string("{ \"3\": { \"Gas\": [[0, 0], [0, 50]] } }");
+    TEST_CHECK_EQUAL(-1, SensorCalibration_LoadFromJson(json_value_get_object(value)));
+    json_value_free(value);
+    TEST_CHECK_EQUAL(50000, SensorCalibration_Apply(3, SensorCalibration_Channel_Gas, 99));
+
+    // Directory indexes have tables of their own, apart from the device ids of the same number.
+    value = json_parse_string("{ \"3\": { \"Gas\": [[0, 0], [99, 50]] },"
+                              "  \"index:3\": { \"Gas\": [[0, 0], [99, 25]] } }");
+    TEST_CHECK_EQUAL(2, SensorCalibration_LoadFromJson(json_value_get_object(value)));
+    json_value_free(value);
+    TEST_CHECK_EQUAL(50000, SensorCalibration_Apply(3, SensorCalibration_Channel_Gas, 99));
+    TEST_CHECK_EQUAL(25000, SensorCalibration_Apply(SENSOR_CALIBRATION_INDEX_ID(3),
+                                                    SensorCalibration_Channel_Gas, 99));
+    TEST_CHECK_EQUAL(99000, SensorCalibration_Apply(SENSOR_CALIBRATION_INDEX_ID(4),
+                                                    SensorCalibration_Channel_Gas, 99));
+
+    // Indexes run up to 254; 255 means unknown to the coordinator.
+    static const char *badKeys[] = {"index:255", "index:", "index:-1", "-1", "65536", "", "x"};
+    for (size_t i = 0; i < sizeof(badKeys) / sizeof(badKeys[0]); i++) {
+        char json[64];
+        snprintf(json, sizeof(json), "{ \"%s\": { \"Gas\": [[0, 0]] } }", badKeys[i]);
+        value = json_parse_string(json);
+        TEST_CHECK_EQUAL(-1, SensorCalibration_LoadFromJson(json_value_get_object(value)));
+        json_value_free(value);
+    }
+    value = json_parse_string("{ \"index:254\": { \"Gas\": [[0, 0]] } }");
+    TEST_CHECK_EQUAL(1, SensorCalibration_LoadFromJson(json_value_get_object(value)));
+    json_value_free(value);
+}
+
+int main(void)
+{
+    TestPassThroughAndOffset();
+    TestSaturation();
+    TestPiecewise();
+    TestCenti();
+    TestLoadFromJson();
+    return TEST_RESULT();
+}
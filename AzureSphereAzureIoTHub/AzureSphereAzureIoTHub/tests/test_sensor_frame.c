@@ -0,0 +1,201 @@
+/// \file test_sensor_frame.c
+/// \brief Tests the sensor report decoder against the coordinator's encoder: CRC agreement,
+/// round trips of random reports, and rejection of corrupted, truncated and malformed frames.
+
+#include <stdlib.h>
+#include <string.h>
+#include "sensor_frame.h"
+#include "test.h"
+#include "zstack_sensor_frame.h"
+
+#define MAX_FRAME_SIZE 48 // SENSORFRAME_MAX_LEN
+
+// The types of legacy reports, and all of them.
+static const uint32_t legacyTypes = (1u << SensorFrame_Tlv_Temperature) |
+                                    (1u << SensorFrame_Tlv_Humidity) |
+                                    (1u << SensorFrame_Tlv_Light) | (1u << SensorFrame_Tlv_Gas) |
+                                    (1u << SensorFrame_Tlv_Pir);
+static const uint32_t allTypes = legacyTypes | (1u << SensorFrame_Tlv_TemperatureCenti) |
+                                 (1u << SensorFrame_Tlv_HumidityCenti);
+
+/// <summary>
+///     Rewrites the CRC of a frame after it was edited.
+/// </summary>
+static void ResealFrame(uint8_t *frame, size_t frameSize)
+{
+    uint16_t crc = SensorFrame_Crc16(frame, frameSize - SENSOR_FRAME_CRC_SIZE);
+    frame[frameSize - 2] = (uint8_t)(crc & 0xFF);
+    frame[frameSize - 1] = (uint8_t)(crc >> 8);
+}
+
+static void RandomValues(int32_t *values)
+{
+    values[SensorFrame_Tlv_Temperature] = (int16_t)rand();
+    values[SensorFrame_Tlv_Humidity] = rand() & 0xFFFF;
+    values[SensorFrame_Tlv_Light] = rand() & 0xFFFF;
+    values[SensorFrame_Tlv_Gas] = rand() & 0xFFFF;
+    values[SensorFrame_Tlv_Pir] = rand() & 1;
+    values[SensorFrame_Tlv_TemperatureCenti] = (int16_t)rand();
+    values[SensorFrame_Tlv_HumidityCenti] = rand() & 0xFFFF;
+}
+
+static void TestCrc(void)
+{
+    // The check value of CRC-16/CCITT-FALSE.
+    static const uint8_t check[] = "123456789";
+    TEST_CHECK_EQUAL(0x29B1, SensorFrame_Crc16(check, 9));
+    TEST_CHECK_EQUAL(0x29B1, ZStackSensorFrame_Crc16(check, 9));
+    TEST_CHECK_EQUAL(0xFFFF, SensorFrame_Crc16(check, 0));
+
+    // The table-driven CRC of the gateway matches the bitwise one of the end device.
+    uint8_t data[255];
+    srand(1);
+    for (int run = 0; run < 1000; run++) {
+        size_t size = (size_t)rand() % sizeof(data);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = (uint8_t)rand();
+        }
+        TEST_CHECK_EQUAL(ZStackSensorFrame_Crc16(data, size), SensorFrame_Crc16(data, size));
+    }
+}
+
+static void TestRoundTrip(void)
+{
+    uint8_t frame[MAX_FRAME_SIZE];
+    int32_t values[SensorFrame_Tlv_Max + 1] = {0};
+    srand(2);
+
+    for (int run = 0; run < 10000; run++) {
+        uint32_t present = (uint32_t)rand() & allTypes;
+        uint16_t seq = (uint16_t)rand();
+        uint8_t deviceId = (uint8_t)rand();
+        RandomValues(values);
+
+        size_t frameSize =
+            ZStackSensorFrame_Encode(frame, sizeof(frame), seq, deviceId, present, values);
+        TEST_CHECK(frameSize != 0);
+        TEST_CHECK(ZStackSensorFrame_Check(frame, frameSize));
+
+        SensorFrame_Report report;
+        TEST_CHECK_EQUAL(SensorFrame_Result_Ok, SensorFrame_Decode(frame, frameSize, &report));
+        TEST_CHECK_EQUAL(SENSOR_FRAME_VERSION, report.version);
+        TEST_CHECK_EQUAL(seq, report.seq);
+        TEST_CHECK_EQUAL(deviceId, report.deviceId);
+        TEST_CHECK_EQUAL(present, report.present);
+        for (int type = SensorFrame_Tlv_Temperature; type <= SensorFrame_Tlv_Max; type++) {
+            if (present & (1u << type)) {
+                TEST_CHECK_EQUAL(values[type], report.values[type]);
+            }
+        }
+    }
+
+    // The encoder refuses frames larger than their buffer.
+    TEST_CHECK_EQUAL(0, ZStackSensorFrame_Encode(frame, 10, 1, 1, allTypes, values));
+    TEST_CHECK_EQUAL(0, ZStackSensorFrame_Encode(frame, 5, 1, 1, 0, values));
+}
+
+static void TestCorruption(void)
+{
+    uint8_t frame[MAX_FRAME_SIZE];
+    int32_t values[SensorFrame_Tlv_Max + 1];
+    SensorFrame_Report report;
+    srand(3);
+    RandomValues(values);
+    size_t frameSize = ZStackSensorFrame_Encode(frame, sizeof(frame), 0x1234, 7, allTypes, values);
+
+    // Every single-bit error, and every two-bit error within 16 bits, is caught by the CRC.
+    for (size_t bit = 0; bit < frameSize * 8; bit++) {
+        frame[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        SensorFrame_Result result = SensorFrame_Decode(frame, frameSize, &report);
+        TEST_CHECK(result != SensorFrame_Result_Ok);
+        TEST_CHECK(!ZStackSensorFrame_Check(frame, frameSize));
+        for (size_t other = bit + 1; (other < bit + 16) && (other < frameSize * 8); other++) {
+            frame[other / 8] ^= (uint8_t)(1u << (other % 8));
+            TEST_CHECK(SensorFrame_Decode(frame, frameSize, &report) != SensorFrame_Result_Ok);
+            frame[other / 8] ^= (uint8_t)(1u << (other % 8));
+        }
+        frame[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+    }
+    TEST_CHECK_EQUAL(SensorFrame_Result_Ok, SensorFrame_Decode(frame, frameSize, &report));
+
+    // Every truncation is rejected.
+    for (size_t size = 0; size < frameSize; size++) {
+        TEST_CHECK(SensorFrame_Decode(frame, size, &report) != SensorFrame_Result_Ok);
+    }
+    TEST_CHECK_EQUAL(SensorFrame_Result_Truncated, SensorFrame_Decode(frame, 5, &report));
+}
+
+static void TestMalformed(void)
+{
+    SensorFrame_Report report;
+
+    // A TLV of an unknown type is skipped, whatever its length.
+    uint8_t unknown[] = {SENSOR_FRAME_VERSION, 1, 0, 2, 0x7F, 3, 9, 9, 9, 0x05, 1, 1, 0, 0};
+    ResealFrame(unknown, sizeof(unknown));
+    TEST_CHECK_EQUAL(SensorFrame_Result_Ok, SensorFrame_Decode(unknown, sizeof(unknown), &report));
+    TEST_CHECK_EQUAL(1u << SensorFrame_Tlv_Pir, report.present);
+    TEST_CHECK(ZStackSensorFrame_Check(unknown, sizeof(unknown)));
+
+    // A 4-byte value, which the coordinator uses for values built from ZCL reports.
+    uint8_t wide[] = {SENSOR_FRAME_VERSION, 1, 0, 2, 0x03, 4, 0x40, 0x42, 0x0F, 0x00, 0, 0};
+    ResealFrame(wide, sizeof(wide));
+    TEST_CHECK_EQUAL(SensorFrame_Result_Ok, SensorFrame_Decode(wide, sizeof(wide), &report));
+    TEST_CHECK_EQUAL(1000000, report.values[SensorFrame_Tlv_Light]);
+
+    // The hundredths of a ZCL temperature below zero and of a humidity above 327.67.
+    uint8_t centi[] = {SENSOR_FRAME_VERSION, 1, 0, 2, 0x06, 2, 0x0B, 0xFF, 0x07, 2, 0x10, 0x27,
+                       0, 0};
+    ResealFrame(centi, sizeof(centi));
+    TEST_CHECK_EQUAL(SensorFrame_Result_Ok, SensorFrame_Decode(centi, sizeof(centi), &report));
+    TEST_CHECK_EQUAL(-245, report.values[SensorFrame_Tlv_TemperatureCenti]);
+    TEST_CHECK_EQUAL(10000, report.values[SensorFrame_Tlv_HumidityCenti]);
+
+    // A known type with a length the decoder does not handle.
+    uint8_t badLength[] = {SENSOR_FRAME_VERSION, 1, 0, 2, 0x01, 3, 1, 2, 3, 0, 0};
+    ResealFrame(badLength, sizeof(badLength));
+    TEST_CHECK_EQUAL(SensorFrame_Result_BadTlv,
+                     SensorFrame_Decode(badLength, sizeof(badLength), &report));
+
+    // A TLV running into the CRC, with a valid CRC.
+    uint8_t overrun[] = {SENSOR_FRAME_VERSION, 1, 0, 2, 0x02, 4, 1, 0, 0};
+    ResealFrame(overrun, sizeof(overrun));
+    TEST_CHECK_EQUAL(SensorFrame_Result_BadTlv,
+                     SensorFrame_Decode(overrun, sizeof(overrun), &report));
+    TEST_CHECK(!ZStackSensorFrame_Check(overrun, sizeof(overrun)));
+
+    // A lone type byte before the CRC.
+    uint8_t dangling[] = {SENSOR_FRAME_VERSION, 1, 0, 2, 0x02, 0, 0};
+    ResealFrame(dangling, sizeof(dangling));
+    TEST_CHECK_EQUAL(SensorFrame_Result_BadTlv,
+                     SensorFrame_Decode(dangling, sizeof(dangling), &report));
+
+    uint8_t version[] = {0x02, 1, 0, 2, 0, 0};
+    ResealFrame(version, sizeof(version));
+    TEST_CHECK_EQUAL(SensorFrame_Result_UnknownVersion,
+                     SensorFrame_Decode(version, sizeof(version), &report));
+}
+
+static void TestLegacy(void)
+{
+    SensorFrame_Report report;
+    TEST_CHECK(SensorFrame_DecodeLegacy((const uint8_t *)"S3254178921", &report));
+    TEST_CHECK_EQUAL(0, report.version);
+    TEST_CHECK_EQUAL(3, report.deviceId);
+    TEST_CHECK_EQUAL(25, report.values[SensorFrame_Tlv_Temperature]);
+    TEST_CHECK_EQUAL(41, report.values[SensorFrame_Tlv_Humidity]);
+    TEST_CHECK_EQUAL(78, report.values[SensorFrame_Tlv_Light]);
+    TEST_CHECK_EQUAL(92, report.values[SensorFrame_Tlv_Gas]);
+    TEST_CHECK_EQUAL(1, report.values[SensorFrame_Tlv_Pir]);
+    TEST_CHECK_EQUAL(legacyTypes, report.present);
+    TEST_CHECK(!SensorFrame_DecodeLegacy((const uint8_t *)"\x01" "3254178921", &report));
+}
+
+int main(void)
+{
+    TestCrc();
+    TestRoundTrip();
+    TestCorruption();
+    TestMalformed();
+    TestLegacy();
+    return TEST_RESULT();
+}
@@ -0,0 +1,378 @@
+/// \file test_uart_tx_queue.c
+/// \brief Stress test of the UART transmit queue over a non-blocking stream socket with a small
+/// send buffer, registered with epoll as the UART is in main.c.
+///
+/// A producer queues frames faster than a consumer reads the other end of the socket, so that
+/// writes are partial and the queue fills up. The consumer checks that the byte stream is made
+/// of whole frames, in order: all of them with the Reject policy, and all but the dropped ones
+/// with DropOldest. EPOLLOUT must be reported exactly while frames are pending.
+///
+/// A second test runs the queue on a pseudo-terminal in raw mode, driven by an epoll loop as
+/// in main.c, with a 1 ms timer standing for the app's other timers. The other end reads the
+/// bytes at 9600 baud, so the queue stays full. It checks that the timer keeps firing on time
+/// and that no call into the queue blocks, and reports the queueing latency of the frames.
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "uart_tx_queue.h"
+#include "test.h"
+
+#define SEND_BUFFER_SIZE 2048
+#define FRAME_HEADER_SIZE 4
+
+// Frames carry their number, and their size and contents follow from it.
+static size_t FrameSize(uint32_t number)
+{
+    return FRAME_HEADER_SIZE + 1 + number % (UART_TX_QUEUE_MAX_FRAME_SIZE - FRAME_HEADER_SIZE);
+}
+
+static size_t MakeFrame(uint32_t number, uint8_t *frame)
+{
+    size_t size = FrameSize(number);
+    memcpy(frame, &number, FRAME_HEADER_SIZE);
+    for (size_t i = FRAME_HEADER_SIZE; i < size; i++) {
+        frame[i] = (uint8_t)(number * 31 + i);
+    }
+    return size;
+}
+
+/// <summary>
+///     Reassembles the frames read from the pipe.
+/// </summary>
+typedef struct {
+    uint8_t frame[UART_TX_QUEUE_MAX_FRAME_SIZE];
+    size_t position;
+    uint32_t expectedNumber;
+    unsigned long framesReceived;
+    unsigned long framesSkipped;
+    bool corrupt;
+} Receiver;
+
+static void Receive(Receiver *receiver, const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; (i < size) && !receiver->corrupt; i++) {
+        receiver->frame[receiver->position++] = data[i];
+        if (receiver->position < FRAME_HEADER_SIZE) {
+            continue;
+        }
+        uint32_t number;
+        memcpy(&number, receiver->frame, FRAME_HEADER_SIZE);
+        if (number < receiver->expectedNumber) {
+            receiver->corrupt = true;
+            break;
+        }
+        if (receiver->position < FrameSize(number)) {
+            continue;
+        }
+        uint8_t expected[UART_TX_QUEUE_MAX_FRAME_SIZE];
+        MakeFrame(number, expected);
+        if (memcmp(expected, receiver->frame, receiver->position) != 0) {
+            receiver->corrupt = true;
+            break;
+        }
+        receiver->framesSkipped += number - receiver->expectedNumber;
+        receiver->framesReceived++;
+        receiver->expectedNumber = number + 1;
+        receiver->position = 0;
+    }
+}
+
+/// <summary>
+///     Returns whether epoll reports the UART as writable now.
+/// </summary>
+static bool IsWritableReported(int epollFd)
+{
+    struct epoll_event event;
+    return (epoll_wait(epollFd, &event, 1, 0) == 1) && ((event.events & EPOLLOUT) != 0);
+}
+
+static void RunStress(UartTxQueue_OverflowPolicy policy, unsigned int readChunk,
+                      unsigned int frames)
+{
+    // A stream socket takes part of a write when its buffer is nearly full, as a UART does.
+    int socketFds[2];
+    int sendBufferSize = SEND_BUFFER_SIZE;
+    TEST_CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, socketFds) == 0);
+    TEST_CHECK(setsockopt(socketFds[1], SOL_SOCKET, SO_SNDBUF, &sendBufferSize,
+                          sizeof(sendBufferSize)) == 0);
+    shutdown(socketFds[1], SHUT_RD);
+
+    int epollFd = CreateEpollFd();
+    static event_data_t uartEventData;
+    TEST_CHECK(RegisterEventHandlerToEpoll(epollFd, socketFds[1], &uartEventData, EPOLLIN) == 0);
+    UartTxQueue_Init(socketFds[1], epollFd, &uartEventData, EPOLLIN, policy);
+
+    Receiver receiver = {0};
+    uint32_t next = 0;
+    unsigned long accepted = 0;
+    unsigned long refused = 0;
+    bool epollMismatch = false;
+    uint8_t frame[UART_TX_QUEUE_MAX_FRAME_SIZE];
+    uint8_t readBuffer[4096];
+    srand(readChunk);
+
+    while ((next < frames) || (UartTxQueue_GetDepth() > 0)) {
+        // Producer: a burst of frames.
+        for (int burst = rand() % 4; (burst > 0) && (next < frames); burst--) {
+            size_t size = MakeFrame(next, frame);
+            if (UartTxQueue_Enqueue(frame, size)) {
+                accepted++;
+                next++;
+            } else {
+                refused++;
+                break; // Rejected: keep the frame, try again later.
+            }
+        }
+
+        // The UART's event handler: drain while epoll says it is writable. EPOLLOUT must not
+        // be reported with nothing pending.
+        bool writable = IsWritableReported(epollFd);
+        if (writable && (UartTxQueue_GetDepth() == 0)) {
+            epollMismatch = true;
+        }
+        if (writable) {
+            TEST_CHECK(UartTxQueue_Drain() == 0);
+        }
+
+        // Consumer: the UART shifting bytes out.
+        size_t toRead = 1 + (size_t)rand() % readChunk;
+        ssize_t bytesRead = read(socketFds[0], readBuffer, toRead);
+        if (bytesRead > 0) {
+            Receive(&receiver, readBuffer, (size_t)bytesRead);
+        } else if ((UartTxQueue_GetDepth() > 0) && !IsWritableReported(epollFd)) {
+            // Everything sent was read, yet frames pending are not reported writable: they
+            // would never be sent.
+            epollMismatch = true;
+        }
+    }
+    for (;;) {
+        ssize_t bytesRead = read(socketFds[0], readBuffer, sizeof(readBuffer));
+        if (bytesRead <= 0) {
+            break;
+        }
+        Receive(&receiver, readBuffer, (size_t)bytesRead);
+    }
+
+    const UartTxQueue_Statistics *stats = UartTxQueue_GetStatistics();
+    TEST_CHECK(!receiver.corrupt);
+    TEST_CHECK(!epollMismatch);
+    TEST_CHECK(!IsWritableReported(epollFd));
+    TEST_CHECK_EQUAL(0, receiver.position);
+    TEST_CHECK_EQUAL(frames, receiver.expectedNumber);
+    TEST_CHECK_EQUAL(stats->framesQueued, accepted);
+    TEST_CHECK_EQUAL(stats->framesRejected, refused);
+    TEST_CHECK_EQUAL(stats->framesDropped, receiver.framesSkipped);
+    TEST_CHECK_EQUAL(accepted - stats->framesDropped, receiver.framesReceived);
+    TEST_CHECK_EQUAL(stats->framesWritten, receiver.framesReceived);
+    TEST_CHECK(stats->maxDepth <= UART_TX_QUEUE_DEPTH);
+    if (policy == UartTxQueue_OverflowPolicy_Reject) {
+        TEST_CHECK_EQUAL(0, stats->framesDropped);
+    } else {
+        TEST_CHECK_EQUAL(0, stats->framesRejected);
+    }
+
+    printf("%-11s %6u %8lu %8u %8u %8u %8u %8zu %10.1f\n",
+           (policy == UartTxQueue_OverflowPolicy_Reject) ? "reject" : "drop-oldest", readChunk,
+           receiver.framesReceived, stats->framesRejected, stats->framesDropped,
+           stats->writeCalls, stats->partialWrites, stats->maxDepth,
+           (double)stats->bytesWritten / stats->writeCalls);
+
+    UnregisterEventHandlerFromEpoll(epollFd, socketFds[1]);
+    close(epollFd);
+    close(socketFds[0]);
+    close(socketFds[1]);
+}
+
+static uint64_t NowUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+#define PTY_TICK_US 1000
+#define PTY_TICKS 2000
+// 9600 baud, 10 bits a byte
+#define PTY_BYTES_PER_S 960
+#define PTY_FRAMES 4096
+
+/// <summary>
+///     State of the pty test, shared by its event handlers as main.c's globals are.
+/// </summary>
+static struct {
+    int masterFd;
+    int timerFd;
+    uint64_t startUs;
+    uint64_t ticks;
+    bool failed;
+    uint32_t next;
+    Receiver receiver;
+    uint64_t queuedUs[PTY_FRAMES];
+    uint64_t maxTimerLateUs;
+    uint64_t maxCallUs;
+    uint64_t totalLatencyUs;
+    uint64_t maxLatencyUs;
+    unsigned long fullTicks;
+} pty;
+
+static void PtyUartHandler(event_data_t *eventData)
+{
+    (void)eventData;
+    uint64_t beforeUs = NowUs();
+    if (UartTxQueue_Drain() != 0) {
+        pty.failed = true;
+    }
+    uint64_t callUs = NowUs() - beforeUs;
+    if (callUs > pty.maxCallUs) {
+        pty.maxCallUs = callUs;
+    }
+}
+
+static void PtyTimerHandler(event_data_t *eventData)
+{
+    (void)eventData;
+    uint64_t expirations;
+    if (read(pty.timerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        pty.failed = true;
+        return;
+    }
+    pty.ticks += expirations;
+    uint64_t nowUs = NowUs();
+    uint64_t dueUs = pty.startUs + pty.ticks * PTY_TICK_US;
+    if ((nowUs > dueUs) && (nowUs - dueUs > pty.maxTimerLateUs)) {
+        pty.maxTimerLateUs = nowUs - dueUs;
+    }
+
+    // The app: queue frames until the queue refuses one.
+    uint8_t frame[UART_TX_QUEUE_MAX_FRAME_SIZE];
+    while (pty.next < PTY_FRAMES) {
+        size_t size = MakeFrame(pty.next, frame);
+        uint64_t beforeUs = NowUs();
+        bool queued = UartTxQueue_Enqueue(frame, size);
+        uint64_t afterUs = NowUs();
+        if (afterUs - beforeUs > pty.maxCallUs) {
+            pty.maxCallUs = afterUs - beforeUs;
+        }
+        if (!queued) {
+            pty.fullTicks++;
+            break;
+        }
+        pty.queuedUs[pty.next++] = afterUs;
+    }
+
+    // The UART: shift out the bytes due by now.
+    size_t due = (size_t)(pty.ticks * PTY_BYTES_PER_S * PTY_TICK_US / 1000000);
+    static size_t shifted;
+    while (shifted < due) {
+        uint8_t buffer[256];
+        size_t chunk = (due - shifted < sizeof(buffer)) ? due - shifted : sizeof(buffer);
+        ssize_t bytesRead = read(pty.masterFd, buffer, chunk);
+        if (bytesRead <= 0) {
+            shifted = due;
+            break;
+        }
+        shifted += (size_t)bytesRead;
+        unsigned long before = pty.receiver.framesReceived;
+        Receive(&pty.receiver, buffer, (size_t)bytesRead);
+        if ((pty.receiver.framesReceived != before) && (pty.receiver.expectedNumber > 0)) {
+            uint64_t latencyUs = NowUs() - pty.queuedUs[pty.receiver.expectedNumber - 1];
+            pty.totalLatencyUs += latencyUs;
+            if (latencyUs > pty.maxLatencyUs) {
+                pty.maxLatencyUs = latencyUs;
+            }
+        }
+    }
+}
+
+static void TestPtyResponsiveness(void)
+{
+    memset(&pty, 0, sizeof(pty));
+    pty.masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    TEST_CHECK(pty.masterFd >= 0);
+    TEST_CHECK((grantpt(pty.masterFd) == 0) && (unlockpt(pty.masterFd) == 0));
+    int uartFd = open(ptsname(pty.masterFd), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    TEST_CHECK(uartFd >= 0);
+    if ((pty.masterFd < 0) || (uartFd < 0)) {
+        return;
+    }
+    struct termios settings;
+    TEST_CHECK(tcgetattr(uartFd, &settings) == 0);
+    cfmakeraw(&settings);
+    TEST_CHECK(tcsetattr(uartFd, TCSANOW, &settings) == 0);
+
+    int epollFd = CreateEpollFd();
+    static event_data_t uartEventData = {.eventHandler = PtyUartHandler};
+    static event_data_t timerEventData = {.eventHandler = PtyTimerHandler};
+    TEST_CHECK(RegisterEventHandlerToEpoll(epollFd, uartFd, &uartEventData, EPOLLIN) == 0);
+    UartTxQueue_Init(uartFd, epollFd, &uartEventData, EPOLLIN,
+                     UartTxQueue_OverflowPolicy_Reject);
+    static const struct timespec tick = {0, PTY_TICK_US * 1000};
+    pty.startUs = NowUs();
+    pty.timerFd = CreateTimerFdAndAddToEpoll(epollFd, &tick, &timerEventData, EPOLLIN);
+    TEST_CHECK(pty.timerFd >= 0);
+
+    while ((pty.ticks < PTY_TICKS) && !pty.failed) {
+        TEST_CHECK(WaitForEventAndCallHandler(epollFd) == 0);
+    }
+
+    const UartTxQueue_Statistics *stats = UartTxQueue_GetStatistics();
+    unsigned long received = pty.receiver.framesReceived;
+    TEST_CHECK(!pty.failed);
+    TEST_CHECK(!pty.receiver.corrupt);
+    TEST_CHECK_EQUAL(0, pty.receiver.framesSkipped);
+    TEST_CHECK(received > 0);
+    // The queue was full for most of the run...
+    TEST_CHECK(pty.fullTicks > PTY_TICKS / 2);
+    TEST_CHECK_EQUAL(UART_TX_QUEUE_DEPTH, stats->maxDepth);
+    // ...yet the timer kept firing, and no call waited for the UART: a blocking write of one
+    // frame would take up to 267 ms at 9600 baud. The bound leaves room for a loaded host.
+    TEST_CHECK(pty.maxTimerLateUs < 50000);
+    TEST_CHECK(pty.maxCallUs < 50000);
+
+    printf("pty at 9600 baud, queue full %lu of %u ticks: timer late by at most %.1f ms, "
+           "longest queue call %.3f ms\n",
+           pty.fullTicks, PTY_TICKS, pty.maxTimerLateUs / 1000.0, pty.maxCallUs / 1000.0);
+    // The latency includes the time in the pty's own buffer, as it would a UART driver's.
+    printf("%lu frames received, queueing latency mean %.0f ms, max %.0f ms\n", received,
+           (received > 0) ? pty.totalLatencyUs / 1000.0 / received : 0.0,
+           pty.maxLatencyUs / 1000.0);
+
+    UnregisterEventHandlerFromEpoll(epollFd, uartFd);
+    close(pty.timerFd);
+    close(epollFd);
+    close(uartFd);
+    close(pty.masterFd);
+}
+
+static void TestOversizedFrames(void)
+{
+    uint8_t frame[UART_TX_QUEUE_MAX_FRAME_SIZE + 1] = {0};
+    UartTxQueue_Init(-1, -1, NULL, EPOLLIN, UartTxQueue_OverflowPolicy_Reject);
+    TEST_CHECK(!UartTxQueue_Enqueue(frame, 0));
+    TEST_CHECK(!UartTxQueue_Enqueue(frame, sizeof(frame)));
+    TEST_CHECK_EQUAL(0, UartTxQueue_GetDepth());
+    TEST_CHECK_EQUAL(2, UartTxQueue_GetStatistics()->framesRejected);
+}
+
+int main(void)
+{
+    TestOversizedFrames();
+
+    printf("%-11s %6s %8s %8s %8s %8s %8s %8s %10s\n", "policy", "read", "received",
+           "rejected", "dropped", "writes", "partial", "depth", "bytes/call");
+    // Reads of up to 64 bytes keep the queue full; of up to 4096, mostly empty.
+    static const unsigned int readChunks[] = {64, 256, 4096};
+    for (size_t i = 0; i < sizeof(readChunks) / sizeof(readChunks[0]); i++) {
+        RunStress(UartTxQueue_OverflowPolicy_Reject, readChunks[i], 20000);
+        RunStress(UartTxQueue_OverflowPolicy_DropOldest, readChunks[i], 20000);
+    }
+
+    TestPtyResponsiveness();
+
+    return TEST_RESULT();
+}
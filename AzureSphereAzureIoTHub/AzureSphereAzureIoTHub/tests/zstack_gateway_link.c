@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "hal_uart.h"
+#include "GatewayLink.h"
+#include "zstack_gateway_link.h"
+
+#define UART_TX_BUFFER_SIZE 128
+
+static halUARTCBack_t uartCallback;
+static uint8 uartTxBuffer[UART_TX_BUFFER_SIZE];
+static uint16 uartTxLength;
+static const uint8 *uartRxData;
+static uint16 uartRxLength;
+static ZStackGatewayLink_FrameFnType frameCallback;
+
+// The UART driver.
+
+uint8 HalUARTOpen(uint8 port, halUARTCfg_t *config)
+{
+    (void)port;
+    uartCallback = config->callBackFunc;
+    return HAL_UART_SUCCESS;
+}
+
+uint16 HalUARTWrite(uint8 port, uint8 *pBuffer, uint16 length)
+{
+    (void)port;
+    if (length > UART_TX_BUFFER_SIZE - uartTxLength) {
+        return 0;
+    }
+    memcpy(&uartTxBuffer[uartTxLength], pBuffer, length);
+    uartTxLength += length;
+    return length;
+}
+
+uint16 HalUARTRead(uint8 port, uint8 *pBuffer, uint16 length)
+{
+    (void)port;
+    if (length > uartRxLength) {
+        length = uartRxLength;
+    }
+    memcpy(pBuffer, uartRxData, length);
+    uartRxData += length;
+    uartRxLength -= length;
+    return length;
+}
+
+uint16 Hal_UART_RxBufLen(uint8 port)
+{
+    (void)port;
+    return uartRxLength;
+}
+
+// The OSAL messages of the received frames.
+
+uint8 *osal_msg_allocate(uint16 len)
+{
+    osal_msg_hdr_t *hdr = malloc(sizeof(osal_msg_hdr_t) + len);
+    return hdr ? (uint8 *)(hdr + 1) : NULL;
+}
+
+uint8 osal_msg_deallocate(uint8 *msg_ptr)
+{
+    free((osal_msg_hdr_t *)msg_ptr - 1);
+    return SUCCESS;
+}
+
+uint8 osal_msg_send(uint8 destination_task, uint8 *msg_ptr)
+{
+    (void)destination_task;
+    gatewayLinkFrame_t *frame = (gatewayLinkFrame_t *)msg_ptr;
+    if (frameCallback != NULL) {
+        frameCallback(frame->type, frame->seq, frame->data, frame->len);
+    }
+    return osal_msg_deallocate(msg_ptr);
+}
+
+void *osal_memset(void *dest, uint8 value, int len)
+{
+    return memset(dest, value, (size_t)len);
+}
+
+// The wrapper.
+
+void ZStackGatewayLink_Init(ZStackGatewayLink_FrameFnType frameFn)
+{
+    frameCallback = frameFn;
+    uartTxLength = 0;
+    uartRxLength = 0;
+    GatewayLink_TxDropped = 0;
+    GatewayLink_Init(0);
+}
+
+bool ZStackGatewayLink_SendFrame(uint8_t type, uint8_t seq, const uint8_t *data, size_t dataSize)
+{
+    return GatewayLink_SendFrame(type, seq, (uint8 *)data, (uint8)dataSize) == SUCCESS;
+}
+
+bool ZStackGatewayLink_SendRaw(const uint8_t *data, size_t size)
+{
+    return GatewayLink_SendRaw((uint8 *)data, (uint8)size) == SUCCESS;
+}
+
+size_t ZStackGatewayLink_Transmit(uint8_t *wire, size_t maxBytes)
+{
+    size_t length = (maxBytes < uartTxLength) ? maxBytes : uartTxLength;
+    memcpy(wire, uartTxBuffer, length);
+    memmove(uartTxBuffer, &uartTxBuffer[length], uartTxLength - length);
+    uartTxLength -= (uint16)length;
+    if ((length > 0) && (uartTxLength == 0)) {
+        uartCallback(GATEWAYLINK_PORT, HAL_UART_TX_EMPTY);
+    }
+    return length;
+}
+
+void ZStackGatewayLink_Receive(const uint8_t *data, size_t size)
+{
+    uartRxData = data;
+    uartRxLength = (uint16)size;
+    uartCallback(GATEWAYLINK_PORT, HAL_UART_RX_TIMEOUT);
+}
+
+unsigned int ZStackGatewayLink_GetTxDropped(void)
+{
+    return GatewayLink_TxDropped;
+}
+
+size_t ZStackGatewayLink_AddBatchRecord(uint8_t *batch, size_t batchSize, uint16_t nwkAddr,
+                                        uint8_t deviceIndex, uint8_t linkQuality,
+                                        const uint8_t *report, size_t reportSize)
+{
+    uint8 *record = &batch[batchSize];
+    record[0] = LO_UINT16(nwkAddr);
+    record[1] = HI_UINT16(nwkAddr);
+    record[2] = deviceIndex;
+    record[3] = linkQuality;
+    record[4] = (uint8)reportSize;
+    memcpy(&record[GATEWAYLINK_BATCH_RECORD_HDR_LEN], report, reportSize);
+    return batchSize + GATEWAYLINK_BATCH_RECORD_HDR_LEN + reportSize;
+}
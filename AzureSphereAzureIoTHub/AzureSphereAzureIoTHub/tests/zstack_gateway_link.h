@@ -0,0 +1,47 @@
+/// \file zstack_gateway_link.h
+/// \brief The coordinator side of the serial link, GatewayLink.c of the GenericApp sample,
+/// wrapped for the gateway tests. It is built in zstack_gateway_link.c with the Z-Stack headers
+/// of the Linux host target, over a model of the CC2530 UART driver: writes are taken whole or
+/// not at all into a 128-byte buffer, as by the DMA driver, and HAL_UART_TX_EMPTY is reported
+/// once the buffer has been shifted out.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+///     Function invoked for each frame the coordinator accepted, as the GATEWAYLINK_FRAME_IND
+///     message sent to its task.
+/// </summary>
+typedef void (*ZStackGatewayLink_FrameFnType)(uint8_t type, uint8_t seq, const uint8_t *data,
+                                              size_t dataSize);
+
+void ZStackGatewayLink_Init(ZStackGatewayLink_FrameFnType frameFn);
+bool ZStackGatewayLink_SendFrame(uint8_t type, uint8_t seq, const uint8_t *data, size_t dataSize);
+bool ZStackGatewayLink_SendRaw(const uint8_t *data, size_t size);
+
+/// <summary>
+///     Shifts up to maxBytes out of the UART driver's buffer onto the wire.
+/// </summary>
+/// <returns>The number of bytes copied to wire.</returns>
+size_t ZStackGatewayLink_Transmit(uint8_t *wire, size_t maxBytes);
+
+/// <summary>
+///     Delivers bytes received from the gateway to the coordinator's receive callback.
+/// </summary>
+void ZStackGatewayLink_Receive(const uint8_t *data, size_t size);
+
+/// <summary>
+///     Returns GatewayLink_TxDropped, the frames refused by a full transmit queue.
+/// </summary>
+unsigned int ZStackGatewayLink_GetTxDropped(void);
+
+/// <summary>
+///     Appends a record to a report batch as GenericApp_AddReportRecord of coordinator.c lays
+///     it out, with GATEWAYLINK_BATCH_RECORD_HDR_LEN bytes of header.
+/// </summary>
+/// <returns>The size of the batch with the record.</returns>
+size_t ZStackGatewayLink_AddBatchRecord(uint8_t *batch, size_t batchSize, uint16_t nwkAddr,
+                                        uint8_t deviceIndex, uint8_t linkQuality,
+                                        const uint8_t *report, size_t reportSize);
@@ -0,0 +1,38 @@
+#include <string.h>
+#include "ZComDef.h"
+#include "SensorFrame.h"
+#include "zstack_sensor_frame.h"
+
+size_t ZStackSensorFrame_Encode(uint8_t *buffer, size_t bufferSize, uint16_t seq, uint8_t deviceId,
+                                uint32_t present, const int32_t *values)
+{
+    sensorFrame_t frame;
+
+    SensorFrame_Begin(&frame, buffer, (uint8)bufferSize, seq, deviceId);
+    for (uint8 type = SENSORFRAME_TLV_TEMPERATURE; type <= SENSORFRAME_TLV_HUMIDITY_CENTI; type++) {
+        if ((present & (1u << type)) == 0) {
+            continue;
+        }
+        if (type == SENSORFRAME_TLV_PIR) {
+            SensorFrame_AddUint8(&frame, type, (uint8)values[type]);
+        } else {
+            SensorFrame_AddUint16(&frame, type, (uint16)values[type]);
+        }
+    }
+    return SensorFrame_End(&frame);
+}
+
+bool ZStackSensorFrame_Check(const uint8_t *frame, size_t frameSize)
+{
+    uint8 copy[255];
+    if (frameSize > sizeof(copy)) {
+        return false;
+    }
+    memcpy(copy, frame, frameSize);
+    return SensorFrame_Check(copy, (uint8)frameSize) == TRUE;
+}
+
+uint16_t ZStackSensorFrame_Crc16(const uint8_t *data, size_t size)
+{
+    return SensorFrame_Crc16((uint8 *)data, (uint8)size);
+}
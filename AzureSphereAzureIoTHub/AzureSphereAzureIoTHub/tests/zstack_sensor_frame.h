@@ -0,0 +1,26 @@
+/// \file zstack_sensor_frame.h
+/// \brief The Z-Stack side of the sensor report frame, SensorFrame.c of the GenericApp sample,
+/// wrapped for the gateway tests. The coordinator builds frames with it from ZCL reports, as
+/// end devices predating ZclSensor.c did from their samples. Its types clash with the gateway's, so it is built in
+/// zstack_sensor_frame.c with the Z-Stack headers of the Linux host target and used through
+/// these functions.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+///     Builds a report as the coordinator does: the values of the TLV types whose bit (1 << type)
+///     is set in present, as uint8 for the PIR sensor and uint16 otherwise.
+/// </summary>
+/// <returns>The length of the frame, or 0 if it does not fit in the buffer.</returns>
+size_t ZStackSensorFrame_Encode(uint8_t *buffer, size_t bufferSize, uint16_t seq, uint8_t deviceId,
+                                uint32_t present, const int32_t *values);
+
+/// <summary>
+///     Returns the result of SensorFrame_Check, used by the coordinator to validate frames.
+/// </summary>
+bool ZStackSensorFrame_Check(const uint8_t *frame, size_t frameSize);
+
+uint16_t ZStackSensorFrame_Crc16(const uint8_t *data, size_t size);
@@ -0,0 +1,155 @@
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <applibs/log.h>
+#include "uart_tx_queue.h"
+
+typedef struct {
+    size_t size;
+    uint8_t data[UART_TX_QUEUE_MAX_FRAME_SIZE];
+} Frame;
+
+static Frame frames[UART_TX_QUEUE_DEPTH];
+static size_t head = 0;
+static size_t count = 0;
+// Bytes of the frame at the head already written to the UART.
+static size_t headOffset = 0;
+
+static int fd = -1;
+static int epoll = -1;
+static event_data_t *eventData = NULL;
+static uint32_t idleEvents = EPOLLIN;
+static bool writableArmed = false;
+static UartTxQueue_OverflowPolicy overflowPolicy = UartTxQueue_OverflowPolicy_Reject;
+static UartTxQueue_Statistics statistics;
+
+/// <summary>
+///     Adds EPOLLOUT to the UART's registration while data is pending, and removes it once
+///     the queue is empty, so that epoll does not report a writable UART continuously.
+/// </summary>
+static void ArmWritable(bool arm)
+{
+    if ((arm == writableArmed) || (eventData == NULL)) {
+        return;
+    }
+    if (RegisterEventHandlerToEpoll(epoll, fd, eventData,
+                                    arm ? (idleEvents | EPOLLOUT) : idleEvents) == 0) {
+        writableArmed = arm;
+    }
+}
+
+void UartTxQueue_Init(int uartFd, int epollFd, event_data_t *uartEventData, uint32_t baseEvents,
+                      UartTxQueue_OverflowPolicy policy)
+{
+    fd = uartFd;
+    epoll = epollFd;
+    eventData = uartEventData;
+    idleEvents = baseEvents;
+    overflowPolicy = policy;
+    writableArmed = false;
+    head = 0;
+    count = 0;
+    headOffset = 0;
+    memset(&statistics, 0, sizeof(statistics));
+    clock_gettime(CLOCK_MONOTONIC, &statistics.startTime);
+}
+
+bool UartTxQueue_Enqueue(const uint8_t *data, size_t size)
+{
+    if ((size == 0) || (size > UART_TX_QUEUE_MAX_FRAME_SIZE)) {
+        statistics.framesRejected++;
+        return false;
+    }
+
+    if (count == UART_TX_QUEUE_DEPTH) {
+        // Writing what the UART accepts now may free a slot.
+        UartTxQueue_Drain();
+    }
+
+    if (count == UART_TX_QUEUE_DEPTH) {
+        if (overflowPolicy == UartTxQueue_OverflowPolicy_Reject) {
+            statistics.framesRejected++;
+            return false;
+        }
+
+        // Drop the oldest frame not yet started; the head may be partly on the wire already.
+        size_t victim = (headOffset == 0) ? 0 : 1;
+        for (size_t i = victim; i + 1 < count; i++) {
+            frames[(head + i) % UART_TX_QUEUE_DEPTH] = frames[(head + i + 1) % UART_TX_QUEUE_DEPTH];
+        }
+        count--;
+        statistics.framesDropped++;
+    }
+
+    Frame *frame = &frames[(head + count) % UART_TX_QUEUE_DEPTH];
+    memcpy(frame->data, data, size);
+    frame->size = size;
+    count++;
+    statistics.framesQueued++;
+    if (count > statistics.maxDepth) {
+        statistics.maxDepth = count;
+    }
+
+    UartTxQueue_Drain();
+    return true;
+}
+
+int UartTxQueue_Drain(void)
+{
+    while (count > 0) {
+        struct iovec iov[UART_TX_QUEUE_DEPTH];
+        size_t iovCount = 0;
+        size_t bytesPending = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            Frame *frame = &frames[(head + i) % UART_TX_QUEUE_DEPTH];
+            size_t offset = (i == 0) ? headOffset : 0;
+            iov[iovCount].iov_base = frame->data + offset;
+            iov[iovCount].iov_len = frame->size - offset;
+            bytesPending += iov[iovCount].iov_len;
+            iovCount++;
+        }
+
+        ssize_t bytesWritten = writev(fd, iov, (int)iovCount);
+        statistics.writeCalls++;
+        if (bytesWritten < 0) {
+            if ((errno == EAGAIN) || (errno == EINTR)) {
+                break;
+            }
+            Log_Debug("ERROR: Could not write to UART: %s (%d).\n", strerror(errno), errno);
+            ArmWritable(false);
+            return -1;
+        }
+        statistics.bytesWritten += (uint64_t)bytesWritten;
+
+        // Release the frames that were written completely.
+        size_t remaining = (size_t)bytesWritten;
+        while ((count > 0) && (remaining >= frames[head].size - headOffset)) {
+            remaining -= frames[head].size - headOffset;
+            headOffset = 0;
+            head = (head + 1) % UART_TX_QUEUE_DEPTH;
+            count--;
+            statistics.framesWritten++;
+        }
+        headOffset += remaining;
+
+        if ((size_t)bytesWritten < bytesPending) {
+            // The UART buffer is full; wait for EPOLLOUT.
+            statistics.partialWrites++;
+            break;
+        }
+    }
+
+    ArmWritable(count > 0);
+    return 0;
+}
+
+size_t UartTxQueue_GetDepth(void)
+{
+    return count;
+}
+
+const UartTxQueue_Statistics *UartTxQueue_GetStatistics(void)
+{
+    return &statistics;
+}
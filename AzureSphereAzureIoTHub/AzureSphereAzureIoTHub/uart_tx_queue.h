@@ -0,0 +1,84 @@
+/// \file uart_tx_queue.h
+/// \brief Non-blocking transmit queue for a UART registered with epoll.
+///
+/// Frames are copied into a ring of fixed-size slots and written with writev() as the UART
+/// accepts them. While data is pending, EPOLLOUT is added to the UART's epoll registration;
+/// the UART's event handler must then call UartTxQueue_Drain. A frame is never split by the
+/// overflow policy: either it is queued whole, or it is refused or dropped whole.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "epoll_timerfd_utilities.h"
+
+#define UART_TX_QUEUE_DEPTH 16
+#define UART_TX_QUEUE_MAX_FRAME_SIZE 256
+
+/// <summary>
+///     What to do with a new frame when the queue is full.
+/// </summary>
+typedef enum {
+    /// <summary>Refuse the new frame; the caller keeps it and retries later.</summary>
+    UartTxQueue_OverflowPolicy_Reject,
+    /// <summary>Drop the oldest frame not yet started to make room for the new one.</summary>
+    UartTxQueue_OverflowPolicy_DropOldest
+} UartTxQueue_OverflowPolicy;
+
+/// <summary>
+///     Counters kept by the transmit queue.
+/// </summary>
+typedef struct {
+    uint32_t framesQueued;
+    uint32_t framesRejected;
+    uint32_t framesDropped;
+    /// <summary>Frames written completely. Frames are written or dropped in the order they
+    /// were queued.</summary>
+    uint32_t framesWritten;
+    uint32_t writeCalls;
+    uint32_t partialWrites;
+    uint64_t bytesWritten;
+    /// <summary>Highest number of frames queued at once.</summary>
+    size_t maxDepth;
+    /// <summary>Time the queue was initialized, to derive the throughput.</summary>
+    struct timespec startTime;
+} UartTxQueue_Statistics;
+
+/// <summary>
+///     Initializes the queue for a UART already registered with epoll.
+/// </summary>
+/// <param name="uartFd">The UART file descriptor</param>
+/// <param name="epollFd">The epoll instance the UART is registered with</param>
+/// <param name="uartEventData">The event data the UART was registered with</param>
+/// <param name="baseEvents">The events the UART is registered for when nothing is queued,
+/// normally EPOLLIN</param>
+/// <param name="policy">What to do when the queue is full</param>
+void UartTxQueue_Init(int uartFd, int epollFd, event_data_t *uartEventData, uint32_t baseEvents,
+                      UartTxQueue_OverflowPolicy policy);
+
+/// <summary>
+///     Queues a frame and writes as much of the queue as the UART accepts.
+/// </summary>
+/// <param name="data">The frame</param>
+/// <param name="size">The size of the frame; at most UART_TX_QUEUE_MAX_FRAME_SIZE</param>
+/// <returns>'true' if the frame was queued; 'false' if it is too large, or the queue is full
+/// and the policy is UartTxQueue_OverflowPolicy_Reject.</returns>
+bool UartTxQueue_Enqueue(const uint8_t *data, size_t size);
+
+/// <summary>
+///     Writes as much of the queue as the UART accepts, without blocking. Call this from the
+///     UART's event handler.
+/// </summary>
+/// <returns>0 on success, or -1 if the UART failed</returns>
+int UartTxQueue_Drain(void);
+
+/// <summary>
+///     Returns the number of frames waiting to be written, including a partially written one.
+/// </summary>
+size_t UartTxQueue_GetDepth(void);
+
+/// <summary>
+///     Returns the counters kept by the transmit queue.
+/// </summary>
+const UartTxQueue_Statistics *UartTxQueue_GetStatistics(void);
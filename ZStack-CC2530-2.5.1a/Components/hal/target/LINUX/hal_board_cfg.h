@@ -0,0 +1,73 @@
+/**************************************************************************************************
+  Filename:       hal_board_cfg.h
+
+  Description:    Board configuration of the Linux host target: no drivers,
+                  only what the OSAL core needs.
+**************************************************************************************************/
+
+#ifndef HAL_BOARD_CFG_H
+#define HAL_BOARD_CFG_H
+
+
+/* ------------------------------------------------------------------------------------------------
+ *                                           Includes
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#include "hal_mcu.h"
+#include "hal_defs.h"
+#include "hal_types.h"
+
+/* ------------------------------------------------------------------------------------------------
+ *                                          Clock Speed
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_CPU_CLOCK_MHZ     32
+
+#define HAL_CLOCK_STABLE()
+
+/* ------------------------------------------------------------------------------------------------
+ *                                       LED Configuration
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_NUM_LEDS            0
+#define HAL_LED_BLINK_DELAY()
+
+/* ------------------------------------------------------------------------------------------------
+ *                                      Board Initialization
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_BOARD_INIT()
+
+#define HAL_PUSH_BUTTON1()        (0)
+#define HAL_PUSH_BUTTON2()        (0)
+#define HAL_PUSH_BUTTON3()        (0)
+#define HAL_PUSH_BUTTON4()        (0)
+#define HAL_PUSH_BUTTON5()        (0)
+#define HAL_PUSH_BUTTON6()        (0)
+
+/* ------------------------------------------------------------------------------------------------
+ *                                     Driver Configuration
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_TIMER FALSE
+#define HAL_ADC   FALSE
+#define HAL_DMA   FALSE
+#define HAL_FLASH FALSE
+#define HAL_AES   FALSE
+#define HAL_LCD   FALSE
+#define HAL_LED   FALSE
+#define HAL_KEY   FALSE
+#define HAL_UART  FALSE
+
+#define HAL_UART_DMA  0
+#define HAL_UART_ISR  0
+#define HAL_UART_USB  0
+
+#endif
+/*******************************************************************************************************
+*/
@@ -0,0 +1,96 @@
+/**************************************************************************************************
+  Filename:       hal_mcu.h
+
+  Description:    MCU abstraction of the Linux host target.
+
+  The host has no interrupts: the tick source is read when OSAL polls it
+  (see macMcuPrecisionCount() in OnBoard.c), so a critical section only
+  has to keep the interrupt enable flag, as EA does on the CC2530. The
+  flag lets the host code check that every critical section is closed.
+**************************************************************************************************/
+
+#ifndef _HAL_MCU_H
+#define _HAL_MCU_H
+
+/*
+ *  Target : Linux host (GCC)
+ *
+ */
+
+/* ------------------------------------------------------------------------------------------------
+ *                                           Includes
+ * ------------------------------------------------------------------------------------------------
+ */
+#include <stdlib.h>
+
+#include "hal_defs.h"
+#include "hal_types.h"
+
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Target Defines
+ * ------------------------------------------------------------------------------------------------
+ */
+#define HAL_MCU_LINUX
+
+
+/* ------------------------------------------------------------------------------------------------
+ *                                     Compiler Abstraction
+ * ------------------------------------------------------------------------------------------------
+ */
+
+/* ---------------------- GNU Compiler ---------------------- */
+#ifdef __GNUC__
+#define HAL_COMPILER_GCC
+#define HAL_MCU_LITTLE_ENDIAN()   (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
+/* IAR memory and function attributes used by the common code */
+#define __no_init
+#define __near_func
+#define __data
+
+#define HAL_ISR_FUNC_DECLARATION(f,v)   void f(void)
+#define HAL_ISR_FUNC_PROTOTYPE(f,v)     void f(void)
+#define HAL_ISR_FUNCTION(f,v)           HAL_ISR_FUNC_PROTOTYPE(f,v); HAL_ISR_FUNC_DECLARATION(f,v)
+
+/* ------------------ Unrecognized Compiler ------------------ */
+#else
+#error "ERROR: Unknown compiler."
+#endif
+
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Interrupt Macros
+ * ------------------------------------------------------------------------------------------------
+ */
+
+/* Interrupt enable flag, in place of EA */
+extern volatile unsigned char halIntEnable;
+
+#define HAL_ENABLE_INTERRUPTS()         st( halIntEnable = 1; )
+#define HAL_DISABLE_INTERRUPTS()        st( halIntEnable = 0; )
+#define HAL_INTERRUPTS_ARE_ENABLED()    (halIntEnable)
+
+typedef unsigned char halIntState_t;
+#define HAL_ENTER_CRITICAL_SECTION(x)   st( x = halIntEnable;  HAL_DISABLE_INTERRUPTS(); )
+#define HAL_EXIT_CRITICAL_SECTION(x)    st( halIntEnable = x; )
+#define HAL_CRITICAL_STATEMENT(x)       st( halIntState_t _s; HAL_ENTER_CRITICAL_SECTION(_s); x; HAL_EXIT_CRITICAL_SECTION(_s); )
+
+#define HAL_ENTER_ISR()
+#define HAL_EXIT_ISR()
+
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Reset Macro
+ * ------------------------------------------------------------------------------------------------
+ */
+#define WD_KICK()
+#define HAL_SYSTEM_RESET()  st( HAL_DISABLE_INTERRUPTS(); abort(); )
+
+#define CLEAR_SLEEP_MODE()
+#define ALLOW_SLEEP_MODE()
+
+
+/**************************************************************************************************
+ */
+#endif
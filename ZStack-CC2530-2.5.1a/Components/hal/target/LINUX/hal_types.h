@@ -0,0 +1,71 @@
+/**************************************************************************************************
+  Filename:       hal_types.h
+
+  Description:    Types of the Linux host target, on which the OSAL core is
+                  built with GCC for measurement. See
+                  Projects/zstack/ZMain/LINUX/OnBoard.h.
+**************************************************************************************************/
+
+#ifndef _HAL_TYPES_H
+#define _HAL_TYPES_H
+
+/* Linux host (GCC, LP64) */
+
+#include <stdint.h>
+
+/* ------------------------------------------------------------------------------------------------
+ *                                               Types
+ * ------------------------------------------------------------------------------------------------
+ */
+typedef int8_t          int8;
+typedef uint8_t         uint8;
+
+typedef int16_t         int16;
+typedef uint16_t        uint16;
+
+typedef int32_t         int32;
+typedef uint32_t        uint32;
+
+typedef unsigned char   bool;
+
+/* As on the CC2530, so the heap keeps its 2-byte block headers; x86 and
+ * ARMv8 read the pointers of the messages at any alignment. */
+typedef uint8           halDataAlign_t;
+
+
+/* ------------------------------------------------------------------------------------------------
+ *                                       Memory Attributes
+ * ------------------------------------------------------------------------------------------------
+ */
+
+/* ----------- GNU Compiler ----------- */
+#ifdef __GNUC__
+#define  CODE
+#define  XDATA
+
+/* ----------- Unrecognized Compiler ----------- */
+#else
+#error "ERROR: Unknown compiler."
+#endif
+
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Standard Defines
+ * ------------------------------------------------------------------------------------------------
+ */
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+
+/**************************************************************************************************
+ */
+#endif
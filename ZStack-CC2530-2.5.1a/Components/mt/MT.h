@@ -94,6 +94,9 @@ extern "C"
 #define MT_SYS_OSAL_NV_DELETE                0x12
 #define MT_SYS_OSAL_NV_LENGTH                0x13
 #define MT_SYS_SET_TX_POWER                  0x14
+#define MT_SYS_OSAL_HEAP_TRACE               0x15
+#define MT_SYS_OSAL_PROFILE                  0x16
+#define MT_SYS_OSAL_PWR_STATS                0x17
 
 /* AREQ to host */
 #define MT_SYS_RESET_IND                     0x80
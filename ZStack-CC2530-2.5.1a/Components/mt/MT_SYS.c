@@ -47,6 +47,7 @@
 #include "nwk_util.h"
 #include "OSAL.h"
 #include "OSAL_NV.h"
+#include "OSAL_PwrMgr.h"
 #include "Onboard.h"  /* This is here because RAM read/write macros need it */
 #include "hal_adc.h"
 #include "ZGlobals.h"
@@ -59,6 +60,11 @@
 
 #define MT_SYS_DEVICE_INFO_RESPONSE_LEN 14
 #define MT_NV_ITEM_MAX_LENGTH           250
+#define MT_SYS_HEAP_TRACE_MAX           24  // osalMemTrace_t events in one response
+#define MT_SYS_HEAP_TRACE_EVT_LEN       10
+#define MT_SYS_PROFILE_RESET            0xFF  // Slot of MT_SYS_OSAL_PROFILE that resets the profiles
+#define MT_SYS_PROFILE_LEN              (12 + (4 * OSAL_PROF_BUCKETS))
+#define MT_SYS_PWR_STATS_LEN            13
 
 #if !defined HAL_GPIO || !HAL_GPIO
 #define GPIO_DIR_IN(IDX)
@@ -123,6 +129,15 @@ void MT_SysGetDeviceInfo(uint8 *pBuf);
 void MT_SysSetUtcTime(uint8 *pBuf);
 void MT_SysGetUtcTime(void);
 void MT_SysSetTxPower(uint8 *pBuf);
+#if OSALMEM_TRACE
+void MT_SysOsalHeapTrace(uint8 *pBuf);
+#endif
+#if OSAL_PROFILE
+void MT_SysOsalProfile(uint8 *pBuf);
+#endif
+#if OSAL_TICKLESS
+void MT_SysOsalPwrStats(uint8 *pBuf);
+#endif
 #endif /* MT_SYS_FUNC */
 
 #if defined (MT_SYS_FUNC)
@@ -223,6 +238,24 @@ uint8 MT_SysCommandProcessing(uint8 *pBuf)
       MT_SysSetTxPower(pBuf);
       break;
 
+#if OSALMEM_TRACE
+    case MT_SYS_OSAL_HEAP_TRACE:
+      MT_SysOsalHeapTrace(pBuf);
+      break;
+#endif
+
+#if OSAL_PROFILE
+    case MT_SYS_OSAL_PROFILE:
+      MT_SysOsalProfile(pBuf);
+      break;
+#endif
+
+#if OSAL_TICKLESS
+    case MT_SYS_OSAL_PWR_STATS:
+      MT_SysOsalPwrStats(pBuf);
+      break;
+#endif
+
     default:
       status = MT_RPC_ERR_COMMAND_ID;
       break;
@@ -1038,6 +1071,219 @@ void MT_SysSetTxPower(uint8 *pBuf)
                                        MT_SYS_SET_TX_POWER, 1,
                                        &signed_dBm_of_TxPower_range_corrected);
 }
+
+#if OSALMEM_TRACE
+/***************************************************************************************************
+ * @fn      MT_SysOsalHeapTrace
+ *
+ * @brief   Move the oldest OSAL heap trace events to the test tool. Repeat until Count is 0 to
+ *          empty the ring; each response is also traced, as it is allocated.
+ *
+ * @param   pBuf - MT message containing the most events to return
+ *
+ *          Response: | Lost (2) | Count (1) | Count x (Tick, Size, Block, Caller (2 each),
+ *                    Task, Op (1 each)) |, all little-endian; | ZMemError (1) | alone if no
+ *                    buffer could be allocated
+ *
+ * @return  None
+ ***************************************************************************************************/
+void MT_SysOsalHeapTrace(uint8 *pBuf)
+{
+  osalMemTrace_t trc;
+  uint8 *buf;
+  uint8 *pOut;
+  uint16 lost;
+  uint16 dropped;
+  uint8 status;
+  uint8 got;
+  uint8 max;
+  uint8 cnt;
+
+  max = pBuf[MT_RPC_POS_DAT0];
+  if ( (max == 0) || (max > MT_SYS_HEAP_TRACE_MAX) )
+  {
+    max = MT_SYS_HEAP_TRACE_MAX;
+  }
+
+  /* The response cannot be bigger than MT_UART_TX_BUFF_MAX. Reduce the count if necessary */
+  if ( max > (MT_UART_TX_BUFF_MAX - SPI_0DATA_MSG_LEN - 3) / MT_SYS_HEAP_TRACE_EVT_LEN )
+  {
+    max = (MT_UART_TX_BUFF_MAX - SPI_0DATA_MSG_LEN - 3) / MT_SYS_HEAP_TRACE_EVT_LEN;
+  }
+
+  /* Allocate before reading, so that no event is dropped for want of a buffer */
+  buf = osal_mem_alloc( 3 + (max * MT_SYS_HEAP_TRACE_EVT_LEN) );
+  if ( buf )
+  {
+    pOut = buf + 3;
+    lost = 0;
+
+    for ( cnt = 0; cnt < max; cnt++ )
+    {
+      got = osal_mem_trace_read( &trc, 1, &dropped );
+      lost += dropped;
+      if ( got == 0 )
+      {
+        break;
+      }
+
+      *pOut++ = LO_UINT16( trc.tick );
+      *pOut++ = HI_UINT16( trc.tick );
+      *pOut++ = LO_UINT16( trc.size );
+      *pOut++ = HI_UINT16( trc.size );
+      *pOut++ = LO_UINT16( trc.block );
+      *pOut++ = HI_UINT16( trc.block );
+      *pOut++ = LO_UINT16( trc.caller );
+      *pOut++ = HI_UINT16( trc.caller );
+      *pOut++ = trc.task;
+      *pOut++ = trc.op;
+    }
+
+    buf[0] = LO_UINT16( lost );
+    buf[1] = HI_UINT16( lost );
+    buf[2] = cnt;
+
+    /* Build and send back the response */
+    MT_BuildAndSendZToolResponse(((uint8)MT_RPC_CMD_SRSP | (uint8)MT_RPC_SYS_SYS),
+                                   MT_SYS_OSAL_HEAP_TRACE, (uint8)(pOut - buf), buf);
+
+    osal_mem_free( buf );
+  }
+  else
+  {
+    status = ZMemError;
+    MT_BuildAndSendZToolResponse(((uint8)MT_RPC_CMD_SRSP | (uint8)MT_RPC_SYS_SYS),
+                                   MT_SYS_OSAL_HEAP_TRACE, 1, &status);
+  }
+}
+#endif
+
+#if OSAL_PROFILE
+/***************************************************************************************************
+ * @fn      MT_SysOsalProfile
+ *
+ * @brief   Send the OSAL profile of an event to the test tool, or reset the profiles. Read the slots
+ *          from 0 until the status is not SUCCESS.
+ *
+ * @param   pBuf - MT message containing the slot, or 0xFF to reset
+ *
+ *          Response: | Status (1) | Missed (2) | Tick ns (2) | Buckets (1) | Task (1) | Event (1) |
+ *                    MaxLatency (2) | MaxExec (2) | Buckets x Latency (2) | Buckets x Exec (2) |,
+ *                    all little-endian; Status alone on a reset, a slot not in use or
+ *                    ZMemError if no buffer could be allocated
+ *
+ * @return  None
+ ***************************************************************************************************/
+void MT_SysOsalProfile(uint8 *pBuf)
+{
+  osalProfile_t *prof;
+  uint8 *buf;
+  uint8 *pOut;
+  uint16 missed;
+  uint8 status;
+  uint8 slot;
+  uint8 i;
+
+  slot = pBuf[MT_RPC_POS_DAT0];
+
+  /* One buffer for the profile and the response, to keep them off the stack */
+  prof = osal_mem_alloc( sizeof( osalProfile_t ) + MT_SYS_PROFILE_LEN );
+  if ( prof )
+  {
+    buf = (uint8 *)(prof + 1);
+    pOut = buf + 1;
+
+    if ( slot == MT_SYS_PROFILE_RESET )
+    {
+      osal_profile_reset();
+      buf[0] = ZSuccess;
+    }
+    else if ( osal_profile_read( slot, prof ) )
+    {
+      missed = osal_profile_missed();
+      buf[0] = ZSuccess;
+      *pOut++ = LO_UINT16( missed );
+      *pOut++ = HI_UINT16( missed );
+      *pOut++ = LO_UINT16( OSAL_PROF_TICK_NS );
+      *pOut++ = HI_UINT16( OSAL_PROF_TICK_NS );
+      *pOut++ = OSAL_PROF_BUCKETS;
+      *pOut++ = prof->task;
+      *pOut++ = prof->event;
+      *pOut++ = LO_UINT16( prof->maxLatency );
+      *pOut++ = HI_UINT16( prof->maxLatency );
+      *pOut++ = LO_UINT16( prof->maxExec );
+      *pOut++ = HI_UINT16( prof->maxExec );
+      for ( i = 0; i < OSAL_PROF_BUCKETS; i++ )
+      {
+        *pOut++ = LO_UINT16( prof->latency[i] );
+        *pOut++ = HI_UINT16( prof->latency[i] );
+      }
+      for ( i = 0; i < OSAL_PROF_BUCKETS; i++ )
+      {
+        *pOut++ = LO_UINT16( prof->exec[i] );
+        *pOut++ = HI_UINT16( prof->exec[i] );
+      }
+    }
+    else
+    {
+      buf[0] = ZInvalidParameter;
+    }
+
+    /* Build and send back the response */
+    MT_BuildAndSendZToolResponse(((uint8)MT_RPC_CMD_SRSP | (uint8)MT_RPC_SYS_SYS),
+                                   MT_SYS_OSAL_PROFILE, (uint8)(pOut - buf), buf);
+
+    osal_mem_free( prof );
+  }
+  else
+  {
+    status = ZMemError;
+    MT_BuildAndSendZToolResponse(((uint8)MT_RPC_CMD_SRSP | (uint8)MT_RPC_SYS_SYS),
+                                   MT_SYS_OSAL_PROFILE, 1, &status);
+  }
+}
+#endif
+
+#if OSAL_TICKLESS
+/***************************************************************************************************
+ * @fn      MT_SysOsalPwrStats
+ *
+ * @brief   Send the sleep counts of the tickless idle to the test tool.
+ *
+ * @param   pBuf - MT message containing TRUE to clear the counts after the read
+ *
+ *          Response: | Status (1) | Sleeps (4) | Timer wakeups (4) | Timers batched (4) |,
+ *                    all little-endian
+ *
+ * @return  None
+ ***************************************************************************************************/
+void MT_SysOsalPwrStats(uint8 *pBuf)
+{
+  pwrmgr_stats_t stats;
+  uint8 retArray[MT_SYS_PWR_STATS_LEN];
+  uint8 *pOut = retArray;
+
+  osal_pwrmgr_stats( &stats, pBuf[MT_RPC_POS_DAT0] );
+
+  *pOut++ = ZSuccess;
+  *pOut++ = BREAK_UINT32( stats.sleeps, 0 );
+  *pOut++ = BREAK_UINT32( stats.sleeps, 1 );
+  *pOut++ = BREAK_UINT32( stats.sleeps, 2 );
+  *pOut++ = BREAK_UINT32( stats.sleeps, 3 );
+  *pOut++ = BREAK_UINT32( stats.timerWakeups, 0 );
+  *pOut++ = BREAK_UINT32( stats.timerWakeups, 1 );
+  *pOut++ = BREAK_UINT32( stats.timerWakeups, 2 );
+  *pOut++ = BREAK_UINT32( stats.timerWakeups, 3 );
+  *pOut++ = BREAK_UINT32( stats.timersBatched, 0 );
+  *pOut++ = BREAK_UINT32( stats.timersBatched, 1 );
+  *pOut++ = BREAK_UINT32( stats.timersBatched, 2 );
+  *pOut++ = BREAK_UINT32( stats.timersBatched, 3 );
+
+  /* Build and send back the response */
+  MT_BuildAndSendZToolResponse(((uint8)MT_RPC_CMD_SRSP | (uint8)MT_RPC_SYS_SYS),
+                                 MT_SYS_OSAL_PWR_STATS, MT_SYS_PWR_STATS_LEN, retArray);
+}
+#endif
 #endif /* MT_SYS_FUNC */
 
 /***************************************************************************************************
@@ -53,6 +53,7 @@
 #include "OSAL_Clock.h"
 
 #include "OnBoard.h"
+#include "hal_assert.h"
 
 /* HAL */
 #include "hal_drivers.h"
@@ -66,21 +67,74 @@
  * MACROS
  */
 
+// Lowest bit set of a non-zero byte
+#define OSAL_LOWEST_BIT( x )  ( ((x) & 0x0F) ? osalLowestBit[(x) & 0x0F] \
+                                             : (uint8)(4 + osalLowestBit[(x) >> 4]) )
+
+// Lowest bit set of a non-zero uint16
+#define OSAL_LOWEST_BIT16( x )  ( ((x) & 0x00FF) ? OSAL_LOWEST_BIT( (uint8)(x) ) \
+                                                 : (uint8)(8 + OSAL_LOWEST_BIT( (uint8)((x) >> 8) )) )
+
+// Add a task to the ready set, or take it out. Ints must be disabled.
+#define OSAL_SET_READY( idx )   st( osalReadyTasks[(idx) >> 3] |= BV( (idx) & 7 ); \
+                                    osalReadyGroups |= BV( (idx) >> 3 ); )
+#define OSAL_CLEAR_READY( idx ) st( osalReadyTasks[(idx) >> 3] &= ~BV( (idx) & 7 ); \
+                                    if ( osalReadyTasks[(idx) >> 3] == 0 ) \
+                                      osalReadyGroups &= ~BV( (idx) >> 3 ); )
+
 /*********************************************************************
  * CONSTANTS
  */
 
+#if ( OSAL_MAX_TASKS > 64 )
+  #error "OSAL_MAX_TASKS is at most 64"
+#endif
+
+#if ( OSAL_PROFILE )
+  #if !defined ( OSAL_PROF_TIME )
+    #error "OSAL_PROFILE needs OSAL_PROF_TIME() in OnBoard.h"
+  #endif
+  #if ( OSAL_PROF_SLOTS > 254 ) || ( OSAL_PROF_BUCKETS < 2 ) || ( OSAL_PROF_BUCKETS > 17 )
+    #error "OSAL_PROF_SLOTS is at most 254, OSAL_PROF_BUCKETS 2 to 17"
+  #endif
+
+  // Event of a task without a profile slot
+  #define OSAL_PROF_NO_SLOT  0xFF
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
 
+// Message queue of a task: its messages in the order they are received
+typedef struct
+{
+  osal_msg_q_t head;
+  void *tail;
+} osalTaskQ_t;
+
+// In front of the header of a shared message, and of a message that
+// points into one
+typedef union
+{
+  uint8 refs;        // References to a shared message
+  uint8 *shared;     // Shared message held by a referencing one
+} osal_msg_ref_t;
+
+#if ( OSAL_PROFILE )
+// Profile slot of an event
+typedef struct
+{
+  osalProfile_t prof;
+  uint16 setTime;    // OSAL_PROF_TIME() when the event was set
+  uint8 pending;     // TRUE from osal_set_event() until a handler clears it
+} osalProfSlot_t;
+#endif
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
 
-// Message Pool Definitions
-osal_msg_q_t osal_qHead;
-
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -96,10 +150,54 @@ osal_msg_q_t osal_qHead;
 // Index of active task
 static uint8 activeTaskID = TASK_NO_TASK;
 
+// Message Pool Definitions: a queue per task, tasksCnt long
+static osalTaskQ_t *osal_qTasks;
+
+// Ready set of the scheduler: bit (idx & 7) of osalReadyTasks[idx >> 3]
+// is set while task idx has events, and bit g of osalReadyGroups while
+// osalReadyTasks[g] is not zero.
+static uint8 osalReadyGroups;
+static uint8 osalReadyTasks[(OSAL_MAX_TASKS + 7) / 8];
+
+// Lowest bit set of each nibble
+static CODE const uint8 osalLowestBit[16] =
+{
+  0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+
+// Dispatches of each task, tasksCnt long
+static uint16 *osalTaskDispatches;
+
+#if ( OSAL_PROFILE )
+// Profiles, the first osalProfUsed in use
+static osalProfSlot_t osalProfSlots[OSAL_PROF_SLOTS];
+static uint8 osalProfUsed;
+static uint16 osalProfMissed;
+
+// Slot of each event of each task, tasksCnt * 16 long
+static uint8 *osalProfMap;
+
+// Significant bits of each nibble
+static CODE const uint8 osalSigBits[16] =
+{
+  0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4
+};
+#endif
+
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
 
+static uint8 osal_msg_enqueue_push( uint8 destination_task, uint8 *msg_ptr, uint8 push );
+
+#if ( OSAL_PROFILE )
+static osalProfSlot_t *osalProfSlot( uint8 idx, uint8 bit, uint8 take );
+static void osalProfSet( uint8 idx, uint16 events );
+static void osalProfClear( uint8 idx, uint16 events );
+static void osalProfDone( uint8 idx, uint16 done, uint16 start );
+static void osalProfAdd( uint16 *hist, uint16 *max, uint16 time );
+#endif
+
 /*********************************************************************
  * HELPER FUNCTIONS
  */
@@ -440,6 +538,91 @@ uint8 * osal_msg_allocate( uint16 len )
     return ( NULL );
 }
 
+/*********************************************************************
+ * @fn      osal_msg_allocate_shared
+ *
+ * @brief
+ *
+ *    This function allocates a message buffer as osal_msg_allocate()
+ *    does, that messages from osal_msg_allocate_ref() can point into,
+ *    so that several tasks get the same data without a copy each.  The
+ *    message is freed when its own reference, dropped by
+ *    osal_msg_deallocate(), and those held with osal_msg_hold() are all
+ *    dropped.  The count is kept in front of the message header, so a
+ *    message has at most 255 references.  The tasks sharing a message
+ *    must not write to it.
+ *
+ *
+ * @param   uint16 len - wanted buffer length
+ *
+ *
+ * @return  pointer to allocated buffer or NULL if allocation failed.
+ */
+uint8 * osal_msg_allocate_shared( uint16 len )
+{
+  osal_msg_ref_t *ref;
+  osal_msg_hdr_t *hdr;
+
+  if ( len == 0 )
+    return ( NULL );
+
+  ref = (osal_msg_ref_t *) osal_mem_alloc( (short)(sizeof( osal_msg_ref_t ) + sizeof( osal_msg_hdr_t ) + len) );
+  if ( ref == NULL )
+    return ( NULL );
+
+  ref->refs = 1;
+  hdr = (osal_msg_hdr_t *) (ref + 1);
+  hdr->next = NULL;
+  hdr->len = len | OSAL_MSG_LEN_SHARED;
+  hdr->dest_id = TASK_NO_TASK;
+  return ( (uint8 *) (hdr + 1) );
+}
+
+/*********************************************************************
+ * @fn      osal_msg_allocate_ref
+ *
+ * @brief
+ *
+ *    This function allocates a message buffer as osal_msg_allocate()
+ *    does, that also holds a reference to a message from
+ *    osal_msg_allocate_shared().  The message can then point into the
+ *    shared one instead of carrying a copy of its data.
+ *    osal_msg_deallocate() drops the reference.  The reference is kept
+ *    in front of the message header.
+ *
+ *
+ * @param   uint16 len - wanted buffer length
+ * @param   uint8 *shared - shared message
+ *
+ *
+ * @return  pointer to allocated buffer or NULL if allocation failed.
+ */
+uint8 * osal_msg_allocate_ref( uint16 len, uint8 *shared )
+{
+  osal_msg_ref_t *ref;
+  osal_msg_hdr_t *hdr;
+
+  if ( (len == 0) || (shared == NULL) )
+    return ( NULL );
+
+  ref = (osal_msg_ref_t *) osal_mem_alloc( (short)(sizeof( osal_msg_ref_t ) + sizeof( osal_msg_hdr_t ) + len) );
+  if ( ref == NULL )
+    return ( NULL );
+
+  if ( osal_msg_hold( shared ) != SUCCESS )
+  {
+    osal_mem_free( ref );
+    return ( NULL );
+  }
+
+  ref->shared = shared;
+  hdr = (osal_msg_hdr_t *) (ref + 1);
+  hdr->next = NULL;
+  hdr->len = len | OSAL_MSG_LEN_REF;
+  hdr->dest_id = TASK_NO_TASK;
+  return ( (uint8 *) (hdr + 1) );
+}
+
 /*********************************************************************
  * @fn      osal_msg_deallocate
  *
@@ -447,7 +630,10 @@ uint8 * osal_msg_allocate( uint16 len )
  *
  *    This function is used to deallocate a message buffer. This function
  *    is called by a task (or processing element) after it has finished
- *    processing a received message.
+ *    processing a received message.  A message from
+ *    osal_msg_allocate_shared() is only freed with its last reference,
+ *    and one from osal_msg_allocate_ref() drops its reference to the
+ *    shared message.
  *
  *
  * @param   uint8 *msg_ptr - pointer to new message buffer
@@ -457,6 +643,7 @@ uint8 * osal_msg_allocate( uint16 len )
 uint8 osal_msg_deallocate( uint8 *msg_ptr )
 {
   uint8 *x;
+  uint16 len;
 
   if ( msg_ptr == NULL )
     return ( INVALID_MSG_POINTER );
@@ -466,12 +653,96 @@ uint8 osal_msg_deallocate( uint8 *msg_ptr )
     return ( MSG_BUFFER_NOT_AVAIL );
 
   x = (uint8 *)((uint8 *)msg_ptr - sizeof( osal_msg_hdr_t ));
+  len = ((osal_msg_hdr_t *) x)->len;
+
+  if ( len & OSAL_MSG_LEN_SHARED )
+  {
+    return ( osal_msg_release( msg_ptr ) );
+  }
+
+  if ( len & OSAL_MSG_LEN_REF )
+  {
+    x -= sizeof( osal_msg_ref_t );
+    osal_msg_release( ((osal_msg_ref_t *) x)->shared );
+  }
 
   osal_mem_free( (void *)x );
 
   return ( SUCCESS );
 }
 
+/*********************************************************************
+ * @fn      osal_msg_hold
+ *
+ * @brief
+ *
+ *    This function adds a reference to a message from
+ *    osal_msg_allocate_shared().
+ *
+ *
+ * @param   uint8 *msg_ptr - shared message
+ *
+ * @return  SUCCESS, INVALID_MSG_POINTER, MSG_BUFFER_NOT_AVAIL when the
+ *          message already has 255 references
+ */
+uint8 osal_msg_hold( uint8 *msg_ptr )
+{
+  osal_msg_ref_t *ref;
+  uint8 status = SUCCESS;
+  halIntState_t intState;
+
+  if ( (msg_ptr == NULL) ||
+       !(((osal_msg_hdr_t *) msg_ptr - 1)->len & OSAL_MSG_LEN_SHARED) )
+    return ( INVALID_MSG_POINTER );
+
+  ref = (osal_msg_ref_t *) ((osal_msg_hdr_t *) msg_ptr - 1) - 1;
+
+  HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts
+  if ( ref->refs == 0xFF )
+    status = MSG_BUFFER_NOT_AVAIL;
+  else
+    ref->refs++;
+  HAL_EXIT_CRITICAL_SECTION(intState);   // Re-enable interrupts
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      osal_msg_release
+ *
+ * @brief
+ *
+ *    This function drops a reference to a message from
+ *    osal_msg_allocate_shared(), and frees the message with the last
+ *    one.
+ *
+ *
+ * @param   uint8 *msg_ptr - shared message
+ *
+ * @return  SUCCESS, INVALID_MSG_POINTER
+ */
+uint8 osal_msg_release( uint8 *msg_ptr )
+{
+  osal_msg_ref_t *ref;
+  uint8 last;
+  halIntState_t intState;
+
+  if ( (msg_ptr == NULL) ||
+       !(((osal_msg_hdr_t *) msg_ptr - 1)->len & OSAL_MSG_LEN_SHARED) )
+    return ( INVALID_MSG_POINTER );
+
+  ref = (osal_msg_ref_t *) ((osal_msg_hdr_t *) msg_ptr - 1) - 1;
+
+  HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts
+  last = ( --ref->refs == 0 );
+  HAL_EXIT_CRITICAL_SECTION(intState);   // Re-enable interrupts
+
+  if ( last )
+    osal_mem_free( (void *)ref );
+
+  return ( SUCCESS );
+}
+
 /*********************************************************************
  * @fn      osal_msg_send
  *
@@ -492,6 +763,51 @@ uint8 osal_msg_deallocate( uint8 *msg_ptr )
  */
 uint8 osal_msg_send( uint8 destination_task, uint8 *msg_ptr )
 {
+  return ( osal_msg_enqueue_push( destination_task, msg_ptr, FALSE ) );
+}
+
+/*********************************************************************
+ * @fn      osal_msg_push_front
+ *
+ * @brief
+ *
+ *    This function is called by a task to push a command message
+ *    to the head of the OSAL queue. The destination_task field
+ *    must refer to a valid task, since the task ID will be used to
+ *    send the message to. This function will also set a message
+ *    ready event in the destination task's event list.
+ *
+ * @param   uint8 destination_task - Send msg to Task ID
+ * @param   uint8 *msg_ptr - pointer to message buffer
+ *
+ * @return  SUCCESS, INVALID_TASK, INVALID_MSG_POINTER
+ */
+uint8 osal_msg_push_front( uint8 destination_task, uint8 *msg_ptr )
+{
+  return ( osal_msg_enqueue_push( destination_task, msg_ptr, TRUE ) );
+}
+
+/*********************************************************************
+ * @fn      osal_msg_enqueue_push
+ *
+ * @brief
+ *
+ *    This function is called by osal_msg_send() and
+ *    osal_msg_push_front() to queue a message for a task, at the tail
+ *    or at the head of the task's queue, and to set a message ready
+ *    event in the destination task's event list.
+ *
+ * @param   uint8 destination_task - Send msg to Task ID
+ * @param   uint8 *msg_ptr - pointer to message buffer
+ * @param   uint8 push - TRUE to push to the head, FALSE to queue at the tail
+ *
+ * @return  SUCCESS, INVALID_TASK, INVALID_MSG_POINTER
+ */
+static uint8 osal_msg_enqueue_push( uint8 destination_task, uint8 *msg_ptr, uint8 push )
+{
+  osalTaskQ_t *q;
+  halIntState_t intState;
+
   if ( msg_ptr == NULL )
     return ( INVALID_MSG_POINTER );
 
@@ -511,8 +827,31 @@ uint8 osal_msg_send( uint8 destination_task, uint8 *msg_ptr )
 
   OSAL_MSG_ID( msg_ptr ) = destination_task;
 
-  // queue message
-  osal_msg_enqueue( &osal_qHead, msg_ptr );
+  q = &osal_qTasks[destination_task];
+
+  // Hold off interrupts
+  HAL_ENTER_CRITICAL_SECTION(intState);
+
+  if ( q->head == NULL )
+  {
+    q->head = msg_ptr;
+    q->tail = msg_ptr;
+  }
+  else if ( push )
+  {
+    // push message to the head of the task's queue
+    OSAL_MSG_NEXT( msg_ptr ) = q->head;
+    q->head = msg_ptr;
+  }
+  else
+  {
+    // queue message after the last one of the task
+    OSAL_MSG_NEXT( q->tail ) = msg_ptr;
+    q->tail = msg_ptr;
+  }
+
+  // Release interrupts
+  HAL_EXIT_CRITICAL_SECTION(intState);
 
   // Signal the task that a message is waiting
   osal_set_event( destination_task, SYS_EVENT_MSG );
@@ -535,42 +874,32 @@ uint8 osal_msg_send( uint8 destination_task, uint8 *msg_ptr )
  */
 uint8 *osal_msg_receive( uint8 task_id )
 {
-  osal_msg_hdr_t *listHdr;
-  osal_msg_hdr_t *prevHdr = NULL;
-  osal_msg_hdr_t *foundHdr = NULL;
+  osalTaskQ_t    *q;
+  osal_msg_hdr_t *foundHdr;
   halIntState_t   intState;
 
+  if ( task_id >= tasksCnt )
+    return ( NULL );
+
+  q = &osal_qTasks[task_id];
+
   // Hold off interrupts
   HAL_ENTER_CRITICAL_SECTION(intState);
 
-  // Point to the top of the queue
-  listHdr = osal_qHead;
+  // The first message of the task's queue
+  foundHdr = q->head;
 
-  // Look through the queue for a message that belongs to the asking task
-  while ( listHdr != NULL )
+  // Did we find a message?
+  if ( foundHdr != NULL )
   {
-    if ( (listHdr - 1)->dest_id == task_id )
-    {
-      if ( foundHdr == NULL )
-      {
-        // Save the first one
-        foundHdr = listHdr;
-      }
-      else
-      {
-        // Second msg found, stop looking
-        break;
-      }
-    }
-    if ( foundHdr == NULL )
-    {
-      prevHdr = listHdr;
-    }
-    listHdr = OSAL_MSG_NEXT( listHdr );
+    // Take out of the task's queue
+    q->head = OSAL_MSG_NEXT( foundHdr );
+    OSAL_MSG_NEXT( foundHdr ) = NULL;
+    OSAL_MSG_ID( foundHdr ) = TASK_NO_TASK;
   }
 
   // Is there more than one?
-  if ( listHdr != NULL )
+  if ( q->head != NULL )
   {
     // Yes, Signal the task that a message is waiting
     osal_set_event( task_id, SYS_EVENT_MSG );
@@ -581,13 +910,6 @@ uint8 *osal_msg_receive( uint8 task_id )
     osal_clear_event( task_id, SYS_EVENT_MSG );
   }
 
-  // Did we find a message?
-  if ( foundHdr != NULL )
-  {
-    // Take out of the link list
-    osal_msg_extract( &osal_qHead, foundHdr, prevHdr );
-  }
-
   // Release interrupts
   HAL_EXIT_CRITICAL_SECTION(intState);
 
@@ -617,14 +939,19 @@ osal_event_hdr_t *osal_msg_find(uint8 task_id, uint8 event)
   osal_msg_hdr_t *pHdr;
   halIntState_t intState;
 
+  if (task_id >= tasksCnt)
+  {
+    return NULL;
+  }
+
   HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts.
 
-  pHdr = osal_qHead;  // Point to the top of the queue.
+  pHdr = osal_qTasks[task_id].head;  // Point to the top of the task's queue.
 
-  // Look through the queue for a message that matches the task_id and event parameters.
+  // Look through the task's queue for a message that matches the event parameter.
   while (pHdr != NULL)
   {
-    if (((pHdr-1)->dest_id == task_id) && (((osal_event_hdr_t *)pHdr)->event == event))
+    if (((osal_event_hdr_t *)pHdr)->event == event)
     {
       break;
     }
@@ -849,7 +1176,11 @@ uint8 osal_set_event( uint8 task_id, uint16 event_flag )
   {
     halIntState_t   intState;
     HAL_ENTER_CRITICAL_SECTION(intState);    // Hold off interrupts
+#if ( OSAL_PROFILE )
+    osalProfSet( task_id, event_flag );
+#endif
     tasksEvents[task_id] |= event_flag;  // Stuff the event bit(s)
+    OSAL_SET_READY( task_id );
     HAL_EXIT_CRITICAL_SECTION(intState);     // Release interrupts
     return ( SUCCESS );
   }
@@ -878,7 +1209,14 @@ uint8 osal_clear_event( uint8 task_id, uint16 event_flag )
   {
     halIntState_t   intState;
     HAL_ENTER_CRITICAL_SECTION(intState);    // Hold off interrupts
+#if ( OSAL_PROFILE )
+    osalProfClear( task_id, event_flag & tasksEvents[task_id] );
+#endif
     tasksEvents[task_id] &= ~(event_flag);   // Clear the event bit(s)
+    if ( tasksEvents[task_id] == 0 )
+    {
+      OSAL_CLEAR_READY( task_id );
+    }
     HAL_EXIT_CRITICAL_SECTION(intState);     // Release interrupts
     return ( SUCCESS );
   }
@@ -987,12 +1325,26 @@ uint8 osal_init_system( void )
   // Initialize the Memory Allocation System
   osal_mem_init();
 
-  // Initialize the message queue
-  osal_qHead = NULL;
+  // Initialize the message queues, one per task
+  osal_qTasks = osal_mem_alloc( tasksCnt * sizeof( osalTaskQ_t ) );
+  osal_memset( osal_qTasks, 0, tasksCnt * sizeof( osalTaskQ_t ) );
 
   // Initialize the timers
   osalTimerInit();
 
+  // Initialize the ready set and the dispatch counts
+  HAL_ASSERT( tasksCnt <= OSAL_MAX_TASKS );
+  osal_memset( osalReadyTasks, 0, sizeof( osalReadyTasks ) );
+  osalReadyGroups = 0;
+  osalTaskDispatches = osal_mem_alloc( tasksCnt * sizeof( uint16 ) );
+  osal_memset( osalTaskDispatches, 0, tasksCnt * sizeof( uint16 ) );
+
+#if ( OSAL_PROFILE )
+  // Initialize the profiler, before the tasks set their first events
+  osalProfMap = osal_mem_alloc( tasksCnt * 16 );
+  osal_profile_reset();
+#endif
+
   // Initialize the Power Management System
   osal_pwrmgr_init();
 
@@ -1032,10 +1384,11 @@ void osal_start_system( void )
  *
  * @brief
  *
- *   This function will make one pass through the OSAL taskEvents table
- *   and call the task_event_processor() function for the first task that
- *   is found with at least one event pending. If there are no pending
- *   events (all tasks), this function puts the processor into Sleep.
+ *   This function will take the first task of the ready set, which is
+ *   the first task of the OSAL taskEvents table with at least one event
+ *   pending, and call its task_event_processor() function. If there are
+ *   no pending events (all tasks), this function puts the processor
+ *   into Sleep.
  *
  * @param   void
  *
@@ -1043,38 +1396,57 @@ void osal_start_system( void )
  */
 void osal_run_system( void )
 {
-  uint8 idx = 0;
+  uint8 idx = TASK_NO_TASK;
+  uint16 events = 0;
+  halIntState_t intState;
+#if ( OSAL_PROFILE )
+  uint16 dispatched;
+  uint16 start;
+#endif
 
   osalTimeUpdate();
   Hal_ProcessPoll();
 
-  do {
-    if (tasksEvents[idx])  // Task is highest priority that is ready.
-    {
-      break;
-    }
-  } while (++idx < tasksCnt);
-
-  if (idx < tasksCnt)
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  if ( osalReadyGroups )
   {
-    uint16 events;
-    halIntState_t intState;
+    // Task is highest priority that is ready.
+    idx = OSAL_LOWEST_BIT( osalReadyGroups );
+    idx = (idx << 3) + OSAL_LOWEST_BIT( osalReadyTasks[idx] );
 
-    HAL_ENTER_CRITICAL_SECTION(intState);
     events = tasksEvents[idx];
     tasksEvents[idx] = 0;  // Clear the Events for this task.
-    HAL_EXIT_CRITICAL_SECTION(intState);
+    OSAL_CLEAR_READY( idx );
+  }
+  HAL_EXIT_CRITICAL_SECTION(intState);
+
+  // A task whose events were cleared without osal_clear_event() is only
+  // taken out of the ready set.
+  if ( events )
+  {
+    osalTaskDispatches[idx]++;
 
     activeTaskID = idx;
+#if ( OSAL_PROFILE )
+    dispatched = events;
+    start = OSAL_PROF_TIME();
+#endif
     events = (tasksArr[idx])( idx, events );
     activeTaskID = TASK_NO_TASK;
 
     HAL_ENTER_CRITICAL_SECTION(intState);
+#if ( OSAL_PROFILE )
+    osalProfDone( idx, dispatched & ~events, start );
+#endif
     tasksEvents[idx] |= events;  // Add back unprocessed events to the current task.
+    if ( tasksEvents[idx] )
+    {
+      OSAL_SET_READY( idx );
+    }
     HAL_EXIT_CRITICAL_SECTION(intState);
   }
 #if defined( POWER_SAVING )
-  else  // Complete pass through all task events with no activity?
+  else if ( idx == TASK_NO_TASK )  // Complete pass through all task events with no activity?
   {
     osal_pwrmgr_powerconserve();  // Put the processor/system into sleep
   }
@@ -1088,6 +1460,287 @@ void osal_run_system( void )
 #endif
 }
 
+/*********************************************************************
+ * @fn      osal_task_dispatches
+ *
+ * @brief
+ *
+ *   This function returns the number of times osal_run_system() called
+ *   the event processor of a task, modulo 65536.
+ *
+ * @param   uint8 task_id - task
+ *
+ * @return  uint16 - dispatches, 0 for an invalid task
+ */
+uint16 osal_task_dispatches( uint8 task_id )
+{
+  return ( (task_id < tasksCnt) ? osalTaskDispatches[task_id] : 0 );
+}
+
+#if ( OSAL_PROFILE )
+/*********************************************************************
+ * @fn      osal_profile_read
+ *
+ * @brief
+ *
+ *   This function copies the profile of an event. The slots are taken
+ *   in the order the events are first set, from 0.
+ *
+ * @param   uint8 slot - profile slot
+ * @param   osalProfile_t *prof - where to copy it
+ *
+ * @return  TRUE, or FALSE when the slot is not in use
+ */
+uint8 osal_profile_read( uint8 slot, osalProfile_t *prof )
+{
+  uint8 used;
+  halIntState_t intState;
+
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  used = ( slot < osalProfUsed );
+  if ( used )
+  {
+    *prof = osalProfSlots[slot].prof;
+  }
+  HAL_EXIT_CRITICAL_SECTION(intState);
+
+  return ( used );
+}
+
+/*********************************************************************
+ * @fn      osal_profile_missed
+ *
+ * @brief
+ *
+ *   This function returns how many events were set or cleared by a
+ *   handler without being profiled, because all the slots were taken,
+ *   or because the event never went through osal_set_event(), which
+ *   takes the slots. It stops at 65535.
+ *
+ * @param   none
+ *
+ * @return  uint16 - samples missed
+ */
+uint16 osal_profile_missed( void )
+{
+  return ( osalProfMissed );
+}
+
+/*********************************************************************
+ * @fn      osal_profile_reset
+ *
+ * @brief
+ *
+ *   This function clears the profiles and frees all the slots. An event
+ *   pending at the reset gets no latency sample.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osal_profile_reset( void )
+{
+  halIntState_t intState;
+
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  osal_memset( osalProfSlots, 0, sizeof( osalProfSlots ) );
+  osal_memset( osalProfMap, OSAL_PROF_NO_SLOT, tasksCnt * 16 );
+  osalProfUsed = 0;
+  osalProfMissed = 0;
+  HAL_EXIT_CRITICAL_SECTION(intState);
+}
+
+/*********************************************************************
+ * @fn      osalProfSlot
+ *
+ * @brief
+ *
+ *   This function returns the profile slot of an event of a task, from
+ *   the map indexed by task and event bit. When take is set, an event
+ *   without one takes the next free slot. Ints must be disabled.
+ *
+ * @param   uint8 idx - task
+ * @param   uint8 bit - event bit, 0-15
+ * @param   uint8 take - TRUE to take a slot for a new event
+ *
+ * @return  the slot, or NULL
+ */
+static osalProfSlot_t *osalProfSlot( uint8 idx, uint8 bit, uint8 take )
+{
+  uint8 *map = &osalProfMap[(idx << 4) + bit];
+  osalProfSlot_t *slot;
+
+  if ( *map != OSAL_PROF_NO_SLOT )
+  {
+    return ( &osalProfSlots[*map] );
+  }
+
+  if ( !take || (osalProfUsed == OSAL_PROF_SLOTS) )
+  {
+    if ( osalProfMissed != 0xFFFF )
+    {
+      osalProfMissed++;
+    }
+    return ( NULL );
+  }
+
+  *map = osalProfUsed++;
+  slot = &osalProfSlots[*map];
+  slot->prof.task = idx;
+  slot->prof.event = bit;
+  return ( slot );
+}
+
+/*********************************************************************
+ * @fn      osalProfSet
+ *
+ * @brief
+ *
+ *   This function stamps the events of a task that osal_set_event()
+ *   sets and that no handler has cleared since they were last set.
+ *   Ints must be disabled.
+ *
+ * @param   uint8 idx - task
+ * @param   uint16 events - events set
+ *
+ * @return  none
+ */
+static void osalProfSet( uint8 idx, uint16 events )
+{
+  osalProfSlot_t *slot;
+  uint16 now;
+
+  if ( events == 0 )
+  {
+    return;
+  }
+
+  now = OSAL_PROF_TIME();
+  do
+  {
+    slot = osalProfSlot( idx, OSAL_LOWEST_BIT16( events ), TRUE );
+    if ( (slot != NULL) && !slot->pending )
+    {
+      slot->setTime = now;
+      slot->pending = TRUE;
+    }
+    events &= events - 1;  // Next event
+  } while ( events );
+}
+
+/*********************************************************************
+ * @fn      osalProfClear
+ *
+ * @brief
+ *
+ *   This function drops the stamps of the events osal_clear_event()
+ *   clears, which no handler will be called for. Ints must be disabled.
+ *
+ * @param   uint8 idx - task
+ * @param   uint16 events - pending events cleared
+ *
+ * @return  none
+ */
+static void osalProfClear( uint8 idx, uint16 events )
+{
+  uint8 map;
+
+  while ( events )
+  {
+    map = osalProfMap[(idx << 4) + OSAL_LOWEST_BIT16( events )];
+    if ( map != OSAL_PROF_NO_SLOT )
+    {
+      osalProfSlots[map].pending = FALSE;
+    }
+    events &= events - 1;  // Next event
+  }
+}
+
+/*********************************************************************
+ * @fn      osalProfDone
+ *
+ * @brief
+ *
+ *   This function adds a handler call to the profiles of the events it
+ *   cleared: a latency sample for each event stamped, and the handler
+ *   time to the highest event. Handlers take one event per call, and
+ *   take SYS_EVENT_MSG first. Ints must be disabled.
+ *
+ * @param   uint8 idx - task
+ * @param   uint16 done - events the handler cleared
+ * @param   uint16 start - OSAL_PROF_TIME() when the handler was called
+ *
+ * @return  none
+ */
+static void osalProfDone( uint8 idx, uint16 done, uint16 start )
+{
+  osalProfSlot_t *slot = NULL;
+  uint16 exec = OSAL_PROF_TIME() - start;
+
+  while ( done )
+  {
+    slot = osalProfSlot( idx, OSAL_LOWEST_BIT16( done ), FALSE );
+    if ( (slot != NULL) && slot->pending )
+    {
+      osalProfAdd( slot->prof.latency, &slot->prof.maxLatency,
+                   (uint16)(start - slot->setTime) );
+      slot->pending = FALSE;
+    }
+    done &= done - 1;  // Next event
+  }
+
+  if ( slot != NULL )
+  {
+    osalProfAdd( slot->prof.exec, &slot->prof.maxExec, exec );
+  }
+}
+
+/*********************************************************************
+ * @fn      osalProfAdd
+ *
+ * @brief
+ *
+ *   This function counts a time in its bucket of a histogram, which is
+ *   the number of significant bits of the time.
+ *
+ * @param   uint16 *hist - histogram, OSAL_PROF_BUCKETS long
+ * @param   uint16 *max - longest time of the histogram
+ * @param   uint16 time - time, in ticks of OSAL_PROF_TIME()
+ *
+ * @return  none
+ */
+static void osalProfAdd( uint16 *hist, uint16 *max, uint16 time )
+{
+  uint8 bucket = 0;
+  uint16 t = time;
+
+  if ( t > 0x00FF )
+  {
+    bucket = 8;
+    t >>= 8;
+  }
+  if ( t > 0x000F )
+  {
+    bucket += 4;
+    t >>= 4;
+  }
+  bucket += osalSigBits[t];
+
+  if ( bucket >= OSAL_PROF_BUCKETS )
+  {
+    bucket = OSAL_PROF_BUCKETS - 1;
+  }
+  if ( hist[bucket] != 0xFFFF )
+  {
+    hist[bucket]++;
+  }
+  if ( time > *max )
+  {
+    *max = time;
+  }
+}
+#endif
+
 /*********************************************************************
  * @fn      osal_buffer_uint32
  *
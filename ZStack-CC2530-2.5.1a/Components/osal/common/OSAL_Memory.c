@@ -49,6 +49,12 @@
 #include "OnBoard.h"
 #include "hal_assert.h"
 
+#if OSALMEM_TRACE
+// The traced functions are defined below, and osal_mem_alloc() and osal_mem_free() for the libraries.
+#undef osal_mem_alloc
+#undef osal_mem_free
+#endif
+
 /* ------------------------------------------------------------------------------------------------
  *                                           Constants
  * ------------------------------------------------------------------------------------------------
@@ -112,6 +118,29 @@
 #define OSALMEM_SMALL_BLKCNT       8
 #endif
 
+#if OSALMEM_SEGREGATED
+/* Block sizes, including the header, of the segregated size classes in increasing order. Each
+ * must be an even multiple of OSALMEM_HDRSZ. After osal_mem_kick(), an allocation that fits a class
+ * is rounded up to the class size, and a block of exactly a class size is kept on the free list of
+ * its class when freed. The list blocks stay marked in-use so that the first-fit walk passes over
+ * them; they are returned to the coalescing heap only when a walk fails. Closer sizes waste less
+ * to the rounding. The defaults cover timer records and short OSAL messages (16), ZCL buffers and
+ * attribute lists (24 to 48), and AF incoming messages with their payload (64 to 96).
+ */
+#if !defined OSALMEM_SEG_SIZES
+#define OSALMEM_SEG_SIZES          16, 24, 32, 48, 64, 80, 96
+#endif
+#define OSALMEM_SEG_CNT           (sizeof(osalMemSegSz) / sizeof(osalMemSegSz[0]))
+
+// Most blocks kept on the free list of a size class; more are freed to the coalescing heap.
+#if !defined OSALMEM_SEG_MAX
+#define OSALMEM_SEG_MAX            8
+#endif
+
+// The link to the next block of a size class list is kept in the data bytes of the block.
+#define OSALMEM_SEG_NEXT(HDR)    (*((osalMemHdr_t **)((HDR) + 1)))
+#endif
+
 /*
  * These numbers setup the size of the small-block bucket which is reserved at the front of the
  * heap for allocations of OSALMEM_SMALL_BLKSZ or smaller.
@@ -151,11 +180,18 @@
  * ------------------------------------------------------------------------------------------------
  */
 
+// GCC sizes bit-fields by their declared type, so a 32-bit unsigned would double the header.
+#if defined __GNUC__
+typedef uint16 osalMemBits_t;
+#else
+typedef unsigned osalMemBits_t;
+#endif
+
 typedef struct {
   // The 15 LSB's of 'val' indicate the total item size, including the header, in 8-bit bytes.
-  unsigned len : 15;
+  osalMemBits_t len : 15;
   // The 1 MSB of 'val' is used as a boolean to indicate in-use or freed.
-  unsigned inUse : 1;
+  osalMemBits_t inUse : 1;
 } osalMemHdrHdr_t;
 
 typedef union {
@@ -177,6 +213,22 @@ static __no_init osalMemHdr_t *ff1;  // First free block in the small-block buck
 
 static uint8 osalMemStat;            // Discrete status flags: 0x01 = kicked.
 
+#if OSALMEM_SEGREGATED
+static CODE const uint16 osalMemSegSz[] = { OSALMEM_SEG_SIZES };
+static osalMemHdr_t *osalMemSegHead[OSALMEM_SEG_CNT];  // Free list of each size class.
+static uint8 osalMemSegLen[OSALMEM_SEG_CNT];           // Blocks on each free list.
+#endif
+
+#if OSALMEM_TRACE
+#if (OSALMEM_TRACE_LEN > 128)
+#error OSALMEM_TRACE_LEN is too big for the uint8 ring indices!
+#endif
+static osalMemTrace_t osalMemTrc[OSALMEM_TRACE_LEN];  // Ring of trace events.
+static uint8 osalMemTrcHead;                          // Oldest event not yet read.
+static uint8 osalMemTrcCnt;                           // Events not yet read.
+static uint16 osalMemTrcLost;                         // Events overwritten since the last read.
+#endif
+
 #if OSALMEM_METRICS
 static uint16 blkMax;  // Max cnt of all blocks ever seen at once.
 static uint16 blkCnt;  // Current cnt of all blocks.
@@ -208,6 +260,19 @@ static uint16 proSmallBlkMiss;
 extern int dprintf(const char *fmt, ...);
 #endif /* DPRINTF_HEAPTRACE */
 
+/* ------------------------------------------------------------------------------------------------
+ *                                           Local Functions
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#if OSALMEM_SEGREGATED
+static uint8 osalMemSegIdx(uint16 size);
+static uint8 osalMemSegDrain(void);
+#endif
+#if OSALMEM_TRACE
+static void osalMemTraceAdd(uint8 op, uint16 size, void *ptr, uint16 caller);
+#endif
+
 /**************************************************************************************************
  * @fn          osal_mem_init
  *
@@ -228,6 +293,21 @@ void osal_mem_init(void)
   HAL_ASSERT(((OSALMEM_MIN_BLKSZ % OSALMEM_HDRSZ) == 0));
   HAL_ASSERT(((OSALMEM_LL_BLKSZ % OSALMEM_HDRSZ) == 0));
   HAL_ASSERT(((OSALMEM_SMALL_BLKSZ % OSALMEM_HDRSZ) == 0));
+#if OSALMEM_SEGREGATED
+  {
+    uint8 idx;
+
+    // The first class must hold the list link; the sizes must increase.
+    HAL_ASSERT((osalMemSegSz[0] >= (OSALMEM_HDRSZ + sizeof(osalMemHdr_t *))));
+    for (idx = 0; idx < OSALMEM_SEG_CNT; idx++)
+    {
+      HAL_ASSERT(((osalMemSegSz[idx] % OSALMEM_HDRSZ) == 0));
+      HAL_ASSERT(((idx == 0) || (osalMemSegSz[idx-1] < osalMemSegSz[idx])));
+      osalMemSegHead[idx] = NULL;
+      osalMemSegLen[idx] = 0;
+    }
+  }
+#endif
 
 #if OSALMEM_PROFILER
   (void)osal_memset(theHeap, OSALMEM_INIT, MAXMEMHEAP);
@@ -308,14 +388,19 @@ void osal_mem_kick(void)
  */
 #ifdef DPRINTF_OSALHEAPTRACE
 void *osal_mem_alloc_dbg( uint16 size, const char *fname, unsigned lnum )
+#elif OSALMEM_TRACE
+void *osal_mem_alloc_trc( uint16 size, uint16 caller )
 #else /* DPRINTF_OSALHEAPTRACE */
 void *osal_mem_alloc( uint16 size )
 #endif /* DPRINTF_OSALHEAPTRACE */
 {
   osalMemHdr_t *prev = NULL;
-  osalMemHdr_t *hdr;
+  osalMemHdr_t *hdr = NULL;
   halIntState_t intState;
-  uint8 coal = 0;
+  uint8 coal;
+#if OSALMEM_TRACE
+  const uint16 reqSize = size;
+#endif
 
   size += OSALMEM_HDRSZ;
 
@@ -336,60 +421,92 @@ void *osal_mem_alloc( uint16 size )
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
-  // Smaller allocations are first attempted in the small-block bucket, and all long-lived
-  // allocations are channeled into the LL block reserved within this bucket.
-  if ((osalMemStat == 0) || (size <= OSALMEM_SMALL_BLKSZ))
+#if OSALMEM_SEGREGATED
+  // Long-lived allocations are not rounded up, so as to keep within the LL block.
+  if (osalMemStat != 0)
   {
-    hdr = ff1;
-  }
-  else
-  {
-    hdr = (theHeap + OSALMEM_BIGBLK_IDX);
+    uint8 idx = osalMemSegIdx(size);
+
+    if (idx < OSALMEM_SEG_CNT)
+    {
+      size = osalMemSegSz[idx];
+      hdr = osalMemSegHead[idx];
+
+      if (hdr != NULL)
+      {
+        osalMemSegHead[idx] = OSALMEM_SEG_NEXT(hdr);
+        osalMemSegLen[idx]--;
+      }
+    }
   }
 
-  do
+  // When the walk fails, return the size class lists to the heap and walk once more.
+  while (hdr == NULL)
+#endif
   {
-    if ( hdr->hdr.inUse )
+    // Smaller allocations are first attempted in the small-block bucket, and all long-lived
+    // allocations are channeled into the LL block reserved within this bucket.
+    if ((osalMemStat == 0) || (size <= OSALMEM_SMALL_BLKSZ))
     {
-      coal = 0;
+      hdr = ff1;
     }
     else
     {
-      if ( coal != 0 )
+      hdr = (theHeap + OSALMEM_BIGBLK_IDX);
+    }
+    coal = 0;
+
+    do
+    {
+      if ( hdr->hdr.inUse )
       {
+        coal = 0;
+      }
+      else
+      {
+        if ( coal != 0 )
+        {
 #if ( OSALMEM_METRICS )
-        blkCnt--;
-        blkFree--;
+          blkCnt--;
+          blkFree--;
 #endif
 
-        prev->hdr.len += hdr->hdr.len;
+          prev->hdr.len += hdr->hdr.len;
 
-        if ( prev->hdr.len >= size )
-        {
-          hdr = prev;
-          break;
+          if ( prev->hdr.len >= size )
+          {
+            hdr = prev;
+            break;
+          }
         }
-      }
-      else
-      {
-        if ( hdr->hdr.len >= size )
+        else
         {
-          break;
-        }
+          if ( hdr->hdr.len >= size )
+          {
+            break;
+          }
 
-        coal = 1;
-        prev = hdr;
+          coal = 1;
+          prev = hdr;
+        }
       }
-    }
 
-    hdr = (osalMemHdr_t *)((uint8 *)hdr + hdr->hdr.len);
+      hdr = (osalMemHdr_t *)((uint8 *)hdr + hdr->hdr.len);
+
+      if ( hdr->val == 0 )
+      {
+        hdr = NULL;
+        break;
+      }
+    } while (1);
 
-    if ( hdr->val == 0 )
+#if OSALMEM_SEGREGATED
+    if ((hdr == NULL) && !osalMemSegDrain())
     {
-      hdr = NULL;
       break;
     }
-  } while (1);
+#endif
+  }
 
   if ( hdr != NULL )
   {
@@ -475,6 +592,10 @@ void *osal_mem_alloc( uint16 size )
     hdr++;
   }
 
+#if OSALMEM_TRACE
+  osalMemTraceAdd(((hdr != NULL) ? OSALMEM_TRACE_ALLOC : OSALMEM_TRACE_FAIL), reqSize, hdr, caller);
+#endif
+
   HAL_EXIT_CRITICAL_SECTION( intState );  // Re-enable interrupts.
 #pragma diag_suppress=Pe767
   HAL_ASSERT(((halDataAlign_t)hdr % sizeof(halDataAlign_t)) == 0);
@@ -503,12 +624,17 @@ void *osal_mem_alloc( uint16 size )
  */
 #ifdef DPRINTF_OSALHEAPTRACE
 void osal_mem_free_dbg(void *ptr, const char *fname, unsigned lnum)
+#elif OSALMEM_TRACE
+void osal_mem_free_trc(void *ptr, uint16 caller)
 #else /* DPRINTF_OSALHEAPTRACE */
 void osal_mem_free(void *ptr)
 #endif /* DPRINTF_OSALHEAPTRACE */
 {
   osalMemHdr_t *hdr = (osalMemHdr_t *)ptr - 1;
   halIntState_t intState;
+#if OSALMEM_SEGREGATED
+  uint8 idx = OSALMEM_SEG_CNT;
+#endif
 
 #ifdef DPRINTF_OSALHEAPTRACE
   dprintf("osal_mem_free(%lx):%s:%u\n", (unsigned) ptr, fname, lnum);
@@ -518,11 +644,29 @@ void osal_mem_free(void *ptr)
   HAL_ASSERT(hdr->hdr.inUse);
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
-  hdr->hdr.inUse = FALSE;
 
-  if (ff1 > hdr)
+#if OSALMEM_SEGREGATED
+  if (osalMemStat != 0)
   {
-    ff1 = hdr;
+    idx = osalMemSegIdx(hdr->hdr.len);
+
+    if ((idx < OSALMEM_SEG_CNT) &&
+        ((hdr->hdr.len != osalMemSegSz[idx]) || (osalMemSegLen[idx] >= OSALMEM_SEG_MAX)))
+    {
+      idx = OSALMEM_SEG_CNT;
+    }
+  }
+
+  // A block of a size class stays in-use, on the free list of its class.
+  if (idx == OSALMEM_SEG_CNT)
+#endif
+  {
+    hdr->hdr.inUse = FALSE;
+
+    if (ff1 > hdr)
+    {
+      ff1 = hdr;
+    }
   }
 
 #if OSALMEM_PROFILER
@@ -545,14 +689,237 @@ void osal_mem_free(void *ptr)
 
   (void)osal_memset((uint8 *)(hdr+1), OSALMEM_REIN, (hdr->hdr.len - OSALMEM_HDRSZ) );
 #endif
+#if OSALMEM_SEGREGATED
+  if (idx != OSALMEM_SEG_CNT)
+  {
+    OSALMEM_SEG_NEXT(hdr) = osalMemSegHead[idx];
+    osalMemSegHead[idx] = hdr;
+    osalMemSegLen[idx]++;
+  }
+#endif
 #if OSALMEM_METRICS
+  // Blocks on the size class lists count as free.
   memAlo -= hdr->hdr.len;
   blkFree++;
 #endif
+#if OSALMEM_TRACE
+  osalMemTraceAdd(OSALMEM_TRACE_FREE, hdr->hdr.len, ptr, caller);
+#endif
 
   HAL_EXIT_CRITICAL_SECTION( intState );  // Re-enable interrupts.
 }
 
+#if OSALMEM_SEGREGATED
+/**************************************************************************************************
+ * @fn          osalMemSegIdx
+ *
+ * @brief       Find the smallest size class that holds a block.
+ *
+ * input parameters
+ *
+ * @param size - the block size, including the header, rounded to halDataAlign_t.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      The index of the size class, or OSALMEM_SEG_CNT if the block is larger than all.
+ */
+static uint8 osalMemSegIdx(uint16 size)
+{
+  uint8 idx;
+
+  for (idx = 0; idx < OSALMEM_SEG_CNT; idx++)
+  {
+    if (size <= osalMemSegSz[idx])
+    {
+      break;
+    }
+  }
+
+  return idx;
+}
+
+/**************************************************************************************************
+ * @fn          osalMemSegDrain
+ *
+ * @brief       Return the blocks of all the size class lists to the coalescing heap, so that a
+ *              failed first-fit walk can merge them. Invoke with interrupts held off.
+ *
+ * input parameters
+ *
+ * None.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      TRUE if any block was returned; FALSE if the lists were all empty.
+ */
+static uint8 osalMemSegDrain(void)
+{
+  osalMemHdr_t *hdr;
+  uint8 drained = FALSE;
+  uint8 idx;
+
+  for (idx = 0; idx < OSALMEM_SEG_CNT; idx++)
+  {
+    while ((hdr = osalMemSegHead[idx]) != NULL)
+    {
+      osalMemSegHead[idx] = OSALMEM_SEG_NEXT(hdr);
+      hdr->hdr.inUse = FALSE;
+
+      if (ff1 > hdr)
+      {
+        ff1 = hdr;
+      }
+      drained = TRUE;
+    }
+    osalMemSegLen[idx] = 0;
+  }
+
+  return drained;
+}
+#endif
+
+#if OSALMEM_TRACE
+/**************************************************************************************************
+ * @fn          osalMemTraceAdd
+ *
+ * @brief       Record a trace event, overwriting the oldest one when the ring is full.
+ *              Invoke with interrupts held off.
+ *
+ * input parameters
+ *
+ * @param op - OSALMEM_TRACE_ALLOC, OSALMEM_TRACE_FREE or OSALMEM_TRACE_FAIL.
+ * @param size - the bytes asked for, or the length of the block freed.
+ * @param ptr - the data bytes of the block, or NULL.
+ * @param caller - the call site, or 0.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+static void osalMemTraceAdd(uint8 op, uint16 size, void *ptr, uint16 caller)
+{
+  osalMemTrace_t *trc;
+  uint8 idx = osalMemTrcHead + osalMemTrcCnt;
+
+  if (idx >= OSALMEM_TRACE_LEN)
+  {
+    idx -= OSALMEM_TRACE_LEN;
+  }
+  trc = osalMemTrc + idx;
+
+  if (osalMemTrcCnt < OSALMEM_TRACE_LEN)
+  {
+    osalMemTrcCnt++;
+  }
+  else
+  {
+    if (++osalMemTrcHead == OSALMEM_TRACE_LEN)
+    {
+      osalMemTrcHead = 0;
+    }
+    if (osalMemTrcLost != 0xFFFF)
+    {
+      osalMemTrcLost++;
+    }
+  }
+
+  trc->tick = (uint16)osal_GetSystemClock();
+  trc->size = size;
+  trc->block = (ptr == NULL) ? 0 : (uint16)((uint8 *)ptr - (uint8 *)theHeap);
+  trc->caller = caller;
+  trc->task = osal_self();
+  trc->op = op;
+}
+
+/**************************************************************************************************
+ * @fn          osal_mem_alloc
+ *
+ * @brief       The allocation entry point of callers built without OSALMEM_TRACE, such as the
+ *              stack libraries; traced with a caller of 0.
+ *
+ * input parameters
+ *
+ * @param size - the number of bytes to allocate from the HEAP.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      A pointer to the memory allocated, or NULL.
+ */
+void *osal_mem_alloc( uint16 size )
+{
+  return osal_mem_alloc_trc(size, 0);
+}
+
+/**************************************************************************************************
+ * @fn          osal_mem_free
+ *
+ * @brief       The de-allocation entry point of callers built without OSALMEM_TRACE, such as the
+ *              stack libraries; traced with a caller of 0.
+ *
+ * input parameters
+ *
+ * @param ptr - A valid pointer (i.e. a pointer returned by osal_mem_alloc()) to the memory to free.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+void osal_mem_free(void *ptr)
+{
+  osal_mem_free_trc(ptr, 0);
+}
+
+/**************************************************************************************************
+ * @fn          osal_mem_trace_read
+ *
+ * @brief       Move the oldest trace events out of the ring.
+ *
+ * input parameters
+ *
+ * @param max - the most events to move.
+ *
+ * output parameters
+ *
+ * @param buf - the events, oldest first.
+ * @param lost - the events overwritten before they could be read since the last read.
+ *
+ * @return      The number of events moved to buf.
+ */
+uint8 osal_mem_trace_read(osalMemTrace_t *buf, uint8 max, uint16 *lost)
+{
+  halIntState_t intState;
+  uint8 cnt;
+
+  HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts.
+
+  for (cnt = 0; (cnt < max) && (osalMemTrcCnt != 0); cnt++)
+  {
+    buf[cnt] = osalMemTrc[osalMemTrcHead];
+    if (++osalMemTrcHead == OSALMEM_TRACE_LEN)
+    {
+      osalMemTrcHead = 0;
+    }
+    osalMemTrcCnt--;
+  }
+  *lost = osalMemTrcLost;
+  osalMemTrcLost = 0;
+
+  HAL_EXIT_CRITICAL_SECTION(intState);  // Re-enable interrupts.
+
+  return cnt;
+}
+#endif
+
 #if OSALMEM_METRICS
 /*********************************************************************
  * @fn      osal_heap_block_max
@@ -609,6 +976,77 @@ uint16 osal_heap_mem_used( void )
 {
   return memAlo;
 }
+
+/*********************************************************************
+ * @fn      osal_heap_mem_free
+ *
+ * @brief   Walk the heap for the free bytes and the largest run of
+ *          adjacent free blocks, which one allocation could take once
+ *          coalesced. 1 - largest / free measures the fragmentation.
+ *          Blocks on the size class lists count as free.
+ *
+ * @param   largest - set to the bytes of the largest free run
+ *
+ * @return  Current number of free bytes.
+ */
+uint16 osal_heap_mem_free( uint16 *largest )
+{
+  osalMemHdr_t *hdr = theHeap;
+  halIntState_t intState;
+  uint16 total = 0;
+  uint16 run = 0;
+  uint16 most = 0;
+#if OSALMEM_SEGREGATED
+  osalMemHdr_t *seg;
+  uint8 idx;
+#endif
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+#if OSALMEM_SEGREGATED
+  for ( idx = 0; idx < OSALMEM_SEG_CNT; idx++ )
+  {
+    for ( seg = osalMemSegHead[idx]; seg != NULL; seg = OSALMEM_SEG_NEXT(seg) )
+    {
+      seg->hdr.inUse = FALSE;
+    }
+  }
+#endif
+
+  do
+  {
+    if ( hdr->hdr.inUse )
+    {
+      run = 0;
+    }
+    else
+    {
+      total += hdr->hdr.len;
+      run += hdr->hdr.len;
+      if ( most < run )
+      {
+        most = run;
+      }
+    }
+
+    hdr = (osalMemHdr_t *)((uint8 *)hdr + hdr->hdr.len);
+  } while ( hdr->val != 0 );
+
+#if OSALMEM_SEGREGATED
+  for ( idx = 0; idx < OSALMEM_SEG_CNT; idx++ )
+  {
+    for ( seg = osalMemSegHead[idx]; seg != NULL; seg = OSALMEM_SEG_NEXT(seg) )
+    {
+      seg->hdr.inUse = TRUE;
+    }
+  }
+#endif
+
+  HAL_EXIT_CRITICAL_SECTION( intState );  // Re-enable interrupts.
+
+  *largest = most;
+  return total;
+}
 #endif
 
 #if defined (ZTOOL_P1) || defined (ZTOOL_P2)
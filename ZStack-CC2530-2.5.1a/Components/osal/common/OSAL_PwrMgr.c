@@ -80,6 +80,13 @@ pwrmgr_attribute_t pwrmgr_attribute;
  * LOCAL VARIABLES
  */
 
+#if ( OSAL_TICKLESS )
+static pwrmgr_stats_t pwrmgr_stats;
+
+// Set when the CPU goes to sleep, until the next timer update
+static uint8 pwrmgr_asleep;
+#endif
+
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
@@ -101,6 +108,11 @@ void osal_pwrmgr_init( void )
 {
   pwrmgr_attribute.pwrmgr_device = PWRMGR_ALWAYS_ON; // Default to no power conservation.
   pwrmgr_attribute.pwrmgr_task_state = 0;            // Cleared.  All set to conserve
+
+#if ( OSAL_TICKLESS )
+  osal_memset( &pwrmgr_stats, 0, sizeof( pwrmgr_stats ) );
+  pwrmgr_asleep = FALSE;
+#endif
 }
 
 /*********************************************************************
@@ -182,6 +194,11 @@ void osal_pwrmgr_powerconserve( void )
       // Re-enable interrupts.
       HAL_EXIT_CRITICAL_SECTION( intState );
 
+#if ( OSAL_TICKLESS )
+      pwrmgr_stats.sleeps++;
+      pwrmgr_asleep = TRUE;
+#endif
+
       // Put the processor into sleep mode
       OSAL_SET_CPU_INTO_SLEEP( next );
     }
@@ -189,5 +206,60 @@ void osal_pwrmgr_powerconserve( void )
 }
 #endif /* POWER_SAVING */
 
+#if ( OSAL_TICKLESS )
+/*********************************************************************
+ * @fn      osal_pwrmgr_stats
+ *
+ * @brief   Copies the sleep counts of the tickless idle.
+ *
+ * @param   stats - where to copy them
+ *          reset - TRUE to clear them after the copy
+ *
+ * @return  none.
+ */
+void osal_pwrmgr_stats( pwrmgr_stats_t *stats, uint8 reset )
+{
+  halIntState_t intState;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );
+
+  *stats = pwrmgr_stats;
+  if ( reset )
+  {
+    pwrmgr_stats.sleeps = 0;
+    pwrmgr_stats.timerWakeups = 0;
+    pwrmgr_stats.timersBatched = 0;
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );
+}
+
+/*********************************************************************
+ * @fn      osal_pwrmgr_timers_due
+ *
+ * @brief   This function is called from osalTimerUpdate() with the
+ *          number of timers that fell due. The first update after a
+ *          sleep tells whether timers ended it.
+ *          Ints must be disabled.
+ *
+ * @param   due - timers that fell due.
+ *
+ * @return  none.
+ */
+void osal_pwrmgr_timers_due( uint8 due )
+{
+  if ( pwrmgr_asleep )
+  {
+    pwrmgr_asleep = FALSE;
+
+    if ( due )
+    {
+      pwrmgr_stats.timerWakeups++;
+      pwrmgr_stats.timersBatched += due - 1;
+    }
+  }
+}
+#endif
+
 /*********************************************************************
 *********************************************************************/
@@ -45,6 +45,7 @@
 #include "OnBoard.h"
 #include "OSAL.h"
 #include "OSAL_Timers.h"
+#include "OSAL_PwrMgr.h"
 #include "hal_timer.h"
 
 /*********************************************************************
@@ -59,13 +60,21 @@
  * TYPEDEFS
  */
 
+/*
+ * The timer list is a delta list: it is sorted by expiry, and each
+ * timer holds its timeout after the timer before it. A tick only
+ * changes the head of the list unless timers fall due.
+ */
 typedef struct
 {
   void   *next;
-  uint16 timeout;
+  uint16 timeout;         // after the previous timer of the list
   uint16 event_flag;
   uint8  task_id;
   uint16 reloadTimeout;
+#if ( OSAL_TICKLESS )
+  uint16 slack;           // how late it may fall due while asleep
+#endif
 } osalTimerRec_t;
 
 /*********************************************************************
@@ -88,12 +97,36 @@ osalTimerRec_t *timerHead;
 // Milliseconds since last reboot
 static uint32 osal_systemClock;
 
+#if ( OSAL_TIMERS_POOL_SIZE > 0 )
+// Timer records taken before the heap, and the free ones among them
+static osalTimerRec_t osalTimerPool[OSAL_TIMERS_POOL_SIZE];
+static osalTimerRec_t *osalTimerFree;
+
+// Records of the pool in use now and at most, and timers from the heap
+static uint8 osalTimerPoolUsed;
+static uint8 osalTimerPoolMax;
+static uint16 osalTimerHeapAllocs;
+#endif
+
+#if ( OSAL_TICKLESS )
+// The tickless wakeup, on osal_systemClock, and whether it is up to date;
+// see osal_next_timeout()
+static uint32 osalTimerWake;
+static uint8 osalTimerWakeValid;
+#endif
+
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
 osalTimerRec_t  *osalAddTimer( uint8 task_id, uint16 event_flag, uint16 timeout );
-osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag );
-void osalDeleteTimer( osalTimerRec_t *rmTimer );
+osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag, osalTimerRec_t **prevTimer );
+void osalInsertTimer( osalTimerRec_t *newTimer, uint16 timeout );
+void osalDeleteTimer( osalTimerRec_t *prevTimer, osalTimerRec_t *rmTimer );
+static osalTimerRec_t *osalAllocTimer( void );
+static void osalFreeTimer( osalTimerRec_t *freeTimer );
+#if ( OSAL_TICKLESS )
+static void osalTimerCoalesce( void );
+#endif
 
 /*********************************************************************
  * FUNCTIONS
@@ -110,13 +143,102 @@ void osalDeleteTimer( osalTimerRec_t *rmTimer );
  */
 void osalTimerInit( void )
 {
+#if ( OSAL_TIMERS_POOL_SIZE > 0 )
+  uint8 i;
+
+  // Chain the pool into the free list
+  osalTimerFree = NULL;
+  for ( i = OSAL_TIMERS_POOL_SIZE; i > 0; i-- )
+  {
+    osalTimerPool[i - 1].next = osalTimerFree;
+    osalTimerFree = &osalTimerPool[i - 1];
+  }
+
+  osalTimerPoolUsed = 0;
+  osalTimerPoolMax = 0;
+  osalTimerHeapAllocs = 0;
+#endif
+
+#if ( OSAL_TICKLESS )
+  osalTimerWakeValid = FALSE;
+#endif
+
   osal_systemClock = 0;
 }
 
+/*********************************************************************
+ * @fn      osalAllocTimer
+ *
+ * @brief   Take a timer record from the pool, or from the heap when
+ *          the pool is in use.
+ *          Ints must be disabled.
+ *
+ * @param   none
+ *
+ * @return  osalTimerRec_t * - the record, NULL if out of memory
+ */
+static osalTimerRec_t *osalAllocTimer( void )
+{
+#if ( OSAL_TIMERS_POOL_SIZE > 0 )
+  osalTimerRec_t *newTimer = osalTimerFree;
+
+  if ( newTimer )
+  {
+    osalTimerFree = newTimer->next;
+
+    if ( ++osalTimerPoolUsed > osalTimerPoolMax )
+    {
+      osalTimerPoolMax = osalTimerPoolUsed;
+    }
+
+    return ( newTimer );
+  }
+
+  newTimer = osal_mem_alloc( sizeof( osalTimerRec_t ) );
+  if ( newTimer && (osalTimerHeapAllocs < 0xFFFF) )
+  {
+    osalTimerHeapAllocs++;
+  }
+
+  return ( newTimer );
+#else
+  return ( osal_mem_alloc( sizeof( osalTimerRec_t ) ) );
+#endif
+}
+
+/*********************************************************************
+ * @fn      osalFreeTimer
+ *
+ * @brief   Give a timer record back to the pool or to the heap.
+ *
+ * @param   freeTimer - the record, out of the timer list
+ *
+ * @return  none
+ */
+static void osalFreeTimer( osalTimerRec_t *freeTimer )
+{
+#if ( OSAL_TIMERS_POOL_SIZE > 0 )
+  halIntState_t intState;
+
+  if ( (freeTimer >= osalTimerPool) && (freeTimer < osalTimerPool + OSAL_TIMERS_POOL_SIZE) )
+  {
+    HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+    freeTimer->next = osalTimerFree;
+    osalTimerFree = freeTimer;
+    osalTimerPoolUsed--;
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+    return;
+  }
+#endif
+
+  osal_mem_free( freeTimer );
+}
+
 /*********************************************************************
  * @fn      osalAddTimer
  *
- * @brief   Add a timer to the timer list.
+ * @brief   Add a timer to the timer list, or move an existing one to
+ *          its new timeout.
  *          Ints must be disabled.
  *
  * @param   task_id
@@ -128,55 +250,37 @@ void osalTimerInit( void )
 osalTimerRec_t * osalAddTimer( uint8 task_id, uint16 event_flag, uint16 timeout )
 {
   osalTimerRec_t *newTimer;
-  osalTimerRec_t *srchTimer;
+  osalTimerRec_t *prevTimer;
 
   // Look for an existing timer first
-  newTimer = osalFindTimer( task_id, event_flag );
+  newTimer = osalFindTimer( task_id, event_flag, &prevTimer );
   if ( newTimer )
   {
-    // Timer is found - update it.
-    newTimer->timeout = timeout;
-
-    return ( newTimer );
+    // Timer is found - take it out to move it.
+    osalDeleteTimer( prevTimer, newTimer );
   }
   else
   {
     // New Timer
-    newTimer = osal_mem_alloc( sizeof( osalTimerRec_t ) );
+    newTimer = osalAllocTimer();
 
-    if ( newTimer )
+    if ( newTimer == NULL )
     {
-      // Fill in new timer
-      newTimer->task_id = task_id;
-      newTimer->event_flag = event_flag;
-      newTimer->timeout = timeout;
-      newTimer->next = (void *)NULL;
-      newTimer->reloadTimeout = 0;
-
-      // Does the timer list already exist
-      if ( timerHead == NULL )
-      {
-        // Start task list
-        timerHead = newTimer;
-      }
-      else
-      {
-        // Add it to the end of the timer list
-        srchTimer = timerHead;
+      return ( (osalTimerRec_t *)NULL );
+    }
 
-        // Stop at the last record
-        while ( srchTimer->next )
-          srchTimer = srchTimer->next;
+    // Fill in new timer
+    newTimer->task_id = task_id;
+    newTimer->event_flag = event_flag;
+    newTimer->reloadTimeout = 0;
+#if ( OSAL_TICKLESS )
+    newTimer->slack = 0;
+#endif
+  }
 
-        // Add to the list
-        srchTimer->next = newTimer;
-      }
+  osalInsertTimer( newTimer, timeout );
 
-      return ( newTimer );
-    }
-    else
-      return ( (osalTimerRec_t *)NULL );
-  }
+  return ( newTimer );
 }
 
 /*********************************************************************
@@ -187,15 +291,17 @@ osalTimerRec_t * osalAddTimer( uint8 task_id, uint16 event_flag, uint16 timeout
  *
  * @param   task_id
  * @param   event_flag
+ * @param   prevTimer - set to the timer before it, NULL at the head
  *
  * @return  osalTimerRec_t *
  */
-osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag )
+osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag, osalTimerRec_t **prevTimer )
 {
   osalTimerRec_t *srchTimer;
 
   // Head of the timer list
   srchTimer = timerHead;
+  *prevTimer = NULL;
 
   // Stop when found or at the end
   while ( srchTimer )
@@ -205,30 +311,103 @@ osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag )
       break;
 
     // Not this one, check another
+    *prevTimer = srchTimer;
     srchTimer = srchTimer->next;
   }
 
   return ( srchTimer );
 }
 
+/*********************************************************************
+ * @fn      osalInsertTimer
+ *
+ * @brief   Insert a timer in the timer list after the timers that
+ *          expire before it or at the same time.
+ *          Ints must be disabled.
+ *
+ * @param   newTimer
+ * @param   timeout - from now
+ *
+ * @return  none
+ */
+void osalInsertTimer( osalTimerRec_t *newTimer, uint16 timeout )
+{
+  osalTimerRec_t *srchTimer;
+  osalTimerRec_t *prevTimer;
+
+#if ( OSAL_TICKLESS )
+  // A timer whose window closes before the wakeup brings it forward
+  if ( osalTimerWakeValid
+      && ((uint32)timeout + newTimer->slack < osalTimerWake - osal_systemClock) )
+  {
+    osalTimerWake = osal_systemClock + timeout + newTimer->slack;
+  }
+#endif
+
+  // Head of the timer list
+  srchTimer = timerHead;
+  prevTimer = NULL;
+
+  // Pass the timers that expire first, taking their timeouts off
+  while ( srchTimer && (srchTimer->timeout <= timeout) )
+  {
+    timeout -= srchTimer->timeout;
+    prevTimer = srchTimer;
+    srchTimer = srchTimer->next;
+  }
+
+  newTimer->timeout = timeout;
+  newTimer->next = srchTimer;
+
+  // The next timer now expires after this one
+  if ( srchTimer )
+  {
+    srchTimer->timeout -= timeout;
+  }
+
+  if ( prevTimer == NULL )
+  {
+    timerHead = newTimer;
+  }
+  else
+  {
+    prevTimer->next = newTimer;
+  }
+}
+
 /*********************************************************************
  * @fn      osalDeleteTimer
  *
- * @brief   Delete a timer from a timer list.
+ * @brief   Take a timer out of the timer list. The caller frees it.
+ *          Ints must be disabled.
  *
- * @param   table
+ * @param   prevTimer - timer before it, NULL at the head
  * @param   rmTimer
  *
  * @return  none
  */
-void osalDeleteTimer( osalTimerRec_t *rmTimer )
+void osalDeleteTimer( osalTimerRec_t *prevTimer, osalTimerRec_t *rmTimer )
 {
-  // Does the timer list really exist
-  if ( rmTimer )
+  osalTimerRec_t *nextTimer = rmTimer->next;
+
+#if ( OSAL_TICKLESS )
+  // The wakeup may have been the timer's own
+  osalTimerWakeValid = FALSE;
+#endif
+
+  // The next timer still expires at the same time
+  if ( nextTimer )
   {
-    // Clear the event flag and osalTimerUpdate() will delete 
-    // the timer from the list.
-    rmTimer->event_flag = 0;
+    nextTimer->timeout += rmTimer->timeout;
+  }
+
+  if ( prevTimer == NULL )
+  {
+    timerHead = nextTimer;
+  }
+  else
+  {
+    prevTimer->next = nextTimer;
   }
 }
 
@@ -261,6 +440,47 @@ uint8 osal_start_timerEx( uint8 taskID, uint16 event_id, uint16 timeout_value )
   return ( (newTimer != NULL) ? SUCCESS : NO_TIMER_AVAIL );
 }
 
+#if ( OSAL_TICKLESS )
+/*********************************************************************
+ * @fn      osal_start_timerEx_slack
+ *
+ * @brief
+ *
+ *   This function is called to start a timer to expire in n mSecs, or
+ *   up to slack mSecs later while the device sleeps: the power manager
+ *   sleeps on until a wakeup serves it with other timers. Awake, the
+ *   timer expires on time. The slack stays with the timer until it
+ *   expires, through reloads and restarts.
+ *
+ * @param   uint8 taskID - task id to set timer for
+ * @param   uint16 event_id - event to be notified with
+ * @param   uint16 timeout_value - in milliseconds.
+ * @param   uint16 slack - in milliseconds.
+ *
+ * @return  SUCCESS, or NO_TIMER_AVAIL.
+ */
+uint8 osal_start_timerEx_slack( uint8 taskID, uint16 event_id,
+                                uint16 timeout_value, uint16 slack )
+{
+  halIntState_t intState;
+  osalTimerRec_t *newTimer;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  // Add timer
+  newTimer = osalAddTimer( taskID, event_id, timeout_value );
+  if ( newTimer )
+  {
+    newTimer->slack = slack;
+    osalTimerWakeValid = FALSE;
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( (newTimer != NULL) ? SUCCESS : NO_TIMER_AVAIL );
+}
+#endif
+
 /*********************************************************************
  * @fn      osal_start_reload_timer
  *
@@ -296,6 +516,48 @@ uint8 osal_start_reload_timer( uint8 taskID, uint16 event_id, uint16 timeout_val
   return ( (newTimer != NULL) ? SUCCESS : NO_TIMER_AVAIL );
 }
 
+#if ( OSAL_TICKLESS )
+/*********************************************************************
+ * @fn      osal_start_reload_timer_slack
+ *
+ * @brief
+ *
+ *   This function is called to start a timer to expire in n mSecs, as
+ *   osal_start_reload_timer(), with the slack of
+ *   osal_start_timerEx_slack(). A reload that fell due late within its
+ *   slack counts from when it was due, so the timer keeps its period.
+ *
+ * @param   uint8 taskID - task id to set timer for
+ * @param   uint16 event_id - event to be notified with
+ * @param   uint16 timeout_value - in milliseconds.
+ * @param   uint16 slack - in milliseconds.
+ *
+ * @return  SUCCESS, or NO_TIMER_AVAIL.
+ */
+uint8 osal_start_reload_timer_slack( uint8 taskID, uint16 event_id,
+                                     uint16 timeout_value, uint16 slack )
+{
+  halIntState_t intState;
+  osalTimerRec_t *newTimer;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  // Add timer
+  newTimer = osalAddTimer( taskID, event_id, timeout_value );
+  if ( newTimer )
+  {
+    // Load the reload timeout value
+    newTimer->reloadTimeout = timeout_value;
+    newTimer->slack = slack;
+    osalTimerWakeValid = FALSE;
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( (newTimer != NULL) ? SUCCESS : NO_TIMER_AVAIL );
+}
+#endif
+
 /*********************************************************************
  * @fn      osal_stop_timerEx
  *
@@ -314,18 +576,24 @@ uint8 osal_stop_timerEx( uint8 task_id, uint16 event_id )
 {
   halIntState_t intState;
   osalTimerRec_t *foundTimer;
+  osalTimerRec_t *prevTimer;
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
   // Find the timer to stop
-  foundTimer = osalFindTimer( task_id, event_id );
+  foundTimer = osalFindTimer( task_id, event_id, &prevTimer );
   if ( foundTimer )
   {
-    osalDeleteTimer( foundTimer );
+    osalDeleteTimer( prevTimer, foundTimer );
   }
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
+  if ( foundTimer )
+  {
+    osalFreeTimer( foundTimer );
+  }
+
   return ( (foundTimer != NULL) ? SUCCESS : INVALID_EVENT_ID );
 }
 
@@ -347,11 +615,21 @@ uint16 osal_get_timeoutEx( uint8 task_id, uint16 event_id )
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
-  tmr = osalFindTimer( task_id, event_id );
+  // Add up the timeouts to the timer
+  tmr = timerHead;
+  while ( tmr )
+  {
+    rtrn += tmr->timeout;
+
+    if ( tmr->event_flag == event_id && tmr->task_id == task_id )
+      break;
 
-  if ( tmr )
+    tmr = tmr->next;
+  }
+
+  if ( tmr == NULL )
   {
-    rtrn = tmr->timeout;
+    rtrn = 0;
   }
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
@@ -391,10 +669,52 @@ uint8 osal_timer_num_active( void )
   return num_timers;
 }
 
+/*********************************************************************
+ * @fn      osal_timer_pool_high_water
+ *
+ * @brief
+ *
+ *   This function returns the highest number of timer records of the
+ *   pool ever in use at once. At OSAL_TIMERS_POOL_SIZE, the pool was
+ *   used up and timers came from the heap. 0 without the pool.
+ *
+ * @return  uint8 - number of records
+ */
+uint8 osal_timer_pool_high_water( void )
+{
+#if ( OSAL_TIMERS_POOL_SIZE > 0 )
+  return ( osalTimerPoolMax );
+#else
+  return ( 0 );
+#endif
+}
+
+/*********************************************************************
+ * @fn      osal_timer_heap_allocs
+ *
+ * @brief
+ *
+ *   This function returns the number of timers allocated from the heap
+ *   because the pool was in use, saturating at 0xFFFF. Without the pool
+ *   it does not count, and returns 0.
+ *
+ * @return  uint16 - number of allocations
+ */
+uint16 osal_timer_heap_allocs( void )
+{
+#if ( OSAL_TIMERS_POOL_SIZE > 0 )
+  return ( osalTimerHeapAllocs );
+#else
+  return ( 0 );
+#endif
+}
+
 /*********************************************************************
  * @fn      osalTimerUpdate
  *
- * @brief   Update the timer structures for a timer tick.
+ * @brief   Update the timer structures for a timer tick. Only the
+ *          timers at the head of the list are touched: those that fall
+ *          due, and the first one that does not.
  *
  * @param   none
  *
@@ -404,79 +724,105 @@ void osalTimerUpdate( uint16 updateTime )
 {
   halIntState_t intState;
   osalTimerRec_t *srchTimer;
-  osalTimerRec_t *prevTimer;
+  osalTimerRec_t *nextTimer;
+  osalTimerRec_t *dueTimers = NULL;
+  osalTimerRec_t *lastTimer = NULL;
+#if ( OSAL_TICKLESS )
+  uint16 late;
+  uint8 due = 0;
+#else
+  const uint16 late = 0;
+#endif
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
   // Update the system time
   osal_systemClock += updateTime;
-  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-  // Look for open timer slot
-  if ( timerHead != NULL )
+  // Take the timers that fall due off the head, in order
+  while ( timerHead && (timerHead->timeout <= updateTime) )
   {
-    // Add it to the end of the timer list
     srchTimer = timerHead;
-    prevTimer = (void *)NULL;
+    updateTime -= srchTimer->timeout;
+    timerHead = srchTimer->next;
+#if ( OSAL_TICKLESS )
+    // Off the list, the timeout holds how late the timer falls due
+    srchTimer->timeout = updateTime;
+#endif
+
+    srchTimer->next = NULL;
+    if ( lastTimer == NULL )
+      dueTimers = srchTimer;
+    else
+      lastTimer->next = srchTimer;
+    lastTimer = srchTimer;
+#if ( OSAL_TICKLESS )
+    if ( due < 0xFF )
+      due++;
+#endif
+  }
 
-    // Look for open timer slot
-    while ( srchTimer )
+  // The rest of the time comes off the first timer not due
+  if ( timerHead )
+  {
+    timerHead->timeout -= updateTime;
+  }
+
+#if ( OSAL_TICKLESS )
+  // The power manager counts the wakeups served by timers
+  osal_pwrmgr_timers_due( due );
+
+  // The wakeup was that of a timer that fell due
+  if ( due )
+    osalTimerWakeValid = FALSE;
+#endif
+
+  // Reload timers go back on the list before interrupts are enabled, so
+  // that osal_stop_timerEx() and osal_get_timeoutEx() find them at all
+  // times. The one-shot timers stay on the due list.
+  srchTimer = dueTimers;
+  dueTimers = NULL;
+  lastTimer = NULL;
+  while ( srchTimer )
+  {
+    nextTimer = srchTimer->next;
+
+    if ( srchTimer->reloadTimeout )
     {
-      osalTimerRec_t *freeTimer = NULL;
-     
-      HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
-      
-      if (srchTimer->timeout <= updateTime)
-      {
-        srchTimer->timeout = 0;
-      }
-      else
-      {
-        srchTimer->timeout = srchTimer->timeout - updateTime;
-      }
-      
-      // Check for reloading
-      if ( (srchTimer->timeout == 0) && (srchTimer->reloadTimeout) && (srchTimer->event_flag) )
-      {
-        // Notify the task of a timeout
-        osal_set_event( srchTimer->task_id, srchTimer->event_flag );
-        
-        // Reload the timer timeout value
-        srchTimer->timeout = srchTimer->reloadTimeout;
-      }
-      
-      // When timeout or delete (event_flag == 0)
-      if ( srchTimer->timeout == 0 || srchTimer->event_flag == 0 )
-      {
-        // Take out of list
-        if ( prevTimer == NULL )
-          timerHead = srchTimer->next;
-        else
-          prevTimer->next = srchTimer->next;
-
-        // Setup to free memory
-        freeTimer = srchTimer;
-
-        // Next
-        srchTimer = srchTimer->next;
-      }
+      // Notify the task of a timeout
+      osal_set_event( srchTimer->task_id, srchTimer->event_flag );
+#if ( OSAL_TICKLESS )
+      // Late within its slack, the timer reloads from when it was due
+      late = (srchTimer->timeout < srchTimer->slack) ? srchTimer->timeout : srchTimer->slack;
+      if ( late >= srchTimer->reloadTimeout )
+        late = 0;
+#endif
+      osalInsertTimer( srchTimer, srchTimer->reloadTimeout - late );
+    }
+    else
+    {
+      srchTimer->next = NULL;
+      if ( lastTimer == NULL )
+        dueTimers = srchTimer;
       else
-      {
-        // Get next
-        prevTimer = srchTimer;
-        srchTimer = srchTimer->next;
-      }
-      
-      HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
-      
-      if ( freeTimer )
-      {
-        if ( freeTimer->timeout == 0 )
-        {
-          osal_set_event( freeTimer->task_id, freeTimer->event_flag );
-        }
-        osal_mem_free( freeTimer );
-      }
+        lastTimer->next = srchTimer;
+      lastTimer = srchTimer;
     }
+
+    srchTimer = nextTimer;
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  while ( dueTimers )
+  {
+    srchTimer = dueTimers;
+    dueTimers = srchTimer->next;
+
+    // Notify the task of a timeout
+    osal_set_event( srchTimer->task_id, srchTimer->event_flag );
+
+    osalFreeTimer( srchTimer );
   }
 }
 
@@ -509,8 +855,14 @@ void osal_adjust_timers( void )
  *
  * @brief
  *
- *   Search timer table to return the lowest timeout value. If the
- *   timer list is empty, then the returned timeout will be zero.
+ *   Return the lowest timeout value. If the timer list is empty, then
+ *   the returned timeout will be zero.
+ *
+ *   Under OSAL_TICKLESS, return the time of the tickless wakeup instead:
+ *   a time by which no timer is later than its slack allows, so that
+ *   every timer that expires by then falls due in the same wakeup. It is
+ *   kept up to date as timers start, and worked out again by
+ *   osalTimerCoalesce() only after timers fell due or stopped.
  *
  * @param   none
  *
@@ -518,35 +870,68 @@ void osal_adjust_timers( void )
  *********************************************************************/
 uint16 osal_next_timeout( void )
 {
-  uint16 nextTimeout;
+#if ( OSAL_TICKLESS )
+  uint32 wake;
+
+  if ( timerHead == NULL )
+    return ( 0 );
+
+  if ( !osalTimerWakeValid )
+    osalTimerCoalesce();
+
+  wake = osalTimerWake - osal_systemClock;
+  return ( (wake < OSAL_TIMERS_MAX_TIMEOUT) ? (uint16)wake : OSAL_TIMERS_MAX_TIMEOUT );
+#else
+  // The head of the list expires first
+  return ( (timerHead != NULL) ? timerHead->timeout : 0 );
+#endif
+}
+#endif // POWER_SAVING
+
+#if ( OSAL_TICKLESS )
+/*********************************************************************
+ * @fn      osalTimerCoalesce
+ *
+ * @brief   Work out the tickless wakeup from the head of the timer list
+ *          and at most OSAL_TIMERS_SLACK_SCAN timers after it: the
+ *          earliest time a slack window closes, but no later than the
+ *          expiry of the first timer not looked at. A timer that expires
+ *          after the wakeup cannot bring it forward, so the walk stops
+ *          there, at once if the head has no slack.
+ *          Ints must be disabled.
+ *
+ * @param   none
+ *
+ * @return  none
+ *********************************************************************/
+static void osalTimerCoalesce( void )
+{
   osalTimerRec_t *srchTimer;
+  uint32 expiry;
+  uint32 wake;
+  uint8 scan;
 
-  if ( timerHead != NULL )
-  {
-    // Head of the timer list
-    srchTimer = timerHead;
-    nextTimeout = OSAL_TIMERS_MAX_TIMEOUT;
+  expiry = timerHead->timeout;
+  wake = expiry + timerHead->slack;
 
-    // Look for the next timeout timer
-    while ( srchTimer != NULL )
+  srchTimer = timerHead->next;
+  for ( scan = 0; srchTimer && (expiry + srchTimer->timeout < wake); scan++ )
+  {
+    expiry += srchTimer->timeout;
+    if ( scan == OSAL_TIMERS_SLACK_SCAN )
     {
-      if (srchTimer->timeout < nextTimeout)
-      {
-        nextTimeout = srchTimer->timeout;
-      }
-      // Check next timer
-      srchTimer = srchTimer->next;
+      wake = expiry;
+      break;
     }
-  }
-  else
-  {
-    // No timers
-    nextTimeout = 0;
+    if ( expiry + srchTimer->slack < wake )
+      wake = expiry + srchTimer->slack;
+    srchTimer = srchTimer->next;
   }
 
-  return ( nextTimeout );
+  osalTimerWake = osal_systemClock + wake;
+  osalTimerWakeValid = TRUE;
 }
-#endif // POWER_SAVING
+#endif
 
 /*********************************************************************
  * @fn      osal_GetSystemClock()
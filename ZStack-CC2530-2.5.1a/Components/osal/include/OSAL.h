@@ -72,7 +72,7 @@ extern "C"
 
 #define OSAL_MSG_Q_HEAD(q_ptr)      (*(q_ptr))
 
-#define OSAL_MSG_LEN(msg_ptr)      ((osal_msg_hdr_t *) (msg_ptr) - 1)->len
+#define OSAL_MSG_LEN(msg_ptr)      (((osal_msg_hdr_t *) (msg_ptr) - 1)->len & ~(OSAL_MSG_LEN_REF | OSAL_MSG_LEN_SHARED))
 
 #define OSAL_MSG_ID(msg_ptr)      ((osal_msg_hdr_t *) (msg_ptr) - 1)->dest_id
 
@@ -83,6 +83,30 @@ extern "C"
 /*** Interrupts ***/
 #define INTS_ALL    0xFF
 
+/*** Messages ***/
+// Set in the len of a message from osal_msg_allocate_ref()
+#define OSAL_MSG_LEN_REF    0x8000
+// Set in the len of a message from osal_msg_allocate_shared()
+#define OSAL_MSG_LEN_SHARED 0x4000
+
+/*** Profiler ***/
+// Histograms of the event latency and handler time of the tasks, per
+// event, in ticks of OSAL_PROF_TIME() of OnBoard.h
+#if !defined ( OSAL_PROFILE )
+  #define OSAL_PROFILE        FALSE
+#endif
+
+// Events profiled, each a task and one of its event bits
+#if !defined ( OSAL_PROF_SLOTS )
+  #define OSAL_PROF_SLOTS     12
+#endif
+
+// Buckets of a histogram: bucket b counts the times of b significant
+// bits (0, 1, 2-3, 4-7, ...), and the last also all longer ones
+#if !defined ( OSAL_PROF_BUCKETS )
+  #define OSAL_PROF_BUCKETS   12
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -101,6 +125,20 @@ typedef struct
 
 typedef void * osal_msg_q_t;
 
+#if ( OSAL_PROFILE )
+// Profile of an event of a task
+typedef struct
+{
+  uint8  task;                         // task ID
+  uint8  event;                        // event bit, 0-15
+  uint16 maxLatency;                   // longest time from osal_set_event()
+  uint16 maxExec;                      // longest handler time
+  uint16 latency[OSAL_PROF_BUCKETS];   // osal_set_event() to the handler
+                                       // call that clears the event
+  uint16 exec[OSAL_PROF_BUCKETS];      // handler calls that clear the event
+} osalProfile_t;
+#endif
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -116,16 +154,41 @@ typedef void * osal_msg_q_t;
    */
   extern uint8 * osal_msg_allocate(uint16 len );
 
+  /*
+   * Task Message Allocation, that other messages can point into
+   */
+  extern uint8 * osal_msg_allocate_shared( uint16 len );
+
+  /*
+   * Task Message Allocation, holding a reference to a shared message
+   */
+  extern uint8 * osal_msg_allocate_ref( uint16 len, uint8 *shared );
+
   /*
    * Task Message Deallocation
    */
   extern uint8 osal_msg_deallocate( uint8 *msg_ptr );
 
+  /*
+   * Add a reference to a Shared Message
+   */
+  extern uint8 osal_msg_hold( uint8 *msg_ptr );
+
+  /*
+   * Drop a reference to a Shared Message, freeing it with the last one
+   */
+  extern uint8 osal_msg_release( uint8 *msg_ptr );
+
   /*
    * Send a Task Message
    */
   extern uint8 osal_msg_send( uint8 destination_task, uint8 *msg_ptr );
 
+  /*
+   * Push a Task Message to head of the task's queue
+   */
+  extern uint8 osal_msg_push_front( uint8 destination_task, uint8 *msg_ptr );
+
   /*
    * Receive a Task Message
    */
@@ -220,6 +283,28 @@ typedef void * osal_msg_q_t;
    */
   extern uint8 osal_self( void );
 
+  /*
+   * Number of times a task was dispatched, modulo 65536
+   */
+  extern uint16 osal_task_dispatches( uint8 task_id );
+
+#if ( OSAL_PROFILE )
+  /*
+   * Copy the profile of an event, by slot from 0; FALSE past the last
+   */
+  extern uint8 osal_profile_read( uint8 slot, osalProfile_t *prof );
+
+  /*
+   * Samples not profiled for want of a slot
+   */
+  extern uint16 osal_profile_missed( void );
+
+  /*
+   * Clear the profiles and free their slots
+   */
+  extern void osal_profile_reset( void );
+#endif
+
 
 /*** Helper Functions ***/
 
@@ -58,6 +58,39 @@ extern "C"
   #define OSALMEM_METRICS  FALSE
 #endif
 
+// Keep freed blocks of the common small sizes on free lists by size class
+// (see OSALMEM_SEG_SIZES in OSAL_Memory.c) for reuse without a heap walk.
+#if !defined ( OSALMEM_SEGREGATED )
+  #define OSALMEM_SEGREGATED  FALSE
+#endif
+
+// Record every osal_mem_alloc() and osal_mem_free() in a RAM ring of
+// OSALMEM_TRACE_LEN osalMemTrace_t events, read with osal_mem_trace_read().
+#if !defined ( OSALMEM_TRACE )
+  #define OSALMEM_TRACE  FALSE
+#endif
+
+#if ( OSALMEM_TRACE )
+  #if defined ( DPRINTF_OSALHEAPTRACE )
+    #error OSALMEM_TRACE and DPRINTF_OSALHEAPTRACE cannot both be used.
+  #endif
+
+  #if !defined ( OSALMEM_TRACE_LEN )
+    #define OSALMEM_TRACE_LEN  64
+  #endif
+
+  // Call site recorded by a traced call; with the task, it names the caller.
+  // Define it per file, e.g. as ((FILE_ID << 12) | __LINE__), to tell files apart.
+  #if !defined ( OSALMEM_TRACE_CALLER )
+    #define OSALMEM_TRACE_CALLER  __LINE__
+  #endif
+#endif
+
+// osalMemTrace_t op values
+#define OSALMEM_TRACE_ALLOC  0x01  // block allocated
+#define OSALMEM_TRACE_FREE   0x02  // block freed
+#define OSALMEM_TRACE_FAIL   0x03  // allocation failed
+
 /*********************************************************************
  * MACROS
  */
@@ -68,6 +101,17 @@ extern "C"
  * TYPEDEFS
  */
 
+// A heap trace event; 10 bytes, little-endian, over MT.
+typedef struct
+{
+  uint16 tick;    // osal_GetSystemClock(), low 16 bits
+  uint16 size;    // bytes asked for; for a free, the block length with its header
+  uint16 block;   // offset of the block's data in the heap; 0 for a failed allocation
+  uint16 caller;  // OSALMEM_TRACE_CALLER of the call; 0 from a library
+  uint8  task;    // osal_self() at the call
+  uint8  op;      // OSALMEM_TRACE_ALLOC, OSALMEM_TRACE_FREE or OSALMEM_TRACE_FAIL
+} osalMemTrace_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -92,6 +136,10 @@ extern "C"
 #ifdef DPRINTF_OSALHEAPTRACE
   void *osal_mem_alloc_dbg( uint16 size, const char *fname, unsigned lnum );
 #define osal_mem_alloc(_size ) osal_mem_alloc_dbg(_size, __FILE__, __LINE__)
+#elif ( OSALMEM_TRACE )
+  void *osal_mem_alloc( uint16 size );
+  void *osal_mem_alloc_trc( uint16 size, uint16 caller );
+#define osal_mem_alloc(_size ) osal_mem_alloc_trc(_size, OSALMEM_TRACE_CALLER)
 #else /* DPRINTF_OSALHEAPTRACE */
   void *osal_mem_alloc( uint16 size );
 #endif /* DPRINTF_OSALHEAPTRACE */
@@ -102,10 +150,22 @@ extern "C"
 #ifdef DPRINTF_OSALHEAPTRACE
   void osal_mem_free_dbg( void *ptr, const char *fname, unsigned lnum );
 #define osal_mem_free(_ptr ) osal_mem_free_dbg(_ptr, __FILE__, __LINE__)
+#elif ( OSALMEM_TRACE )
+  void osal_mem_free( void *ptr );
+  void osal_mem_free_trc( void *ptr, uint16 caller );
+#define osal_mem_free(_ptr ) osal_mem_free_trc(_ptr, OSALMEM_TRACE_CALLER)
 #else /* DPRINTF_OSALHEAPTRACE */
   void osal_mem_free( void *ptr );
 #endif /* DPRINTF_OSALHEAPTRACE */
 
+#if ( OSALMEM_TRACE )
+ /*
+  * Move up to max of the oldest trace events to buf; return how many.
+  * *lost is set to the events overwritten since the last read.
+  */
+  uint8 osal_mem_trace_read( osalMemTrace_t *buf, uint8 max, uint16 *lost );
+#endif
+
 #if ( OSALMEM_METRICS )
  /*
   * Return the maximum number of blocks ever allocated at once.
@@ -126,6 +186,11 @@ extern "C"
   * Return the current number of bytes allocated.
   */
   uint16 osal_heap_mem_used( void );
+
+ /*
+  * Return the number of free bytes, and the most that one block could take.
+  */
+  uint16 osal_heap_mem_free( uint16 *largest );
 #endif
 
 #if defined (ZTOOL_P1) || defined (ZTOOL_P2)
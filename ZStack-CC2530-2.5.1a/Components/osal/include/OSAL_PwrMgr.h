@@ -48,6 +48,7 @@ extern "C"
 /*********************************************************************
  * INCLUDES
  */
+#include "OSAL_Timers.h"
  
 /*********************************************************************
  * MACROS
@@ -68,6 +69,18 @@ typedef struct
   uint8  pwrmgr_device;
 } pwrmgr_attribute_t;
 
+#if ( OSAL_TICKLESS )
+/* Sleep counts of the tickless idle. A sleep not ended by a timer was
+ * ended by an interrupt, or by the MAC.
+ */
+typedef struct
+{
+  uint32 sleeps;          // times the CPU was put to sleep
+  uint32 timerWakeups;    // sleeps ended by OSAL timers falling due
+  uint32 timersBatched;   // timers beyond the first of those wakeups
+} pwrmgr_stats_t;
+#endif
+
 /* With PWRMGR_ALWAYS_ON selection, there is no power savings and the
  * device is most likely on mains power. The PWRMGR_BATTERY selection allows
  * the HAL sleep manager to enter SLEEP LITE state or SLEEP DEEP state.
@@ -129,6 +142,19 @@ extern pwrmgr_attribute_t pwrmgr_attribute;
    */
   extern void osal_pwrmgr_powerconserve( void );
 
+#if ( OSAL_TICKLESS )
+  /*
+   * Copy the sleep counts, and clear them if reset is TRUE.
+   */
+  extern void osal_pwrmgr_stats( pwrmgr_stats_t *stats, uint8 reset );
+
+  /*
+   * Called by osalTimerUpdate() with the number of timers that fell due,
+   * and shouldn't be called from anywhere else.
+   */
+  extern void osal_pwrmgr_timers_due( uint8 due );
+#endif
+
 /*********************************************************************
 *********************************************************************/
 
@@ -58,6 +58,11 @@ extern "C"
  */
 #define TASK_NO_TASK      0xFF
 
+// Most tasks the ready set of the scheduler holds (at most 64)
+#if !defined ( OSAL_MAX_TASKS )
+  #define OSAL_MAX_TASKS    32
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
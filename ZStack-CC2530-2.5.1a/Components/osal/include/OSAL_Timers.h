@@ -58,6 +58,37 @@ extern "C"
  */
 #define OSAL_TIMERS_MAX_TIMEOUT 0xFFFF
 
+// Timer records kept in RAM for the timers; more timers come from the heap.
+// Each record takes about 10 bytes of RAM (12 with OSAL_TICKLESS) whether
+// in use or not, where a heap timer takes its record and a heap header
+// only while it runs. The GenericApp coordinator runs up to about 8 timers
+// of its own, the HAL's and the ZDO's at once, and the stack libraries
+// some more. 0 takes every timer from the heap, as before.
+#if !defined ( OSAL_TIMERS_POOL_SIZE )
+  #define OSAL_TIMERS_POOL_SIZE  12
+#endif
+
+// The pool counters are uint8
+#if ( OSAL_TIMERS_POOL_SIZE > 255 )
+  #error "OSAL_TIMERS_POOL_SIZE must be at most 255"
+#endif
+
+// Tickless idle of POWER_SAVING builds: a timer may fall due up to its
+// slack late, so that one wakeup serves the timers whose windows overlap
+#if !defined ( POWER_SAVING )
+  #undef OSAL_TICKLESS
+  #define OSAL_TICKLESS  FALSE
+#elif !defined ( OSAL_TICKLESS )
+  #define OSAL_TICKLESS  FALSE
+#endif
+
+// Timers after the first that the tickless wakeup is worked out over when
+// the timer list changes. The wakeup is no later than the expiry of the
+// first timer past them, so more timers only batch more.
+#if !defined ( OSAL_TIMERS_SLACK_SCAN )
+  #define OSAL_TIMERS_SLACK_SCAN  4
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -79,12 +110,35 @@ extern "C"
    * Set a Timer
    */
   extern uint8 osal_start_timerEx( uint8 task_id, uint16 event_id, uint16 timeout_value );
+
+  /*
+   * Set a Timer that may fall due up to slack ms late while the device sleeps
+   */
+#if ( OSAL_TICKLESS )
+  extern uint8 osal_start_timerEx_slack( uint8 task_id, uint16 event_id,
+                                         uint16 timeout_value, uint16 slack );
+#else
+  #define osal_start_timerEx_slack( task_id, event_id, timeout_value, slack ) \
+            osal_start_timerEx( (task_id), (event_id), (timeout_value) )
+#endif
   
   /*
    * Set a timer that reloads itself.
    */
   extern uint8 osal_start_reload_timer( uint8 taskID, uint16 event_id, uint16 timeout_value );
 
+  /*
+   * Set a timer that reloads itself, and may fall due up to slack ms late
+   * while the device sleeps without losing its period.
+   */
+#if ( OSAL_TICKLESS )
+  extern uint8 osal_start_reload_timer_slack( uint8 taskID, uint16 event_id,
+                                              uint16 timeout_value, uint16 slack );
+#else
+  #define osal_start_reload_timer_slack( taskID, event_id, timeout_value, slack ) \
+            osal_start_reload_timer( (taskID), (event_id), (timeout_value) )
+#endif
+
   /*
    * Stop a Timer
    */
@@ -116,6 +170,18 @@ extern "C"
    */
   extern uint8 osal_timer_num_active( void );
 
+  /*
+   * Return the highest number of timer records of the pool ever in use at once;
+   * 0 without the pool
+   */
+  extern uint8 osal_timer_pool_high_water( void );
+
+  /*
+   * Return the number of timers allocated from the heap with the pool in use;
+   * 0 without the pool
+   */
+  extern uint16 osal_timer_heap_allocs( void );
+
   /*
    * Set the hardware timer interrupts for sleep mode.
    * These functions should only be called in OSAL_PwrMgr.c
@@ -129,7 +195,8 @@ extern "C"
   extern uint32 osal_GetSystemClock( void );
 
   /*
-   * Get the next OSAL timer expiration.
+   * Get the next OSAL timer expiration; under OSAL_TICKLESS, a time by
+   * which no timer is later than its slack allows.
    * This function should only be called in OSAL_PwrMgr.c
    */
   extern uint16 osal_next_timeout( void );
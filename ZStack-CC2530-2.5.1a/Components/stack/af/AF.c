@@ -99,8 +99,9 @@ epList_t *epList;
  */
 
 static void afBuildMSGIncoming( aps_FrameFormat_t *aff, endPointDesc_t *epDesc,
-                zAddrType_t *SrcAddress, uint16 SrcPanId, NLDE_Signal_t *sig,
-                uint8 nwkSeqNum, uint8 SecurityUse, uint32 timestamp );
+                uint8 **shared, uint8 share, zAddrType_t *SrcAddress, uint16 SrcPanId,
+                NLDE_Signal_t *sig, uint8 nwkSeqNum, uint8 SecurityUse,
+                uint32 timestamp );
 
 static epList_t *afFindEndPointDescList( uint8 EndPoint );
 
@@ -284,6 +285,10 @@ void afDataConfirm( uint8 endPoint, uint8 transID, ZStatus_t status )
  * @fn          afIncomingData
  *
  * @brief       Transfer a data PDU (ASDU) from the APS sub-layer to the AF.
+ *              Each endpoint matched is delivered when the next one is
+ *              found, so that when there are several the message of the
+ *              first carries the ASDU and the others point into it
+ *              (AF_SHARED_INCOMING).
  *
  * @param       aff  - pointer to APS frame format
  * @param       SrcAddress  - Source address
@@ -299,6 +304,8 @@ void afIncomingData( aps_FrameFormat_t *aff, zAddrType_t *SrcAddress, uint16 Src
                      NLDE_Signal_t *sig, uint8 nwkSeqNum, uint8 SecurityUse, uint32 timestamp )
 {
   endPointDesc_t *epDesc = NULL;
+  endPointDesc_t *pending = NULL;  // Endpoint matched, not yet delivered
+  uint8 *shared = NULL;            // Message carrying the ASDU for all of them
   epList_t *pList = epList;
 #if !defined ( APS_NO_GROUPS )
   uint8 grpEp = APS_GROUPS_EP_NOT_FOUND;
@@ -356,19 +363,16 @@ void afIncomingData( aps_FrameFormat_t *aff, zAddrType_t *SrcAddress, uint16 Src
     if ( (aff->ProfileID == epProfileID) ||
          ((epDesc->endPoint == ZDO_EP) && (aff->ProfileID == ZDO_PROFILE_ID)) )
     {
+      if ( pending )
       {
-        // Save original endpoint
-        uint8 endpoint = aff->DstEndPoint;
-
-        // overwrite with descriptor's endpoint
-        aff->DstEndPoint = epDesc->endPoint;
-
-        afBuildMSGIncoming( aff, epDesc, SrcAddress, SrcPanId, sig,
-                           nwkSeqNum, SecurityUse, timestamp );
-
-        // Restore with original endpoint
-        aff->DstEndPoint = endpoint;
+        // Another endpoint: the message of the first carries the ASDU
+        // for all of them
+        afBuildMSGIncoming( aff, pending, &shared, AF_SHARED_INCOMING,
+                            SrcAddress, SrcPanId, sig, nwkSeqNum, SecurityUse,
+                            timestamp );
       }
+
+      pending = epDesc;
     }
 
     if ( ((aff->FrmCtrl & APS_DELIVERYMODE_MASK) == APS_FC_DM_GROUP) )
@@ -377,15 +381,11 @@ void afIncomingData( aps_FrameFormat_t *aff, zAddrType_t *SrcAddress, uint16 Src
       // Find the next endpoint for this group
       grpEp = aps_FindGroupForEndpoint( aff->GroupID, grpEp );
       if ( grpEp == APS_GROUPS_EP_NOT_FOUND )
-        return;   // No endpoint found
-
-      epDesc = afFindEndPointDesc( grpEp );
-      if ( epDesc == NULL )
-        return;   // Endpoint descriptor not found
-
-      pList = afFindEndPointDescList( epDesc->endPoint );
+        epDesc = NULL;  // No endpoint found
+      else if ( (epDesc = afFindEndPointDesc( grpEp )) )
+        pList = afFindEndPointDescList( epDesc->endPoint );
 #else
-      return;
+      epDesc = NULL;
 #endif
     }
     else if ( aff->DstEndPoint == AF_BROADCAST_ENDPOINT )
@@ -399,6 +399,18 @@ void afIncomingData( aps_FrameFormat_t *aff, zAddrType_t *SrcAddress, uint16 Src
     else
       epDesc = NULL;
   }
+
+  if ( pending )
+  {
+    afBuildMSGIncoming( aff, pending, &shared, FALSE, SrcAddress, SrcPanId,
+                        sig, nwkSeqNum, SecurityUse, timestamp );
+  }
+
+  if ( shared )
+  {
+    // The messages hold their own references
+    osal_msg_release( shared );
+  }
 }
 
 /*********************************************************************
@@ -406,24 +418,54 @@ void afIncomingData( aps_FrameFormat_t *aff, zAddrType_t *SrcAddress, uint16 Src
  *
  * @brief       Build the message for the app
  *
- * @param
+ * @param       shared - message carrying the ASDU to point into, or
+ *                       NULL to carry it in this message
+ * @param       share - TRUE to make this message the one carrying the
+ *                      ASDU for the next ones, held in *shared until
+ *                      released with osal_msg_release()
  *
  * @return      pointer to next in data buffer
  */
 static void afBuildMSGIncoming( aps_FrameFormat_t *aff, endPointDesc_t *epDesc,
-                 zAddrType_t *SrcAddress, uint16 SrcPanId, NLDE_Signal_t *sig,
-                 uint8 nwkSeqNum, uint8 SecurityUse, uint32 timestamp )
+                 uint8 **shared, uint8 share, zAddrType_t *SrcAddress, uint16 SrcPanId,
+                 NLDE_Signal_t *sig, uint8 nwkSeqNum, uint8 SecurityUse,
+                 uint32 timestamp )
 {
   afIncomingMSGPacket_t *MSGpkt;
-  const uint8 len = sizeof( afIncomingMSGPacket_t ) + aff->asduLength;
   uint8 *asdu = aff->asdu;
-  MSGpkt = (afIncomingMSGPacket_t *)osal_msg_allocate( len );
+  // Save original endpoint
+  uint8 endpoint = aff->DstEndPoint;
+
+  if ( *shared )
+  {
+    MSGpkt = (afIncomingMSGPacket_t *)osal_msg_allocate_ref(
+                                        sizeof( afIncomingMSGPacket_t ), *shared );
+  }
+  else if ( share && aff->asduLength )
+  {
+    MSGpkt = (afIncomingMSGPacket_t *)osal_msg_allocate_shared(
+                                        sizeof( afIncomingMSGPacket_t ) + aff->asduLength );
+    if ( MSGpkt )
+    {
+      // Held until every endpoint has its message
+      osal_msg_hold( (uint8 *)MSGpkt );
+      *shared = (uint8 *)MSGpkt;
+    }
+  }
+  else
+  {
+    MSGpkt = (afIncomingMSGPacket_t *)osal_msg_allocate(
+                                        sizeof( afIncomingMSGPacket_t ) + aff->asduLength );
+  }
 
   if ( MSGpkt == NULL )
   {
     return;
   }
 
+  // overwrite with descriptor's endpoint
+  aff->DstEndPoint = epDesc->endPoint;
+
   MSGpkt->hdr.event = AF_INCOMING_MSG_CMD;
   MSGpkt->groupId = aff->GroupID;
   MSGpkt->clusterId = aff->ClusterID;
@@ -442,7 +484,11 @@ static void afBuildMSGIncoming( aps_FrameFormat_t *aff, endPointDesc_t *epDesc,
   MSGpkt->cmd.TransSeqNumber = 0;
   MSGpkt->cmd.DataLength = aff->asduLength;
 
-  if ( MSGpkt->cmd.DataLength )
+  if ( *shared && (*shared != (uint8 *)MSGpkt) )
+  {
+    MSGpkt->cmd.Data = ((afIncomingMSGPacket_t *)*shared)->cmd.Data;
+  }
+  else if ( MSGpkt->cmd.DataLength )
   {
     MSGpkt->cmd.Data = (uint8 *)(MSGpkt + 1);
     osal_memcpy( MSGpkt->cmd.Data, asdu, MSGpkt->cmd.DataLength );
@@ -466,6 +512,9 @@ static void afBuildMSGIncoming( aps_FrameFormat_t *aff, endPointDesc_t *epDesc,
     // Send message through task message.
     osal_msg_send( *(epDesc->task_id), (uint8 *)MSGpkt );
   }
+
+  // Restore with original endpoint
+  aff->DstEndPoint = endpoint;
 }
 
 /*********************************************************************
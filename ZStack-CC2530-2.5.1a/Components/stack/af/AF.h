@@ -72,6 +72,14 @@ extern "C"
 // Default Radius Count value
 #define AF_DEFAULT_RADIUS                  DEF_NWK_RADIUS
 
+// A frame for several endpoints is carried by the message of the first
+// (osal_msg_allocate_shared) and the messages of the others point into it,
+// instead of each carrying a copy. The data of an incoming message must
+// then not be changed.
+#if !defined ( AF_SHARED_INCOMING )
+  #define AF_SHARED_INCOMING               TRUE
+#endif
+
 /*********************************************************************
  * Node Descriptor
  */
@@ -260,7 +268,7 @@ typedef struct
   uint8 SecurityUse;        /* deprecated */
   uint32 timestamp;         /* receipt timestamp from MAC */
   uint8 nwkSeqNum;          /* network header frame sequence number */
-  afMSGCommandFormat_t cmd; /* Application Data */
+  afMSGCommandFormat_t cmd; /* Application Data, read-only */
 } afIncomingMSGPacket_t;
 
 typedef struct
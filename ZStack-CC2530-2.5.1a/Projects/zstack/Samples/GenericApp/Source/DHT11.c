@@ -1,8 +1,9 @@
 #include <ioCC2530.h>
 #include "OnBoard.h"
+#include "hal_mcu.h"
+#include "DHT11.h"
 
-typedef unsigned char uchar;
-typedef unsigned int  uint;
+typedef unsigned int  uint;   // uchar comes from DHT11.h
 
 #define DATA_PIN P1_1
 
@@ -114,3 +115,240 @@ void DHT11(void)   //
     
     P1DIR |= 0x02; //IOҪ 
 }
+
+/*********************************************************************
+ * Non-blocking driver; see DHT11.h.
+ *
+ * After the start signal the sensor pulls the line low for 80 us and
+ * releases it for 80 us, then sends 40 bits, MSB first: humidity,
+ * humidity decimal, temperature, temperature decimal and checksum. Each
+ * bit is 50 us low followed by 26-28 us high for a 0 or 70 us high for a
+ * 1, so the time between two falling edges tells the bit. Timer 1 runs
+ * at 1 MHz and captures the edges in hardware, so interrupt latency does
+ * not skew the timing.
+ */
+
+// Start signal, and time allowed for the response
+#define DHT11_START_MS          20
+#define DHT11_RECEIVE_MS        10
+
+#define DHT11_BITS              40
+#define DHT11_ONE_MIN_US        100     // falling edge to falling edge
+
+// Driver states
+#define DHT11_STATE_IDLE        0x00
+#define DHT11_STATE_START       0x01    // line held low
+#define DHT11_STATE_RECEIVE     0x02    // capturing edges
+#define DHT11_STATE_DONE        0x03    // all bits received
+
+static uint8 dht11_TaskID;
+static uint16 dht11_Event;
+static volatile uint8 dht11_State = DHT11_STATE_IDLE;
+static uint8 dht11_Edges;
+static uint16 dht11_LastEdge;
+static uint8 dht11_Data[DHT11_BITS / 8];
+
+static void dht11_Edge( uint16 time );
+static void dht11_Stop( void );
+static void dht11_Report( uint8 status );
+
+/*********************************************************************
+ * @fn      DHT11_Init
+ *
+ * @brief   Sets the task and event used by the driver.
+ *
+ * @param   taskId - task receiving the event and DHT11_READING_IND
+ * @param   event  - event reserved for the driver
+ *
+ * @return  none
+ */
+void DHT11_Init( uint8 taskId, uint16 event )
+{
+  dht11_TaskID = taskId;
+  dht11_Event = event;
+  dht11_State = DHT11_STATE_IDLE;
+}
+
+/*********************************************************************
+ * @fn      DHT11_Start
+ *
+ * @brief   Pulls the line low to wake the sensor and returns.
+ *
+ * @param   none
+ *
+ * @return  SUCCESS, or FAILURE if a reading is in progress
+ */
+uint8 DHT11_Start( void )
+{
+  if ( dht11_State != DHT11_STATE_IDLE )
+  {
+    return FAILURE;
+  }
+
+  P1SEL &= ~0x02;         // GPIO
+  P1DIR |= 0x02;
+  DATA_PIN = 0;
+  dht11_State = DHT11_STATE_START;
+  osal_start_timerEx( dht11_TaskID, dht11_Event, DHT11_START_MS );
+  return SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      DHT11_ProcessEvent
+ *
+ * @brief   Releases the line after the start signal, or finishes the
+ *          reading once all the bits are in or the sensor timed out.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void DHT11_ProcessEvent( void )
+{
+  uint8 sum;
+
+  switch ( dht11_State )
+  {
+    case DHT11_STATE_START:
+      dht11_Edges = 0;
+      dht11_State = DHT11_STATE_RECEIVE;
+
+      DATA_PIN = 1;
+      P1DIR &= ~0x02;     // release the line to the pull-up
+      PERCFG |= 0x40;     // Timer 1 on alternative 2 location
+      P1SEL |= 0x02;
+      T1CCTL1 = 0x42;     // interrupt, capture on falling edge
+      T1CNTL = 0;         // writing resets the counter
+      T1CTL = 0x09;       // tick / 32 = 1 MHz, free-running
+      T1IE = 1;
+
+      osal_start_timerEx( dht11_TaskID, dht11_Event, DHT11_RECEIVE_MS );
+      break;
+
+    case DHT11_STATE_RECEIVE:
+      dht11_Stop();
+      dht11_Report( DHT11_TIMEOUT );
+      break;
+
+    case DHT11_STATE_DONE:
+      osal_stop_timerEx( dht11_TaskID, dht11_Event );
+      dht11_Stop();
+      sum = dht11_Data[0] + dht11_Data[1] + dht11_Data[2] + dht11_Data[3];
+      dht11_Report( ( sum == dht11_Data[4] ) ? DHT11_SUCCESS : DHT11_BAD_CHECKSUM );
+      break;
+
+    default:
+      break;
+  }
+}
+
+/*********************************************************************
+ * @fn      dht11_Edge
+ *
+ * @brief   Decodes a falling edge. The first edge starts the response
+ *          and the second the first bit; every later edge ends a bit.
+ *
+ * @param   time - capture time of the edge, in us
+ *
+ * @return  none
+ */
+static void dht11_Edge( uint16 time )
+{
+  uint16 width = time - dht11_LastEdge;
+  uint8 bit;
+
+  dht11_LastEdge = time;
+  if ( ++dht11_Edges < 3 )
+  {
+    return;
+  }
+
+  bit = dht11_Edges - 3;
+  dht11_Data[bit >> 3] <<= 1;
+  if ( width > DHT11_ONE_MIN_US )
+  {
+    dht11_Data[bit >> 3] |= 0x01;
+  }
+
+  if ( bit == DHT11_BITS - 1 )
+  {
+    T1IE = 0;
+    dht11_State = DHT11_STATE_DONE;
+    osal_set_event( dht11_TaskID, dht11_Event );
+  }
+}
+
+/*********************************************************************
+ * @fn      dht11_Stop
+ *
+ * @brief   Stops Timer 1 and drives the line high again, as DHT11()
+ *          leaves it.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void dht11_Stop( void )
+{
+  T1IE = 0;
+  T1CTL = 0x00;
+  T1CCTL1 = 0x00;
+  P1SEL &= ~0x02;
+  DATA_PIN = 1;
+  P1DIR |= 0x02;
+  dht11_State = DHT11_STATE_IDLE;
+}
+
+/*********************************************************************
+ * @fn      dht11_Report
+ *
+ * @brief   Sends the outcome of the reading to the task.
+ *
+ * @param   status - DHT11_SUCCESS or an error
+ *
+ * @return  none
+ */
+static void dht11_Report( uint8 status )
+{
+  dht11Reading_t *msg;
+
+  msg = (dht11Reading_t *)osal_msg_allocate( sizeof( dht11Reading_t ) );
+  if ( msg )
+  {
+    msg->hdr.event = DHT11_READING_IND;
+    msg->hdr.status = status;
+    msg->humidity = dht11_Data[0];
+    msg->temperature = dht11_Data[2];
+    osal_msg_send( dht11_TaskID, (uint8 *)msg );
+  }
+}
+
+/*********************************************************************
+ * @fn      dht11Timer1Isr
+ *
+ * @brief   Timer 1 interrupt: passes the captured edge to the decoder.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+HAL_ISR_FUNCTION( dht11Timer1Isr, T1_VECTOR )
+{
+  uint16 time;
+
+  HAL_ENTER_ISR();
+
+  if ( T1STAT & 0x02 )
+  {
+    T1STAT = ~0x02;     // clear CH1IF before T1IF
+    T1IF = 0;
+    time = T1CC1L;
+    time |= (uint16)T1CC1H << 8;
+    if ( dht11_State == DHT11_STATE_RECEIVE )
+    {
+      dht11_Edge( time );
+    }
+  }
+
+  HAL_EXIT_ISR();
+}
@@ -1,6 +1,9 @@
 #ifndef __DHT11_H__
 #define __DHT11_H__
 
+#include "ZComDef.h"
+#include "OSAL.h"
+
 #define uchar unsigned char
 extern void Delay_ms(unsigned int xms);	//ʱ
 extern void COM(void);                  // ʪд
@@ -12,4 +15,43 @@ extern uchar humidity[2];
 extern uchar humidity1[9];
 extern uchar shidu_shi,shidu_ge,wendu_shi,wendu_ge;
 
+/*********************************************************************
+ * Non-blocking driver
+ *
+ * DHT11_Start() pulls the line low and returns. The rest of the read
+ * runs on the event given to DHT11_Init(), which the task must pass to
+ * DHT11_ProcessEvent(), and on Timer 1 channel 1, which captures the
+ * falling edges of P1.1 (alternative 2 location). The outcome arrives as
+ * a dht11Reading_t message.
+ */
+// OSAL message event of dht11Reading_t
+#define DHT11_READING_IND     0xE1
+
+// dht11Reading_t status
+#define DHT11_SUCCESS         0x00
+#define DHT11_TIMEOUT         0x01    // no complete frame from the sensor
+#define DHT11_BAD_CHECKSUM    0x02
+
+typedef struct
+{
+  osal_event_hdr_t hdr;   // DHT11_READING_IND, status DHT11_SUCCESS or error
+  uint8 humidity;         // %RH
+  uint8 temperature;      // degrees C
+} dht11Reading_t;
+
+/*
+ * Sets the task and event used by the driver.
+ */
+extern void DHT11_Init( uint8 taskId, uint16 event );
+
+/*
+ * Starts a reading. Returns SUCCESS, or FAILURE if one is in progress.
+ */
+extern uint8 DHT11_Start( void );
+
+/*
+ * Advances the reading; call on the event given to DHT11_Init().
+ */
+extern void DHT11_ProcessEvent( void );
+
 #endif
\ No newline at end of file
@@ -0,0 +1,347 @@
+/**************************************************************************************************
+  Filename:       DeviceDirectory.c
+
+  Description:    Directory of the devices known to the coordinator.
+                  See DeviceDirectory.h.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "OSAL_Nv.h"
+
+#include "DeviceDirectory.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Hash table slots. At most half of them are ever used, which keeps the
+// linear probe sequences short.
+#define DEVDIR_SLOTS          (2 * DEVDIR_MAX_DEVICES)
+#define DEVDIR_SLOT_MASK      (DEVDIR_SLOTS - 1)
+
+// Slots hold the index plus one, so that 0 is an empty slot.
+#define DEVDIR_EMPTY_SLOT     0
+
+/*********************************************************************
+ * MACROS
+ */
+#define DEVDIR_NWK_HASH( addr )   ((uint8)(LO_UINT16( addr ) ^ HI_UINT16( addr )) & DEVDIR_SLOT_MASK)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint16 devDir_NvId;
+static uint8 devDir_Count;
+static devDirEntry_t devDir_Entries[DEVDIR_MAX_DEVICES];
+static uint8 devDir_NwkSlots[DEVDIR_SLOTS];
+static uint8 devDir_ExtSlots[DEVDIR_SLOTS];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static uint8 devDir_ExtHash( uint8 *extAddr );
+static uint8 devDir_ExtFind( uint8 *extAddr );
+static void devDir_NwkInsert( uint8 index );
+static void devDir_NwkRemove( uint16 nwkAddr );
+static void devDir_Save( uint8 index );
+
+/*********************************************************************
+ * @fn      DeviceDirectory_Init
+ *
+ * @brief   Restores the directory from NV and builds the hash tables.
+ *
+ * @param   nvId - NV item holding the entries
+ *
+ * @return  none
+ */
+void DeviceDirectory_Init( uint16 nvId )
+{
+  uint8 slot;
+  uint8 i;
+
+  devDir_NvId = nvId;
+  devDir_Count = 0;
+  osal_memset( devDir_Entries, 0, sizeof( devDir_Entries ) );
+  osal_memset( devDir_NwkSlots, DEVDIR_EMPTY_SLOT, sizeof( devDir_NwkSlots ) );
+  osal_memset( devDir_ExtSlots, DEVDIR_EMPTY_SLOT, sizeof( devDir_ExtSlots ) );
+
+  if ( osal_nv_item_init( nvId, sizeof( devDir_Entries ), devDir_Entries ) == ZSUCCESS )
+  {
+    osal_nv_read( nvId, 0, sizeof( devDir_Entries ), devDir_Entries );
+  }
+
+  // Entries are allocated in order, so the first empty one ends the list.
+  for ( i = 0; i < DEVDIR_MAX_DEVICES; i++ )
+  {
+    if ( osal_isbufset( devDir_Entries[i].extAddr, 0x00, Z_EXTADDR_LEN ) )
+    {
+      break;
+    }
+
+    slot = devDir_ExtHash( devDir_Entries[i].extAddr );
+    while ( devDir_ExtSlots[slot] != DEVDIR_EMPTY_SLOT )
+    {
+      slot = (slot + 1) & DEVDIR_SLOT_MASK;
+    }
+    devDir_ExtSlots[slot] = i + 1;
+
+    if ( (devDir_Entries[i].nwkAddr != DEVDIR_NO_NWK_ADDR)
+        && (DeviceDirectory_Lookup( devDir_Entries[i].nwkAddr ) == DEVDIR_INVALID_INDEX) )
+    {
+      devDir_NwkInsert( i );
+    }
+    devDir_Count++;
+  }
+}
+
+/*********************************************************************
+ * @fn      DeviceDirectory_Update
+ *
+ * @brief   Records the NWK address of a device, from a device announce
+ *          or an address lookup. A device that was already known keeps
+ *          its index. Another device holding the same NWK address, left
+ *          over from before an address conflict was resolved, loses it.
+ *          Only the entries that change are written to NV.
+ *
+ * @param   nwkAddr - NWK address of the device
+ * @param   extAddr - IEEE address of the device
+ * @param   changed - set TRUE if the device was added or its NWK
+ *                    address changed, FALSE otherwise
+ *
+ * @return  index of the device, or DEVDIR_INVALID_INDEX if it is new
+ *          and the directory is full
+ */
+uint8 DeviceDirectory_Update( uint16 nwkAddr, uint8 *extAddr, bool *changed )
+{
+  devDirEntry_t *entry;
+  uint8 index;
+  uint8 other;
+  uint8 slot;
+
+  *changed = FALSE;
+  index = devDir_ExtFind( extAddr );
+  if ( index == DEVDIR_INVALID_INDEX )
+  {
+    if ( devDir_Count == DEVDIR_MAX_DEVICES )
+    {
+      return DEVDIR_INVALID_INDEX;
+    }
+
+    index = devDir_Count++;
+    entry = &devDir_Entries[index];
+    osal_memcpy( entry->extAddr, extAddr, Z_EXTADDR_LEN );
+    entry->nwkAddr = DEVDIR_NO_NWK_ADDR;
+
+    slot = devDir_ExtHash( extAddr );
+    while ( devDir_ExtSlots[slot] != DEVDIR_EMPTY_SLOT )
+    {
+      slot = (slot + 1) & DEVDIR_SLOT_MASK;
+    }
+    devDir_ExtSlots[slot] = index + 1;
+  }
+  else
+  {
+    entry = &devDir_Entries[index];
+    if ( entry->nwkAddr == nwkAddr )
+    {
+      return index;
+    }
+    if ( entry->nwkAddr != DEVDIR_NO_NWK_ADDR )
+    {
+      devDir_NwkRemove( entry->nwkAddr );
+    }
+  }
+
+  other = DeviceDirectory_Lookup( nwkAddr );
+  if ( other != DEVDIR_INVALID_INDEX )
+  {
+    devDir_NwkRemove( nwkAddr );
+    devDir_Entries[other].nwkAddr = DEVDIR_NO_NWK_ADDR;
+    devDir_Save( other );
+  }
+
+  entry->nwkAddr = nwkAddr;
+  devDir_NwkInsert( index );
+  devDir_Save( index );
+  *changed = TRUE;
+  return index;
+}
+
+/*********************************************************************
+ * @fn      DeviceDirectory_Lookup
+ *
+ * @brief   Finds a device by NWK address.
+ *
+ * @param   nwkAddr - NWK address
+ *
+ * @return  index of the device, or DEVDIR_INVALID_INDEX
+ */
+uint8 DeviceDirectory_Lookup( uint16 nwkAddr )
+{
+  uint8 slot = DEVDIR_NWK_HASH( nwkAddr );
+  uint8 index;
+
+  while ( devDir_NwkSlots[slot] != DEVDIR_EMPTY_SLOT )
+  {
+    index = devDir_NwkSlots[slot] - 1;
+    if ( devDir_Entries[index].nwkAddr == nwkAddr )
+    {
+      return index;
+    }
+    slot = (slot + 1) & DEVDIR_SLOT_MASK;
+  }
+
+  return DEVDIR_INVALID_INDEX;
+}
+
+/*********************************************************************
+ * @fn      DeviceDirectory_GetEntry
+ *
+ * @brief   Returns the entry of a device.
+ *
+ * @param   index - index of the device
+ *
+ * @return  entry, or NULL if the index is not allocated
+ */
+devDirEntry_t *DeviceDirectory_GetEntry( uint8 index )
+{
+  return ( index < devDir_Count ) ? &devDir_Entries[index] : NULL;
+}
+
+/*********************************************************************
+ * @fn      devDir_ExtHash
+ *
+ * @brief   Hashes an IEEE address. The low bytes, which hold the serial
+ *          number, differ the most between devices.
+ *
+ * @param   extAddr - IEEE address, LSB first
+ *
+ * @return  home slot
+ */
+static uint8 devDir_ExtHash( uint8 *extAddr )
+{
+  return (extAddr[0] ^ extAddr[1] ^ extAddr[2] ^ extAddr[3]) & DEVDIR_SLOT_MASK;
+}
+
+/*********************************************************************
+ * @fn      devDir_ExtFind
+ *
+ * @brief   Finds a device by IEEE address.
+ *
+ * @param   extAddr - IEEE address
+ *
+ * @return  index of the device, or DEVDIR_INVALID_INDEX
+ */
+static uint8 devDir_ExtFind( uint8 *extAddr )
+{
+  uint8 slot = devDir_ExtHash( extAddr );
+  uint8 index;
+
+  while ( devDir_ExtSlots[slot] != DEVDIR_EMPTY_SLOT )
+  {
+    index = devDir_ExtSlots[slot] - 1;
+    if ( osal_memcmp( devDir_Entries[index].extAddr, extAddr, Z_EXTADDR_LEN ) )
+    {
+      return index;
+    }
+    slot = (slot + 1) & DEVDIR_SLOT_MASK;
+  }
+
+  return DEVDIR_INVALID_INDEX;
+}
+
+/*********************************************************************
+ * @fn      devDir_NwkInsert
+ *
+ * @brief   Adds an entry to the NWK address table, under its current
+ *          NWK address.
+ *
+ * @param   index - index of the entry
+ *
+ * @return  none
+ */
+static void devDir_NwkInsert( uint8 index )
+{
+  uint8 slot = DEVDIR_NWK_HASH( devDir_Entries[index].nwkAddr );
+
+  while ( devDir_NwkSlots[slot] != DEVDIR_EMPTY_SLOT )
+  {
+    slot = (slot + 1) & DEVDIR_SLOT_MASK;
+  }
+  devDir_NwkSlots[slot] = index + 1;
+}
+
+/*********************************************************************
+ * @fn      devDir_NwkRemove
+ *
+ * @brief   Removes a NWK address from its table. The entries after it
+ *          in the probe sequence are shifted back into the hole rather
+ *          than leaving a tombstone, so that lookups stay short however
+ *          often devices change address.
+ *
+ * @param   nwkAddr - NWK address, still held by its entry
+ *
+ * @return  none
+ */
+static void devDir_NwkRemove( uint16 nwkAddr )
+{
+  uint8 hole = DEVDIR_NWK_HASH( nwkAddr );
+  uint8 slot;
+  uint8 home;
+
+  while ( devDir_NwkSlots[hole] != DEVDIR_EMPTY_SLOT )
+  {
+    if ( devDir_Entries[devDir_NwkSlots[hole] - 1].nwkAddr == nwkAddr )
+    {
+      break;
+    }
+    hole = (hole + 1) & DEVDIR_SLOT_MASK;
+  }
+  if ( devDir_NwkSlots[hole] == DEVDIR_EMPTY_SLOT )
+  {
+    return;
+  }
+
+  slot = hole;
+  for ( ;; )
+  {
+    slot = (slot + 1) & DEVDIR_SLOT_MASK;
+    if ( devDir_NwkSlots[slot] == DEVDIR_EMPTY_SLOT )
+    {
+      break;
+    }
+
+    // An entry can fill the hole unless its home slot lies cyclically
+    // after the hole, up to its own slot.
+    home = DEVDIR_NWK_HASH( devDir_Entries[devDir_NwkSlots[slot] - 1].nwkAddr );
+    if ( ((slot - home) & DEVDIR_SLOT_MASK) >= ((slot - hole) & DEVDIR_SLOT_MASK) )
+    {
+      devDir_NwkSlots[hole] = devDir_NwkSlots[slot];
+      hole = slot;
+    }
+  }
+
+  devDir_NwkSlots[hole] = DEVDIR_EMPTY_SLOT;
+}
+
+/*********************************************************************
+ * @fn      devDir_Save
+ *
+ * @brief   Writes one entry to its place in the NV item.
+ *
+ * @param   index - index of the entry
+ *
+ * @return  none
+ */
+static void devDir_Save( uint8 index )
+{
+  osal_nv_write( devDir_NvId, (uint16)index * sizeof( devDirEntry_t ),
+                 sizeof( devDirEntry_t ), &devDir_Entries[index] );
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,91 @@
+/**************************************************************************************************
+  Filename:       DeviceDirectory.h
+
+  Description:    Directory of the devices known to the coordinator.
+
+  Each device is identified by its IEEE address and given a small index,
+  allocated densely from 0 in the order the devices are first seen. The
+  index stays with the device when its NWK address changes, and across
+  restarts: every entry is saved in NV as it changes. Lookups by NWK or
+  IEEE address go through open-addressed hash tables of twice
+  DEVDIR_MAX_DEVICES slots, so they take a probe or two whatever the
+  number of devices.
+**************************************************************************************************/
+
+#ifndef DEVICEDIRECTORY_H
+#define DEVICEDIRECTORY_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Capacity of the directory; a power of two, at most 128
+#if !defined( DEVDIR_MAX_DEVICES )
+  #define DEVDIR_MAX_DEVICES          32
+#endif
+#if ( DEVDIR_MAX_DEVICES & (DEVDIR_MAX_DEVICES - 1) ) || ( DEVDIR_MAX_DEVICES > 128 )
+  #error "DEVDIR_MAX_DEVICES must be a power of two, at most 128"
+#endif
+
+// Index of a device that is not in the directory
+#define DEVDIR_INVALID_INDEX          0xFF
+
+// NWK address of an entry whose address was taken over by another device
+#define DEVDIR_NO_NWK_ADDR            0xFFFE
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  uint8 extAddr[Z_EXTADDR_LEN];
+  uint16 nwkAddr;
+} devDirEntry_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Restores the directory from the NV item given, creating the item on
+ * first use.
+ */
+extern void DeviceDirectory_Init( uint16 nvId );
+
+/*
+ * Records the NWK address of a device, adding the device if it is new.
+ * Returns its index, or DEVDIR_INVALID_INDEX if the directory is full,
+ * and sets *changed if the device was added or its NWK address changed.
+ */
+extern uint8 DeviceDirectory_Update( uint16 nwkAddr, uint8 *extAddr, bool *changed );
+
+/*
+ * Returns the index of the device with a NWK address, or
+ * DEVDIR_INVALID_INDEX.
+ */
+extern uint8 DeviceDirectory_Lookup( uint16 nwkAddr );
+
+/*
+ * Returns the entry of an index, or NULL.
+ */
+extern devDirEntry_t *DeviceDirectory_GetEntry( uint8 index );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVICEDIRECTORY_H */
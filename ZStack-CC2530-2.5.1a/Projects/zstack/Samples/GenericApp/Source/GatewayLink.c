@@ -0,0 +1,293 @@
+/**************************************************************************************************
+  Filename:       GatewayLink.c
+
+  Description:    Framed serial link between the coordinator and the Azure Sphere gateway.
+                  See GatewayLink.h for the frame layout.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "hal_uart.h"
+
+#include "GatewayLink.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Bytes handed to the UART driver per HalUARTWrite() call. The DMA driver
+// takes a write whole or not at all, so small chunks keep its buffer busy.
+#define TX_CHUNK_LEN  32
+
+// Receive states
+#define SOF_STATE     0x00
+#define LEN_STATE     0x01
+#define TYPE_STATE    0x02
+#define SEQ_STATE     0x03
+#define DATA_STATE    0x04
+#define FCS_STATE     0x05
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint8 gatewayLink_TaskID;
+
+static uint8 rxState;
+static uint8 rxFcs;
+static uint8 rxDataLen;
+static gatewayLinkFrame_t *rxMsg;
+
+// Transmit queue. Its size is 256 so that the uint8 indexes wrap by
+// themselves.
+static uint8 txQueue[256];
+static uint8 txHead;
+static uint8 txTail;
+static uint16 txCount;
+
+// Frames dropped because the transmit queue was full
+uint16 GatewayLink_TxDropped = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static void gatewayLink_UartCB( uint8 port, uint8 event );
+static void gatewayLink_TxDrain( void );
+
+/*********************************************************************
+ * @fn      GatewayLink_Init
+ *
+ * @brief   Opens the gateway UART with the frame parser as its
+ *          receive callback.
+ *
+ * @param   taskId - task receiving GATEWAYLINK_FRAME_IND messages
+ *
+ * @return  none
+ */
+void GatewayLink_Init( uint8 taskId )
+{
+  halUARTCfg_t uartConfig;
+
+  gatewayLink_TaskID = taskId;
+  rxState = SOF_STATE;
+  rxMsg = NULL;
+  txHead = 0;
+  txTail = 0;
+  txCount = 0;
+
+  osal_memset( &uartConfig, 0, sizeof( uartConfig ) );
+  uartConfig.configured           = TRUE;
+  uartConfig.baudRate             = GATEWAYLINK_BAUDRATE;
+  uartConfig.flowControl          = FALSE;
+  uartConfig.flowControlThreshold = 0;
+  uartConfig.rx.maxBufSize        = 128;
+  uartConfig.tx.maxBufSize        = 128;
+  uartConfig.idleTimeout          = 6;
+  uartConfig.intEnable            = TRUE;
+  uartConfig.callBackFunc         = gatewayLink_UartCB;
+  HalUARTOpen( GATEWAYLINK_PORT, &uartConfig );
+}
+
+/*********************************************************************
+ * @fn      GatewayLink_SendFrame
+ *
+ * @brief   Encodes a frame into the transmit queue and starts sending
+ *          it. Never waits for the UART.
+ *
+ * @param   type - frame type
+ * @param   seq  - frame sequence number
+ * @param   data - frame data
+ * @param   len  - length of data, at most GATEWAYLINK_MAX_DATA_LEN
+ *
+ * @return  SUCCESS, or FAILURE if the frame does not fit in the queue
+ */
+uint8 GatewayLink_SendFrame( uint8 type, uint8 seq, uint8 *data, uint8 len )
+{
+  uint8 fcs;
+  uint8 i;
+
+  if ( (len > GATEWAYLINK_MAX_DATA_LEN)
+      || (sizeof( txQueue ) - txCount < GATEWAYLINK_HDR_LEN + len + 1) )
+  {
+    GatewayLink_TxDropped++;
+    return FAILURE;
+  }
+
+  txQueue[txHead++] = GATEWAYLINK_SOF;
+  txQueue[txHead++] = len;
+  txQueue[txHead++] = type;
+  txQueue[txHead++] = seq;
+  fcs = len ^ type ^ seq;
+  for ( i = 0; i < len; i++ )
+  {
+    txQueue[txHead++] = data[i];
+    fcs ^= data[i];
+  }
+  txQueue[txHead++] = fcs;
+  txCount += GATEWAYLINK_HDR_LEN + len + 1;
+
+  gatewayLink_TxDrain();
+  return SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      GatewayLink_SendRaw
+ *
+ * @brief   Queues unframed bytes, for the messages of older end devices
+ *          that the gateway reads without framing. They go through the
+ *          same queue so that they never split a frame.
+ *
+ * @param   data - bytes to send
+ * @param   len  - number of bytes
+ *
+ * @return  SUCCESS, or FAILURE if the bytes do not fit in the queue
+ */
+uint8 GatewayLink_SendRaw( uint8 *data, uint8 len )
+{
+  uint8 i;
+
+  if ( sizeof( txQueue ) - txCount < len )
+  {
+    GatewayLink_TxDropped++;
+    return FAILURE;
+  }
+
+  for ( i = 0; i < len; i++ )
+  {
+    txQueue[txHead++] = data[i];
+  }
+  txCount += len;
+
+  gatewayLink_TxDrain();
+  return SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      gatewayLink_TxDrain
+ *
+ * @brief   Hands queued bytes to the UART driver until its buffer is
+ *          full. Called again when the driver reports HAL_UART_TX_EMPTY.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void gatewayLink_TxDrain( void )
+{
+  uint16 chunk;
+
+  while ( txCount )
+  {
+    chunk = ( txCount < TX_CHUNK_LEN ) ? txCount : TX_CHUNK_LEN;
+    if ( chunk > sizeof( txQueue ) - txTail )
+    {
+      chunk = sizeof( txQueue ) - txTail;   // up to the end of the ring
+    }
+
+    if ( HalUARTWrite( GATEWAYLINK_PORT, &txQueue[txTail], chunk ) == 0 )
+    {
+      break;
+    }
+    txTail += (uint8)chunk;
+    txCount -= chunk;
+  }
+}
+
+/*********************************************************************
+ * @fn      gatewayLink_UartCB
+ *
+ * @brief   UART callback; resumes transmission when the driver has
+ *          room, parses the received bytes and sends every frame with a
+ *          valid FCS to the registered task.
+ *
+ * @param   port  - UART port
+ * @param   event - UART events
+ *
+ * @return  none
+ */
+static void gatewayLink_UartCB( uint8 port, uint8 event )
+{
+  uint8 ch;
+
+  if ( event & HAL_UART_TX_EMPTY )
+  {
+    gatewayLink_TxDrain();
+  }
+
+  while ( Hal_UART_RxBufLen( port ) )
+  {
+    HalUARTRead( port, &ch, 1 );
+
+    switch ( rxState )
+    {
+      case SOF_STATE:
+        if ( ch == GATEWAYLINK_SOF )
+        {
+          rxState = LEN_STATE;
+        }
+        break;
+
+      case LEN_STATE:
+        rxState = SOF_STATE;
+        if ( ch > GATEWAYLINK_MAX_DATA_LEN )
+        {
+          break;
+        }
+        rxMsg = (gatewayLinkFrame_t *)osal_msg_allocate( sizeof( gatewayLinkFrame_t ) + ch );
+        if ( rxMsg )
+        {
+          rxMsg->hdr.event = GATEWAYLINK_FRAME_IND;
+          rxMsg->hdr.status = 0;
+          rxMsg->len = ch;
+          rxMsg->data = (uint8 *)(rxMsg + 1);
+          rxDataLen = 0;
+          rxFcs = ch;
+          rxState = TYPE_STATE;
+        }
+        break;
+
+      case TYPE_STATE:
+        rxMsg->type = ch;
+        rxFcs ^= ch;
+        rxState = SEQ_STATE;
+        break;
+
+      case SEQ_STATE:
+        rxMsg->seq = ch;
+        rxFcs ^= ch;
+        rxState = ( rxMsg->len ) ? DATA_STATE : FCS_STATE;
+        break;
+
+      case DATA_STATE:
+        rxMsg->data[rxDataLen++] = ch;
+        rxFcs ^= ch;
+        if ( rxDataLen == rxMsg->len )
+        {
+          rxState = FCS_STATE;
+        }
+        break;
+
+      case FCS_STATE:
+        if ( ch == rxFcs )
+        {
+          osal_msg_send( gatewayLink_TaskID, (uint8 *)rxMsg );
+        }
+        else
+        {
+          osal_msg_deallocate( (uint8 *)rxMsg );
+        }
+        rxMsg = NULL;
+        rxState = SOF_STATE;
+        break;
+
+      default:
+        rxState = SOF_STATE;
+        break;
+    }
+  }
+}
+
+/*********************************************************************
+*********************************************************************/
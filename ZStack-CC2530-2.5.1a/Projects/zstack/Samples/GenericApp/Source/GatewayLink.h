@@ -0,0 +1,118 @@
+/**************************************************************************************************
+  Filename:       GatewayLink.h
+
+  Description:    Framed serial link between the coordinator and the Azure Sphere gateway.
+
+  Every frame has the layout below, modelled on the MT frame:
+
+      | SOF  | LEN | TYPE | SEQ | DATA  | FCS |
+      | 0xFE |  1  |  1   |  1  | 0-LEN |  1  |
+
+  LEN is the length of DATA and FCS is the XOR of the LEN, TYPE, SEQ and DATA
+  bytes. The gateway side of the protocol is coordinator_link.h in the
+  AzureSphereAzureIoTHub project; the two must be kept in step.
+**************************************************************************************************/
+
+#ifndef GATEWAYLINK_H
+#define GATEWAYLINK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "OSAL.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define GATEWAYLINK_PORT              0
+
+#if !defined( GATEWAYLINK_BAUDRATE )
+  #define GATEWAYLINK_BAUDRATE        HAL_UART_BR_9600
+#endif
+
+#define GATEWAYLINK_SOF               0xFE
+#define GATEWAYLINK_HDR_LEN           4       // SOF, LEN, TYPE, SEQ
+#define GATEWAYLINK_MAX_DATA_LEN      128
+
+// Frame types. Frames sent by the coordinator have the top bit set.
+#define GATEWAYLINK_TYPE_COMMAND      0x01    // DATA = NWK addr (LSB first), command id, args
+#define GATEWAYLINK_TYPE_COMMAND_ACK  0x81    // SEQ = command seq, DATA = ZStatus_t of delivery, NWK addr (LSB first)
+#define GATEWAYLINK_TYPE_SENSOR_REPORT 0x82   // DATA = NWK addr (LSB first), SensorFrame.h frame
+#define GATEWAYLINK_TYPE_LEGACY_REPORT 0x83   // DATA = NWK addr (LSB first), 11-byte ASCII report
+#define GATEWAYLINK_TYPE_REPORT_BATCH  0x84   // DATA = records, see below
+#define GATEWAYLINK_TYPE_DEVICE_ENTRY  0x85   // DATA = device index, NWK addr, IEEE addr (LSB first)
+#define GATEWAYLINK_TYPE_ROUTE_STATS   0x86   // DATA = srcRouteStats_t counters, see below
+
+// A GATEWAYLINK_TYPE_ROUTE_STATS frame holds the counters of
+// SourceRoute_Stats in the order of srcRouteStats_t, each a uint16
+// LSB first. They count from the start of the coordinator and wrap.
+#define GATEWAYLINK_ROUTE_STATS_LEN   12
+
+// Each record of a GATEWAYLINK_TYPE_REPORT_BATCH frame is
+//   | NWK addr (LSB first) | device index | LQI | LEN | report |
+//   |          2           |      1       |  1  |  1  |  LEN   |
+// where the report is a SensorFrame.h frame or an 11-byte ASCII report,
+// and the device index is that of DeviceDirectory.h, or 0xFF if the
+// coordinator does not know the IEEE address of the sender yet.
+#define GATEWAYLINK_BATCH_RECORD_HDR_LEN  5
+
+// OSAL message event carrying a frame received from the gateway.
+#define GATEWAYLINK_FRAME_IND         0xE0
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  osal_event_hdr_t hdr;
+  uint8 type;
+  uint8 seq;
+  uint8 len;
+  uint8 *data;
+} gatewayLinkFrame_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Opens the gateway UART; received frames are sent to taskId as
+ * GATEWAYLINK_FRAME_IND messages.
+ */
+extern void GatewayLink_Init( uint8 taskId );
+
+/*
+ * Queues a frame for the gateway; the queue is drained through the UART
+ * driver as it frees up, without blocking. Returns SUCCESS, or FAILURE
+ * if the queue is full.
+ */
+extern uint8 GatewayLink_SendFrame( uint8 type, uint8 seq, uint8 *data, uint8 len );
+
+/*
+ * Queues unframed bytes; see GatewayLink_SendFrame().
+ */
+extern uint8 GatewayLink_SendRaw( uint8 *data, uint8 len );
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+// Frames dropped because the transmit queue was full
+extern uint16 GatewayLink_TxDropped;
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GATEWAYLINK_H */
@@ -63,6 +63,10 @@ extern "C"
 #define GENERICAPP_DEVICE_VERSION     0
 #define GENERICAPP_FLAGS              0
 
+// Home Automation endpoint of the ZCL measurement clusters (ZclSensor.h)
+#define GENERICAPP_ZCL_ENDPOINT       11
+#define GENERICAPP_ZCL_PROFID         0x0104  // ZCL_HA_PROFILE_ID
+
 #define GENERICAPP_MAX_CLUSTERS           4
 #define GENERICAPP_CLUSTERID              1
 #define GenericApp_GAN_CLUSTERID          2     //ID
@@ -71,12 +75,34 @@ extern "C"
 #define GenericApp_wendu_CLUSTERID        5     //¶id
 #define GenericApp_rentihongwai_CLUSTERID        6   //id
 #define GenericApp_Sensor_CLUSTERID       7 
+#define GENERICAPP_COMMAND_CLUSTERID      8     // Gateway commands: command id, args
+
+// Commands carried by GENERICAPP_COMMAND_CLUSTERID
+#define GENERICAPP_CMD_REPORT_NOW           0x01
+#define GENERICAPP_CMD_SET_REPORT_INTERVAL  0x02  // args: uint16 seconds, LSB first
+#define GENERICAPP_CMD_SET_DEADBAND         0x03  // args: TLV type, uint16 deadband, LSB first
+#define GENERICAPP_CMD_SET_SAMPLE_INTERVAL  0x04  // args: uint16 ms, LSB first
+
+// NV item holding the end device report configuration
+#define GENERICAPP_NV_REPORT_CFG      0x0401
+
+// NV item holding the coordinator device directory (DeviceDirectory.h)
+#define GENERICAPP_NV_DEVICE_DIR      0x0402
+
+// NV item holding the end device ZCL reporting configuration (ZclSensor.h)
+#define GENERICAPP_NV_ZCL_REPORT_CFG  0x0403
 
 // Send Message Timeout
 #define GENERICAPP_SEND_MSG_TIMEOUT   5000     // Every 5 seconds
 
 // Application Events (OSAL) - These are bit weighted definitions.
 #define GENERICAPP_SEND_MSG_EVT       0x0001
+#define GENERICAPP_FLUSH_REPORTS_EVT  0x0004  // Coordinator: send the report batch
+#define GENERICAPP_SAMPLE_EVT         0x0008  // End device: sample the sensors
+#define GENERICAPP_DHT11_EVT          0x0010  // End device: used by the DHT11 driver
+#define GENERICAPP_DS18B20_EVT        0x0010  // End device: the DS18B20 driver, in
+                                              //  GENERICAPP_DS18B20 builds
+#define GENERICAPP_MTO_ROUTE_EVT      0x0020  // Coordinator: many-to-one route request
 
 #if defined( IAR_ARMCM3_LM )
 #define GENERICAPP_RTOS_MSG_EVT       0x0002
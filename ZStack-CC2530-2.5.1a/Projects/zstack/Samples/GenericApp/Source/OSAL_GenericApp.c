@@ -62,6 +62,10 @@
   #include "aps_frag.h"
 #endif
 
+#if defined ( ZCL_REPORT )
+  #include "zcl.h"
+#endif
+
 #include "GenericApp.h"
 
 /*********************************************************************
@@ -83,6 +87,9 @@ const pTaskEventHandlerFn tasksArr[] = {
   ZDApp_event_loop,
 #if defined ( ZIGBEE_FREQ_AGILITY ) || defined ( ZIGBEE_PANID_CONFLICT )
   ZDNwkMgr_event_loop,
+#endif
+#if defined ( ZCL_REPORT )
+  zcl_event_loop,
 #endif
   GenericApp_ProcessEvent
 };
@@ -123,6 +130,9 @@ void osalInitTasks( void )
   ZDApp_Init( taskID++ );
 #if defined ( ZIGBEE_FREQ_AGILITY ) || defined ( ZIGBEE_PANID_CONFLICT )
   ZDNwkMgr_Init( taskID++ );
+#endif
+#if defined ( ZCL_REPORT )
+  zcl_Init( taskID++ );
 #endif
   GenericApp_Init( taskID );
 }
@@ -0,0 +1,358 @@
+/**************************************************************************************************
+  Filename:       OneWire.c
+
+  Description:    Bit-banged 1-Wire bus master with the ROM search.
+                  See OneWire.h.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "OnBoard.h"
+#include "hal_mcu.h"
+
+#include "OneWire.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Standard speed timing, in us. Every slot adds up to ONEWIRE_SLOT_US
+// and the reset to ONEWIRE_RESET_US.
+#define ONEWIRE_RESET_LOW_US        480
+#define ONEWIRE_PRESENCE_US         70      // release to presence sample
+#define ONEWIRE_RESET_TAIL_US       (ONEWIRE_RESET_US - ONEWIRE_RESET_LOW_US - ONEWIRE_PRESENCE_US)
+
+#define ONEWIRE_WRITE1_LOW_US       6
+#define ONEWIRE_WRITE0_LOW_US       60
+#define ONEWIRE_READ_LOW_US         6
+#define ONEWIRE_READ_SAMPLE_US      9       // release to sample, within 15 us of the edge
+
+// Reflected CRC-8 polynomial x^8 + x^5 + x^4 + 1
+#define ONEWIRE_CRC8_POLY           0x8C
+
+/*********************************************************************
+ * MACROS
+ */
+#define ONEWIRE_LOW()               st( ONEWIRE_PIN = 0; ONEWIRE_DIR |= ONEWIRE_BIT; )
+#define ONEWIRE_RELEASE()           st( ONEWIRE_DIR &= ~ONEWIRE_BIT; )
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static void oneWire_WriteBit( uint8 bit );
+static uint8 oneWire_ReadBit( void );
+
+/*********************************************************************
+ * @fn      OneWire_Init
+ *
+ * @brief   Makes the pin a GPIO input, releasing the bus.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void OneWire_Init( void )
+{
+  ONEWIRE_SEL &= ~ONEWIRE_BIT;
+  ONEWIRE_RELEASE();
+}
+
+/*********************************************************************
+ * @fn      OneWire_Reset
+ *
+ * @brief   Holds the bus low for the reset pulse, then samples it for
+ *          the presence pulse of the devices. Only the sample needs
+ *          interrupts off: a longer reset pulse is still a reset.
+ *
+ * @param   none
+ *
+ * @return  TRUE if a device is present
+ */
+uint8 OneWire_Reset( void )
+{
+  halIntState_t intState;
+  uint8 present;
+
+  ONEWIRE_LOW();
+  MicroWait( ONEWIRE_RESET_LOW_US );
+
+  HAL_ENTER_CRITICAL_SECTION( intState );
+  ONEWIRE_RELEASE();
+  MicroWait( ONEWIRE_PRESENCE_US );
+  present = ( ONEWIRE_PIN == 0 );
+  HAL_EXIT_CRITICAL_SECTION( intState );
+
+  MicroWait( ONEWIRE_RESET_TAIL_US );
+  return present;
+}
+
+/*********************************************************************
+ * @fn      OneWire_WriteByte
+ *
+ * @brief   Writes a byte, LSB first.
+ *
+ * @param   value - byte to write
+ *
+ * @return  none
+ */
+void OneWire_WriteByte( uint8 value )
+{
+  uint8 i;
+
+  for ( i = 0; i < 8; i++ )
+  {
+    oneWire_WriteBit( value & 0x01 );
+    value >>= 1;
+  }
+}
+
+/*********************************************************************
+ * @fn      OneWire_ReadByte
+ *
+ * @brief   Reads a byte, LSB first.
+ *
+ * @param   none
+ *
+ * @return  byte read
+ */
+uint8 OneWire_ReadByte( void )
+{
+  uint8 value = 0;
+  uint8 i;
+
+  for ( i = 0; i < 8; i++ )
+  {
+    value >>= 1;
+    if ( oneWire_ReadBit() )
+    {
+      value |= 0x80;
+    }
+  }
+
+  return value;
+}
+
+/*********************************************************************
+ * @fn      OneWire_Select
+ *
+ * @brief   Resets the bus and addresses one device, or all of them.
+ *
+ * @param   rom - ROM code of the device, or NULL for Skip ROM
+ *
+ * @return  TRUE if a device is present
+ */
+uint8 OneWire_Select( uint8 *rom )
+{
+  uint8 i;
+
+  if ( !OneWire_Reset() )
+  {
+    return FALSE;
+  }
+
+  if ( rom == NULL )
+  {
+    OneWire_WriteByte( ONEWIRE_SKIP_ROM );
+  }
+  else
+  {
+    OneWire_WriteByte( ONEWIRE_MATCH_ROM );
+    for ( i = 0; i < ONEWIRE_ROM_LEN; i++ )
+    {
+      OneWire_WriteByte( rom[i] );
+    }
+  }
+
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      OneWire_Search
+ *
+ * @brief   Enumerates the devices on the bus with the ROM search of
+ *          Maxim application note 187. Each pass walks the 64 ROM bits:
+ *          the devices send every bit and its complement, and where both
+ *          read 0 the codes fork. A pass takes the 1 branch at the fork
+ *          where the previous pass took 0, the previous branches before
+ *          it and 0 after it, remembering the last fork where it took 0
+ *          for the next pass. The search ends when no such fork is left.
+ *
+ * @param   roms    - buffer for maxRoms codes of ONEWIRE_ROM_LEN bytes
+ * @param   maxRoms - number of codes that fit in roms
+ *
+ * @return  number of codes stored
+ */
+uint8 OneWire_Search( uint8 *roms, uint8 maxRoms )
+{
+  uint8 rom[ONEWIRE_ROM_LEN];
+  uint8 lastFork = 0;
+  uint8 zeroFork;
+  uint8 count = 0;
+  uint8 bitNum;
+  uint8 idBit;
+  uint8 cmpBit;
+  uint8 dir;
+  uint8 mask;
+  uint8 *byte;
+
+  osal_memset( rom, 0, sizeof( rom ) );
+
+  while ( (count < maxRoms) && OneWire_Reset() )
+  {
+    OneWire_WriteByte( ONEWIRE_SEARCH_ROM );
+    zeroFork = 0;
+
+    for ( bitNum = 1; bitNum <= 8 * ONEWIRE_ROM_LEN; bitNum++ )
+    {
+      byte = &rom[(bitNum - 1) >> 3];
+      mask = BV( (bitNum - 1) & 0x07 );
+
+      idBit = oneWire_ReadBit();
+      cmpBit = oneWire_ReadBit();
+      if ( idBit && cmpBit )
+      {
+        break;            // every device dropped out
+      }
+
+      if ( idBit != cmpBit )
+      {
+        dir = idBit;
+      }
+      else
+      {
+        if ( bitNum < lastFork )
+        {
+          dir = ( *byte & mask ) ? 1 : 0;
+        }
+        else
+        {
+          dir = ( bitNum == lastFork ) ? 1 : 0;
+        }
+        if ( dir == 0 )
+        {
+          zeroFork = bitNum;
+        }
+      }
+
+      if ( dir )
+      {
+        *byte |= mask;
+      }
+      else
+      {
+        *byte &= ~mask;
+      }
+      oneWire_WriteBit( dir );
+    }
+
+    // Family 0 is what a bus held low reads as, CRC and all.
+    if ( (bitNum <= 8 * ONEWIRE_ROM_LEN)
+        || (rom[0] == 0)
+        || (OneWire_Crc8( rom, ONEWIRE_ROM_LEN ) != 0) )
+    {
+      break;
+    }
+
+    osal_memcpy( &roms[count * ONEWIRE_ROM_LEN], rom, ONEWIRE_ROM_LEN );
+    count++;
+
+    lastFork = zeroFork;
+    if ( lastFork == 0 )
+    {
+      break;
+    }
+  }
+
+  return count;
+}
+
+/*********************************************************************
+ * @fn      OneWire_Crc8
+ *
+ * @brief   Computes the Dallas/Maxim CRC-8 used by ROM codes and
+ *          scratchpads.
+ *
+ * @param   data - bytes to check
+ * @param   len  - number of bytes
+ *
+ * @return  CRC-8 of the bytes
+ */
+uint8 OneWire_Crc8( uint8 *data, uint8 len )
+{
+  uint8 crc = 0;
+  uint8 i;
+
+  while ( len-- )
+  {
+    crc ^= *data++;
+    for ( i = 0; i < 8; i++ )
+    {
+      crc = ( crc & 0x01 ) ? ((crc >> 1) ^ ONEWIRE_CRC8_POLY) : (crc >> 1);
+    }
+  }
+
+  return crc;
+}
+
+/*********************************************************************
+ * @fn      oneWire_WriteBit
+ *
+ * @brief   Writes a bit: a short low pulse for 1, a long one for 0.
+ *
+ * @param   bit - bit to write
+ *
+ * @return  none
+ */
+static void oneWire_WriteBit( uint8 bit )
+{
+  halIntState_t intState;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );
+  ONEWIRE_LOW();
+  if ( bit )
+  {
+    MicroWait( ONEWIRE_WRITE1_LOW_US );
+    ONEWIRE_RELEASE();
+    MicroWait( ONEWIRE_SLOT_US - ONEWIRE_WRITE1_LOW_US );
+  }
+  else
+  {
+    MicroWait( ONEWIRE_WRITE0_LOW_US );
+    ONEWIRE_RELEASE();
+    MicroWait( ONEWIRE_SLOT_US - ONEWIRE_WRITE0_LOW_US );
+  }
+  HAL_EXIT_CRITICAL_SECTION( intState );
+}
+
+/*********************************************************************
+ * @fn      oneWire_ReadBit
+ *
+ * @brief   Reads a bit: starts the slot with a short low pulse and
+ *          samples the bus, which a device holds low to send a 0.
+ *
+ * @param   none
+ *
+ * @return  bit read
+ */
+static uint8 oneWire_ReadBit( void )
+{
+  halIntState_t intState;
+  uint8 bit;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );
+  ONEWIRE_LOW();
+  MicroWait( ONEWIRE_READ_LOW_US );
+  ONEWIRE_RELEASE();
+  MicroWait( ONEWIRE_READ_SAMPLE_US );
+  bit = ONEWIRE_PIN;
+  MicroWait( ONEWIRE_SLOT_US - ONEWIRE_READ_LOW_US - ONEWIRE_READ_SAMPLE_US );
+  HAL_EXIT_CRITICAL_SECTION( intState );
+
+  return bit;
+}
+
+/*********************************************************************
+*********************************************************************/
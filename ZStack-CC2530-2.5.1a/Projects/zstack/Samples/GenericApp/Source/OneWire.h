@@ -0,0 +1,99 @@
+/**************************************************************************************************
+  Filename:       OneWire.h
+
+  Description:    Bit-banged 1-Wire bus master with the ROM search, so that
+                  one pin can serve several devices.
+
+  The bus idles high through its pull-up. The master only ever pulls it
+  low or releases it, by switching the pin between an output driving 0
+  and an input. Every time slot runs with interrupts disabled; a slot is
+  ONEWIRE_SLOT_US long, and a reset with its presence detect
+  ONEWIRE_RESET_US.
+**************************************************************************************************/
+
+#ifndef ONEWIRE_H
+#define ONEWIRE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Bus pin; P1.1, as wired on the sensor boards
+#if !defined( ONEWIRE_PIN )
+  #define ONEWIRE_PIN                 P1_1
+  #define ONEWIRE_SEL                 P1SEL
+  #define ONEWIRE_DIR                 P1DIR
+  #define ONEWIRE_BIT                 BV(1)
+#endif
+
+// Length of a ROM code: family, 48-bit serial number, CRC-8
+#define ONEWIRE_ROM_LEN               8
+
+// ROM commands
+#define ONEWIRE_SEARCH_ROM            0xF0
+#define ONEWIRE_READ_ROM              0x33
+#define ONEWIRE_MATCH_ROM             0x55
+#define ONEWIRE_SKIP_ROM              0xCC
+
+// Bus time taken by a reset and by one bit, in us
+#define ONEWIRE_RESET_US              960
+#define ONEWIRE_SLOT_US               70
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Makes the pin a GPIO input, releasing the bus.
+ */
+extern void OneWire_Init( void );
+
+/*
+ * Sends a reset pulse. Returns TRUE if a device answered with a
+ * presence pulse.
+ */
+extern uint8 OneWire_Reset( void );
+
+/*
+ * Writes and reads bytes, LSB first.
+ */
+extern void OneWire_WriteByte( uint8 value );
+extern uint8 OneWire_ReadByte( void );
+
+/*
+ * Resets the bus and addresses one device with Match ROM, or all of them
+ * with Skip ROM if rom is NULL. Returns TRUE if a device is present.
+ */
+extern uint8 OneWire_Select( uint8 *rom );
+
+/*
+ * Runs the ROM search and stores the codes of up to maxRoms devices,
+ * ONEWIRE_ROM_LEN bytes each, in roms. Codes with a bad CRC-8 end the
+ * search. Returns the number of codes stored.
+ */
+extern uint8 OneWire_Search( uint8 *roms, uint8 maxRoms );
+
+/*
+ * Returns the Dallas/Maxim CRC-8 of len bytes. Running it over data
+ * followed by its CRC gives 0.
+ */
+extern uint8 OneWire_Crc8( uint8 *data, uint8 len );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ONEWIRE_H */
@@ -0,0 +1,239 @@
+/**************************************************************************************************
+  Filename:       SensorAdc.c
+
+  Description:    Interrupt-driven, oversampled ADC acquisition of the light
+                  and gas sensors. See SensorAdc.h.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "hal_adc.h"
+#include "hal_mcu.h"
+
+#include "SensorAdc.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// ADCCON3 decimation rate of a single conversion: 10 bits, as in hal_adc.c
+#define SENSORADC_DEC_128     0x10
+
+// Bit of the right-aligned conversion result holding the sign
+#define SENSORADC_SIGN        0x0200
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// AIN inputs of the channels
+static const uint8 sensorAdc_Input[SENSORADC_CHANNELS] =
+{
+  HAL_ADC_CHN_AIN6,     // SENSORADC_LIGHT
+  HAL_ADC_CHN_AIN7      // SENSORADC_GAS
+};
+
+// Burst in progress
+static volatile uint8 sensorAdc_Busy;
+static uint8 sensorAdc_Channel;
+static uint8 sensorAdc_Count;
+static uint16 sensorAdc_Sum;
+
+// Moving-average rings of the decimated samples
+static uint16 sensorAdc_Ring[SENSORADC_CHANNELS][SENSORADC_AVERAGE_LEN];
+static uint16 sensorAdc_RingSum[SENSORADC_CHANNELS];
+static uint8 sensorAdc_RingIdx[SENSORADC_CHANNELS];
+static uint8 sensorAdc_RingLen[SENSORADC_CHANNELS];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static void sensorAdc_Convert( void );
+static void sensorAdc_Accumulate( uint16 result );
+
+/*********************************************************************
+ * @fn      SensorAdc_Init
+ *
+ * @brief   Enables the sensor inputs and the ADC interrupt.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void SensorAdc_Init( void )
+{
+  uint8 i;
+
+  // Leave the inputs enabled so that their voltage settles between
+  // bursts; see HalAdcRead().
+  for ( i = 0; i < SENSORADC_CHANNELS; i++ )
+  {
+    ADCCFG |= BV( sensorAdc_Input[i] );
+  }
+
+  sensorAdc_Busy = FALSE;
+  ADCIE = 1;
+}
+
+/*********************************************************************
+ * @fn      SensorAdc_Start
+ *
+ * @brief   Starts a burst of conversions of all channels. Returns at
+ *          once; the ADC interrupt runs the burst to completion.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void SensorAdc_Start( void )
+{
+  if ( sensorAdc_Busy )
+  {
+    return;
+  }
+
+  sensorAdc_Busy = TRUE;
+  sensorAdc_Channel = 0;
+  sensorAdc_Count = 0;
+  sensorAdc_Sum = 0;
+  sensorAdc_Convert();
+}
+
+/*********************************************************************
+ * @fn      SensorAdc_Read
+ *
+ * @brief   Returns the moving average of a channel without waiting.
+ *
+ * @param   channel - SENSORADC_LIGHT or SENSORADC_GAS
+ *
+ * @return  average of the decimated samples, SENSORADC_RESOLUTION_BITS
+ *          wide, or 0 before the first burst has completed
+ */
+uint16 SensorAdc_Read( uint8 channel )
+{
+  halIntState_t intState;
+  uint16 sum;
+  uint8 len;
+
+  if ( channel >= SENSORADC_CHANNELS )
+  {
+    return 0;
+  }
+
+  HAL_ENTER_CRITICAL_SECTION( intState );
+  sum = sensorAdc_RingSum[channel];
+  len = sensorAdc_RingLen[channel];
+  HAL_EXIT_CRITICAL_SECTION( intState );
+
+  return ( len ) ? (sum / len) : 0;
+}
+
+/*********************************************************************
+ * @fn      sensorAdc_Convert
+ *
+ * @brief   Starts a single conversion of the current channel; the ADC
+ *          interrupt fires when it completes.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void sensorAdc_Convert( void )
+{
+  ADCCON3 = HAL_ADC_REF_AVDD | SENSORADC_DEC_128 | sensorAdc_Input[sensorAdc_Channel];
+}
+
+/*********************************************************************
+ * @fn      sensorAdc_Accumulate
+ *
+ * @brief   Adds a conversion to the current channel. After
+ *          SENSORADC_OVERSAMPLE conversions, decimates their sum into
+ *          the channel's moving-average ring and moves to the next
+ *          channel.
+ *
+ * @param   result - ADCH:ADCL of the conversion
+ *
+ * @return  none
+ */
+static void sensorAdc_Accumulate( uint16 result )
+{
+  uint16 *ring;
+  uint8 ch = sensorAdc_Channel;
+
+  // Left-aligned two's complement; small negative readings are 0.
+  result >>= 6;
+  if ( !(result & SENSORADC_SIGN) )
+  {
+    sensorAdc_Sum += result;
+  }
+
+  if ( ++sensorAdc_Count < SENSORADC_OVERSAMPLE )
+  {
+    return;
+  }
+
+  ring = &sensorAdc_Ring[ch][sensorAdc_RingIdx[ch]];
+  sensorAdc_RingSum[ch] -= *ring;
+  *ring = sensorAdc_Sum >> SENSORADC_OVERSAMPLE_SHIFT;
+  sensorAdc_RingSum[ch] += *ring;
+  sensorAdc_RingIdx[ch] = (sensorAdc_RingIdx[ch] + 1) & (SENSORADC_AVERAGE_LEN - 1);
+  if ( sensorAdc_RingLen[ch] < SENSORADC_AVERAGE_LEN )
+  {
+    sensorAdc_RingLen[ch]++;
+  }
+
+  sensorAdc_Channel++;
+  sensorAdc_Count = 0;
+  sensorAdc_Sum = 0;
+}
+
+/*********************************************************************
+ * @fn      sensorAdcIsr
+ *
+ * @brief   ADC interrupt: takes the result of the conversion and starts
+ *          the next one until the burst is complete. The CPU clears
+ *          ADCIF when it vectors here.
+ *
+ *          A conversion started by someone else, such as HalAdcCheckVdd()
+ *          before an NV write, ends the burst and its result is left
+ *          alone: reading it would clear the EOC bit that the other
+ *          code is waiting for.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+HAL_ISR_FUNCTION( sensorAdcIsr, ADC_VECTOR )
+{
+  uint16 result;
+
+  HAL_ENTER_ISR();
+
+  if ( sensorAdc_Busy
+      && ((ADCCON3 & HAL_ADC_CHN_BITS) == sensorAdc_Input[sensorAdc_Channel]) )
+  {
+    result = ADCL;
+    result |= (uint16)ADCH << 8;
+    sensorAdc_Accumulate( result );
+
+    if ( sensorAdc_Channel < SENSORADC_CHANNELS )
+    {
+      sensorAdc_Convert();
+    }
+    else
+    {
+      sensorAdc_Busy = FALSE;
+    }
+  }
+  else
+  {
+    sensorAdc_Busy = FALSE;
+  }
+
+  HAL_EXIT_ISR();
+}
+
+/*********************************************************************
+*********************************************************************/
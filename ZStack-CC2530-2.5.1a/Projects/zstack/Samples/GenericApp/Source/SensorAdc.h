@@ -0,0 +1,81 @@
+/**************************************************************************************************
+  Filename:       SensorAdc.h
+
+  Description:    Interrupt-driven, oversampled ADC acquisition of the light
+                  and gas sensors of the end device.
+
+  SensorAdc_Start() begins a burst in the background. The burst takes
+  SENSORADC_OVERSAMPLE single conversions of each channel, each completed
+  by the ADC interrupt. The samples of a channel are summed and decimated,
+  which adds SENSORADC_OVERSAMPLE_SHIFT bits of resolution. The result is
+  pushed into a moving-average ring of SENSORADC_AVERAGE_LEN entries.
+  SensorAdc_Read() returns the average at once, so it never waits for a
+  conversion.
+**************************************************************************************************/
+
+#ifndef SENSORADC_H
+#define SENSORADC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Channels
+#define SENSORADC_LIGHT               0
+#define SENSORADC_GAS                 1
+#define SENSORADC_CHANNELS            2
+
+// Each decimated sample is the sum of 4^SENSORADC_OVERSAMPLE_SHIFT
+// conversions shifted right by SENSORADC_OVERSAMPLE_SHIFT
+#if !defined( SENSORADC_OVERSAMPLE_SHIFT )
+  #define SENSORADC_OVERSAMPLE_SHIFT  2
+#endif
+#define SENSORADC_OVERSAMPLE          (1 << (2 * SENSORADC_OVERSAMPLE_SHIFT))
+
+// Decimated samples averaged by SensorAdc_Read(); a power of two
+#if !defined( SENSORADC_AVERAGE_LEN )
+  #define SENSORADC_AVERAGE_LEN       8
+#endif
+
+// Conversions are 10-bit two's complement, i.e. 0-511 for the single-ended
+// inputs; oversampling adds SENSORADC_OVERSAMPLE_SHIFT bits.
+#define SENSORADC_RESOLUTION_BITS     (9 + SENSORADC_OVERSAMPLE_SHIFT)
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Enables the sensor inputs and the ADC interrupt.
+ */
+extern void SensorAdc_Init( void );
+
+/*
+ * Starts a burst of conversions of all channels, unless one is running.
+ */
+extern void SensorAdc_Start( void );
+
+/*
+ * Returns the moving average of a channel, SENSORADC_RESOLUTION_BITS
+ * wide, or 0 before the first burst has completed.
+ */
+extern uint16 SensorAdc_Read( uint8 channel );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSORADC_H */
@@ -0,0 +1,188 @@
+/**************************************************************************************************
+  Filename:       SensorFrame.c
+
+  Description:    Binary sensor report encoder and checker. See SensorFrame.h
+                  for the frame layout.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+
+#include "SensorFrame.h"
+
+/*********************************************************************
+ * @fn      SensorFrame_Crc16
+ *
+ * @brief   CRC-16/CCITT-FALSE, computed bitwise to save code space.
+ *
+ * @param   buf - data
+ * @param   len - length of data
+ *
+ * @return  CRC of the data
+ */
+uint16 SensorFrame_Crc16( uint8 *buf, uint8 len )
+{
+  uint16 crc = 0xFFFF;
+  uint8 bit;
+
+  while ( len-- )
+  {
+    crc ^= (uint16)(*buf++) << 8;
+    for ( bit = 0; bit < 8; bit++ )
+    {
+      if ( crc & 0x8000 )
+      {
+        crc = (crc << 1) ^ 0x1021;
+      }
+      else
+      {
+        crc <<= 1;
+      }
+    }
+  }
+  return crc;
+}
+
+/*********************************************************************
+ * @fn      SensorFrame_Begin
+ *
+ * @brief   Starts a frame in the given buffer.
+ *
+ * @param   frame    - frame to start
+ * @param   buf      - buffer receiving the frame
+ * @param   size     - size of buf
+ * @param   seq      - report sequence number
+ * @param   deviceId - id of the reporting device
+ *
+ * @return  none
+ */
+void SensorFrame_Begin( sensorFrame_t *frame, uint8 *buf, uint8 size,
+                        uint16 seq, uint8 deviceId )
+{
+  frame->buf = buf;
+  frame->size = size;
+  frame->len = 0;
+
+  if ( size < SENSORFRAME_HDR_LEN + SENSORFRAME_CRC_LEN )
+  {
+    frame->size = 0;
+    return;
+  }
+  buf[0] = SENSORFRAME_VERSION;
+  buf[1] = LO_UINT16( seq );
+  buf[2] = HI_UINT16( seq );
+  buf[3] = deviceId;
+  frame->len = SENSORFRAME_HDR_LEN;
+}
+
+/*********************************************************************
+ * @fn      SensorFrame_AddUint8
+ *
+ * @brief   Appends a one-byte TLV.
+ *
+ * @param   frame - frame being built
+ * @param   type  - TLV type
+ * @param   value - value
+ *
+ * @return  TRUE if the TLV fits in the frame
+ */
+uint8 SensorFrame_AddUint8( sensorFrame_t *frame, uint8 type, uint8 value )
+{
+  if ( frame->len + 3 + SENSORFRAME_CRC_LEN > frame->size )
+  {
+    frame->size = 0;
+    return FALSE;
+  }
+  frame->buf[frame->len++] = type;
+  frame->buf[frame->len++] = 1;
+  frame->buf[frame->len++] = value;
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      SensorFrame_AddUint16
+ *
+ * @brief   Appends a two-byte TLV, LSB first. Signed values are
+ *          passed in two's complement.
+ *
+ * @param   frame - frame being built
+ * @param   type  - TLV type
+ * @param   value - value
+ *
+ * @return  TRUE if the TLV fits in the frame
+ */
+uint8 SensorFrame_AddUint16( sensorFrame_t *frame, uint8 type, uint16 value )
+{
+  if ( frame->len + 4 + SENSORFRAME_CRC_LEN > frame->size )
+  {
+    frame->size = 0;
+    return FALSE;
+  }
+  frame->buf[frame->len++] = type;
+  frame->buf[frame->len++] = 2;
+  frame->buf[frame->len++] = LO_UINT16( value );
+  frame->buf[frame->len++] = HI_UINT16( value );
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      SensorFrame_End
+ *
+ * @brief   Appends the CRC to a frame.
+ *
+ * @param   frame - frame being built
+ *
+ * @return  length of the frame, or 0 if a TLV did not fit
+ */
+uint8 SensorFrame_End( sensorFrame_t *frame )
+{
+  uint16 crc;
+
+  if ( frame->size == 0 )
+  {
+    return 0;
+  }
+  crc = SensorFrame_Crc16( frame->buf, frame->len );
+  frame->buf[frame->len++] = LO_UINT16( crc );
+  frame->buf[frame->len++] = HI_UINT16( crc );
+  return frame->len;
+}
+
+/*********************************************************************
+ * @fn      SensorFrame_Check
+ *
+ * @brief   Validates a received frame.
+ *
+ * @param   buf - received frame
+ * @param   len - length of the frame
+ *
+ * @return  TRUE if the version is known, the CRC matches and the TLVs
+ *          end exactly at the CRC
+ */
+uint8 SensorFrame_Check( uint8 *buf, uint8 len )
+{
+  uint16 pos;
+
+  if ( (len < SENSORFRAME_HDR_LEN + SENSORFRAME_CRC_LEN) || (buf[0] != SENSORFRAME_VERSION) )
+  {
+    return FALSE;
+  }
+
+  len -= SENSORFRAME_CRC_LEN;
+  if ( SensorFrame_Crc16( buf, len ) != BUILD_UINT16( buf[len], buf[len + 1] ) )
+  {
+    return FALSE;
+  }
+
+  pos = SENSORFRAME_HDR_LEN;
+  while ( pos + 2 <= len )
+  {
+    pos += 2 + buf[pos + 1];
+  }
+  return ( pos == len );
+}
+
+/*********************************************************************
+*********************************************************************/
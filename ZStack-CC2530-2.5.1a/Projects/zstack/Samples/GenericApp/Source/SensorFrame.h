@@ -0,0 +1,97 @@
+/**************************************************************************************************
+  Filename:       SensorFrame.h
+
+  Description:    Binary sensor report built by the coordinator from the
+                  ZCL attribute reports of ZclSensor.h, or sent on
+                  GenericApp_Sensor_CLUSTERID by end devices predating it.
+
+  All fields are little-endian:
+
+      | VER | SEQ | DEVICE | TLV ... | CRC |
+      |  1  |  2  |   1    |         |  2  |
+
+  Each TLV is a type byte, a length byte and the value. CRC is the
+  CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of all the preceding
+  bytes. Reports from older end devices are 11 ASCII bytes starting with
+  'S'; the version byte never takes that value. The gateway decoder is
+  sensor_frame.h in the AzureSphereAzureIoTHub project.
+**************************************************************************************************/
+
+#ifndef SENSORFRAME_H
+#define SENSORFRAME_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define SENSORFRAME_VERSION           0x01
+#define SENSORFRAME_HDR_LEN           4       // VER, SEQ, DEVICE
+#define SENSORFRAME_CRC_LEN           2
+#define SENSORFRAME_MAX_LEN           48
+
+// Start byte and length of the ASCII reports of older end devices
+#define SENSORFRAME_LEGACY_START      'S'
+#define SENSORFRAME_LEGACY_LEN        11
+
+// TLV types
+#define SENSORFRAME_TLV_TEMPERATURE   0x01    // int16, degrees C
+#define SENSORFRAME_TLV_HUMIDITY      0x02    // uint16, %RH
+#define SENSORFRAME_TLV_LIGHT         0x03    // uint16, ADC reading
+#define SENSORFRAME_TLV_GAS           0x04    // uint16, ADC reading
+#define SENSORFRAME_TLV_PIR           0x05    // uint8, 1 when motion is detected
+#define SENSORFRAME_TLV_TEMPERATURE_CENTI 0x06  // int16, 0.01 degrees C
+#define SENSORFRAME_TLV_HUMIDITY_CENTI    0x07  // uint16, 0.01 %RH
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Frame being built by SensorFrame_Begin() and the SensorFrame_Add functions
+typedef struct
+{
+  uint8 *buf;
+  uint8 size;
+  uint8 len;
+} sensorFrame_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+extern void SensorFrame_Begin( sensorFrame_t *frame, uint8 *buf, uint8 size,
+                               uint16 seq, uint8 deviceId );
+extern uint8 SensorFrame_AddUint8( sensorFrame_t *frame, uint8 type, uint8 value );
+extern uint8 SensorFrame_AddUint16( sensorFrame_t *frame, uint8 type, uint16 value );
+
+/*
+ * Appends the CRC. Returns the length of the frame, or 0 if it
+ * overflowed its buffer.
+ */
+extern uint8 SensorFrame_End( sensorFrame_t *frame );
+
+/*
+ * Returns TRUE if buf holds a frame of a known version with a valid
+ * CRC and well-formed TLVs.
+ */
+extern uint8 SensorFrame_Check( uint8 *buf, uint8 len );
+
+extern uint16 SensorFrame_Crc16( uint8 *buf, uint8 len );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSORFRAME_H */
@@ -0,0 +1,291 @@
+/**************************************************************************************************
+  Filename:       SourceRoute.c
+
+  Description:    Many-to-one routing and source routing of the coordinator.
+                  See SourceRoute.h.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "AF.h"
+#include "ZDApp.h"
+#include "ZGlobals.h"
+#include "NLMEDE.h"
+#include "rtg.h"
+
+#include "DeviceDirectory.h"
+#include "SourceRoute.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Relay count of a device without a cached relay list
+#define SRCROUTE_NO_ROUTE     0xFF
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  uint8 relayCnt;                       // SRCROUTE_NO_ROUTE if none
+  uint8 age;                            // many-to-one route requests since the record
+  uint16 relays[SRCROUTE_MAX_RELAYS];   // as in the route record, nearest the device first
+} srcRouteEntry_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+srcRouteStats_t SourceRoute_Stats;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint8 srcRoute_TaskID;
+static uint16 srcRoute_Event;
+
+// osal_GetSystemClock() of the last many-to-one route request
+static uint32 srcRoute_LastRequest;
+
+// Relay lists, by directory index
+static srcRouteEntry_t srcRoute_Cache[DEVDIR_MAX_DEVICES];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static void *srcRoute_RecordCB( void *param );
+static void srcRoute_RequestSoon( void );
+
+/*********************************************************************
+ * @fn      SourceRoute_Init
+ *
+ * @brief   Registers for the route records and starts the timer of the
+ *          many-to-one route requests. The stack sends the first one
+ *          when the network starts.
+ *
+ * @param   taskId - task of the timer
+ * @param   event  - event of the timer
+ *
+ * @return  none
+ */
+void SourceRoute_Init( uint8 taskId, uint16 event )
+{
+  uint8 i;
+
+  srcRoute_TaskID = taskId;
+  srcRoute_Event = event;
+  osal_memset( &SourceRoute_Stats, 0, sizeof( SourceRoute_Stats ) );
+
+  for ( i = 0; i < DEVDIR_MAX_DEVICES; i++ )
+  {
+    srcRoute_Cache[i].relayCnt = SRCROUTE_NO_ROUTE;
+  }
+
+  ZDO_RegisterForZdoCB( ZDO_SRC_RTG_IND_CBID, srcRoute_RecordCB );
+
+  srcRoute_LastRequest = osal_GetSystemClock();
+  osal_start_timerEx( taskId, event, SRCROUTE_MTO_INTERVAL );
+}
+
+/*********************************************************************
+ * @fn      SourceRoute_ProcessEvent
+ *
+ * @brief   Sends a many-to-one route request and ages the relay lists.
+ *          Every device sends a new route record on its next unicast to
+ *          the coordinator, so a relay list that is not renewed belongs
+ *          to a device that left or stopped reporting.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void SourceRoute_ProcessEvent( void )
+{
+  srcRouteEntry_t *entry;
+  uint8 i;
+
+  // The cache holds every record, so the devices need not send one
+  //  before each unicast (NO_ROUTE_CACHE).
+  if ( NLME_RouteDiscoveryRequest( 0, MTO_ROUTE, zgConcentratorRadius ) == ZSuccess )
+  {
+    SourceRoute_Stats.mtoRequests++;
+  }
+  srcRoute_LastRequest = osal_GetSystemClock();
+
+  for ( i = 0; i < DEVDIR_MAX_DEVICES; i++ )
+  {
+    entry = &srcRoute_Cache[i];
+    if ( (entry->relayCnt != SRCROUTE_NO_ROUTE) && (++entry->age > SRCROUTE_MAX_AGE) )
+    {
+      entry->relayCnt = SRCROUTE_NO_ROUTE;
+    }
+  }
+
+  osal_start_timerEx( srcRoute_TaskID, srcRoute_Event, SRCROUTE_MTO_INTERVAL );
+}
+
+/*********************************************************************
+ * @fn      SourceRoute_DataRequest
+ *
+ * @brief   Sends a unicast with AF_DataRequestSrcRtg() on the cached
+ *          relay list of the device. A device without one takes the
+ *          relay list left in the stack's table, which is cached for the
+ *          next time if it fits. Other messages go to AF_DataRequest()
+ *          as they are.
+ *
+ * @param   see AF_DataRequest()
+ *
+ * @return  status of the request
+ */
+afStatus_t SourceRoute_DataRequest( afAddrType_t *dstAddr, endPointDesc_t *srcEP,
+                                    uint16 cID, uint16 len, uint8 *buf,
+                                    uint8 *transID, uint8 options, uint8 radius )
+{
+  srcRouteEntry_t *entry = NULL;
+  uint16 *relays;
+  uint8 relayCnt;
+  uint8 index;
+
+  if ( dstAddr->addrMode != afAddr16Bit )
+  {
+    return AF_DataRequest( dstAddr, srcEP, cID, len, buf, transID, options, radius );
+  }
+
+  index = DeviceDirectory_Lookup( dstAddr->addr.shortAddr );
+  if ( index != DEVDIR_INVALID_INDEX )
+  {
+    entry = &srcRoute_Cache[index];
+  }
+
+  if ( (entry == NULL) || (entry->relayCnt == SRCROUTE_NO_ROUTE) )
+  {
+    if ( RTG_GetRtgSrcEntry( dstAddr->addr.shortAddr, &relayCnt, &relays ) != RTG_SUCCESS )
+    {
+      // No route record since the last request. The next one brings a
+      //  record the cache can keep, unless the device has no index.
+      SourceRoute_Stats.discovered++;
+      if ( entry != NULL )
+      {
+        srcRoute_RequestSoon();
+      }
+      return AF_DataRequest( dstAddr, srcEP, cID, len, buf, transID, options, radius );
+    }
+
+    SourceRoute_Stats.stackCached++;
+    if ( (entry == NULL) || (relayCnt > SRCROUTE_MAX_RELAYS) )
+    {
+      // The network layer finds the relay list in its table.
+      return AF_DataRequest( dstAddr, srcEP, cID, len, buf, transID, options, radius );
+    }
+
+    entry->relayCnt = relayCnt;
+    entry->age = 0;
+    osal_memcpy( entry->relays, relays, relayCnt * sizeof( uint16 ) );
+  }
+  else
+  {
+    SourceRoute_Stats.cached++;
+  }
+
+  return AF_DataRequestSrcRtg( dstAddr, srcEP, cID, len, buf, transID, options, radius,
+                               entry->relayCnt, entry->relays );
+}
+
+/*********************************************************************
+ * @fn      SourceRoute_DeliveryFailed
+ *
+ * @brief   Drops the relay list of a device that a unicast did not
+ *          reach, since a relay may be gone, and brings the next
+ *          many-to-one route request forward.
+ *
+ * @param   nwkAddr - NWK address of the device
+ *
+ * @return  none
+ */
+void SourceRoute_DeliveryFailed( uint16 nwkAddr )
+{
+  uint8 index;
+
+  index = DeviceDirectory_Lookup( nwkAddr );
+  if ( (index != DEVDIR_INVALID_INDEX)
+      && (srcRoute_Cache[index].relayCnt != SRCROUTE_NO_ROUTE) )
+  {
+    srcRoute_Cache[index].relayCnt = SRCROUTE_NO_ROUTE;
+    SourceRoute_Stats.failed++;
+  }
+
+  srcRoute_RequestSoon();
+}
+
+/*********************************************************************
+ * @fn      srcRoute_RecordCB
+ *
+ * @brief   ZDO_SRC_RTG_IND_CBID callback: caches the relay list of a
+ *          route record from a device of the directory.
+ *
+ * @param   param - zdoSrcRtg_t of the record
+ *
+ * @return  NULL
+ */
+static void *srcRoute_RecordCB( void *param )
+{
+  zdoSrcRtg_t *record = (zdoSrcRtg_t *)param;
+  srcRouteEntry_t *entry;
+  uint8 index;
+
+  SourceRoute_Stats.routeRecords++;
+
+  index = DeviceDirectory_Lookup( record->srcAddr );
+  if ( index == DEVDIR_INVALID_INDEX )
+  {
+    return NULL;
+  }
+
+  entry = &srcRoute_Cache[index];
+  if ( record->relayCnt > SRCROUTE_MAX_RELAYS )
+  {
+    entry->relayCnt = SRCROUTE_NO_ROUTE;
+    return NULL;
+  }
+
+  entry->relayCnt = record->relayCnt;
+  entry->age = 0;
+  osal_memcpy( entry->relays, record->pRelayList, record->relayCnt * sizeof( uint16 ) );
+  return NULL;
+}
+
+/*********************************************************************
+ * @fn      srcRoute_RequestSoon
+ *
+ * @brief   Moves the next many-to-one route request to
+ *          SRCROUTE_MIN_MTO_INTERVAL after the last one, or to now.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void srcRoute_RequestSoon( void )
+{
+  uint32 elapsed = osal_GetSystemClock() - srcRoute_LastRequest;
+  uint16 timeout;
+
+  if ( elapsed >= SRCROUTE_MIN_MTO_INTERVAL )
+  {
+    osal_stop_timerEx( srcRoute_TaskID, srcRoute_Event );
+    osal_set_event( srcRoute_TaskID, srcRoute_Event );
+    return;
+  }
+
+  timeout = (uint16)(SRCROUTE_MIN_MTO_INTERVAL - elapsed);
+  if ( osal_get_timeoutEx( srcRoute_TaskID, srcRoute_Event ) > timeout )
+  {
+    osal_start_timerEx( srcRoute_TaskID, srcRoute_Event, timeout );
+  }
+}
+
+/*********************************************************************
+*********************************************************************/
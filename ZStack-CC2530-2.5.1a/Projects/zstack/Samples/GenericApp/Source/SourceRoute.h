@@ -0,0 +1,120 @@
+/**************************************************************************************************
+  Filename:       SourceRoute.h
+
+  Description:    Many-to-one routing and source routing of the coordinator.
+
+  The coordinator runs as a concentrator. Every SRCROUTE_MTO_INTERVAL ms
+  it broadcasts a many-to-one route request, which gives every router a
+  route to it without route discovery. The devices then send a route
+  record on their first unicast to it after each request. The relay list
+  of each record is cached under the DeviceDirectory.h index of the
+  device, so the cache holds every device of the directory whatever the
+  size of the stack's own source route table, which is small and
+  expires within seconds.
+
+  SourceRoute_DataRequest() sends unicasts to the devices with
+  AF_DataRequestSrcRtg(), on the cached relay list or else on the one
+  left in the stack's table. Only a device with neither is left to route
+  discovery, and that also brings the next many-to-one request forward.
+  A delivery failure drops the relay list of the device, as does missing
+  SRCROUTE_MAX_AGE requests in a row.
+**************************************************************************************************/
+
+#ifndef SOURCEROUTE_H
+#define SOURCEROUTE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "AF.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Period of the many-to-one route requests, in ms (at most 65535)
+#if !defined( SRCROUTE_MTO_INTERVAL )
+  #define SRCROUTE_MTO_INTERVAL       60000
+#endif
+
+// Shortest time between two many-to-one route requests, in ms. A request
+// brought forward by a missing route waits for it.
+#if !defined( SRCROUTE_MIN_MTO_INTERVAL )
+  #define SRCROUTE_MIN_MTO_INTERVAL   10000
+#endif
+
+// Longest relay list cached; longer routes use the stack's table alone
+#if !defined( SRCROUTE_MAX_RELAYS )
+  #define SRCROUTE_MAX_RELAYS         5
+#endif
+
+// Many-to-one route requests a relay list outlives without a new record
+#if !defined( SRCROUTE_MAX_AGE )
+  #define SRCROUTE_MAX_AGE            6
+#endif
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  uint16 mtoRequests;   // many-to-one route requests sent
+  uint16 routeRecords;  // route records received
+  uint16 cached;        // unicasts sent on a relay list of the cache
+  uint16 stackCached;   // unicasts sent on a relay list of the stack's table
+  uint16 discovered;    // unicasts left to route discovery
+  uint16 failed;        // relay lists dropped after a delivery failure
+} srcRouteStats_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Registers for the route records and starts the many-to-one route
+ * requests on the task and event given.
+ */
+extern void SourceRoute_Init( uint8 taskId, uint16 event );
+
+/*
+ * Sends a many-to-one route request; call on the event given to
+ * SourceRoute_Init().
+ */
+extern void SourceRoute_ProcessEvent( void );
+
+/*
+ * AF_DataRequest() to a device, on its source route if one is known.
+ */
+extern afStatus_t SourceRoute_DataRequest( afAddrType_t *dstAddr, endPointDesc_t *srcEP,
+                                           uint16 cID, uint16 len, uint8 *buf,
+                                           uint8 *transID, uint8 options, uint8 radius );
+
+/*
+ * Drops the source route of a device whose unicast was not delivered.
+ */
+extern void SourceRoute_DeliveryFailed( uint16 nwkAddr );
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+// Routing counters; the unicasts sent on a relay list are the route
+// discoveries avoided. The coordinator sends them to the gateway in a
+// GATEWAYLINK_TYPE_ROUTE_STATS frame after each many-to-one request.
+extern srcRouteStats_t SourceRoute_Stats;
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOURCEROUTE_H */
@@ -0,0 +1,657 @@
+/**************************************************************************************************
+  Filename:       ZclSensor.c
+
+  Description:    Home Automation endpoint of the sensor node, serving the
+                  ZCL measurement clusters with attribute reporting.
+                  See ZclSensor.h.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "OSAL_Nv.h"
+#include "AF.h"
+
+#include "zcl.h"
+#include "zcl_general.h"
+#include "zcl_ms.h"
+
+#include "GenericApp.h"
+#include "SensorAdc.h"
+#include "ZclSensor.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define ZCLSENSOR_DEVICEID            0x0302  // HA Temperature Sensor, as in zcl_ha.h
+#define ZCLSENSOR_DEVICE_VERSION      0
+#define ZCLSENSOR_FLAGS               0
+
+#define ZCLSENSOR_ATTRID_IOV_BASIC_STATUS_FLAGS   0x006F
+
+// Maximum interval that turns reporting of an attribute off
+#define ZCLSENSOR_NO_REPORTS          0xFFFF
+
+// Default reporting configuration, in seconds and in the units of the
+// attributes. Each cluster sends its own heartbeat, so the maximum
+// interval is five times that of the single GenericApp report. The
+// changes are its deadbands plus one step of the attribute.
+#define ZCLSENSOR_MIN_INTERVAL        1
+#define ZCLSENSOR_MAX_INTERVAL        300
+#define ZCLSENSOR_TEMPERATURE_CHANGE  101     // more than 1 degree C
+#define ZCLSENSOR_HUMIDITY_CHANGE     301     // more than 3 %RH
+#define ZCLSENSOR_LIGHT_CHANGE        161     // SensorAdc reading
+#define ZCLSENSOR_GAS_CHANGE          81      // SensorAdc reading
+
+// Temperature and humidity are in hundredths of the units of a deadband
+#define ZCLSENSOR_CENTI               100
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// A reported attribute
+typedef struct
+{
+  uint16 clusterId;
+  uint16 attrId;
+  uint8 dataType;
+  void *value;
+} zclSensorReportable_t;
+
+// Reporting configuration of an attribute; stored in NV
+typedef struct
+{
+  uint16 minInterval;   // s
+  uint16 maxInterval;   // s; 0 for no periodic reports, ZCLSENSOR_NO_REPORTS for none
+  uint16 change;        // reportable change, in the units of zclSensor_Level
+} zclSensorReportCfg_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Attribute values
+static const uint8 zclSensor_ZclVersion = 0x01;
+static const uint8 zclSensor_PowerSource = POWER_SOURCE_UNKNOWN;
+
+static int16 zclSensor_Temperature = 0;
+#if defined( GENERICAPP_DS18B20 )
+static const int16 zclSensor_MinTemperature = -5500;        // DS18B20 range
+static const int16 zclSensor_MaxTemperature = 12500;
+#else
+static const int16 zclSensor_MinTemperature = 0;            // DHT11 range
+static const int16 zclSensor_MaxTemperature = 5000;
+#endif
+
+static uint16 zclSensor_Humidity = 0;
+static const uint16 zclSensor_MinHumidity = 2000;           // DHT11 range
+static const uint16 zclSensor_MaxHumidity = 9000;
+
+static uint16 zclSensor_Illuminance = 0;
+static const uint16 zclSensor_MinIlluminance = 0;
+static const uint16 zclSensor_MaxIlluminance = (1 << SENSORADC_RESOLUTION_BITS) - 1;
+
+static float zclSensor_Gas = 0;
+static const uint8 zclSensor_GasOutOfService = FALSE;
+static const uint8 zclSensor_GasStatusFlags = 0;
+
+static uint8 zclSensor_Occupancy = 0;
+static const uint8 zclSensor_OccupancySensorType = MS_OCCUPANCY_SENSOR_TYPE_PIR;
+
+static CONST zclAttrRec_t zclSensor_Attrs[] =
+{
+  { ZCL_CLUSTER_ID_GEN_BASIC,
+    { ATTRID_BASIC_ZCL_VERSION, ZCL_DATATYPE_UINT8, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_ZclVersion } },
+  { ZCL_CLUSTER_ID_GEN_BASIC,
+    { ATTRID_BASIC_POWER_SOURCE, ZCL_DATATYPE_ENUM8, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_PowerSource } },
+
+  { ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT,
+    { ATTRID_MS_TEMPERATURE_MEASURED_VALUE, ZCL_DATATYPE_INT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_Temperature } },
+  { ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT,
+    { ATTRID_MS_TEMPERATURE_MIN_MEASURED_VALUE, ZCL_DATATYPE_INT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_MinTemperature } },
+  { ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT,
+    { ATTRID_MS_TEMPERATURE_MAX_MEASURED_VALUE, ZCL_DATATYPE_INT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_MaxTemperature } },
+
+  { ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY,
+    { ATTRID_MS_RELATIVE_HUMIDITY_MEASURED_VALUE, ZCL_DATATYPE_UINT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_Humidity } },
+  { ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY,
+    { ATTRID_MS_RELATIVE_HUMIDITY_MIN_MEASURED_VALUE, ZCL_DATATYPE_UINT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_MinHumidity } },
+  { ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY,
+    { ATTRID_MS_RELATIVE_HUMIDITY_MAX_MEASURED_VALUE, ZCL_DATATYPE_UINT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_MaxHumidity } },
+
+  { ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT,
+    { ATTRID_MS_ILLUMINANCE_MEASURED_VALUE, ZCL_DATATYPE_UINT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_Illuminance } },
+  { ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT,
+    { ATTRID_MS_ILLUMINANCE_MIN_MEASURED_VALUE, ZCL_DATATYPE_UINT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_MinIlluminance } },
+  { ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT,
+    { ATTRID_MS_ILLUMINANCE_MAX_MEASURED_VALUE, ZCL_DATATYPE_UINT16, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_MaxIlluminance } },
+
+  { ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC,
+    { ATTRID_IOV_BASIC_PRESENT_VALUE, ZCL_DATATYPE_SINGLE_PREC, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_Gas } },
+  { ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC,
+    { ATTRID_IOV_BASIC_OUT_OF_SERVICE, ZCL_DATATYPE_BOOLEAN, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_GasOutOfService } },
+  { ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC,
+    { ZCLSENSOR_ATTRID_IOV_BASIC_STATUS_FLAGS, ZCL_DATATYPE_BITMAP8, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_GasStatusFlags } },
+
+  { ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING,
+    { ATTRID_MS_OCCUPANCY_SENSING_CONFIG_OCCUPANCY, ZCL_DATATYPE_BITMAP8, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_Occupancy } },
+  { ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING,
+    { ATTRID_MS_OCCUPANCY_SENSING_CONFIG_OCCUPANCY_SENSOR_TYPE, ZCL_DATATYPE_ENUM8, ACCESS_CONTROL_READ,
+      (void *)&zclSensor_OccupancySensorType } }
+};
+
+#define ZCLSENSOR_NUM_ATTRIBUTES  ( sizeof( zclSensor_Attrs ) / sizeof( zclSensor_Attrs[0] ) )
+
+// Reported attributes, indexed by the ZCLSENSOR_ constants
+static const zclSensorReportable_t zclSensor_Reportable[ZCLSENSOR_REPORTED_ATTRS] =
+{
+  { ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT, ATTRID_MS_TEMPERATURE_MEASURED_VALUE,
+    ZCL_DATATYPE_INT16, (void *)&zclSensor_Temperature },
+  { ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY, ATTRID_MS_RELATIVE_HUMIDITY_MEASURED_VALUE,
+    ZCL_DATATYPE_UINT16, (void *)&zclSensor_Humidity },
+  { ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT, ATTRID_MS_ILLUMINANCE_MEASURED_VALUE,
+    ZCL_DATATYPE_UINT16, (void *)&zclSensor_Illuminance },
+  { ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC, ATTRID_IOV_BASIC_PRESENT_VALUE,
+    ZCL_DATATYPE_SINGLE_PREC, (void *)&zclSensor_Gas },
+  { ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING, ATTRID_MS_OCCUPANCY_SENSING_CONFIG_OCCUPANCY,
+    ZCL_DATATYPE_BITMAP8, (void *)&zclSensor_Occupancy }
+};
+
+// Attribute units per sample unit of the first four attributes
+static const uint8 zclSensor_Scale[ZCLSENSOR_OCCUPANCY] =
+{
+  ZCLSENSOR_CENTI, ZCLSENSOR_CENTI, 1, 1
+};
+
+static const cId_t zclSensor_InClusterList[] =
+{
+  ZCL_CLUSTER_ID_GEN_BASIC,
+  ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT,
+  ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY,
+  ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT,
+  ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC,
+  ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING
+};
+
+static SimpleDescriptionFormat_t zclSensor_SimpleDesc =
+{
+  GENERICAPP_ZCL_ENDPOINT,                  //  int Endpoint;
+  GENERICAPP_ZCL_PROFID,                    //  uint16 AppProfId[2];
+  ZCLSENSOR_DEVICEID,                       //  uint16 AppDeviceId[2];
+  ZCLSENSOR_DEVICE_VERSION,                 //  int   AppDevVer:4;
+  ZCLSENSOR_FLAGS,                          //  int   AppFlags:4;
+  sizeof( zclSensor_InClusterList ) / sizeof( cId_t ),
+                                            //  byte  AppNumInClusters;
+  (cId_t *)zclSensor_InClusterList,         //  byte *pAppInClusterList;
+  0,                                        //  byte  AppNumOutClusters;
+  (cId_t *)NULL                             //  byte *pAppOutClusterList;
+};
+
+static endPointDesc_t zclSensor_EpDesc;
+static afAddrType_t zclSensor_DstAddr;
+static uint16 zclSensor_NvId;
+static uint8 zclSensor_SeqNum = 0;
+
+// Reporting configuration; set by the coordinator and kept in NV
+static zclSensorReportCfg_t zclSensor_Cfg[ZCLSENSOR_REPORTED_ATTRS] =
+{
+  { ZCLSENSOR_MIN_INTERVAL, ZCLSENSOR_MAX_INTERVAL, ZCLSENSOR_TEMPERATURE_CHANGE },
+  { ZCLSENSOR_MIN_INTERVAL, ZCLSENSOR_MAX_INTERVAL, ZCLSENSOR_HUMIDITY_CHANGE },
+  { ZCLSENSOR_MIN_INTERVAL, ZCLSENSOR_MAX_INTERVAL, ZCLSENSOR_LIGHT_CHANGE },
+  { ZCLSENSOR_MIN_INTERVAL, ZCLSENSOR_MAX_INTERVAL, ZCLSENSOR_GAS_CHANGE },
+  { ZCLSENSOR_MIN_INTERVAL, ZCLSENSOR_MAX_INTERVAL, 0 }
+};
+
+// Values of the reported attributes as uint16, the gas as its reading;
+// the latest ones and those last reported
+static uint16 zclSensor_Level[ZCLSENSOR_REPORTED_ATTRS];
+static uint16 zclSensor_Reported[ZCLSENSOR_REPORTED_ATTRS];
+
+// osal_GetSystemClock() of the last report of each attribute
+static uint32 zclSensor_ReportTime[ZCLSENSOR_REPORTED_ATTRS];
+
+// Bit per attribute reported since the start
+static uint8 zclSensor_HasReported = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static uint8 zclSensor_Due( uint8 attr, uint32 now );
+static void zclSensor_SendReports( uint8 due, uint32 now );
+static void zclSensor_ConfigReport( zclIncomingMsg_t *msg );
+static uint8 zclSensor_Configure( uint16 clusterId, zclCfgReportRec_t *rec );
+static void zclSensor_SaveCfg( void );
+
+/*********************************************************************
+ * @fn      ZclSensor_Init
+ *
+ * @brief   Registers the endpoint with ZCL and restores the reporting
+ *          configuration.
+ *
+ * @param   taskId - task to receive ZCL_INCOMING_MSG messages
+ * @param   nvId   - NV item holding the reporting configuration
+ *
+ * @return  none
+ */
+void ZclSensor_Init( uint8 taskId, uint16 nvId )
+{
+  zclSensor_NvId = nvId;
+  if ( osal_nv_item_init( nvId, sizeof( zclSensor_Cfg ), zclSensor_Cfg ) == ZSUCCESS )
+  {
+    osal_nv_read( nvId, 0, sizeof( zclSensor_Cfg ), zclSensor_Cfg );
+  }
+
+  // Reports go to the coordinator's endpoint of the same number.
+  zclSensor_DstAddr.addrMode = (afAddrMode_t)Addr16Bit;
+  zclSensor_DstAddr.endPoint = GENERICAPP_ZCL_ENDPOINT;
+  zclSensor_DstAddr.addr.shortAddr = 0x0000;
+
+  // All messages to the endpoint go to ZCL first, as in zclHA_Init().
+  zclSensor_EpDesc.endPoint = GENERICAPP_ZCL_ENDPOINT;
+  zclSensor_EpDesc.task_id = &zcl_TaskID;
+  zclSensor_EpDesc.simpleDesc = &zclSensor_SimpleDesc;
+  zclSensor_EpDesc.latencyReq = noLatencyReqs;
+  afRegister( &zclSensor_EpDesc );
+
+  zcl_registerAttrList( GENERICAPP_ZCL_ENDPOINT, ZCLSENSOR_NUM_ATTRIBUTES, zclSensor_Attrs );
+  zcl_registerForMsg( taskId );
+}
+
+/*********************************************************************
+ * @fn      ZclSensor_Update
+ *
+ * @brief   Sets the attributes from a sample, then reports those that
+ *          moved by their reportable change after their minimum
+ *          interval, or reached their maximum interval.
+ *
+ * @param   sample - temperature (0.01 degrees C), humidity (0.01 %RH),
+ *                   light and gas
+ * @param   pir    - 1 when motion is detected
+ * @param   force  - TRUE to report every attribute
+ *
+ * @return  none
+ */
+void ZclSensor_Update( uint16 *sample, uint8 pir, uint8 force )
+{
+  uint32 now = osal_GetSystemClock();
+  uint8 due = 0;
+  uint8 i;
+
+  zclSensor_Temperature = (int16)sample[ZCLSENSOR_TEMPERATURE];
+  zclSensor_Humidity = sample[ZCLSENSOR_HUMIDITY];
+  zclSensor_Illuminance = sample[ZCLSENSOR_LIGHT];
+  zclSensor_Gas = (float)sample[ZCLSENSOR_GAS];
+  zclSensor_Occupancy = pir ? 0x01 : 0x00;
+
+  zclSensor_Level[ZCLSENSOR_TEMPERATURE] = (uint16)zclSensor_Temperature;
+  zclSensor_Level[ZCLSENSOR_HUMIDITY] = zclSensor_Humidity;
+  zclSensor_Level[ZCLSENSOR_LIGHT] = zclSensor_Illuminance;
+  zclSensor_Level[ZCLSENSOR_GAS] = sample[ZCLSENSOR_GAS];
+  zclSensor_Level[ZCLSENSOR_OCCUPANCY] = zclSensor_Occupancy;
+
+  for ( i = 0; i < ZCLSENSOR_REPORTED_ATTRS; i++ )
+  {
+    if ( zclSensor_Cfg[i].maxInterval == ZCLSENSOR_NO_REPORTS )
+    {
+      continue;
+    }
+    if ( force || zclSensor_Due( i, now ) )
+    {
+      due |= BV( i );
+    }
+  }
+  if ( due != 0 )
+  {
+    zclSensor_SendReports( due, now );
+  }
+}
+
+/*********************************************************************
+ * @fn      ZclSensor_ProcessMsg
+ *
+ * @brief   Handles a ZCL foundation message for the endpoint.
+ *
+ * @param   msg - ZCL_INCOMING_MSG message
+ *
+ * @return  none
+ */
+void ZclSensor_ProcessMsg( zclIncomingMsg_t *msg )
+{
+  if ( (msg->endPoint == GENERICAPP_ZCL_ENDPOINT)
+      && (msg->zclHdr.commandID == ZCL_CMD_CONFIG_REPORT) )
+  {
+    zclSensor_ConfigReport( msg );
+  }
+
+  if ( msg->attrCmd )
+  {
+    osal_mem_free( msg->attrCmd );
+  }
+}
+
+/*********************************************************************
+ * @fn      ZclSensor_SetMaxInterval
+ *
+ * @brief   Sets the maximum reporting interval of every attribute.
+ *
+ * @param   seconds - maximum interval
+ *
+ * @return  none
+ */
+void ZclSensor_SetMaxInterval( uint16 seconds )
+{
+  uint8 i;
+
+  for ( i = 0; i < ZCLSENSOR_REPORTED_ATTRS; i++ )
+  {
+    zclSensor_Cfg[i].maxInterval = seconds;
+    if ( zclSensor_Cfg[i].minInterval > seconds )
+    {
+      zclSensor_Cfg[i].minInterval = seconds;
+    }
+  }
+  zclSensor_SaveCfg();
+}
+
+/*********************************************************************
+ * @fn      ZclSensor_SetDeadband
+ *
+ * @brief   Sets the reportable change of one of the first four
+ *          attributes from a deadband: the attribute is reported when
+ *          it moves by more than the deadband. The occupancy is reported
+ *          on every change.
+ *
+ * @param   attr     - ZCLSENSOR_TEMPERATURE to ZCLSENSOR_GAS
+ * @param   deadband - deadband, in degrees C, %RH or SensorAdc readings
+ *
+ * @return  none
+ */
+void ZclSensor_SetDeadband( uint8 attr, uint16 deadband )
+{
+  uint32 change;
+
+  if ( attr >= ZCLSENSOR_OCCUPANCY )
+  {
+    return;
+  }
+
+  change = (uint32)deadband * zclSensor_Scale[attr] + 1;
+  zclSensor_Cfg[attr].change = ( change <= 0xFFFF ) ? (uint16)change : 0xFFFF;
+  zclSensor_SaveCfg();
+}
+
+/*********************************************************************
+ * @fn      zclSensor_Due
+ *
+ * @brief   Checks whether an attribute has to be reported.
+ *
+ * @param   attr - attribute
+ * @param   now  - osal_GetSystemClock()
+ *
+ * @return  TRUE if it was never reported, reached its maximum interval,
+ *          or moved by its reportable change after its minimum interval
+ */
+static uint8 zclSensor_Due( uint8 attr, uint32 now )
+{
+  zclSensorReportCfg_t *cfg = &zclSensor_Cfg[attr];
+  uint32 elapsed;
+  uint16 diff;
+
+  if ( !(zclSensor_HasReported & BV( attr )) )
+  {
+    return TRUE;
+  }
+
+  elapsed = (now - zclSensor_ReportTime[attr]) / 1000;
+  if ( elapsed < cfg->minInterval )
+  {
+    return FALSE;
+  }
+  if ( (cfg->maxInterval != 0) && (elapsed >= cfg->maxInterval) )
+  {
+    return TRUE;
+  }
+
+  // Also right for the signed temperature
+  diff = zclSensor_Level[attr] - zclSensor_Reported[attr];
+  if ( diff & 0x8000 )
+  {
+    diff = -diff;
+  }
+  return ( (diff != 0) && (diff >= cfg->change) );
+}
+
+/*********************************************************************
+ * @fn      zclSensor_SendReports
+ *
+ * @brief   Sends the attributes due, in one Report Attributes command
+ *          per cluster. An attribute that cannot be sent stays due for
+ *          the next sample.
+ *
+ * @param   due - bit per attribute to report
+ * @param   now - osal_GetSystemClock()
+ *
+ * @return  none
+ */
+static void zclSensor_SendReports( uint8 due, uint32 now )
+{
+  zclReportCmd_t *reportCmd;
+  zclReport_t *report;
+  uint16 clusterId;
+  uint8 sent;
+  uint8 i;
+  uint8 j;
+
+  reportCmd = (zclReportCmd_t *)osal_mem_alloc( sizeof( zclReportCmd_t )
+                                  + ZCLSENSOR_REPORTED_ATTRS * sizeof( zclReport_t ) );
+  if ( reportCmd == NULL )
+  {
+    return;
+  }
+
+  for ( i = 0; i < ZCLSENSOR_REPORTED_ATTRS; i++ )
+  {
+    if ( !(due & BV( i )) )
+    {
+      continue;
+    }
+
+    clusterId = zclSensor_Reportable[i].clusterId;
+    reportCmd->numAttr = 0;
+    sent = 0;
+    for ( j = i; j < ZCLSENSOR_REPORTED_ATTRS; j++ )
+    {
+      if ( (due & BV( j )) && (zclSensor_Reportable[j].clusterId == clusterId) )
+      {
+        report = &reportCmd->attrList[reportCmd->numAttr++];
+        report->attrID = zclSensor_Reportable[j].attrId;
+        report->dataType = zclSensor_Reportable[j].dataType;
+        report->attrData = zclSensor_Reportable[j].value;
+        sent |= BV( j );
+      }
+    }
+    due &= ~sent;
+
+    if ( zcl_SendReportCmd( GENERICAPP_ZCL_ENDPOINT, &zclSensor_DstAddr, clusterId,
+                            reportCmd, ZCL_FRAME_SERVER_CLIENT_DIR, TRUE,
+                            zclSensor_SeqNum++ ) != ZSuccess )
+    {
+      continue;
+    }
+
+    for ( j = i; j < ZCLSENSOR_REPORTED_ATTRS; j++ )
+    {
+      if ( sent & BV( j ) )
+      {
+        zclSensor_Reported[j] = zclSensor_Level[j];
+        zclSensor_ReportTime[j] = now;
+      }
+    }
+    zclSensor_HasReported |= sent;
+  }
+
+  osal_mem_free( reportCmd );
+}
+
+/*********************************************************************
+ * @fn      zclSensor_ConfigReport
+ *
+ * @brief   Applies a Configure Reporting command and answers it. Only
+ *          the records that failed are listed in the response, or a
+ *          single success status if none did.
+ *
+ * @param   msg - ZCL_INCOMING_MSG holding the parsed command
+ *
+ * @return  none
+ */
+static void zclSensor_ConfigReport( zclIncomingMsg_t *msg )
+{
+  zclCfgReportCmd_t *cfgReportCmd = (zclCfgReportCmd_t *)msg->attrCmd;
+  zclCfgReportRspCmd_t *rspCmd;
+  zclCfgReportStatus_t *status;
+  uint8 changed = FALSE;
+  uint8 result;
+  uint8 i;
+
+  if ( cfgReportCmd == NULL )
+  {
+    return;
+  }
+
+  rspCmd = (zclCfgReportRspCmd_t *)osal_mem_alloc( sizeof( zclCfgReportRspCmd_t )
+                          + (cfgReportCmd->numAttr + 1) * sizeof( zclCfgReportStatus_t ) );
+  if ( rspCmd == NULL )
+  {
+    return;
+  }
+  rspCmd->numAttr = 0;
+
+  for ( i = 0; i < cfgReportCmd->numAttr; i++ )
+  {
+    result = zclSensor_Configure( msg->clusterId, &cfgReportCmd->attrList[i] );
+    if ( result == ZCL_STATUS_SUCCESS )
+    {
+      changed = TRUE;
+    }
+    else
+    {
+      status = &rspCmd->attrList[rspCmd->numAttr++];
+      status->status = result;
+      status->direction = cfgReportCmd->attrList[i].direction;
+      status->attrID = cfgReportCmd->attrList[i].attrID;
+    }
+  }
+
+  if ( rspCmd->numAttr == 0 )
+  {
+    rspCmd->numAttr = 1;
+    rspCmd->attrList[0].status = ZCL_STATUS_SUCCESS;
+    rspCmd->attrList[0].direction = ZCL_SEND_ATTR_REPORTS;
+    rspCmd->attrList[0].attrID = 0;
+  }
+
+  if ( changed )
+  {
+    zclSensor_SaveCfg();
+  }
+
+  zcl_SendConfigReportRspCmd( GENERICAPP_ZCL_ENDPOINT, &msg->srcAddr, msg->clusterId,
+                              rspCmd, ZCL_FRAME_SERVER_CLIENT_DIR, TRUE,
+                              msg->zclHdr.transSeqNum );
+  osal_mem_free( rspCmd );
+}
+
+/*********************************************************************
+ * @fn      zclSensor_Configure
+ *
+ * @brief   Applies one record of a Configure Reporting command.
+ *
+ * @param   clusterId - cluster of the command
+ * @param   rec       - record
+ *
+ * @return  ZCL status of the record
+ */
+static uint8 zclSensor_Configure( uint16 clusterId, zclCfgReportRec_t *rec )
+{
+  zclSensorReportCfg_t *cfg;
+  float change;
+  uint8 i;
+
+  for ( i = 0; i < ZCLSENSOR_REPORTED_ATTRS; i++ )
+  {
+    if ( (zclSensor_Reportable[i].clusterId == clusterId)
+        && (zclSensor_Reportable[i].attrId == rec->attrID) )
+    {
+      break;
+    }
+  }
+  if ( (i == ZCLSENSOR_REPORTED_ATTRS) || (rec->direction != ZCL_SEND_ATTR_REPORTS) )
+  {
+    return ZCL_STATUS_UNREPORTABLE_ATTRIBUTE;
+  }
+  if ( rec->dataType != zclSensor_Reportable[i].dataType )
+  {
+    return ZCL_STATUS_INVALID_DATA_TYPE;
+  }
+  if ( (rec->maxReportInt != 0) && (rec->maxReportInt != ZCLSENSOR_NO_REPORTS)
+      && (rec->maxReportInt < rec->minReportInt) )
+  {
+    return ZCL_STATUS_INVALID_VALUE;
+  }
+
+  cfg = &zclSensor_Cfg[i];
+  cfg->minInterval = rec->minReportInt;
+  cfg->maxInterval = rec->maxReportInt;
+
+  if ( rec->reportableChange != NULL )
+  {
+    if ( rec->dataType == ZCL_DATATYPE_SINGLE_PREC )
+    {
+      osal_memcpy( &change, rec->reportableChange, sizeof( change ) );
+      cfg->change = ( change >= 65535.0f ) ? 0xFFFF
+                    : ( change > 0.0f ) ? (uint16)change : 0;
+    }
+    else
+    {
+      cfg->change = *(uint16 *)rec->reportableChange;
+    }
+  }
+
+  return ZCL_STATUS_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zclSensor_SaveCfg
+ *
+ * @brief   Writes the reporting configuration to NV.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void zclSensor_SaveCfg( void )
+{
+  osal_nv_write( zclSensor_NvId, 0, sizeof( zclSensor_Cfg ), zclSensor_Cfg );
+}
+
+/*********************************************************************
+*********************************************************************/
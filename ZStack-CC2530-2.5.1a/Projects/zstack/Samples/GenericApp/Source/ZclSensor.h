@@ -0,0 +1,99 @@
+/**************************************************************************************************
+  Filename:       ZclSensor.h
+
+  Description:    Home Automation endpoint of the sensor node, serving the
+                  ZCL measurement clusters with attribute reporting.
+
+  The endpoint GENERICAPP_ZCL_ENDPOINT serves:
+
+      Temperature Measurement   MeasuredValue     int16,  0.01 degrees C
+      Relative Humidity         MeasuredValue     uint16, 0.01 %RH
+      Illuminance Measurement   MeasuredValue     uint16, SensorAdc reading
+      Analog Input (Basic)      PresentValue      single, SensorAdc reading of the gas sensor
+      Occupancy Sensing         Occupancy         bitmap8, PIR
+
+  The illuminance is the raw light sensor reading rather than the
+  logarithmic lux scale of the ZCL, since the sensor is not calibrated.
+  The ZCL has no gas cluster; the gas reading is an Analog Input.
+
+  Each of these attributes is reported to the coordinator on its own
+  minimum interval, maximum interval and reportable change, which a
+  Configure Reporting command can change; they are kept in NV. The
+  attributes are checked whenever ZclSensor_Update() is called, so the
+  intervals are only as precise as the sampling. A Report Attributes
+  frame holds one cluster, so the attributes due in each cluster go out
+  in one frame per cluster.
+**************************************************************************************************/
+
+#ifndef ZCLSENSOR_H
+#define ZCLSENSOR_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "ZComDef.h"
+#include "zcl.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Reported attributes. The first four are in the order of the samples
+// passed to ZclSensor_Update().
+#define ZCLSENSOR_TEMPERATURE         0
+#define ZCLSENSOR_HUMIDITY            1
+#define ZCLSENSOR_LIGHT               2
+#define ZCLSENSOR_GAS                 3
+#define ZCLSENSOR_OCCUPANCY           4
+#define ZCLSENSOR_REPORTED_ATTRS      5
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Registers the endpoint and its attributes, and restores the reporting
+ * configuration from the NV item given, creating it on first use. ZCL
+ * foundation messages are passed to taskId as ZCL_INCOMING_MSG.
+ */
+extern void ZclSensor_Init( uint8 taskId, uint16 nvId );
+
+/*
+ * Sets the attributes from a sample and reports those that are due.
+ * sample holds the temperature (0.01 degrees C, as an int16), humidity
+ * (0.01 %RH), light and gas (SensorAdc readings); pir is 1 when motion
+ * is detected. If force is TRUE, every attribute is reported.
+ */
+extern void ZclSensor_Update( uint16 *sample, uint8 pir, uint8 force );
+
+/*
+ * Handles a ZCL_INCOMING_MSG: answers Configure Reporting commands.
+ * Frees the parsed command, but not the message.
+ */
+extern void ZclSensor_ProcessMsg( zclIncomingMsg_t *msg );
+
+/*
+ * Sets the maximum reporting interval of every attribute, in seconds.
+ */
+extern void ZclSensor_SetMaxInterval( uint16 seconds );
+
+/*
+ * Sets the reportable change of an attribute so that it is reported when
+ * it moves by more than deadband: degrees C, %RH or SensorAdc readings,
+ * as GENERICAPP_CMD_SET_DEADBAND gives it.
+ */
+extern void ZclSensor_SetDeadband( uint8 attr, uint16 deadband );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZCLSENSOR_H */
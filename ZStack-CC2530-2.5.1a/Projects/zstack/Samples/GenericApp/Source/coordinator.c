@@ -65,8 +65,17 @@
 #include "ZDApp.h"
 #include "ZDObject.h"
 #include "ZDProfile.h"
+#include "AddrMgr.h"
+
+#include "zcl.h"
+#include "zcl_general.h"
+#include "zcl_ms.h"
 
 #include "GenericApp.h"
+#include "GatewayLink.h"
+#include "SensorFrame.h"
+#include "DeviceDirectory.h"
+#include "SourceRoute.h"
 #include "DebugTrace.h"
 
 #if !defined( WIN32 )
@@ -92,10 +101,48 @@
  * CONSTANTS
  */
 
+// Gateway commands awaiting their AF data confirm
+#define GENERICAPP_MAX_PENDING_COMMANDS   4
+
+// Sensor reports are collected for up to GENERICAPP_REPORT_BATCH_WINDOW ms,
+// or until GENERICAPP_REPORT_BATCH_MAX_LEN bytes, and sent to the gateway
+// in one GATEWAYLINK_TYPE_REPORT_BATCH frame. The byte limit must hold a
+// record of SENSORFRAME_MAX_LEN and be at most GATEWAYLINK_MAX_DATA_LEN.
+#if !defined( GENERICAPP_REPORT_BATCH_WINDOW )
+  #define GENERICAPP_REPORT_BATCH_WINDOW    100
+#endif
+#if !defined( GENERICAPP_REPORT_BATCH_MAX_LEN )
+  #define GENERICAPP_REPORT_BATCH_MAX_LEN   GATEWAYLINK_MAX_DATA_LEN
+#endif
+
+// An IEEE_addr_req for a sender missing from the directory is not repeated
+// for GENERICAPP_IEEE_REQ_TIMEOUT ms while it is unanswered, whatever
+// sender the next unknown report comes from.
+#if !defined( GENERICAPP_IEEE_REQ_TIMEOUT )
+  #define GENERICAPP_IEEE_REQ_TIMEOUT       10000
+#endif
+
+#define GENERICAPP_ZCL_DEVICEID           0x0007  // HA Combined Interface, as in zcl_ha.h
+
+// Frame control, sequence number and command of a ZCL foundation command
+#define GENERICAPP_ZCL_HDR_LEN            3
+
+// MeasuredValue of a temperature or humidity that could not be measured
+#define GENERICAPP_ZCL_INVALID_INT16      ((int16)0x8000)
+#define GENERICAPP_ZCL_INVALID_UINT16     0xFFFF
+
 /*********************************************************************
  * TYPEDEFS
  */
 
+typedef struct
+{
+  uint8 inUse;
+  uint8 transID;  // AF transaction ID of the command sent to the end device
+  uint8 seq;      // Gateway link sequence number of the command
+  uint16 nwkAddr; // End device the command was sent to
+} pendingCommand_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -124,6 +171,33 @@ const SimpleDescriptionFormat_t GenericApp_SimpleDesc =
 // way it's defined in this sample app it is define in RAM.
 endPointDesc_t GenericApp_epDesc;
 
+// Measurement clusters whose attribute reports the end devices send to
+// GENERICAPP_ZCL_ENDPOINT; see ZclSensor.h.
+const cId_t GenericApp_ZclClusterList[] =
+{
+  ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT,
+  ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY,
+  ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT,
+  ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC,
+  ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING
+};
+
+const SimpleDescriptionFormat_t GenericApp_ZclSimpleDesc =
+{
+  GENERICAPP_ZCL_ENDPOINT,              //  int Endpoint;
+  GENERICAPP_ZCL_PROFID,                //  uint16 AppProfId[2];
+  GENERICAPP_ZCL_DEVICEID,              //  uint16 AppDeviceId[2];
+  GENERICAPP_DEVICE_VERSION,            //  int   AppDevVer:4;
+  GENERICAPP_FLAGS,                     //  int   AppFlags:4;
+  0,                                    //  byte  AppNumInClusters;
+  (cId_t *)NULL,                        //  byte *pAppInClusterList;
+  sizeof( GenericApp_ZclClusterList ) / sizeof( cId_t ),
+                                        //  byte  AppNumOutClusters;
+  (cId_t *)GenericApp_ZclClusterList    //  byte *pAppOutClusterList;
+};
+
+endPointDesc_t GenericApp_ZclEpDesc;
+
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -145,6 +219,19 @@ byte GenericApp_TransID;  // This is the unique message ID (counter)
 
 afAddrType_t GenericApp_DstAddr;
 
+static pendingCommand_t GenericApp_PendingCommands[GENERICAPP_MAX_PENDING_COMMANDS];
+
+// Sequence number of the next sensor report frame sent to the gateway
+static uint8 GenericApp_ReportLinkSeq = 0;
+
+// Records of the report batch being collected
+static uint8 GenericApp_ReportBatch[GENERICAPP_REPORT_BATCH_MAX_LEN];
+static uint8 GenericApp_ReportBatchLen = 0;
+
+// NWK address of the IEEE_addr_req awaiting a response, and when it was sent
+static uint16 GenericApp_IeeeReqAddr = INVALID_NODE_ADDR;
+static uint32 GenericApp_IeeeReqTime;
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -152,6 +239,17 @@ static void GenericApp_ProcessZDOMsgs( zdoIncomingMsg_t *inMsg );
 static void GenericApp_HandleKeys( byte shift, byte keys );
 static void GenericApp_MessageMSGCB( afIncomingMSGPacket_t *pckt );
 static void GenericApp_SendTheMessage( void );
+static void GenericApp_ProcessGatewayFrame( gatewayLinkFrame_t *frame );
+static void GenericApp_CommandConfirm( uint8 transID, uint8 status );
+static void GenericApp_SendCommandAck( uint8 seq, uint16 nwkAddr, uint8 status );
+static void GenericApp_ForwardSensorReport( afIncomingMSGPacket_t *pkt );
+static void GenericApp_ForwardZclReport( afIncomingMSGPacket_t *pkt );
+static void GenericApp_AddReportRecord( afIncomingMSGPacket_t *pkt, uint8 index,
+                                        uint8 *report, uint8 len );
+static void GenericApp_FlushReports( void );
+static uint8 GenericApp_DeviceIndex( uint16 nwkAddr );
+static uint8 GenericApp_AddDevice( uint16 nwkAddr, uint8 *extAddr );
+static void GenericApp_SendRouteStats( void );
 
 #if defined( IAR_ARMCM3_LM )
 static void GenericApp_ProcessRtosMessage( void );
@@ -193,11 +291,14 @@ void GenericApp_Init( uint8 task_id )
   GenericApp_DstAddr.endPoint = GENERICAPP_ENDPOINT;
   GenericApp_DstAddr.addr.shortAddr = 0xFFFF;
   
-    halUARTCfg_t uartConfig;//Ҽӵģһڽṹ塣
-  uartConfig.configured = TRUE;
-  uartConfig.baudRate = HAL_UART_BR_9600;
-  uartConfig.flowControl = FALSE;
-  HalUARTOpen (0,&uartConfig);
+  // Commands from the gateway arrive as GATEWAYLINK_FRAME_IND messages.
+  GatewayLink_Init( GenericApp_TaskID );
+
+  // Devices keep the index they had before a restart.
+  DeviceDirectory_Init( GENERICAPP_NV_DEVICE_DIR );
+
+  // Commands go out on the source routes that the devices record.
+  SourceRoute_Init( GenericApp_TaskID, GENERICAPP_MTO_ROUTE_EVT );
 
   // Fill out the endpoint description.
   GenericApp_epDesc.endPoint = GENERICAPP_ENDPOINT;
@@ -209,6 +310,14 @@ void GenericApp_Init( uint8 task_id )
   // Register the endpoint description with the AF
   afRegister( &GenericApp_epDesc );
 
+  // ZCL attribute reports of the end devices arrive on their own endpoint.
+  GenericApp_ZclEpDesc.endPoint = GENERICAPP_ZCL_ENDPOINT;
+  GenericApp_ZclEpDesc.task_id = &GenericApp_TaskID;
+  GenericApp_ZclEpDesc.simpleDesc
+            = (SimpleDescriptionFormat_t *)&GenericApp_ZclSimpleDesc;
+  GenericApp_ZclEpDesc.latencyReq = noLatencyReqs;
+  afRegister( &GenericApp_ZclEpDesc );
+
   // Register for all key events - This app will handle all key events
   RegisterForKeys( GenericApp_TaskID );
 
@@ -219,6 +328,8 @@ void GenericApp_Init( uint8 task_id )
 
   ZDO_RegisterForZDOMsg( GenericApp_TaskID, End_Device_Bind_rsp );
   ZDO_RegisterForZDOMsg( GenericApp_TaskID, Match_Desc_rsp );
+  ZDO_RegisterForZDOMsg( GenericApp_TaskID, Device_annce );
+  ZDO_RegisterForZDOMsg( GenericApp_TaskID, IEEE_addr_rsp );
 
 #if defined( IAR_ARMCM3_LM )
   // Register this task with RTOS task initiator
@@ -274,13 +385,13 @@ uint16 GenericApp_ProcessEvent( uint8 task_id, uint16 events )
           sentStatus = afDataConfirm->hdr.status;
           sentTransID = afDataConfirm->transID;
           (void)sentEP;
-          (void)sentTransID;
 
-          // Action taken when confirmation is received.
-          if ( sentStatus != ZSuccess )
-          {
-            // The data wasn't delivered -- Do something
-          }
+          // Report the outcome of gateway commands back to the gateway.
+          GenericApp_CommandConfirm( sentTransID, sentStatus );
+          break;
+
+        case GATEWAYLINK_FRAME_IND:
+          GenericApp_ProcessGatewayFrame( (gatewayLinkFrame_t *)MSGpkt );
           break;
 
         case AF_INCOMING_MSG_CMD:
@@ -331,6 +442,25 @@ uint16 GenericApp_ProcessEvent( uint8 task_id, uint16 events )
     return (events ^ GENERICAPP_SEND_MSG_EVT);
   }
 
+  // The report batch window has elapsed
+  if ( events & GENERICAPP_FLUSH_REPORTS_EVT )
+  {
+    GenericApp_FlushReports();
+
+    // return unprocessed events
+    return (events ^ GENERICAPP_FLUSH_REPORTS_EVT);
+  }
+
+  // Time for a many-to-one route request
+  if ( events & GENERICAPP_MTO_ROUTE_EVT )
+  {
+    SourceRoute_ProcessEvent();
+    GenericApp_SendRouteStats();
+
+    // return unprocessed events
+    return (events ^ GENERICAPP_MTO_ROUTE_EVT);
+  }
+
   
 #if defined( IAR_ARMCM3_LM )
   // Receive a message from the RTOS queue
@@ -399,6 +529,29 @@ static void GenericApp_ProcessZDOMsgs( zdoIncomingMsg_t *inMsg )
         }
       }
       break;
+
+    case Device_annce:
+      {
+        ZDO_DeviceAnnce_t annce;
+
+        ZDO_ParseDeviceAnnce( inMsg, &annce );
+        GenericApp_AddDevice( annce.nwkAddr, annce.extAddr );
+      }
+      break;
+
+    case IEEE_addr_rsp:
+      {
+        ZDO_NwkIEEEAddrResp_t *pRsp = ZDO_ParseAddrRsp( inMsg );
+        if ( pRsp )
+        {
+          if ( pRsp->status == ZSuccess )
+          {
+            GenericApp_AddDevice( pRsp->nwkAddr, pRsp->extAddr );
+          }
+          osal_mem_free( pRsp );
+        }
+      }
+      break;
   }
 }
 
@@ -502,38 +655,42 @@ static void GenericApp_HandleKeys( uint8 shift, uint8 keys )
 static void GenericApp_MessageMSGCB( afIncomingMSGPacket_t *pkt )
 {
   unsigned char str_uart[5];
+
+  if ( pkt->endPoint == GENERICAPP_ZCL_ENDPOINT )
+  {
+    GenericApp_ForwardZclReport( pkt );
+    return;
+  }
   
   switch ( pkt->clusterId )
   {
       case GenericApp_GAN_CLUSTERID:
         str_uart[0] = 'y';
         osal_memcpy(&str_uart[1],pkt->cmd.Data,4);
-        HalUARTWrite(0, str_uart, 5);
+        GatewayLink_SendRaw(str_uart, 5);
       break;
       
       case GenericApp_Guangqiang_CLUSTERID:
         str_uart[0] = 'g';
         osal_memcpy(&str_uart[1],pkt->cmd.Data,3);
-        HalUARTWrite(0, str_uart, 4);
+        GatewayLink_SendRaw(str_uart, 4);
       break;
         
       case GenericApp_rentihongwai_CLUSTERID:
         str_uart[0] = 'r';
         osal_memcpy(&str_uart[1],pkt->cmd.Data,2);
-        HalUARTWrite(0, str_uart, 3);
+        GatewayLink_SendRaw(str_uart, 3);
         break;
         
       case GenericApp_wendu_CLUSTERID:
         str_uart[0] = 'w';
         osal_memcpy(&str_uart[1],pkt->cmd.Data,3);
-        HalUARTWrite(0, str_uart, 4);
-        HalUARTWrite(0, "\n", 1);
+        str_uart[4] = '\n';
+        GatewayLink_SendRaw(str_uart, 5);
       break;
       
-     case GenericApp_Sensor_CLUSTERID:        
-        HalUARTWrite(0, pkt->cmd.Data, pkt->cmd.DataLength);
-        uint16 i = 0;
-        for(i=0;i<60000;i++)
+     case GenericApp_Sensor_CLUSTERID:
+        GenericApp_ForwardSensorReport( pkt );
       break;
   }
    
@@ -567,6 +724,468 @@ static void GenericApp_SendTheMessage( void )
   }*/
 }
 
+/*********************************************************************
+ * @fn      GenericApp_ProcessGatewayFrame
+ *
+ * @brief   Forwards a command frame from the gateway to its end device,
+ *          on its source route if one is known. The gateway is
+ *          acknowledged when the AF data confirm for the command arrives,
+ *          or at once if the command cannot be sent.
+ *
+ * @param   frame - frame received from the gateway
+ *
+ * @return  none
+ */
+static void GenericApp_ProcessGatewayFrame( gatewayLinkFrame_t *frame )
+{
+  afAddrType_t dstAddr;
+  uint8 transID;
+  uint8 i;
+
+  if ( frame->type != GATEWAYLINK_TYPE_COMMAND )
+  {
+    return;
+  }
+  if ( frame->len < 3 )
+  {
+    // No destination to report; the gateway times the command out.
+    GenericApp_SendCommandAck( frame->seq, INVALID_NODE_ADDR, ZInvalidParameter );
+    return;
+  }
+  dstAddr.addrMode = (afAddrMode_t)Addr16Bit;
+  dstAddr.addr.shortAddr = BUILD_UINT16( frame->data[0], frame->data[1] );
+  dstAddr.endPoint = GENERICAPP_ENDPOINT;
+
+  for ( i = 0; i < GENERICAPP_MAX_PENDING_COMMANDS; i++ )
+  {
+    if ( !GenericApp_PendingCommands[i].inUse )
+    {
+      break;
+    }
+  }
+  if ( i == GENERICAPP_MAX_PENDING_COMMANDS )
+  {
+    GenericApp_SendCommandAck( frame->seq, dstAddr.addr.shortAddr, ZBufferFull );
+    return;
+  }
+
+  // AF_DataRequest() uses the current transaction ID, then increments it.
+  transID = GenericApp_TransID;
+  if ( SourceRoute_DataRequest( &dstAddr, &GenericApp_epDesc,
+                                GENERICAPP_COMMAND_CLUSTERID,
+                                frame->len - 2,
+                                &frame->data[2],
+                                &GenericApp_TransID,
+                                AF_ACK_REQUEST | AF_DISCV_ROUTE,
+                                AF_DEFAULT_RADIUS ) == afStatus_SUCCESS )
+  {
+    GenericApp_PendingCommands[i].inUse = TRUE;
+    GenericApp_PendingCommands[i].transID = transID;
+    GenericApp_PendingCommands[i].seq = frame->seq;
+    GenericApp_PendingCommands[i].nwkAddr = dstAddr.addr.shortAddr;
+  }
+  else
+  {
+    GenericApp_SendCommandAck( frame->seq, dstAddr.addr.shortAddr, ZFailure );
+  }
+}
+
+/*********************************************************************
+ * @fn      GenericApp_CommandConfirm
+ *
+ * @brief   Acknowledges the gateway command sent with the given AF
+ *          transaction ID, if any. A command that was not delivered
+ *          drops the source route of its end device.
+ *
+ * @param   transID - transaction ID of the AF data confirm
+ * @param   status  - delivery status of the AF data confirm
+ *
+ * @return  none
+ */
+static void GenericApp_CommandConfirm( uint8 transID, uint8 status )
+{
+  uint8 i;
+
+  for ( i = 0; i < GENERICAPP_MAX_PENDING_COMMANDS; i++ )
+  {
+    if ( GenericApp_PendingCommands[i].inUse
+        && (GenericApp_PendingCommands[i].transID == transID) )
+    {
+      GenericApp_PendingCommands[i].inUse = FALSE;
+      if ( status != ZSuccess )
+      {
+        SourceRoute_DeliveryFailed( GenericApp_PendingCommands[i].nwkAddr );
+      }
+      GenericApp_SendCommandAck( GenericApp_PendingCommands[i].seq,
+                                 GenericApp_PendingCommands[i].nwkAddr, status );
+      break;
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      GenericApp_SendCommandAck
+ *
+ * @brief   Sends a command acknowledgement frame to the gateway. If the
+ *          UART cannot take it, the gateway times the command out and
+ *          resends it.
+ *
+ * @param   seq     - gateway link sequence number of the command
+ * @param   nwkAddr - destination of the command
+ * @param   status  - ZSuccess if the end device acknowledged the command
+ *
+ * @return  none
+ */
+static void GenericApp_SendCommandAck( uint8 seq, uint16 nwkAddr, uint8 status )
+{
+  uint8 data[3];
+
+  data[0] = status;
+  data[1] = LO_UINT16( nwkAddr );
+  data[2] = HI_UINT16( nwkAddr );
+  GatewayLink_SendFrame( GATEWAYLINK_TYPE_COMMAND_ACK, seq, data, sizeof( data ) );
+}
+
+/*********************************************************************
+ * @fn      GenericApp_ForwardSensorReport
+ *
+ * @brief   Checks a sensor report and adds it to the batch for the
+ *          gateway. ASCII reports of end devices predating
+ *          SensorFrame.h are added as they are.
+ *
+ * @param   pkt - received sensor report
+ *
+ * @return  none
+ */
+static void GenericApp_ForwardSensorReport( afIncomingMSGPacket_t *pkt )
+{
+  if ( !((pkt->cmd.DataLength == SENSORFRAME_LEGACY_LEN)
+         && (pkt->cmd.Data[0] == SENSORFRAME_LEGACY_START))
+      && ((pkt->cmd.DataLength > SENSORFRAME_MAX_LEN)
+          || !SensorFrame_Check( pkt->cmd.Data, (uint8)pkt->cmd.DataLength )) )
+  {
+    return;
+  }
+
+  GenericApp_AddReportRecord( pkt, GenericApp_DeviceIndex( pkt->srcAddr.addr.shortAddr ),
+                              pkt->cmd.Data, (uint8)pkt->cmd.DataLength );
+}
+
+/*********************************************************************
+ * @fn      GenericApp_ForwardZclReport
+ *
+ * @brief   Translates a ZCL Report Attributes command from the
+ *          measurement clusters of an end device into a sensor report
+ *          (see SensorFrame.h) and adds it to the batch for the gateway,
+ *          which thus gets the same reports from ZCL end devices as
+ *          from the others. The ZCL sequence number becomes the report
+ *          sequence number and the device index its device ID.
+ *          Temperature and humidity keep the 0.01 resolution of the
+ *          ZCL in their own TLV types.
+ *          Attributes without a TLV type, and anything after an
+ *          attribute of an unexpected data type, are skipped.
+ *
+ * @param   pkt - received ZCL command
+ *
+ * @return  none
+ */
+static void GenericApp_ForwardZclReport( afIncomingMSGPacket_t *pkt )
+{
+  uint8 buf[SENSORFRAME_MAX_LEN];
+  sensorFrame_t frame;
+  uint8 *data = pkt->cmd.Data;
+  uint8 *end = pkt->cmd.Data + pkt->cmd.DataLength;
+  uint16 attrId;
+  uint16 value;
+  uint8 dataType;
+  uint8 valueLen;
+  uint8 added = FALSE;
+  uint8 index;
+  uint8 len;
+  float level;
+
+  // A foundation command without a manufacturer code
+  if ( (pkt->cmd.DataLength < GENERICAPP_ZCL_HDR_LEN)
+      || ((data[0] & (ZCL_FRAME_CONTROL_TYPE | ZCL_FRAME_CONTROL_MANU_SPECIFIC))
+          != ZCL_FRAME_TYPE_PROFILE_CMD)
+      || (data[2] != ZCL_CMD_REPORT) )
+  {
+    return;
+  }
+
+  index = GenericApp_DeviceIndex( pkt->srcAddr.addr.shortAddr );
+  SensorFrame_Begin( &frame, buf, sizeof( buf ), data[1], index );
+  data += GENERICAPP_ZCL_HDR_LEN;
+
+  // Attribute ID (2), data type, value
+  while ( end - data >= 3 )
+  {
+    attrId = BUILD_UINT16( data[0], data[1] );
+    dataType = data[2];
+    data += 3;
+
+    switch ( dataType )
+    {
+      case ZCL_DATATYPE_BITMAP8:
+        valueLen = 1;
+        break;
+      case ZCL_DATATYPE_INT16:
+      case ZCL_DATATYPE_UINT16:
+        valueLen = 2;
+        break;
+      case ZCL_DATATYPE_SINGLE_PREC:
+        valueLen = 4;
+        break;
+      default:
+        valueLen = 0;
+        break;
+    }
+    if ( (valueLen == 0) || (end - data < valueLen) )
+    {
+      break;
+    }
+    value = ( valueLen == 1 ) ? data[0] : BUILD_UINT16( data[0], data[1] );
+
+    switch ( pkt->clusterId )
+    {
+      case ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT:
+        if ( (attrId == ATTRID_MS_TEMPERATURE_MEASURED_VALUE)
+            && (dataType == ZCL_DATATYPE_INT16)
+            && ((int16)value != GENERICAPP_ZCL_INVALID_INT16) )
+        {
+          added |= SensorFrame_AddUint16( &frame, SENSORFRAME_TLV_TEMPERATURE_CENTI, value );
+        }
+        break;
+
+      case ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY:
+        if ( (attrId == ATTRID_MS_RELATIVE_HUMIDITY_MEASURED_VALUE)
+            && (dataType == ZCL_DATATYPE_UINT16)
+            && (value != GENERICAPP_ZCL_INVALID_UINT16) )
+        {
+          added |= SensorFrame_AddUint16( &frame, SENSORFRAME_TLV_HUMIDITY_CENTI, value );
+        }
+        break;
+
+      case ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT:
+        if ( (attrId == ATTRID_MS_ILLUMINANCE_MEASURED_VALUE)
+            && (dataType == ZCL_DATATYPE_UINT16) )
+        {
+          added |= SensorFrame_AddUint16( &frame, SENSORFRAME_TLV_LIGHT, value );
+        }
+        break;
+
+      case ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC:
+        if ( (attrId == ATTRID_IOV_BASIC_PRESENT_VALUE)
+            && (dataType == ZCL_DATATYPE_SINGLE_PREC) )
+        {
+          // Little-endian IEEE 754, as the compiler stores a float
+          osal_memcpy( &level, data, sizeof( level ) );
+          value = ( level >= 65535.0f ) ? 0xFFFF
+                  : ( level > 0.0f ) ? (uint16)level : 0;
+          added |= SensorFrame_AddUint16( &frame, SENSORFRAME_TLV_GAS, value );
+        }
+        break;
+
+      case ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING:
+        if ( (attrId == ATTRID_MS_OCCUPANCY_SENSING_CONFIG_OCCUPANCY)
+            && (dataType == ZCL_DATATYPE_BITMAP8) )
+        {
+          added |= SensorFrame_AddUint8( &frame, SENSORFRAME_TLV_PIR, (uint8)(value & 0x01) );
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    data += valueLen;
+  }
+
+  len = SensorFrame_End( &frame );
+  if ( added && (len != 0) )
+  {
+    GenericApp_AddReportRecord( pkt, index, buf, len );
+  }
+}
+
+/*********************************************************************
+ * @fn      GenericApp_AddReportRecord
+ *
+ * @brief   Adds a sensor report to the batch for the gateway, with the
+ *          NWK address and link quality of its sender and the device
+ *          index.
+ *
+ * @param   pkt    - received message holding the report
+ * @param   index  - device index of the sender
+ * @param   report - report to forward
+ * @param   len    - length of the report, at most SENSORFRAME_MAX_LEN
+ *
+ * @return  none
+ */
+static void GenericApp_AddReportRecord( afIncomingMSGPacket_t *pkt, uint8 index,
+                                        uint8 *report, uint8 len )
+{
+  uint8 *record;
+
+  if ( GenericApp_ReportBatchLen + GATEWAYLINK_BATCH_RECORD_HDR_LEN + len
+       > GENERICAPP_REPORT_BATCH_MAX_LEN )
+  {
+    GenericApp_FlushReports();
+  }
+  if ( GenericApp_ReportBatchLen == 0 )
+  {
+    osal_start_timerEx( GenericApp_TaskID, GENERICAPP_FLUSH_REPORTS_EVT,
+                        GENERICAPP_REPORT_BATCH_WINDOW );
+  }
+
+  record = &GenericApp_ReportBatch[GenericApp_ReportBatchLen];
+  record[0] = LO_UINT16( pkt->srcAddr.addr.shortAddr );
+  record[1] = HI_UINT16( pkt->srcAddr.addr.shortAddr );
+  record[2] = index;
+  record[3] = pkt->LinkQuality;
+  record[4] = len;
+  osal_memcpy( &record[GATEWAYLINK_BATCH_RECORD_HDR_LEN], report, len );
+  GenericApp_ReportBatchLen += GATEWAYLINK_BATCH_RECORD_HDR_LEN + len;
+
+  // Not even the smallest report would fit any more; send now.
+  if ( GenericApp_ReportBatchLen + GATEWAYLINK_BATCH_RECORD_HDR_LEN
+       + SENSORFRAME_HDR_LEN + SENSORFRAME_CRC_LEN > GENERICAPP_REPORT_BATCH_MAX_LEN )
+  {
+    GenericApp_FlushReports();
+  }
+}
+
+/*********************************************************************
+ * @fn      GenericApp_FlushReports
+ *
+ * @brief   Sends the collected report batch to the gateway.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void GenericApp_FlushReports( void )
+{
+  if ( GenericApp_ReportBatchLen == 0 )
+  {
+    return;
+  }
+
+  osal_stop_timerEx( GenericApp_TaskID, GENERICAPP_FLUSH_REPORTS_EVT );
+  GatewayLink_SendFrame( GATEWAYLINK_TYPE_REPORT_BATCH, GenericApp_ReportLinkSeq++,
+                         GenericApp_ReportBatch, GenericApp_ReportBatchLen );
+  GenericApp_ReportBatchLen = 0;
+}
+
+/*********************************************************************
+ * @fn      GenericApp_DeviceIndex
+ *
+ * @brief   Returns the directory index of the sender of a report. A
+ *          sender missing from the directory, such as one that joined
+ *          before it was kept, is added from the address manager if the
+ *          stack knows its IEEE address, or else asked for it. One
+ *          request is outstanding at a time, so that a stream of reports
+ *          from unknown senders does not flood the network with them.
+ *
+ * @param   nwkAddr - NWK address of the sender
+ *
+ * @return  index of the sender, or DEVDIR_INVALID_INDEX
+ */
+static uint8 GenericApp_DeviceIndex( uint16 nwkAddr )
+{
+  uint8 extAddr[Z_EXTADDR_LEN];
+  uint8 index;
+
+  index = DeviceDirectory_Lookup( nwkAddr );
+  if ( index == DEVDIR_INVALID_INDEX )
+  {
+    if ( AddrMgrExtAddrLookup( nwkAddr, extAddr ) )
+    {
+      index = GenericApp_AddDevice( nwkAddr, extAddr );
+    }
+    else if ( (GenericApp_IeeeReqAddr == INVALID_NODE_ADDR) ||
+              (osal_GetSystemClock() - GenericApp_IeeeReqTime >= GENERICAPP_IEEE_REQ_TIMEOUT) )
+    {
+      if ( ZDP_IEEEAddrReq( nwkAddr, ZDP_ADDR_REQTYPE_SINGLE, 0, FALSE ) == afStatus_SUCCESS )
+      {
+        GenericApp_IeeeReqAddr = nwkAddr;
+        GenericApp_IeeeReqTime = osal_GetSystemClock();
+      }
+    }
+  }
+
+  return index;
+}
+
+/*********************************************************************
+ * @fn      GenericApp_AddDevice
+ *
+ * @brief   Records the addresses of a device in the directory and,
+ *          if its entry changed, tells the gateway which device the
+ *          index stands for. Devices announce themselves again on every
+ *          rejoin, which mostly changes nothing.
+ *
+ * @param   nwkAddr - NWK address of the device
+ * @param   extAddr - IEEE address of the device
+ *
+ * @return  index of the device, or DEVDIR_INVALID_INDEX if the
+ *          directory is full
+ */
+static uint8 GenericApp_AddDevice( uint16 nwkAddr, uint8 *extAddr )
+{
+  uint8 entry[1 + 2 + Z_EXTADDR_LEN];
+  uint8 index;
+  bool changed;
+
+  if ( nwkAddr == GenericApp_IeeeReqAddr )
+  {
+    GenericApp_IeeeReqAddr = INVALID_NODE_ADDR;
+  }
+
+  index = DeviceDirectory_Update( nwkAddr, extAddr, &changed );
+  if ( changed )
+  {
+    entry[0] = index;
+    entry[1] = LO_UINT16( nwkAddr );
+    entry[2] = HI_UINT16( nwkAddr );
+    osal_memcpy( &entry[3], extAddr, Z_EXTADDR_LEN );
+    GatewayLink_SendFrame( GATEWAYLINK_TYPE_DEVICE_ENTRY, 0, entry, sizeof( entry ) );
+  }
+
+  return index;
+}
+
+/*********************************************************************
+ * @fn      GenericApp_SendRouteStats
+ *
+ * @brief   Sends the routing counters to the gateway, once per
+ *          many-to-one route request.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void GenericApp_SendRouteStats( void )
+{
+  uint8 stats[GATEWAYLINK_ROUTE_STATS_LEN];
+  uint16 counters[GATEWAYLINK_ROUTE_STATS_LEN / 2];
+  uint8 i;
+
+  counters[0] = SourceRoute_Stats.mtoRequests;
+  counters[1] = SourceRoute_Stats.routeRecords;
+  counters[2] = SourceRoute_Stats.cached;
+  counters[3] = SourceRoute_Stats.stackCached;
+  counters[4] = SourceRoute_Stats.discovered;
+  counters[5] = SourceRoute_Stats.failed;
+  for ( i = 0; i < GATEWAYLINK_ROUTE_STATS_LEN / 2; i++ )
+  {
+    stats[2 * i] = LO_UINT16( counters[i] );
+    stats[2 * i + 1] = HI_UINT16( counters[i] );
+  }
+
+  GatewayLink_SendFrame( GATEWAYLINK_TYPE_ROUTE_STATS, 0, stats, sizeof( stats ) );
+}
+
 #if defined( IAR_ARMCM3_LM )
 /*********************************************************************
  * @fn      GenericApp_ProcessRtosMessage
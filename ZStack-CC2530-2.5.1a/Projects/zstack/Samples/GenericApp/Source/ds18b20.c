@@ -154,3 +154,288 @@ float floatReadDs18B20(void)
     
     return fValue;
 }
+
+/*********************************************************************
+ * Multi-drop driver; see ds18b20.h.
+ */
+
+// Function commands
+#define DS18B20_CONVERT_T         0x44
+#define DS18B20_READ_SCRATCHPAD   0xBE
+#define DS18B20_WRITE_SCRATCHPAD  0x4E
+
+// Scratchpad bytes
+#define DS18B20_TEMP_LSB          0
+#define DS18B20_TEMP_MSB          1
+#define DS18B20_ALARM_HIGH        2
+#define DS18B20_ALARM_LOW         3
+#define DS18B20_CONFIG            4
+
+// Configuration register: 0 R1 R0 1 1 1 1 1, with R1 R0 = 3 for 12 bits
+#define DS18B20_CONFIG_FIXED      0x1F
+#define DS18B20_CONFIG_12BIT      0x7F
+#define DS18B20_CONFIG_RES(cfg)   (((cfg) >> 5) & 0x03)
+
+// Driver states
+#define DS18B20_STATE_IDLE        0x00
+#define DS18B20_STATE_CONVERT     0x01    // waiting for the conversion
+#define DS18B20_STATE_READ        0x02    // reading one sensor per event
+
+static uint8 ds18b20_TaskID;
+static uint16 ds18b20_Event;
+static uint8 ds18b20_State = DS18B20_STATE_IDLE;
+static uint8 ds18b20_Count;
+static uint8 ds18b20_Next;
+static uint8 ds18b20_Roms[DS18B20_MAX_SENSORS][ONEWIRE_ROM_LEN];
+static ds18b20Sample_t ds18b20_Samples[DS18B20_MAX_SENSORS];
+
+static void ds18b20_Search( void );
+static void ds18b20_ReadSensor( uint8 index );
+static void ds18b20_Report( uint8 status );
+
+/*********************************************************************
+ * @fn      Ds18b20_Init
+ *
+ * @brief   Sets the task and event used by the driver and searches the
+ *          bus for sensors.
+ *
+ * @param   taskId - task receiving the event and DS18B20_READING_IND
+ * @param   event  - event reserved for the driver
+ *
+ * @return  number of sensors found
+ */
+uint8 Ds18b20_Init( uint8 taskId, uint16 event )
+{
+  ds18b20_TaskID = taskId;
+  ds18b20_Event = event;
+  ds18b20_State = DS18B20_STATE_IDLE;
+
+  OneWire_Init();
+  ds18b20_Search();
+  return ds18b20_Count;
+}
+
+/*********************************************************************
+ * @fn      Ds18b20_GetRom
+ *
+ * @brief   Returns the ROM code of a sensor, which identifies it across
+ *          restarts.
+ *
+ * @param   index - sensor, as in ds18b20Readings_t
+ *
+ * @return  ONEWIRE_ROM_LEN bytes, or NULL if there is no such sensor
+ */
+uint8 *Ds18b20_GetRom( uint8 index )
+{
+  return ( index < ds18b20_Count ) ? ds18b20_Roms[index] : NULL;
+}
+
+/*********************************************************************
+ * @fn      Ds18b20_Start
+ *
+ * @brief   Starts a conversion in all the sensors with one Skip ROM
+ *          command and returns. A bus on which nothing was found is
+ *          searched again first, so sensors can be plugged in later.
+ *
+ * @param   none
+ *
+ * @return  SUCCESS, or FAILURE if a cycle is in progress
+ */
+uint8 Ds18b20_Start( void )
+{
+  uint8 i;
+
+  if ( ds18b20_State != DS18B20_STATE_IDLE )
+  {
+    return FAILURE;
+  }
+
+  if ( ds18b20_Count == 0 )
+  {
+    ds18b20_Search();
+  }
+
+  if ( (ds18b20_Count == 0) || !OneWire_Select( NULL ) )
+  {
+    for ( i = 0; i < ds18b20_Count; i++ )
+    {
+      ds18b20_Samples[i].status = DS18B20_NO_RESPONSE;
+    }
+    ds18b20_Report( DS18B20_NO_RESPONSE );
+    return SUCCESS;
+  }
+
+  OneWire_WriteByte( DS18B20_CONVERT_T );
+  ds18b20_State = DS18B20_STATE_CONVERT;
+  osal_start_timerEx( ds18b20_TaskID, ds18b20_Event, DS18B20_CONVERT_MS );
+  return SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      Ds18b20_ProcessEvent
+ *
+ * @brief   Reads the next sensor once the conversion is over, and
+ *          reports when all have been read. Reading one sensor per
+ *          event keeps the busy-wait of each under DS18B20_READ_US.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void Ds18b20_ProcessEvent( void )
+{
+  switch ( ds18b20_State )
+  {
+    case DS18B20_STATE_CONVERT:
+      ds18b20_Next = 0;
+      ds18b20_State = DS18B20_STATE_READ;
+      osal_set_event( ds18b20_TaskID, ds18b20_Event );
+      break;
+
+    case DS18B20_STATE_READ:
+      ds18b20_ReadSensor( ds18b20_Next++ );
+      if ( ds18b20_Next < ds18b20_Count )
+      {
+        osal_set_event( ds18b20_TaskID, ds18b20_Event );
+      }
+      else
+      {
+        ds18b20_State = DS18B20_STATE_IDLE;
+        ds18b20_Report( DS18B20_SUCCESS );
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/*********************************************************************
+ * @fn      ds18b20_Search
+ *
+ * @brief   Finds the sensors on the bus, skipping other 1-Wire devices,
+ *          and sets each to 12-bit resolution. The setting stays in the
+ *          scratchpad, not the EEPROM, so the alarm thresholds that go
+ *          with it are written back unchanged.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void ds18b20_Search( void )
+{
+  uint8 pad[DS18B20_SCRATCHPAD_LEN];
+  uint8 found;
+  uint8 i;
+  uint8 j;
+
+  found = OneWire_Search( ds18b20_Roms[0], DS18B20_MAX_SENSORS );
+
+  ds18b20_Count = 0;
+  for ( i = 0; i < found; i++ )
+  {
+    if ( ds18b20_Roms[i][0] != DS18B20_FAMILY )
+    {
+      continue;
+    }
+    if ( i != ds18b20_Count )
+    {
+      osal_memcpy( ds18b20_Roms[ds18b20_Count], ds18b20_Roms[i], ONEWIRE_ROM_LEN );
+    }
+    ds18b20_Count++;
+  }
+
+  for ( i = 0; i < ds18b20_Count; i++ )
+  {
+    if ( !OneWire_Select( ds18b20_Roms[i] ) )
+    {
+      continue;
+    }
+    OneWire_WriteByte( DS18B20_READ_SCRATCHPAD );
+    for ( j = 0; j < DS18B20_SCRATCHPAD_LEN; j++ )
+    {
+      pad[j] = OneWire_ReadByte();
+    }
+    if ( (OneWire_Crc8( pad, DS18B20_SCRATCHPAD_LEN ) != 0)
+        || (pad[DS18B20_CONFIG] == DS18B20_CONFIG_12BIT) )
+    {
+      continue;
+    }
+
+    OneWire_Select( ds18b20_Roms[i] );
+    OneWire_WriteByte( DS18B20_WRITE_SCRATCHPAD );
+    OneWire_WriteByte( pad[DS18B20_ALARM_HIGH] );
+    OneWire_WriteByte( pad[DS18B20_ALARM_LOW] );
+    OneWire_WriteByte( DS18B20_CONFIG_12BIT );
+  }
+}
+
+/*********************************************************************
+ * @fn      ds18b20_ReadSensor
+ *
+ * @brief   Reads the scratchpad of a sensor and checks it: besides the
+ *          CRC-8, the fixed bits of the configuration register catch a
+ *          bus held low, whose zeros pass the CRC.
+ *
+ * @param   index - sensor
+ *
+ * @return  none
+ */
+static void ds18b20_ReadSensor( uint8 index )
+{
+  ds18b20Sample_t *sample = &ds18b20_Samples[index];
+  uint8 pad[DS18B20_SCRATCHPAD_LEN];
+  uint8 i;
+  int16 raw;
+
+  if ( !OneWire_Select( ds18b20_Roms[index] ) )
+  {
+    sample->status = DS18B20_NO_RESPONSE;
+    return;
+  }
+
+  OneWire_WriteByte( DS18B20_READ_SCRATCHPAD );
+  for ( i = 0; i < DS18B20_SCRATCHPAD_LEN; i++ )
+  {
+    pad[i] = OneWire_ReadByte();
+  }
+
+  if ( (OneWire_Crc8( pad, DS18B20_SCRATCHPAD_LEN ) != 0)
+      || ((pad[DS18B20_CONFIG] & DS18B20_CONFIG_FIXED) != DS18B20_CONFIG_FIXED) )
+  {
+    sample->status = DS18B20_BAD_CRC;
+    return;
+  }
+
+  // A sensor that lost power since the search is back at the resolution
+  // in its EEPROM, and the low bits it leaves undefined are cleared.
+  raw = (int16)(((uint16)pad[DS18B20_TEMP_MSB] << 8) | pad[DS18B20_TEMP_LSB]);
+  raw &= (int16)~((1 << (3 - DS18B20_CONFIG_RES( pad[DS18B20_CONFIG] ))) - 1);
+
+  sample->status = DS18B20_SUCCESS;
+  sample->temperature = raw;
+}
+
+/*********************************************************************
+ * @fn      ds18b20_Report
+ *
+ * @brief   Sends the samples of the cycle to the task.
+ *
+ * @param   status - DS18B20_SUCCESS or DS18B20_NO_RESPONSE
+ *
+ * @return  none
+ */
+static void ds18b20_Report( uint8 status )
+{
+  ds18b20Readings_t *msg;
+
+  msg = (ds18b20Readings_t *)osal_msg_allocate( sizeof( ds18b20Readings_t ) );
+  if ( msg )
+  {
+    msg->hdr.event = DS18B20_READING_IND;
+    msg->hdr.status = status;
+    msg->count = ds18b20_Count;
+    osal_memcpy( msg->sample, ds18b20_Samples, sizeof( ds18b20_Samples ) );
+    osal_msg_send( ds18b20_TaskID, (uint8 *)msg );
+  }
+}
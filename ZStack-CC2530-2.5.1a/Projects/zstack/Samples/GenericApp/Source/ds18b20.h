@@ -4,4 +4,89 @@
 extern unsigned char Ds18b20Initial(void);
 extern unsigned char ReadDs18B20(void);
 extern float floatReadDs18B20(void);
+
+/*********************************************************************
+ * Multi-drop driver
+ *
+ * Several sensors share the 1-Wire bus of OneWire.h. Ds18b20_Init()
+ * finds them with the ROM search and sets them to 12-bit resolution;
+ * other 1-Wire devices on the bus take up DS18B20_MAX_SENSORS slots too.
+ * Ds18b20_Start() starts a conversion in all of them at once with Skip
+ * ROM and returns. The rest of the cycle runs on the event given to
+ * Ds18b20_Init(), which the task must pass to Ds18b20_ProcessEvent():
+ * after DS18B20_CONVERT_MS it reads one sensor per event, addressed with
+ * Match ROM, and checks the CRC-8 of its scratchpad. The results arrive
+ * as a ds18b20Readings_t message.
+ *
+ * Sensors must be externally powered; parasite power needs a strong
+ * pull-up during the conversion, which this board does not have.
+ *
+ * Bus time, during which the CPU busy-waits:
+ *   once per cycle  DS18B20_CONVERT_US = 2.1 ms (reset, Skip ROM, Convert T)
+ *   per sensor      DS18B20_READ_US = 11.6 ms (reset, Match ROM,
+ *                   Read Scratchpad, 9 bytes)
+ * Interrupts are disabled for at most ONEWIRE_SLOT_US at a time.
+ */
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "OneWire.h"
+
+// OSAL message event of ds18b20Readings_t
+#define DS18B20_READING_IND   0xE2
+
+#if !defined( DS18B20_MAX_SENSORS )
+  #define DS18B20_MAX_SENSORS 4
+#endif
+
+#define DS18B20_FAMILY        0x28
+#define DS18B20_SCRATCHPAD_LEN 9
+
+// Conversion time at 12-bit resolution
+#define DS18B20_CONVERT_MS    750
+
+#define DS18B20_CONVERT_US    (ONEWIRE_RESET_US + 2 * 8 * ONEWIRE_SLOT_US)
+#define DS18B20_READ_US       (ONEWIRE_RESET_US + (8 + 8 * ONEWIRE_ROM_LEN + 8 \
+                                + 8 * DS18B20_SCRATCHPAD_LEN) * ONEWIRE_SLOT_US)
+
+// ds18b20Readings_t and ds18b20Sample_t status
+#define DS18B20_SUCCESS       0x00
+#define DS18B20_NO_RESPONSE   0x01    // no presence pulse
+#define DS18B20_BAD_CRC       0x02    // scratchpad CRC-8 mismatch
+
+typedef struct
+{
+  uint8 status;           // DS18B20_SUCCESS or error
+  int16 temperature;      // 1/16 degrees C
+} ds18b20Sample_t;
+
+typedef struct
+{
+  osal_event_hdr_t hdr;   // DS18B20_READING_IND, status DS18B20_SUCCESS,
+                          // or DS18B20_NO_RESPONSE if nothing converted
+  uint8 count;            // sensors, in the order of Ds18b20_GetRom()
+  ds18b20Sample_t sample[DS18B20_MAX_SENSORS];
+} ds18b20Readings_t;
+
+/*
+ * Sets the task and event used by the driver, then searches the bus.
+ * Returns the number of sensors found.
+ */
+extern uint8 Ds18b20_Init( uint8 taskId, uint16 event );
+
+/*
+ * Returns the ROM code of a sensor found by Ds18b20_Init(), or NULL.
+ */
+extern uint8 *Ds18b20_GetRom( uint8 index );
+
+/*
+ * Starts a conversion in every sensor. Returns SUCCESS, or FAILURE if a
+ * cycle is in progress.
+ */
+extern uint8 Ds18b20_Start( void );
+
+/*
+ * Advances the cycle; call on the event given to Ds18b20_Init().
+ */
+extern void Ds18b20_ProcessEvent( void );
+
 #endif
\ No newline at end of file
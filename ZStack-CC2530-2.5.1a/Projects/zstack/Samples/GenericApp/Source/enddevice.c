@@ -61,6 +61,7 @@
  * INCLUDES
  */
 #include "OSAL.h"
+#include "OSAL_Nv.h"
 #include "AF.h"
 #include "ZDApp.h"
 #include "ZDObject.h"
@@ -81,6 +82,9 @@
 
 #include "DHT11.h"
 #include "ds18b20.h"
+#include "SensorFrame.h"
+#include "SensorAdc.h"
+#include "ZclSensor.h"
 
 /* RTOS */
 #if defined( IAR_ARMCM3_LM )
@@ -91,14 +95,47 @@
  * MACROS
  */
 
+// Index of a SensorFrame.h TLV type in the sample array and ZclSensor.h
+#define GENERICAPP_CHANNEL( tlvType )     ((tlvType) - SENSORFRAME_TLV_TEMPERATURE)
+
 /*********************************************************************
  * CONSTANTS
  */
 
+#define GENERICAPP_MIN_SAMPLE_INTERVAL    100
+
+// Temperature, humidity, light and gas
+#define GENERICAPP_ANALOG_CHANNELS        4
+
+// Default sample interval. The DHT11 gives at most one reading per
+// second, the DS18B20s one per conversion of DS18B20_CONVERT_MS.
+#define GENERICAPP_SAMPLE_TIMEOUT         2000
+
+// GENERICAPP_DS18B20 builds the end device for boards carrying DS18B20
+// sensors on the 1-Wire bus of OneWire.h instead of the DHT11, which
+// uses the same pin. The temperature is then the mean of the sensors
+// that answered, to 1/16 degree C, and the humidity is reported as the
+// ZCL invalid value, which the coordinator drops.
+#if defined( GENERICAPP_DS18B20 )
+  #define GENERICAPP_NO_HUMIDITY          0xFFFF
+#endif
+
+// How late a sample may be taken while the device sleeps (OSAL_TICKLESS):
+// half an interval lets it wait for the next data poll. The sample timer
+// reloads, so the samples keep their interval on average.
+#define GENERICAPP_SAMPLE_SLACK( interval )  ((interval) / 2)
+
 /*********************************************************************
  * TYPEDEFS
  */
 
+// Stored in NV as GENERICAPP_NV_REPORT_CFG. When and what to report is
+// the ZCL reporting configuration of ZclSensor.h.
+typedef struct
+{
+  uint16 sampleInterval;                        // ms
+} genericAppReportCfg_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -150,6 +187,19 @@ afAddrType_t GenericApp_DstAddr;
 
 char sensorID = '1';
 
+// Report configuration; set by the gateway and kept in NV
+static genericAppReportCfg_t GenericApp_ReportCfg =
+{
+  GENERICAPP_SAMPLE_TIMEOUT
+};
+
+// Latest sample
+static uint16 GenericApp_Sample[GENERICAPP_ANALOG_CHANNELS];
+static uint8 GenericApp_SamplePir;
+
+// Report the sample being taken even if nothing changed
+static uint8 GenericApp_ForceReport = FALSE;
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -170,7 +220,14 @@ void GenericApp_Send_wedu_Message( void );//
 
 void GenericApp_Send_rentihongwai_Message( void );//Ҽӵģ߷ͺ
 
-void GenericApp_Send_Sensor_Message( void );
+static void GenericApp_StartSample( uint8 force );
+#if defined( GENERICAPP_DS18B20 )
+static void GenericApp_FinishDs18b20Sample( ds18b20Readings_t *readings );
+#else
+static void GenericApp_FinishDht11Sample( dht11Reading_t *reading );
+#endif
+static void GenericApp_FinishSample( void );
+static void GenericApp_SaveReportCfg( void );
 
 #if defined( IAR_ARMCM3_LM )
 static void GenericApp_ProcessRtosMessage( void );
@@ -205,6 +262,14 @@ void GenericApp_Init( uint8 task_id )
   GenericApp_TransID = 0;
   
   P0_5 = 0;
+  SensorAdc_Init();
+  SensorAdc_Start();
+#if defined( GENERICAPP_DS18B20 )
+  Ds18b20_Init( task_id, GENERICAPP_DS18B20_EVT );
+  GenericApp_Sample[GENERICAPP_CHANNEL( SENSORFRAME_TLV_HUMIDITY )] = GENERICAPP_NO_HUMIDITY;
+#else
+  DHT11_Init( task_id, GENERICAPP_DHT11_EVT );
+#endif
 
   // Device hardware initialization can be added here or in main() (Zmain.c).
   // If the hardware is application specific - add it here.
@@ -214,6 +279,14 @@ void GenericApp_Init( uint8 task_id )
   GenericApp_DstAddr.endPoint = GENERICAPP_ENDPOINT;
   GenericApp_DstAddr.addr.shortAddr = 0x0000;
 
+  // Restore the report configuration last set by the gateway
+  if ( osal_nv_item_init( GENERICAPP_NV_REPORT_CFG, sizeof( GenericApp_ReportCfg ),
+                          &GenericApp_ReportCfg ) == ZSUCCESS )
+  {
+    osal_nv_read( GENERICAPP_NV_REPORT_CFG, 0, sizeof( GenericApp_ReportCfg ),
+                  &GenericApp_ReportCfg );
+  }
+
   // Fill out the endpoint description.
   GenericApp_epDesc.endPoint = GENERICAPP_ENDPOINT;
   GenericApp_epDesc.task_id = &GenericApp_TaskID;
@@ -224,6 +297,9 @@ void GenericApp_Init( uint8 task_id )
   // Register the endpoint description with the AF
   afRegister( &GenericApp_epDesc );
 
+  // Sensor readings are reported as ZCL attributes on their own endpoint.
+  ZclSensor_Init( GenericApp_TaskID, GENERICAPP_NV_ZCL_REPORT_CFG );
+
   // Register for all key events - This app will handle all key events
   RegisterForKeys( GenericApp_TaskID );
 
@@ -302,16 +378,31 @@ uint16 GenericApp_ProcessEvent( uint8 task_id, uint16 events )
           GenericApp_MessageMSGCB( MSGpkt );
           break;
 
+#if defined( GENERICAPP_DS18B20 )
+        case DS18B20_READING_IND:
+          GenericApp_FinishDs18b20Sample( (ds18b20Readings_t *)MSGpkt );
+          break;
+#else
+        case DHT11_READING_IND:
+          GenericApp_FinishDht11Sample( (dht11Reading_t *)MSGpkt );
+          break;
+#endif
+
+        case ZCL_INCOMING_MSG:
+          ZclSensor_ProcessMsg( (zclIncomingMsg_t *)MSGpkt );
+          break;
+
         case ZDO_STATE_CHANGE:
           GenericApp_NwkState = (devStates_t)(MSGpkt->hdr.status);
           if ( (GenericApp_NwkState == DEV_ZB_COORD)
               || (GenericApp_NwkState == DEV_ROUTER)
               || (GenericApp_NwkState == DEV_END_DEVICE) )
           {
-            // Start sending "the" message in a regular interval.
-            osal_start_timerEx( GenericApp_TaskID,
-                                GENERICAPP_SEND_MSG_EVT,
-                                GENERICAPP_SEND_MSG_TIMEOUT );
+            // Start sampling; ZclSensor reports the first sample in full.
+            osal_start_reload_timer_slack( GenericApp_TaskID,
+                                           GENERICAPP_SAMPLE_EVT,
+                                           GenericApp_ReportCfg.sampleInterval,
+                                           GENERICAPP_SAMPLE_SLACK( GenericApp_ReportCfg.sampleInterval ) );
           }
           break;
 
@@ -330,8 +421,18 @@ uint16 GenericApp_ProcessEvent( uint8 task_id, uint16 events )
     return (events ^ SYS_EVENT_MSG);
   }
 
-  // Send a message out - This event is generated by a timer
-  //  (setup in GenericApp_Init()).
+  // Sample the sensors; GenericApp_FinishSample() reports the attributes
+  //  that are due.
+  if ( events & GENERICAPP_SAMPLE_EVT )
+  {
+    GenericApp_StartSample( FALSE );
+
+    // return unprocessed events
+    return (events ^ GENERICAPP_SAMPLE_EVT);
+  }
+
+  // Send a message out - This event is generated by a
+  //  GENERICAPP_CMD_REPORT_NOW command.
   if ( events & GENERICAPP_SEND_MSG_EVT )
   {
     // Send "the" message
@@ -341,17 +442,32 @@ uint16 GenericApp_ProcessEvent( uint8 task_id, uint16 events )
     //GenericApp_Send_rentihongwai_Message( );//Ҽӵģ߷ͺ
     //GenericApp_Send_wenshidu_Message();
     //GenericApp_Send_wedu_Message( );//Ҽӵģ¶߷ͺ
-    GenericApp_Send_Sensor_Message();
-    
-    // Setup to send message again
-    osal_start_timerEx( GenericApp_TaskID,
-                        GENERICAPP_SEND_MSG_EVT,
-                        GENERICAPP_SEND_MSG_TIMEOUT );
+    GenericApp_StartSample( TRUE );
 
     // return unprocessed events
     return (events ^ GENERICAPP_SEND_MSG_EVT);
   }
 
+#if defined( GENERICAPP_DS18B20 )
+  // Temperature conversion or reading in progress
+  if ( events & GENERICAPP_DS18B20_EVT )
+  {
+    Ds18b20_ProcessEvent();
+
+    // return unprocessed events
+    return (events ^ GENERICAPP_DS18B20_EVT);
+  }
+#else
+  // Temperature and humidity reading in progress
+  if ( events & GENERICAPP_DHT11_EVT )
+  {
+    DHT11_ProcessEvent();
+
+    // return unprocessed events
+    return (events ^ GENERICAPP_DHT11_EVT);
+  }
+#endif
+
   
 #if defined( IAR_ARMCM3_LM )
   // Receive a message from the RTOS queue
@@ -522,6 +638,76 @@ static void GenericApp_HandleKeys( uint8 shift, uint8 keys )
  */
 static void GenericApp_MessageMSGCB( afIncomingMSGPacket_t *pkt )
 {
+  uint16 seconds;
+  uint16 interval;
+  uint8 tlvType;
+
+  switch ( pkt->clusterId )
+  {
+    case GENERICAPP_COMMAND_CLUSTERID:
+      if ( pkt->cmd.DataLength < 1 )
+      {
+        break;
+      }
+      switch ( pkt->cmd.Data[0] )
+      {
+        case GENERICAPP_CMD_REPORT_NOW:
+          osal_set_event( GenericApp_TaskID, GENERICAPP_SEND_MSG_EVT );
+          break;
+
+        case GENERICAPP_CMD_SET_REPORT_INTERVAL:
+          if ( pkt->cmd.DataLength < 3 )
+          {
+            break;
+          }
+          // The maximum reporting interval of every attribute
+          seconds = BUILD_UINT16( pkt->cmd.Data[1], pkt->cmd.Data[2] );
+          if ( seconds == 0 )
+          {
+            seconds = 1;
+          }
+          ZclSensor_SetMaxInterval( seconds );
+          break;
+
+        case GENERICAPP_CMD_SET_DEADBAND:
+          if ( pkt->cmd.DataLength < 4 )
+          {
+            break;
+          }
+          tlvType = pkt->cmd.Data[1];
+          if ( (tlvType < SENSORFRAME_TLV_TEMPERATURE) || (tlvType > SENSORFRAME_TLV_GAS) )
+          {
+            break;
+          }
+          // The reportable change of the attribute
+          ZclSensor_SetDeadband( GENERICAPP_CHANNEL( tlvType ),
+                                 BUILD_UINT16( pkt->cmd.Data[2], pkt->cmd.Data[3] ) );
+          break;
+
+        case GENERICAPP_CMD_SET_SAMPLE_INTERVAL:
+          if ( pkt->cmd.DataLength < 3 )
+          {
+            break;
+          }
+          interval = BUILD_UINT16( pkt->cmd.Data[1], pkt->cmd.Data[2] );
+          if ( interval < GENERICAPP_MIN_SAMPLE_INTERVAL )
+          {
+            interval = GENERICAPP_MIN_SAMPLE_INTERVAL;
+          }
+          GenericApp_ReportCfg.sampleInterval = interval;
+          GenericApp_SaveReportCfg();
+          osal_start_reload_timer_slack( GenericApp_TaskID,
+                                         GENERICAPP_SAMPLE_EVT,
+                                         GenericApp_ReportCfg.sampleInterval,
+                                         GENERICAPP_SAMPLE_SLACK( GenericApp_ReportCfg.sampleInterval ) );
+          break;
+
+        default:
+          break;
+      }
+      break;
+  }
+
   /*switch ( pkt->clusterId )
   {
     case GENERICAPP_CLUSTERID:
@@ -536,52 +722,128 @@ static void GenericApp_MessageMSGCB( afIncomingMSGPacket_t *pkt )
 }
 
 /*********************************************************************
- * @fn      GenericApp_Send_Sensor_Message
+ * @fn      GenericApp_StartSample
  *
- * @brief   point to point.
+ * @brief   Starts a temperature and humidity reading, or a DS18B20
+ *          conversion; the sample is completed when it arrives.
  *
- * @param   none
+ * @param   force - TRUE to report the sample even if nothing changed
  *
  * @return  none
  */
-void GenericApp_Send_Sensor_Message( void )
+static void GenericApp_StartSample( uint8 force )
 {
-  byte strTemp[11];
-  
-  strTemp[0] = 'S';
-  strTemp[1] = sensorID;
-
-  //read temperature and humidity
-  DHT11();
-  strTemp[2] = wendu_shi+0x30;
-  strTemp[3] = wendu_ge+0x30;
-  strTemp[4] = shidu_shi+0x30;
-  strTemp[5] = shidu_ge+0x30;  
-  //read light level
-  uint16 LightLevel = myApp_ReadLightLevel();  
-  strTemp[6] = LightLevel / 10%10 + '0';
-  strTemp[7] = LightLevel % 100 + '0';
-  //read gas level
-  uint16 GasLevel = myApp_ReadGasLevel();
-  strTemp[8] = GasLevel / 10%10 + '0';
-  strTemp[9] = GasLevel % 10 + '0';
-  //read PIR sensor
-  if(P0_5 == 0)
+  if ( force )
   {
-    strTemp[10] = '0' ;
+    GenericApp_ForceReport = TRUE;
   }
-  else
+
+  // If a reading is already in progress, it completes this sample.
+#if defined( GENERICAPP_DS18B20 )
+  Ds18b20_Start();
+#else
+  DHT11_Start();
+#endif
+}
+
+#if defined( GENERICAPP_DS18B20 )
+/*********************************************************************
+ * @fn      GenericApp_FinishDs18b20Sample
+ *
+ * @brief   Completes a sample with the mean temperature of the DS18B20
+ *          sensors that answered. If none did, the previous temperature
+ *          is kept.
+ *
+ * @param   readings - outcome of the DS18B20 cycle
+ *
+ * @return  none
+ */
+static void GenericApp_FinishDs18b20Sample( ds18b20Readings_t *readings )
+{
+  int32 sum = 0;
+  uint8 count = 0;
+  uint8 i;
+
+  for ( i = 0; i < readings->count; i++ )
   {
-    strTemp[10] = '1' ;
+    if ( readings->sample[i].status == DS18B20_SUCCESS )
+    {
+      sum += readings->sample[i].temperature;
+      count++;
+    }
   }
-  
-  AF_DataRequest( &GenericApp_DstAddr, &GenericApp_epDesc,
-                       GenericApp_Sensor_CLUSTERID,
-                       11,
-                       strTemp,
-                       &GenericApp_TransID,
-                       AF_DISCV_ROUTE,
-                       AF_DEFAULT_RADIUS ) ;
+
+  if ( count != 0 )
+  {
+    // From 1/16 to the 0.01 degrees C of ZclSensor_Update(), rounded
+    sum *= 25;
+    sum += ( sum < 0 ) ? -2 * (int32)count : 2 * (int32)count;
+    GenericApp_Sample[GENERICAPP_CHANNEL( SENSORFRAME_TLV_TEMPERATURE )]
+      = (uint16)(int16)(sum / (4 * (int32)count));
+  }
+  GenericApp_FinishSample();
+}
+#else
+/*********************************************************************
+ * @fn      GenericApp_FinishDht11Sample
+ *
+ * @brief   Completes a sample with the DHT11 reading. A failed reading
+ *          keeps the previous temperature and humidity.
+ *
+ * @param   reading - outcome of the DHT11 reading
+ *
+ * @return  none
+ */
+static void GenericApp_FinishDht11Sample( dht11Reading_t *reading )
+{
+  if ( reading->hdr.status == DHT11_SUCCESS )
+  {
+    // In the 0.01 units of ZclSensor_Update()
+    GenericApp_Sample[GENERICAPP_CHANNEL( SENSORFRAME_TLV_TEMPERATURE )]
+      = (uint16)reading->temperature * 100;
+    GenericApp_Sample[GENERICAPP_CHANNEL( SENSORFRAME_TLV_HUMIDITY )]
+      = (uint16)reading->humidity * 100;
+  }
+  GenericApp_FinishSample();
+}
+#endif
+
+/*********************************************************************
+ * @fn      GenericApp_FinishSample
+ *
+ * @brief   Completes a sample with the other sensors, and hands it to
+ *          ZclSensor to report what is due.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void GenericApp_FinishSample( void )
+{
+  //read light and gas levels, then refresh them in the background
+  GenericApp_Sample[GENERICAPP_CHANNEL( SENSORFRAME_TLV_LIGHT )] = myApp_ReadLightLevel();
+  GenericApp_Sample[GENERICAPP_CHANNEL( SENSORFRAME_TLV_GAS )] = myApp_ReadGasLevel();
+  SensorAdc_Start();
+  //read PIR sensor
+  GenericApp_SamplePir = (P0_5 == 0) ? 0 : 1;
+
+  ZclSensor_Update( GenericApp_Sample, GenericApp_SamplePir, GenericApp_ForceReport );
+  GenericApp_ForceReport = FALSE;
+}
+
+/*********************************************************************
+ * @fn      GenericApp_SaveReportCfg
+ *
+ * @brief   Writes the report configuration to NV.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void GenericApp_SaveReportCfg( void )
+{
+  osal_nv_write( GENERICAPP_NV_REPORT_CFG, 0, sizeof( GenericApp_ReportCfg ),
+                 &GenericApp_ReportCfg );
 }
 
 /*********************************************************************
@@ -649,28 +911,9 @@ void GenericApp_Send_Guangqiang_Message(void)//
 */
 uint16 myApp_ReadLightLevel( void )
 {
-  uint16 reading = 0;
-  
-  /* Enable channel */
-  ADCCFG |= 0x40;
-  
-  /* writing to this register starts the extra conversion */
-  ADCCON3 = 0x86;
-  
-  /* Wait for the conversion to be done */
-  while (!(ADCCON1 & 0x80));
-  
-  /* Disable channel after done conversion */
-  ADCCFG &= (0x40 ^ 0xFF);
-  
-  /* Read the result */
-  reading = ADCH;
-  reading |= (int16) (ADCH << 8); 
-  
-  reading >>= 8;
-  
-  return (reading);
-} 
+  // Filtered by SensorAdc; never waits for a conversion.
+  return SensorAdc_Read( SENSORADC_LIGHT );
+}
 
 void GenericApp_Send_GAN_Message( void )//͹ǿ
 {
@@ -714,27 +957,8 @@ void GenericApp_Send_GAN_Message( void )//
 */
 uint16 myApp_ReadGasLevel( void )
 {
-  uint16 reading = 0;
-  
-  /* Enable channel */
-  ADCCFG |= 0x80;
-  
-  /* writing to this register starts the extra conversion */
-  ADCCON3 = 0x87;
-  
-  /* Wait for the conversion to be done */
-  while (!(ADCCON1 & 0x80));
-  
-  /* Disable channel after done conversion */
-  ADCCFG &= (0x80 ^ 0xFF);
-  
-  /* Read the result */
-  reading = ADCH;
-  reading |= (int16) (ADCH << 8); 
-  
-  reading >>= 8;
-  
-  return (reading);
+  // Filtered by SensorAdc; never waits for a conversion.
+  return SensorAdc_Read( SENSORADC_GAS );
 }
 
 void GenericApp_Send_wedu_Message( void )//Ҽӵģ¶߷ͺ
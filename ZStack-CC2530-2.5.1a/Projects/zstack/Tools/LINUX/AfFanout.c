@@ -0,0 +1,408 @@
+/**************************************************************************************************
+  Filename:       AfFanout.c
+
+  Description:    Benchmark of the delivery of incoming AF data to several
+                  endpoints on the Linux host target: afIncomingData() of
+                  AF.c with the OSAL, and the rest of the stack stubbed.
+
+  Broadcast data frames, of the profile of every endpoint, are passed to
+  afIncomingData() as APS does, a burst of them before the tasks run;
+  then each task receives and frees its messages, and checks their data.
+  For 1, 2 and 4 endpoints and bursts of 1 and 8 frames it prints:
+
+      endpoints burst  <ns> ns/frame  <cycles> cycles/frame  <allocs> allocs/frame  <bytes> bytes/frame  <peak>  <lost>
+
+  where allocs and bytes count the calls of osal_mem_alloc() and the
+  bytes they ask for, peak is the most heap in use after a burst, and
+  lost the deliveries that failed. Cycles are counted with the time stamp
+  counter on x86; elsewhere the column shows "-".
+
+  A frame for several endpoints is carried by the message of the first,
+  that the others point into (AF_SHARED_INCOMING, see AF.h); build with
+  -DAF_SHARED_INCOMING=FALSE to compare with a copy in each message:
+
+    make clean AfFanout BENCH_FLAGS=-DAF_SHARED_INCOMING=FALSE
+
+  The heap is larger than the target's 3072 bytes, which 8 frames to 4
+  endpoints outgrow, so that the peak shows by how much.
+
+  Build on the Linux host target (see Projects/zstack/ZMain/LINUX/OnBoard.h)
+  with "make AfFanout": AF.c needs the configuration of the stack
+  (AF_FLAGS of the Makefile) and the include paths of its layers
+  (AF_INCLUDES), and the allocations are counted by linking with
+  -Wl,--wrap=osal_mem_alloc.
+
+  Usage: AfFanout [-n frames] [-l length]
+    -n  frames delivered for each line (200000)
+    -l  length of the ASDU, in bytes (50)
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+  #include <x86intrin.h>
+#endif
+
+#include "ZComDef.h"
+#include "OnBoard.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "OSAL_Memory.h"
+#include "AF.h"
+#include "aps_groups.h"
+#include "aps_frag.h"
+#include "rtg.h"
+#include "saddr.h"
+
+#if !OSALMEM_METRICS
+  #error AfFanout needs OSALMEM_METRICS=TRUE.
+#endif
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Tasks, one per endpoint
+#define FANOUT_TASKS      4
+
+#define FANOUT_PROFILE    0x0104
+#define FANOUT_CLUSTER    0x0006
+#define FANOUT_MAX_ASDU   100
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint16 fanoutTask( uint8 task_id, uint16 events );
+static void fanoutRun( int endpoints, int burst );
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+const pTaskEventHandlerFn tasksArr[FANOUT_TASKS] =
+{
+  fanoutTask, fanoutTask, fanoutTask, fanoutTask
+};
+const uint8 tasksCnt = FANOUT_TASKS;
+uint16 *tasksEvents;
+
+// The fragmentation of APS is not linked
+APSF_SendFragmented_t *apsfSendFragmented = NULL;
+
+void *__real_osal_mem_alloc( uint16 size );
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static long fanoutFrames = 200000;
+static int fanoutLen = 50;
+
+static uint8 fanoutTaskIds[FANOUT_TASKS];
+static endPointDesc_t fanoutEps[FANOUT_TASKS];
+static SimpleDescriptionFormat_t fanoutDesc =
+{
+  0, FANOUT_PROFILE, 0, 0, 0, 0, NULL, 0, NULL
+};
+
+static uint8 fanoutAsdu[FANOUT_MAX_ASDU];
+
+// Calls of osal_mem_alloc() and the bytes asked for
+static unsigned long fanoutAllocs;
+static unsigned long fanoutAllocBytes;
+
+/*********************************************************************
+ * @fn      osalInitTasks
+ *
+ * @brief   Allocates the events of the tasks.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osalInitTasks( void )
+{
+  tasksEvents = (uint16 *)osal_mem_alloc( sizeof( uint16 ) * tasksCnt );
+  osal_memset( tasksEvents, 0, sizeof( uint16 ) * tasksCnt );
+}
+
+/*********************************************************************
+ * @fn      fanoutTask
+ *
+ * @brief   Handler of every task; the benchmark takes the messages
+ *          itself.
+ *
+ * @param   task_id - task
+ * @param   events  - events set
+ *
+ * @return  none left
+ */
+static uint16 fanoutTask( uint8 task_id, uint16 events )
+{
+  (void)task_id;
+  (void)events;
+  return 0;
+}
+
+/*********************************************************************
+ * @fn      __wrap_osal_mem_alloc
+ *
+ * @brief   Counts the allocations of the heap (-Wl,--wrap=osal_mem_alloc).
+ *
+ * @param   size - bytes
+ *
+ * @return  the block, or NULL
+ */
+void *__wrap_osal_mem_alloc( uint16 size )
+{
+  fanoutAllocs++;
+  fanoutAllocBytes += size;
+  return __real_osal_mem_alloc( size );
+}
+
+/*********************************************************************
+ * The rest of the stack, as far as AF.c calls it. Only the delivery of
+ * incoming data is run, so none of it is reached.
+ */
+
+ZStatus_t APSDE_DataReq( APSDE_DataReq_t *req )
+{
+  (void)req;
+  return ZFailure;
+}
+
+uint8 APSDE_DataReqMTU( APSDE_DataReqMTU_t *fields )
+{
+  (void)fields;
+  return 0;
+}
+
+uint16 NLME_GetShortAddr( void )
+{
+  return 0x0000;
+}
+
+addr_filter_t NLME_IsAddressBroadcast( uint16 shortAddress )
+{
+  return ( (shortAddress >= NWK_BROADCAST_SHORTADDR_DEVZCZR) ? ADDR_BCAST_FOR_ME : ADDR_NOT_BCAST );
+}
+
+RTG_Status_t RTG_AddSrcRtgEntry_Guaranteed( uint16 srcAddr, uint8 relayCnt, uint16 *pRelayList )
+{
+  (void)srcAddr;
+  (void)relayCnt;
+  (void)pRelayList;
+  return RTG_FAIL;
+}
+
+RTG_Status_t RTG_CheckRtStatus( uint16 DstAddress, byte RtStatus, uint8 options )
+{
+  (void)DstAddress;
+  (void)RtStatus;
+  (void)options;
+  return RTG_FAIL;
+}
+
+void *sAddrExtCpy( uint8 *pDest, const uint8 *pSrc )
+{
+  return osal_memcpy( pDest, pSrc, Z_EXTADDR_LEN );
+}
+
+uint8 aps_FindGroupForEndpoint( uint16 groupID, uint8 lastGroup )
+{
+  (void)groupID;
+  (void)lastGroup;
+  return APS_GROUPS_EP_NOT_FOUND;
+}
+
+/*********************************************************************
+ * @fn      fanoutRun
+ *
+ * @brief   Delivers fanoutFrames broadcast frames to the endpoints, in
+ *          bursts, and prints their cost.
+ *
+ * @param   endpoints - endpoints registered, at most FANOUT_TASKS
+ * @param   burst     - frames passed to AF before the tasks run
+ *
+ * @return  none
+ */
+static void fanoutRun( int endpoints, int burst )
+{
+  aps_FrameFormat_t aff;
+  zAddrType_t srcAddr;
+  NLDE_Signal_t sig = { 200, 100, -40 };
+  struct timespec t0, t1;
+  unsigned long long c0 = 0;
+  double cycles = 0;
+  double ns = 0;
+  unsigned long delivered = 0;
+  uint16 peak = 0;
+  long bursts = fanoutFrames / burst;
+  long frames = bursts * burst;
+  long b;
+  int i;
+
+  osal_memset( &srcAddr, 0, sizeof( srcAddr ) );
+  srcAddr.addrMode = Addr16Bit;
+  srcAddr.addr.shortAddr = 0x1234;
+  fanoutAllocs = 0;
+  fanoutAllocBytes = 0;
+
+  for ( b = 0; b < bursts; b++ )
+  {
+    clock_gettime( CLOCK_MONOTONIC, &t0 );
+#if defined( __x86_64__ ) || defined( __i386__ )
+    c0 = __rdtsc();
+#endif
+    for ( i = 0; i < burst; i++ )
+    {
+      // afIncomingData() overwrites the destination endpoint
+      osal_memset( &aff, 0, sizeof( aff ) );
+      aff.FrmCtrl = APS_FC_DM_BROADCAST;
+      aff.DstEndPoint = AF_BROADCAST_ENDPOINT;
+      aff.SrcEndPoint = 1;
+      aff.ClusterID = FANOUT_CLUSTER;
+      aff.ProfileID = FANOUT_PROFILE;
+      aff.asdu = fanoutAsdu;
+      aff.asduLength = fanoutLen;
+      aff.wasBroadcast = TRUE;
+      afIncomingData( &aff, &srcAddr, 0, &sig, 0, FALSE, 0 );
+    }
+#if defined( __x86_64__ ) || defined( __i386__ )
+    cycles += (double)(__rdtsc() - c0);
+#endif
+    clock_gettime( CLOCK_MONOTONIC, &t1 );
+    ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+    if ( osal_heap_mem_used() > peak )
+    {
+      peak = osal_heap_mem_used();
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &t0 );
+#if defined( __x86_64__ ) || defined( __i386__ )
+    c0 = __rdtsc();
+#endif
+    for ( i = 0; i < endpoints; i++ )
+    {
+      afIncomingMSGPacket_t *pkt;
+
+      while ( (pkt = (afIncomingMSGPacket_t *)osal_msg_receive( fanoutTaskIds[i] )) )
+      {
+        if ( (pkt->endPoint == fanoutEps[i].endPoint) &&
+             (pkt->cmd.DataLength == fanoutLen) &&
+             ((fanoutLen == 0) || (pkt->cmd.Data[fanoutLen - 1] == (uint8)(fanoutLen - 1))) )
+        {
+          delivered++;
+        }
+        osal_msg_deallocate( (uint8 *)pkt );
+      }
+    }
+#if defined( __x86_64__ ) || defined( __i386__ )
+    cycles += (double)(__rdtsc() - c0);
+#endif
+    clock_gettime( CLOCK_MONOTONIC, &t1 );
+    ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+  }
+
+  if ( cycles > 0 )
+  {
+    printf( "%9d %5d %8.1f ns/frame %8.1f cycles/frame", endpoints, burst,
+            ns / frames, cycles / frames );
+  }
+  else
+  {
+    printf( "%9d %5d %8.1f ns/frame %8s cycles/frame", endpoints, burst, ns / frames, "-" );
+  }
+  printf( " %5.2f allocs/frame %6.1f bytes/frame %5u peak %6lu lost\n",
+          (double)fanoutAllocs / frames, (double)fanoutAllocBytes / frames, peak,
+          (unsigned long)(frames * endpoints) - delivered );
+}
+
+/*********************************************************************
+ * @fn      main
+ *
+ * @brief   Runs the benchmark.
+ *
+ * @param   argc, argv - see the usage above
+ *
+ * @return  0, or 1 for a bad argument or a leak of the heap
+ */
+int main( int argc, char *argv[] )
+{
+  static const int endpoints[] = { 1, 2, 4 };
+  static const int bursts[] = { 1, 8 };
+  uint16 heapUsed;
+  unsigned int e, b;
+  int opt;
+  int i;
+
+  while ( (opt = getopt( argc, argv, "n:l:" )) != -1 )
+  {
+    if ( (opt == 'n') && (atol( optarg ) > 0) )
+    {
+      fanoutFrames = atol( optarg );
+    }
+    else if ( (opt == 'l') && (atoi( optarg ) >= 0) && (atoi( optarg ) <= FANOUT_MAX_ASDU) )
+    {
+      fanoutLen = atoi( optarg );
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-n frames] [-l length]\n", argv[0] );
+      return 1;
+    }
+  }
+
+  InitBoard( OB_COLD );
+  osal_init_system();
+  osal_int_enable( INTS_ALL );
+  afInit();
+
+  for ( i = 0; i < FANOUT_MAX_ASDU; i++ )
+  {
+    fanoutAsdu[i] = (uint8)i;
+  }
+  heapUsed = osal_heap_mem_used();
+  printf( "AF_SHARED_INCOMING %s, ASDU %d bytes, %ld frames\n",
+          AF_SHARED_INCOMING ? "TRUE" : "FALSE", fanoutLen, fanoutFrames );
+
+  for ( e = 0; e < sizeof( endpoints ) / sizeof( endpoints[0] ); e++ )
+  {
+    for ( i = 0; i < endpoints[e]; i++ )
+    {
+      fanoutTaskIds[i] = (uint8)i;
+      fanoutEps[i].endPoint = (uint8)(i + 1);
+      fanoutEps[i].task_id = &fanoutTaskIds[i];
+      fanoutEps[i].simpleDesc = &fanoutDesc;
+      fanoutEps[i].latencyReq = noLatencyReqs;
+      afRegister( &fanoutEps[i] );
+    }
+    for ( b = 0; b < sizeof( bursts ) / sizeof( bursts[0] ); b++ )
+    {
+      fanoutRun( endpoints[e], bursts[b] );
+    }
+    while ( epList )
+    {
+      afDelete( epList->epDesc->endPoint );
+    }
+  }
+
+  if ( osal_heap_mem_used() != heapUsed )
+  {
+    printf( "heap in use %u at the start, %u at the end\n", heapUsed, osal_heap_mem_used() );
+    return 1;
+  }
+  return 0;
+}
+
+/*********************************************************************
+*********************************************************************/
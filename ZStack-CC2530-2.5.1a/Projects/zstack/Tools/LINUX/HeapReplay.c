@@ -0,0 +1,651 @@
+/**************************************************************************************************
+  Filename:       HeapReplay.c
+
+  Description:    Replays an OSAL heap trace (OSALMEM_TRACE) on the Linux
+                  host, through the OSAL heap and through other allocators
+                  of the same size, and reports peak usage, fragmentation
+                  over time and the allocation sites at the high-water mark.
+
+  The trace is the data of the MT_SYS_OSAL_HEAP_TRACE responses of a
+  device built with OSALMEM_TRACE=TRUE, written one after the other to a
+  file:
+
+      | Lost (2) | Count (1) | Count x osalMemTrace_t (10) | ...
+
+  A response of one byte (ZMemError: the device had no buffer for it)
+  carries no events and is left out.
+
+  Each event is replayed through:
+
+      osal      osal_mem_alloc() and osal_mem_free() of
+                Components/osal/common/OSAL_Memory.c, as built (e.g. with
+                -DOSALMEM_SEGREGATED=TRUE)
+      bestfit   a best-fit heap with the OSAL block headers, coalescing on
+                free
+      ideal     no fragmentation: the sum of the blocks in use
+
+  A free whose allocation is not in the trace, such as one of a block
+  allocated before the trace started, is counted and skipped. The trace
+  should start with the device, or the first events dumped lost should
+  be 0, for the usage to be exact.
+
+  Build on the Linux host target (see Projects/zstack/ZMain/LINUX/OnBoard.h)
+  with the heap size of the device:
+
+    gcc -std=gnu99 -O2 -DUBIT -DOSALMEM_METRICS=TRUE -DINT_HEAP_LEN=3072 \
+        -I Components/hal/target/LINUX -I Projects/zstack/ZMain/LINUX \
+        -I Components/hal/include -I Components/osal/include \
+        Components/osal/common/OSAL_Memory.c Projects/zstack/ZMain/LINUX/OnBoard.c \
+        Projects/zstack/Tools/LINUX/HeapReplay.c -o HeapReplay
+
+  Usage: HeapReplay [-i ms] [-n sites] [-k events] trace
+    -i  interval of the fragmentation lines, in ms of the trace (1000);
+        0 prints none
+    -n  allocation sites listed at the high-water mark (10)
+    -k  events replayed before osal_mem_kick(), i.e. the long-lived
+        allocations of osal_init_system() at the start of the trace (0)
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comdef.h"
+#include "OnBoard.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+
+#if !OSALMEM_METRICS
+  #error HeapReplay needs OSALMEM_METRICS=TRUE for osal_heap_mem_free().
+#endif
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define REPLAY_EVT_LEN      10     // osalMemTrace_t over MT
+#define REPLAY_HEAPS        3      // osal, bestfit, ideal
+#define REPLAY_HDRSZ        2      // OSAL block header of the target
+#define REPLAY_MIN_SPLIT    4      // OSALMEM_MIN_BLKSZ of the target
+#define REPLAY_MAX_BLOCKS   (MAXMEMHEAP / REPLAY_HDRSZ)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// An allocator replaying the trace
+typedef struct
+{
+  const char *name;
+  void (*init)( void );
+  void *(*alloc)( uint16 size );
+  void (*free)( void *ptr );
+  uint16 (*freeBytes)( uint16 *largest );
+} replayHeap_t;
+
+// Results of an allocator
+typedef struct
+{
+  unsigned long failed;      // allocations that failed here
+  unsigned peak;             // most bytes of the heap in use
+  double fragSum;            // fragmentation summed over the events
+  double fragWorst;          // worst fragmentation
+} replayStats_t;
+
+// A block in use on the device, by its offset in the heap
+typedef struct
+{
+  void *ptr[REPLAY_HEAPS];   // the block in each allocator, or NULL
+  uint16 size;
+  uint16 caller;
+  uint8 task;
+  uint8 live;
+  unsigned liveIdx;          // index in replayLive[]
+} replayBlock_t;
+
+// Bytes allocated by a call site
+typedef struct
+{
+  uint16 caller;
+  uint8 task;
+  unsigned count;
+  unsigned long bytes;
+} replaySite_t;
+
+// A block of the best-fit heap
+typedef struct
+{
+  uint16 offset;
+  uint16 len;                // with the header
+  uint8 inUse;
+} replayBfBlock_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static replayBlock_t replayBlocks[0x10000];
+static unsigned replayLive[0x10000];
+static unsigned replayLiveCnt;
+
+static replaySite_t *replayPeakSites;
+static unsigned replayPeakSiteCnt;
+static unsigned long replayPeakBytes;
+static unsigned long replayPeakTick;
+
+// Best-fit heap: its blocks in address order
+static replayBfBlock_t replayBf[REPLAY_MAX_BLOCKS];
+static unsigned replayBfCnt;
+static uint8 replayBfHeap[MAXMEMHEAP];
+
+static unsigned long replayIdealUsed;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void osalInit( void );
+static void *osalAlloc( uint16 size );
+static void osalFree( void *ptr );
+static uint16 osalFreeBytes( uint16 *largest );
+static void bfInit( void );
+static void *bfAlloc( uint16 size );
+static void bfFree( void *ptr );
+static uint16 bfFreeBytes( uint16 *largest );
+static void idealInit( void );
+static void *idealAlloc( uint16 size );
+static void idealFree( void *ptr );
+static uint16 idealFreeBytes( uint16 *largest );
+static uint16 replayBlockLen( uint16 size );
+static void replayPeak( unsigned long tick );
+static int replaySiteCmp( const void *a, const void *b );
+
+static const replayHeap_t replayHeaps[REPLAY_HEAPS] =
+{
+  { "osal",    osalInit,  osalAlloc,  osalFree,  osalFreeBytes },
+  { "bestfit", bfInit,    bfAlloc,    bfFree,    bfFreeBytes },
+  { "ideal",   idealInit, idealAlloc, idealFree, idealFreeBytes },
+};
+
+/*********************************************************************
+ * @fn      main
+ *
+ * @brief   Replays the trace and prints the report.
+ *
+ * @param   see the usage above
+ *
+ * @return  0, or 1 on a bad command line or file
+ */
+int main( int argc, char **argv )
+{
+  replayStats_t stats[REPLAY_HEAPS];
+  unsigned long interval = 1000;
+  unsigned long nextLine;
+  unsigned long kick = 0;
+  unsigned long events = 0;
+  unsigned long lost = 0;
+  unsigned long unmatched = 0;
+  unsigned long devFailed = 0;
+  unsigned long tick = 0;
+  unsigned long liveBytes = 0;
+  unsigned sites = 10;
+  uint16 lastTick = 0;
+  uint8 hdr[3];
+  uint8 evt[REPLAY_EVT_LEN];
+  FILE *fp;
+  int arg;
+  int h;
+
+  for ( arg = 1; (arg + 1 < argc) && (argv[arg][0] == '-'); arg += 2 )
+  {
+    if ( strcmp( argv[arg], "-i" ) == 0 )
+    {
+      interval = strtoul( argv[arg + 1], NULL, 0 );
+    }
+    else if ( strcmp( argv[arg], "-n" ) == 0 )
+    {
+      sites = (unsigned)strtoul( argv[arg + 1], NULL, 0 );
+    }
+    else if ( strcmp( argv[arg], "-k" ) == 0 )
+    {
+      kick = strtoul( argv[arg + 1], NULL, 0 );
+    }
+    else
+    {
+      break;
+    }
+  }
+  if ( (arg != argc - 1) || ((fp = fopen( argv[arg], "rb" )) == NULL) )
+  {
+    fprintf( stderr, "usage: %s [-i ms] [-n sites] [-k events] trace\n", argv[0] );
+    return 1;
+  }
+
+  InitBoard( OB_COLD );
+  memset( stats, 0, sizeof( stats ) );
+  for ( h = 0; h < REPLAY_HEAPS; h++ )
+  {
+    replayHeaps[h].init();
+  }
+
+  nextLine = interval;
+  if ( interval != 0 )
+  {
+    printf( "%10s %8s", "ms", "live" );
+    for ( h = 0; h < REPLAY_HEAPS; h++ )
+    {
+      printf( " %9s.used %9s.frag", replayHeaps[h].name, replayHeaps[h].name );
+    }
+    printf( "\n" );
+  }
+
+  while ( fread( hdr, sizeof( hdr ), 1, fp ) == 1 )
+  {
+    uint8 cnt = hdr[2];
+
+    lost += BUILD_UINT16( hdr[0], hdr[1] );
+
+    while ( cnt-- != 0 )
+    {
+      uint16 t, size, block, caller;
+      uint8 task, op;
+      replayBlock_t *blk;
+
+      if ( fread( evt, sizeof( evt ), 1, fp ) != 1 )
+      {
+        fprintf( stderr, "%s: truncated\n", argv[arg] );
+        break;
+      }
+      t = BUILD_UINT16( evt[0], evt[1] );
+      size = BUILD_UINT16( evt[2], evt[3] );
+      block = BUILD_UINT16( evt[4], evt[5] );
+      caller = BUILD_UINT16( evt[6], evt[7] );
+      task = evt[8];
+      op = evt[9];
+
+      // The tick is the low 16 bits of the ms clock.
+      tick += (uint16)(t - lastTick);
+      lastTick = t;
+      if ( events == 0 )
+      {
+        tick = 0;
+        nextLine = interval;
+      }
+      if ( events == kick )
+      {
+        osal_mem_kick();
+      }
+      events++;
+
+      blk = &replayBlocks[block];
+      if ( op == OSALMEM_TRACE_ALLOC )
+      {
+        if ( blk->live )
+        {
+          unmatched++;  // its free was lost
+        }
+        else
+        {
+          blk->live = TRUE;
+          blk->liveIdx = replayLiveCnt;
+          replayLive[replayLiveCnt++] = block;
+          liveBytes += replayBlockLen( size );
+        }
+        blk->size = size;
+        blk->caller = caller;
+        blk->task = task;
+        for ( h = 0; h < REPLAY_HEAPS; h++ )
+        {
+          blk->ptr[h] = replayHeaps[h].alloc( size );
+          if ( blk->ptr[h] == NULL )
+          {
+            stats[h].failed++;
+          }
+        }
+        if ( liveBytes > replayPeakBytes )
+        {
+          replayPeakBytes = liveBytes;
+          replayPeak( tick );
+        }
+      }
+      else if ( op == OSALMEM_TRACE_FREE )
+      {
+        if ( !blk->live )
+        {
+          unmatched++;  // allocated before the trace
+          continue;
+        }
+        for ( h = 0; h < REPLAY_HEAPS; h++ )
+        {
+          if ( blk->ptr[h] != NULL )
+          {
+            replayHeaps[h].free( blk->ptr[h] );
+            blk->ptr[h] = NULL;
+          }
+        }
+        blk->live = FALSE;
+        replayLive[blk->liveIdx] = replayLive[--replayLiveCnt];
+        replayBlocks[replayLive[blk->liveIdx]].liveIdx = blk->liveIdx;
+        liveBytes -= replayBlockLen( blk->size );
+      }
+      else
+      {
+        devFailed++;
+        continue;
+      }
+
+      for ( h = 0; h < REPLAY_HEAPS; h++ )
+      {
+        uint16 largest;
+        uint16 freeB = replayHeaps[h].freeBytes( &largest );
+        double frag = (freeB != 0) ? 1.0 - ((double)largest / freeB) : 0.0;
+
+        if ( stats[h].peak < (unsigned)(MAXMEMHEAP - freeB) )
+        {
+          stats[h].peak = MAXMEMHEAP - freeB;
+        }
+        stats[h].fragSum += frag;
+        if ( stats[h].fragWorst < frag )
+        {
+          stats[h].fragWorst = frag;
+        }
+      }
+
+      while ( (interval != 0) && (tick >= nextLine) )
+      {
+        printf( "%10lu %8lu", nextLine, liveBytes );
+        for ( h = 0; h < REPLAY_HEAPS; h++ )
+        {
+          uint16 largest;
+          uint16 freeB = replayHeaps[h].freeBytes( &largest );
+
+          printf( " %14u %13.1f%%", MAXMEMHEAP - freeB,
+                  (freeB != 0) ? 100.0 * (1.0 - ((double)largest / freeB)) : 0.0 );
+        }
+        printf( "\n" );
+        nextLine += interval;
+      }
+    }
+  }
+  fclose( fp );
+
+  printf( "\n%lu events over %lu ms, %lu lost in the trace, %lu unmatched, "
+          "%lu failed on the device\n", events, tick, lost, unmatched, devFailed );
+  printf( "heap %u bytes\n\n", MAXMEMHEAP );
+  printf( "%-8s %8s %10s %10s %10s\n", "", "failed", "peak", "frag.mean", "frag.worst" );
+  for ( h = 0; h < REPLAY_HEAPS; h++ )
+  {
+    printf( "%-8s %8lu %10u %9.1f%% %9.1f%%\n", replayHeaps[h].name, stats[h].failed,
+            stats[h].peak, (events != 0) ? (100.0 * stats[h].fragSum / events) : 0.0,
+            100.0 * stats[h].fragWorst );
+  }
+
+  printf( "\nhigh-water mark: %lu bytes in use at %lu ms, by site\n", replayPeakBytes, replayPeakTick );
+  printf( "%6s %6s %8s %8s\n", "task", "caller", "blocks", "bytes" );
+  for ( arg = 0; (arg < (int)replayPeakSiteCnt) && (arg < (int)sites); arg++ )
+  {
+    replaySite_t *s = &replayPeakSites[arg];
+
+    if ( s->task == TASK_NO_TASK )
+    {
+      printf( "%6s", "-" );
+    }
+    else
+    {
+      printf( "%6u", s->task );
+    }
+    if ( s->caller == 0 )
+    {
+      printf( " %6s", "lib" );
+    }
+    else
+    {
+      printf( " %6u", s->caller );
+    }
+    printf( " %8u %8lu\n", s->count, s->bytes );
+  }
+
+  return 0;
+}
+
+/*********************************************************************
+ * @fn      replayPeak
+ *
+ * @brief   Records the blocks in use by site at a new high-water mark,
+ *          largest first.
+ *
+ * @param   tick - ms of the trace
+ *
+ * @return  none
+ */
+static void replayPeak( unsigned long tick )
+{
+  unsigned i, j;
+
+  replayPeakTick = tick;
+  replayPeakSites = realloc( replayPeakSites, replayLiveCnt * sizeof( replaySite_t ) );
+  replayPeakSiteCnt = 0;
+
+  for ( i = 0; i < replayLiveCnt; i++ )
+  {
+    replayBlock_t *blk = &replayBlocks[replayLive[i]];
+
+    for ( j = 0; j < replayPeakSiteCnt; j++ )
+    {
+      if ( (replayPeakSites[j].caller == blk->caller) && (replayPeakSites[j].task == blk->task) )
+      {
+        break;
+      }
+    }
+    if ( j == replayPeakSiteCnt )
+    {
+      replayPeakSites[j].caller = blk->caller;
+      replayPeakSites[j].task = blk->task;
+      replayPeakSites[j].count = 0;
+      replayPeakSites[j].bytes = 0;
+      replayPeakSiteCnt++;
+    }
+    replayPeakSites[j].count++;
+    replayPeakSites[j].bytes += replayBlockLen( blk->size );
+  }
+
+  qsort( replayPeakSites, replayPeakSiteCnt, sizeof( replaySite_t ), replaySiteCmp );
+}
+
+/*********************************************************************
+ * @fn      replaySiteCmp
+ *
+ * @brief   qsort() order of the sites: most bytes first.
+ */
+static int replaySiteCmp( const void *a, const void *b )
+{
+  unsigned long x = ((const replaySite_t *)a)->bytes;
+  unsigned long y = ((const replaySite_t *)b)->bytes;
+
+  return (x < y) - (x > y);
+}
+
+/*********************************************************************
+ * @fn      replayBlockLen
+ *
+ * @brief   Length of the target's block for an allocation, with its
+ *          header, rounded to it.
+ *
+ * @param   size - bytes asked for
+ *
+ * @return  block length
+ */
+static uint16 replayBlockLen( uint16 size )
+{
+  return (uint16)((size + (2 * REPLAY_HDRSZ) - 1) / REPLAY_HDRSZ * REPLAY_HDRSZ);
+}
+
+/*********************************************************************
+ * The OSAL heap
+ */
+static void osalInit( void )
+{
+  osal_mem_init();
+}
+
+static void *osalAlloc( uint16 size )
+{
+  return osal_mem_alloc( size );
+}
+
+static void osalFree( void *ptr )
+{
+  osal_mem_free( ptr );
+}
+
+static uint16 osalFreeBytes( uint16 *largest )
+{
+  return osal_heap_mem_free( largest );
+}
+
+/*********************************************************************
+ * The best-fit heap: the smallest free block that fits is split, and a
+ * freed block is merged with its free neighbours.
+ */
+static void bfInit( void )
+{
+  replayBf[0].offset = 0;
+  replayBf[0].len = MAXMEMHEAP;
+  replayBf[0].inUse = FALSE;
+  replayBfCnt = 1;
+}
+
+static void *bfAlloc( uint16 size )
+{
+  uint16 len = replayBlockLen( size );
+  unsigned best = replayBfCnt;
+  unsigned i;
+
+  for ( i = 0; i < replayBfCnt; i++ )
+  {
+    if ( !replayBf[i].inUse && (replayBf[i].len >= len)
+        && ((best == replayBfCnt) || (replayBf[i].len < replayBf[best].len)) )
+    {
+      best = i;
+    }
+  }
+  if ( best == replayBfCnt )
+  {
+    return NULL;
+  }
+
+  if ( replayBf[best].len - len >= REPLAY_MIN_SPLIT )
+  {
+    memmove( &replayBf[best + 2], &replayBf[best + 1],
+             (replayBfCnt - best - 1) * sizeof( replayBfBlock_t ) );
+    replayBf[best + 1].offset = replayBf[best].offset + len;
+    replayBf[best + 1].len = replayBf[best].len - len;
+    replayBf[best + 1].inUse = FALSE;
+    replayBf[best].len = len;
+    replayBfCnt++;
+  }
+  replayBf[best].inUse = TRUE;
+
+  return replayBfHeap + replayBf[best].offset;
+}
+
+static void bfFree( void *ptr )
+{
+  uint16 offset = (uint16)((uint8 *)ptr - replayBfHeap);
+  unsigned lo = 0;
+  unsigned hi = replayBfCnt;
+  unsigned i;
+
+  while ( replayBf[i = (lo + hi) / 2].offset != offset )
+  {
+    if ( replayBf[i].offset < offset )
+    {
+      lo = i + 1;
+    }
+    else
+    {
+      hi = i;
+    }
+  }
+  replayBf[i].inUse = FALSE;
+
+  if ( (i + 1 < replayBfCnt) && !replayBf[i + 1].inUse )
+  {
+    replayBf[i].len += replayBf[i + 1].len;
+    memmove( &replayBf[i + 1], &replayBf[i + 2],
+             (replayBfCnt - i - 2) * sizeof( replayBfBlock_t ) );
+    replayBfCnt--;
+  }
+  if ( (i != 0) && !replayBf[i - 1].inUse )
+  {
+    replayBf[i - 1].len += replayBf[i].len;
+    memmove( &replayBf[i], &replayBf[i + 1],
+             (replayBfCnt - i - 1) * sizeof( replayBfBlock_t ) );
+    replayBfCnt--;
+  }
+}
+
+static uint16 bfFreeBytes( uint16 *largest )
+{
+  uint16 total = 0;
+  unsigned i;
+
+  *largest = 0;
+  for ( i = 0; i < replayBfCnt; i++ )
+  {
+    if ( !replayBf[i].inUse )
+    {
+      total += replayBf[i].len;
+      if ( *largest < replayBf[i].len )
+      {
+        *largest = replayBf[i].len;
+      }
+    }
+  }
+
+  return total;
+}
+
+/*********************************************************************
+ * The ideal heap: the blocks in use take only their own bytes, and the
+ * rest is one free block.
+ */
+static void idealInit( void )
+{
+  replayIdealUsed = 0;
+}
+
+static void *idealAlloc( uint16 size )
+{
+  uint16 len = replayBlockLen( size );
+  uint16 *blk;
+
+  if ( replayIdealUsed + len > MAXMEMHEAP )
+  {
+    return NULL;
+  }
+  blk = malloc( sizeof( uint16 ) );
+  *blk = len;
+  replayIdealUsed += len;
+
+  return blk;
+}
+
+static void idealFree( void *ptr )
+{
+  replayIdealUsed -= *(uint16 *)ptr;
+  free( ptr );
+}
+
+static uint16 idealFreeBytes( uint16 *largest )
+{
+  *largest = (uint16)(MAXMEMHEAP - replayIdealUsed);
+  return *largest;
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,652 @@
+/**************************************************************************************************
+  Filename:       LinkSim.c
+
+  Description:    Simulates the serial link of the coordinator of the
+                  GenericApp sample to the gateway on the Linux host, and
+                  measures the sensor reports per second it forwards
+                  intact, before and after the transmit queue of
+                  GatewayLink.c.
+
+  Sensor reports reach the coordinator at random (a Poisson process) at
+  each offered rate. A share of them are the 11-byte ASCII reports of
+  end devices predating SensorFrame.h, the others SensorFrame.h frames of
+  SIM_FRAME_LEN bytes. The application task takes one incoming message
+  per pass of the OSAL loop; the heap holds SIM_MSG_MAX of them, and a
+  report arriving beyond that is lost.
+
+  The UART is a model of the DMA driver of the CC2530 (_hal_uart_dma.c):
+  two transmit buffers of HAL_UART_DMA_TX_MAX bytes, a write taken whole
+  into the buffer being filled or not at all, the DMA started on it by
+  HalUARTPoll() once the other buffer is sent, and HAL_UART_TX_EMPTY
+  given to the callback at the next poll after a buffer is sent. The
+  bytes go out at the baud rate, 10 bits each, to a model of the gateway
+  that parses the frames of GatewayLink.h and the unframed ASCII reports,
+  and checks each against the report the coordinator sent.
+
+  Each rate runs three ways, on the same reports:
+
+      before    the coordinator as it was: each frame built on the stack
+                and written to the driver whole, or dropped if it does
+                not fit, and the ASCII reports written unframed. The
+                "for(i=0;i<60000;i++) break;" after them never looped,
+                so costs nothing.
+      spin      the same, with the 60000-iteration busy-wait the loop
+                was meant to be, costing -w us (22500, 60000 passes of
+                about 12 cycles at 32 MHz) of the OSAL loop after each
+                ASCII report, during which nothing polls the UART.
+      after     GatewayLink.c, linked as it is built for the coordinator:
+                every report framed into its 256-byte queue and drained
+                into the driver on HAL_UART_TX_EMPTY.
+
+  For each it prints the reports per second the gateway received intact,
+  the share of the offered reports lost, and the mean time from the
+  arrival of a report at the coordinator to its last byte at the gateway.
+
+  Build on the Linux host target (see Projects/zstack/ZMain/LINUX/OnBoard.h)
+  with "make LinkSim".
+
+  Usage: LinkSim [-b baud] [-t seconds] [-l percent] [-w us]
+    -b  baud rate of the link (9600)
+    -t  length of each run, in seconds (60)
+    -l  share of ASCII reports, in percent (50)
+    -w  cost of the busy-wait of the spin runs, in us (22500)
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "hal_uart.h"
+
+#include "GatewayLink.h"
+#include "SensorFrame.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define HAL_UART_DMA_TX_MAX   128     // the transmit buffers of the DMA driver
+#define SIM_LOOP_US           100     // a pass of the OSAL loop
+#define SIM_MSG_MAX           24      // incoming messages the heap holds
+#define SIM_FRAME_LEN         16      // a SensorFrame.h report with three readings
+#define SIM_SENT_MAX          128     // reports in flight to the gateway
+
+// Ways to run
+#define SIM_BEFORE            0
+#define SIM_SPIN              1
+#define SIM_AFTER             2
+
+// States of the model of the gateway
+#define SIM_RX_SOF            0
+#define SIM_RX_LEN            1
+#define SIM_RX_TYPE           2
+#define SIM_RX_SEQ            3
+#define SIM_RX_DATA           4
+#define SIM_RX_FCS            5
+#define SIM_RX_ASCII          6
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// A sensor report, as received by the coordinator or sent to the gateway
+typedef struct
+{
+  uint32 arrival;               // us
+  uint8 ascii;                  // an ASCII report
+  uint8 framed;                 // sent in a frame
+  uint8 len;
+  uint8 data[2 + SENSORFRAME_MAX_LEN];   // NWK addr (LSB first), report
+} simReport_t;
+
+typedef struct
+{
+  unsigned long offered;
+  unsigned long lost;           // by the heap, the driver or the queue
+  unsigned long intact;
+  unsigned long broken;
+  double latency;               // us, summed over the intact reports
+} simCounts_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static long simBaud = 9600;
+static long simSeconds = 60;
+static int simAsciiShare = 50;
+static long simSpinUs = 22500;
+
+static uint32 simRandState;
+static uint32 simNow;
+static uint32 simByteUs;
+static simCounts_t simCounts;
+
+// The incoming messages of the application task
+static simReport_t simMsgs[SIM_MSG_MAX];
+static uint8 simMsgHead;
+static uint8 simMsgCnt;
+
+// The reports sent, in the order the gateway should receive them
+static simReport_t simSent[SIM_SENT_MAX];
+static uint8 simSentHead;
+static uint8 simSentCnt;
+
+// The DMA driver
+static halUARTCBack_t simUartCB;
+static uint8 simTxBuf[2][HAL_UART_DMA_TX_MAX];
+static uint8 simTxIdx[2];
+static uint8 simTxSel;
+static uint8 simTxMT;
+static uint8 simTxDMAPending;
+static uint8 simTxActive;       // the buffer being sent, or 0xFF
+static uint8 simTxSent;
+static uint32 simTxNextByte;    // us
+
+// The gateway
+static uint8 simRxState;
+static uint8 simRxLen;
+static uint8 simRxFcs;
+static uint8 simRxCnt;
+static uint8 simRxBuf[GATEWAYLINK_HDR_LEN + GATEWAYLINK_MAX_DATA_LEN];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint32 simRand( void );
+static uint16 simSendDirect( uint8 type, uint8 seq, uint8 *data, uint8 len );
+static void simLine( void );
+static void simReceive( uint8 ch );
+static void simCheck( uint8 framed, uint8 *data, uint8 len );
+static void simForward( simReport_t *report, uint8 how, uint8 seq );
+static void simRun( uint32 seed, uint8 how, double rate );
+
+/*********************************************************************
+ * The OSAL, as far as GatewayLink.c calls it. Nothing is received
+ * from the gateway, so no message is ever allocated.
+ */
+
+void *osal_memset( void *dest, uint8 value, int len )
+{
+  return memset( dest, value, len );
+}
+
+uint8 *osal_msg_allocate( uint16 len )
+{
+  (void)len;
+  return NULL;
+}
+
+uint8 osal_msg_send( uint8 destination_task, uint8 *msg_ptr )
+{
+  (void)destination_task;
+  (void)msg_ptr;
+  return INVALID_MSG_POINTER;
+}
+
+uint8 osal_msg_deallocate( uint8 *msg_ptr )
+{
+  (void)msg_ptr;
+  return INVALID_MSG_POINTER;
+}
+
+/*********************************************************************
+ * The DMA driver of the UART, after _hal_uart_dma.c.
+ */
+
+uint8 HalUARTOpen( uint8 port, halUARTCfg_t *config )
+{
+  (void)port;
+  simUartCB = config->callBackFunc;
+  return HAL_UART_SUCCESS;
+}
+
+uint16 HalUARTRead( uint8 port, uint8 *pBuffer, uint16 length )
+{
+  (void)port;
+  (void)pBuffer;
+  (void)length;
+  return 0;
+}
+
+uint16 Hal_UART_RxBufLen( uint8 port )
+{
+  (void)port;
+  return 0;
+}
+
+/*********************************************************************
+ * @fn      HalUARTWrite
+ *
+ * @brief   HalUARTWriteDMA(): all or none, into the buffer being
+ *          filled; the DMA is to be started on it if the other one is
+ *          idle.
+ */
+uint16 HalUARTWrite( uint8 port, uint8 *pBuffer, uint16 length )
+{
+  (void)port;
+
+  if ( length + simTxIdx[simTxSel] > HAL_UART_DMA_TX_MAX )
+  {
+    return 0;
+  }
+  memcpy( &simTxBuf[simTxSel][simTxIdx[simTxSel]], pBuffer, length );
+  simTxIdx[simTxSel] += (uint8)length;
+  if ( simTxIdx[simTxSel ^ 1] == 0 )
+  {
+    simTxDMAPending = TRUE;
+  }
+  return length;
+}
+
+/*********************************************************************
+ * @fn      HalUARTPoll
+ *
+ * @brief   HalUARTPollDMA(): starts the DMA on the buffer being filled
+ *          and gives HAL_UART_TX_EMPTY to the callback once a buffer is
+ *          sent.
+ */
+void HalUARTPoll( void )
+{
+  uint8 evt = 0;
+
+  if ( simTxMT )
+  {
+    simTxMT = FALSE;
+    evt |= HAL_UART_TX_EMPTY;
+  }
+
+  if ( simTxDMAPending && (simTxActive == 0xFF) )
+  {
+    simTxDMAPending = FALSE;
+    simTxActive = simTxSel;
+    simTxSent = 0;
+    simTxNextByte = simNow + simByteUs;
+    simTxSel ^= 1;
+  }
+
+  if ( evt && (simUartCB != NULL) )
+  {
+    simUartCB( GATEWAYLINK_PORT, evt );
+  }
+}
+
+/*********************************************************************
+ * @fn      simLine
+ *
+ * @brief   Sends the bytes of the DMA up to now to the gateway, then
+ *          does as HalUARTIsrDMA() at the end of the buffer.
+ */
+static void simLine( void )
+{
+  while ( (simTxActive != 0xFF) && (simTxNextByte <= simNow) )
+  {
+    simReceive( simTxBuf[simTxActive][simTxSent++] );
+    simTxNextByte += simByteUs;
+    if ( simTxSent == simTxIdx[simTxActive] )
+    {
+      simTxIdx[simTxActive] = 0;
+      simTxActive = 0xFF;
+      simTxMT = TRUE;
+      if ( simTxIdx[simTxSel] )
+      {
+        simTxDMAPending = TRUE;
+      }
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      simRand
+ *
+ * @brief   xorshift32, so that the runs of a rate draw the same reports.
+ */
+static uint32 simRand( void )
+{
+  simRandState ^= simRandState << 13;
+  simRandState ^= simRandState >> 17;
+  simRandState ^= simRandState << 5;
+  return simRandState;
+}
+
+/*********************************************************************
+ * @fn      simSendDirect
+ *
+ * @brief   GatewayLink_SendFrame() before the transmit queue: the frame
+ *          built on the stack and written to the driver whole.
+ *
+ * @return  the bytes written, 0 if the frame was dropped
+ */
+static uint16 simSendDirect( uint8 type, uint8 seq, uint8 *data, uint8 len )
+{
+  uint8 frame[GATEWAYLINK_HDR_LEN + GATEWAYLINK_MAX_DATA_LEN + 1];
+  uint8 fcs;
+  uint8 i;
+
+  frame[0] = GATEWAYLINK_SOF;
+  frame[1] = len;
+  frame[2] = type;
+  frame[3] = seq;
+  memcpy( &frame[GATEWAYLINK_HDR_LEN], data, len );
+
+  fcs = 0;
+  for ( i = 1; i < GATEWAYLINK_HDR_LEN + len; i++ )
+  {
+    fcs ^= frame[i];
+  }
+  frame[GATEWAYLINK_HDR_LEN + len] = fcs;
+
+  return HalUARTWrite( GATEWAYLINK_PORT, frame, GATEWAYLINK_HDR_LEN + len + 1 );
+}
+
+/*********************************************************************
+ * @fn      simForward
+ *
+ * @brief   The coordinator forwarding a report, as
+ *          GenericApp_MessageMSGCB() did before or does after, and
+ *          remembering what the gateway should get if it was taken.
+ */
+static void simForward( simReport_t *report, uint8 how, uint8 seq )
+{
+  simReport_t *sent = &simSent[(uint8)(simSentHead + simSentCnt) % SIM_SENT_MAX];
+  uint8 taken;
+
+  if ( how == SIM_AFTER )
+  {
+    taken = ( GatewayLink_SendFrame( report->ascii ? GATEWAYLINK_TYPE_LEGACY_REPORT
+                                                   : GATEWAYLINK_TYPE_SENSOR_REPORT,
+                                     seq, report->data, report->len ) == SUCCESS );
+    *sent = *report;
+    sent->framed = TRUE;
+  }
+  else if ( report->ascii )
+  {
+    taken = ( HalUARTWrite( GATEWAYLINK_PORT, &report->data[2], SENSORFRAME_LEGACY_LEN ) != 0 );
+    *sent = *report;
+    sent->framed = FALSE;
+    sent->len = SENSORFRAME_LEGACY_LEN;
+    memmove( sent->data, &report->data[2], SENSORFRAME_LEGACY_LEN );
+    if ( how == SIM_SPIN )
+    {
+      // Nothing runs meanwhile; the DMA goes on
+      simNow += (uint32)simSpinUs;
+      simLine();
+    }
+  }
+  else
+  {
+    taken = ( simSendDirect( GATEWAYLINK_TYPE_SENSOR_REPORT, seq, report->data,
+                             report->len ) != 0 );
+    *sent = *report;
+    sent->framed = TRUE;
+  }
+
+  if ( !taken )
+  {
+    simCounts.lost++;
+  }
+  else if ( simSentCnt < SIM_SENT_MAX )
+  {
+    simSentCnt++;
+  }
+}
+
+/*********************************************************************
+ * @fn      simReceive
+ *
+ * @brief   The gateway parsing a byte from the coordinator: a frame of
+ *          GatewayLink.h, or an unframed ASCII report.
+ */
+static void simReceive( uint8 ch )
+{
+  switch ( simRxState )
+  {
+    case SIM_RX_SOF:
+      if ( ch == GATEWAYLINK_SOF )
+      {
+        simRxState = SIM_RX_LEN;
+      }
+      else if ( ch == SENSORFRAME_LEGACY_START )
+      {
+        simRxBuf[0] = ch;
+        simRxCnt = 1;
+        simRxState = SIM_RX_ASCII;
+      }
+      break;
+
+    case SIM_RX_ASCII:
+      simRxBuf[simRxCnt++] = ch;
+      if ( simRxCnt == SENSORFRAME_LEGACY_LEN )
+      {
+        simCheck( FALSE, simRxBuf, SENSORFRAME_LEGACY_LEN );
+        simRxState = SIM_RX_SOF;
+      }
+      break;
+
+    case SIM_RX_LEN:
+      simRxLen = ch;
+      simRxFcs = ch;
+      simRxCnt = 0;
+      simRxState = ( ch > GATEWAYLINK_MAX_DATA_LEN ) ? SIM_RX_SOF : SIM_RX_TYPE;
+      break;
+
+    case SIM_RX_TYPE:
+    case SIM_RX_SEQ:
+      simRxFcs ^= ch;
+      simRxState = ( simRxState == SIM_RX_TYPE ) ? SIM_RX_SEQ
+                 : ( simRxLen ? SIM_RX_DATA : SIM_RX_FCS );
+      break;
+
+    case SIM_RX_DATA:
+      simRxBuf[simRxCnt++] = ch;
+      simRxFcs ^= ch;
+      if ( simRxCnt == simRxLen )
+      {
+        simRxState = SIM_RX_FCS;
+      }
+      break;
+
+    case SIM_RX_FCS:
+      if ( ch == simRxFcs )
+      {
+        simCheck( TRUE, simRxBuf, simRxLen );
+      }
+      else
+      {
+        simCounts.broken++;
+      }
+      simRxState = SIM_RX_SOF;
+      break;
+  }
+}
+
+/*********************************************************************
+ * @fn      simCheck
+ *
+ * @brief   Checks a report received by the gateway against the next one
+ *          sent; a report that does not match is broken.
+ */
+static void simCheck( uint8 framed, uint8 *data, uint8 len )
+{
+  simReport_t *sent = &simSent[simSentHead];
+
+  if ( (simSentCnt == 0) || (sent->framed != framed) || (sent->len != len)
+      || (memcmp( sent->data, data, len ) != 0) )
+  {
+    simCounts.broken++;
+    return;
+  }
+  simCounts.intact++;
+  simCounts.latency += simTxNextByte - sent->arrival;
+  simSentHead = (uint8)(simSentHead + 1) % SIM_SENT_MAX;
+  simSentCnt--;
+}
+
+/*********************************************************************
+ * @fn      simRun
+ *
+ * @brief   Runs one way at one offered rate, in reports per second.
+ */
+static void simRun( uint32 seed, uint8 how, double rate )
+{
+  uint32 end = (uint32)simSeconds * 1000000;
+  uint32 nextArrival;
+  uint8 seq = 0;
+  uint8 i;
+
+  memset( &simCounts, 0, sizeof( simCounts ) );
+  simRandState = seed;
+  simNow = 0;
+  simMsgHead = 0;
+  simMsgCnt = 0;
+  simSentHead = 0;
+  simSentCnt = 0;
+  memset( simTxIdx, 0, sizeof( simTxIdx ) );
+  simTxSel = 0;
+  simTxMT = FALSE;
+  simTxDMAPending = FALSE;
+  simTxActive = 0xFF;
+  simRxState = SIM_RX_SOF;
+  simUartCB = NULL;
+  GatewayLink_Init( 0 );
+  GatewayLink_TxDropped = 0;
+
+  nextArrival = (uint32)(-log( (simRand() + 1.0) / 4294967296.0 ) / rate * 1e6);
+  while ( simNow < end )
+  {
+    // The reports received by the radio up to now
+    while ( nextArrival <= simNow )
+    {
+      simReport_t *report = &simMsgs[(uint8)(simMsgHead + simMsgCnt) % SIM_MSG_MAX];
+
+      report->arrival = nextArrival;
+      report->ascii = ( (int)(simRand() % 100) < simAsciiShare );
+      report->data[0] = (uint8)simRand();
+      report->data[1] = (uint8)simRand();
+      if ( report->ascii )
+      {
+        report->len = 2 + SENSORFRAME_LEGACY_LEN;
+        report->data[2] = SENSORFRAME_LEGACY_START;
+        for ( i = 3; i < report->len; i++ )
+        {
+          report->data[i] = (uint8)('0' + simRand() % 10);
+        }
+      }
+      else
+      {
+        report->len = 2 + SIM_FRAME_LEN;
+        for ( i = 2; i < report->len; i++ )
+        {
+          report->data[i] = (uint8)simRand();
+        }
+      }
+      simCounts.offered++;
+      if ( simMsgCnt < SIM_MSG_MAX )
+      {
+        simMsgCnt++;
+      }
+      else
+      {
+        simCounts.lost++;
+      }
+      nextArrival += (uint32)(-log( (simRand() + 1.0) / 4294967296.0 ) / rate * 1e6);
+    }
+
+    // A pass of the OSAL loop: the HAL, then a message of the application
+    simLine();
+    HalUARTPoll();
+    if ( simMsgCnt )
+    {
+      simForward( &simMsgs[simMsgHead], how, seq++ );
+      simMsgHead = (uint8)(simMsgHead + 1) % SIM_MSG_MAX;
+      simMsgCnt--;
+    }
+    simNow += SIM_LOOP_US;
+  }
+
+  printf( " %8.1f %5.1f%% %6.0f",
+          simCounts.intact / (double)simSeconds,
+          100.0 * simCounts.lost / simCounts.offered,
+          simCounts.intact ? simCounts.latency / simCounts.intact / 1000 : 0.0 );
+  if ( simCounts.broken )
+  {
+    printf( " (%lu broken)", simCounts.broken );
+  }
+}
+
+/*********************************************************************
+ * @fn      main
+ *
+ * @brief   Runs the offered rates.
+ *
+ * @param   argc, argv - see the usage above
+ *
+ * @return  0, or 1 for a bad argument
+ */
+int main( int argc, char **argv )
+{
+  static const int rates[] = { 10, 20, 30, 40, 50, 60, 80, 100 };
+  unsigned int r;
+  uint8 how;
+  int opt;
+
+  while ( (opt = getopt( argc, argv, "b:t:l:w:" )) != -1 )
+  {
+    if ( (opt == 'b') && (atol( optarg ) >= 1200) )
+    {
+      simBaud = atol( optarg );
+    }
+    else if ( (opt == 't') && (atol( optarg ) > 0) && (atol( optarg ) <= 3600) )
+    {
+      simSeconds = atol( optarg );
+    }
+    else if ( (opt == 'l') && (atoi( optarg ) >= 0) && (atoi( optarg ) <= 100) )
+    {
+      simAsciiShare = atoi( optarg );
+    }
+    else if ( (opt == 'w') && (atol( optarg ) >= 0) )
+    {
+      simSpinUs = atol( optarg );
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-b baud] [-t seconds] [-l percent] [-w us]\n", argv[0] );
+      return 1;
+    }
+  }
+  simByteUs = (uint32)((10 * 1000000L + simBaud / 2) / simBaud);
+
+  printf( "%ld baud, %ld s, %d%% ASCII reports, %d-byte SensorFrame reports, "
+          "busy-wait %ld us\n", simBaud, simSeconds, simAsciiShare, SIM_FRAME_LEN, simSpinUs );
+  printf( "  %7s |%-23s|%-23s|%-23s|\n", "offered", " before", " spin", " after" );
+  printf( "  %7s |", "/s" );
+  for ( how = SIM_BEFORE; how <= SIM_AFTER; how++ )
+  {
+    printf( " %8s %6s %6s|", "intact/s", "lost", "ms" );
+  }
+  printf( "\n" );
+
+  for ( r = 0; r < sizeof( rates ) / sizeof( rates[0] ); r++ )
+  {
+    printf( "  %7d |", rates[r] );
+    for ( how = SIM_BEFORE; how <= SIM_AFTER; how++ )
+    {
+      simRun( (uint32)rates[r], how, rates[r] );
+      printf( "|" );
+    }
+    printf( "\n" );
+  }
+  return 0;
+}
+
+/*********************************************************************
+*********************************************************************/
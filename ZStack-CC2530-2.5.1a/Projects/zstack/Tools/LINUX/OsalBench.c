@@ -0,0 +1,1105 @@
+/**************************************************************************************************
+  Filename:       OsalBench.c
+
+  Description:    Microbenchmarks of the OSAL core on the Linux host
+                  target: messages, event dispatch, timers and the heap.
+
+  Each benchmark repeats one OSAL operation, or a short sequence of them,
+  and prints its rate and its cost:
+
+      <name>                              <ops/s> ops/s  <ns> ns/op  <cycles> cycles/op
+
+  Cycles are counted with the time stamp counter on x86; elsewhere the
+  column shows "-". The numbers are of the host, not of the 8051, but the
+  OSAL source is the target's, so they compare versions of it: run the
+  suite before and after a change, on the same machine, with the same
+  flags. Take the best of a few runs (-n).
+
+  The suites are:
+
+      msg       osal_msg_allocate(), osal_msg_send(), osal_msg_receive()
+                and osal_msg_deallocate() of one message, with other
+                messages queued to another task; with 128 messages
+                queued over 15 tasks, receives and sends round robin,
+                and osal_msg_find() on the task with none; and queues
+                filled and drained
+      dispatch  osal_set_event() and the pass of osal_run_system() that
+                runs it, for tasks 0, 7, 15 and 31, and an idle pass;
+                and a check of the order of dispatch
+      pool      random starts and stops of timers, and how many of their
+                records come from the pool of OSAL_TIMERS_POOL_SIZE
+      timer     timer start, stop, restart, lookup and ticks with 8, 32
+                and 128 timers running; ticks that reload a timer, and
+                random restarts of timers that keep falling due
+      heap      osal_mem_alloc() and osal_mem_free() in random order over
+                16 to 64 live blocks of message-like sizes, up to near
+                capacity; the same steps checked for corrupt blocks, and
+                with OSALMEM_METRICS, the fragmentation of the heap
+
+  Build on the Linux host target with the makefile of this directory, or
+  (see Projects/zstack/ZMain/LINUX/OnBoard.h):
+
+    gcc -std=gnu99 -O2 -DUBIT -DRTR_NWK -DINT_HEAP_LEN=8192 -DOSALMEM_LL_BLKSZ=1024 \
+        -I Components/hal/target/LINUX -I Projects/zstack/ZMain/LINUX \
+        -I Components/hal/include -I Components/osal/include \
+        Components/osal/common/OSAL.c Components/osal/common/OSAL_Clock.c \
+        Components/osal/common/OSAL_Memory.c Components/osal/common/OSAL_PwrMgr.c \
+        Components/osal/common/OSAL_Timers.c Projects/zstack/ZMain/LINUX/OnBoard.c \
+        Projects/zstack/Tools/LINUX/OsalBench.c -o OsalBench
+
+  The heap is larger than the target's 3072 bytes so that 128 timers fit
+  with 8-byte pointers. For the same reason the long-lived allocations of
+  the 32 tasks outgrow the target's long-lived block, and would be left
+  in the way of every heap walk; OSALMEM_LL_BLKSZ makes room for them.
+  To compare builds of the OSAL, pass their flags, e.g. "make clean
+  bench BENCH_FLAGS=-DOSAL_TIMERS_POOL_SIZE=0", or
+  BENCH_FLAGS="-DOSALMEM_METRICS=TRUE -DOSALMEM_SEGREGATED=TRUE" for the
+  heap's size classes.
+
+  Usage: OsalBench [-n runs] [suite ...]
+    -n  runs of each benchmark, of which the fastest is printed (3)
+    suite names as above; all of them by default
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+  #include <x86intrin.h>
+#endif
+
+#include "comdef.h"
+#include "OnBoard.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "OSAL_Timers.h"
+#include "OSAL_Memory.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define BENCH_TASKS       32
+
+// Timer of the benchmarks: the top event of the last task, which the
+// background timers of benchTimerStart() leave free
+#define BENCH_TIMER_TASK  (BENCH_TASKS - 1)
+#define BENCH_TIMER_EVT   0x8000
+
+// Timers that fit in the 16 events of the tasks, less the one above
+#define BENCH_MAX_TIMERS  (BENCH_TASKS * 16 - 1)
+
+// Tasks of the message benchmarks, and messages queued over all of
+// them but the last in the queue benchmarks
+#define BENCH_MSG_TASKS   16
+#define BENCH_MSG_QUEUED  128
+
+// Largest number of live blocks of the heap benchmarks
+#define BENCH_MAX_LIVE    64
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  const char *name;
+  void (*fn)( void );
+} benchSuite_t;
+
+// Block mix of a heap benchmark: live slots, and the share and largest
+// size of the large blocks
+typedef struct
+{
+  const char *name;
+  int live;
+  int largePct;
+  uint16 largeMax;
+} benchHeapMix_t;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint16 benchTask( uint8 task_id, uint16 events );
+static void benchStart( void );
+static void benchPause( void );
+static void benchResume( void );
+static void benchStop( const char *name, unsigned long ops );
+static uint32 benchRand( void );
+static void benchTimerStart( int count, uint16 timeout );
+static void benchTimerStopAll( void );
+static void benchMsgDrain( void );
+static void benchMsg( void );
+static void benchDispatch( void );
+static void benchTimer( void );
+static int benchPoolStep( int ids, bool count );
+static void benchPool( void );
+static uint16 benchHeapSize( const benchHeapMix_t *mix );
+static void benchHeapCheck( const benchHeapMix_t *mix, unsigned long ops );
+static void benchHeap( void );
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+const pTaskEventHandlerFn tasksArr[BENCH_TASKS] =
+{
+  benchTask, benchTask, benchTask, benchTask,
+  benchTask, benchTask, benchTask, benchTask,
+  benchTask, benchTask, benchTask, benchTask,
+  benchTask, benchTask, benchTask, benchTask,
+  benchTask, benchTask, benchTask, benchTask,
+  benchTask, benchTask, benchTask, benchTask,
+  benchTask, benchTask, benchTask, benchTask,
+  benchTask, benchTask, benchTask, benchTask
+};
+const uint8 tasksCnt = BENCH_TASKS;
+uint16 *tasksEvents;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const benchSuite_t benchSuites[] =
+{
+  { "msg", benchMsg },
+  { "dispatch", benchDispatch },
+  { "pool", benchPool },
+  { "timer", benchTimer },
+  { "heap", benchHeap }
+};
+
+#define BENCH_SUITES  ( sizeof( benchSuites ) / sizeof( benchSuites[0] ) )
+
+// The last mix keeps the heap of INT_HEAP_LEN 8192 near capacity
+static const benchHeapMix_t benchHeapMixes[] =
+{
+  { "heap, small blocks,   16 live", 16, 0, 48 },
+  { "heap, 30% large,      24 live", 24, 30, 160 },
+  { "heap, 30% large,      48 live", 48, 30, 160 },
+  { "heap, near capacity,  64 live", 64, 50, 480 }
+};
+
+static int benchRuns = 3;
+
+// Time of the run being timed, up to its last pause or resume
+static struct timespec benchT0;
+static unsigned long long benchC0;
+static double benchNs;
+static double benchCycles;
+
+// Best of the runs of the benchmark being timed
+static int benchRun;
+static double benchBestNs;
+static double benchBestCycles;
+
+static uint32 benchSeed;
+static volatile uint32 benchSink;
+
+// Last handler call
+static uint8 benchLastTask;
+static uint16 benchLastEvents;
+
+/*********************************************************************
+ * @fn      osalInitTasks
+ *
+ * @brief   Allocates the events of the tasks.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osalInitTasks( void )
+{
+  tasksEvents = (uint16 *)osal_mem_alloc( sizeof( uint16 ) * tasksCnt );
+  osal_memset( tasksEvents, 0, sizeof( uint16 ) * tasksCnt );
+}
+
+/*********************************************************************
+ * @fn      benchTask
+ *
+ * @brief   Handler of every task: takes all its events.
+ *
+ * @param   task_id - task
+ * @param   events  - events set
+ *
+ * @return  none left
+ */
+static uint16 benchTask( uint8 task_id, uint16 events )
+{
+  benchLastTask = task_id;
+  benchLastEvents = events;
+  benchSink += events;
+  return 0;
+}
+
+/*********************************************************************
+ * @fn      benchStart
+ *
+ * @brief   Starts timing a run.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchStart( void )
+{
+  benchNs = 0;
+  benchCycles = 0;
+  benchResume();
+}
+
+/*********************************************************************
+ * @fn      benchPause
+ *
+ * @brief   Stops the clock of a run, to set up the next part of it.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchPause( void )
+{
+  struct timespec t1;
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+  benchCycles += (double)(__rdtsc() - benchC0);
+#endif
+  clock_gettime( CLOCK_MONOTONIC, &t1 );
+  benchNs += (t1.tv_sec - benchT0.tv_sec) * 1e9 + (t1.tv_nsec - benchT0.tv_nsec);
+}
+
+/*********************************************************************
+ * @fn      benchResume
+ *
+ * @brief   Restarts the clock of a run.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchResume( void )
+{
+  clock_gettime( CLOCK_MONOTONIC, &benchT0 );
+#if defined( __x86_64__ ) || defined( __i386__ )
+  benchC0 = __rdtsc();
+#endif
+}
+
+/*********************************************************************
+ * @fn      benchStop
+ *
+ * @brief   Ends the timing of a run, and prints the best of the runs
+ *          of the benchmark after the last one.
+ *
+ * @param   name - benchmark
+ * @param   ops  - operations of the run
+ *
+ * @return  none
+ */
+static void benchStop( const char *name, unsigned long ops )
+{
+  benchPause();
+  if ( (benchRun == 0) || (benchNs / ops < benchBestNs) )
+  {
+    benchBestNs = benchNs / ops;
+    benchBestCycles = benchCycles / ops;
+  }
+  if ( ++benchRun < benchRuns )
+  {
+    return;
+  }
+  benchRun = 0;
+
+  if ( benchBestCycles > 0 )
+  {
+    printf( "%-40s %12.0f ops/s %8.1f ns/op %8.1f cycles/op\n",
+            name, 1e9 / benchBestNs, benchBestNs, benchBestCycles );
+  }
+  else
+  {
+    printf( "%-40s %12.0f ops/s %8.1f ns/op %8s cycles/op\n",
+            name, 1e9 / benchBestNs, benchBestNs, "-" );
+  }
+}
+
+/*********************************************************************
+ * @fn      benchRand
+ *
+ * @brief   Pseudo-random numbers, the same on every run.
+ *
+ * @param   none
+ *
+ * @return  24 random bits
+ */
+static uint32 benchRand( void )
+{
+  benchSeed = benchSeed * 1103515245u + 12345u;
+  return benchSeed >> 8;
+}
+
+/*********************************************************************
+ * @fn      benchTimerStart
+ *
+ * @brief   Starts background timers, one per task and event, with
+ *          timeouts spread over a second past the one given.
+ *
+ * @param   count   - timers, at most BENCH_MAX_TIMERS
+ * @param   timeout - shortest timeout, in ms
+ *
+ * @return  none
+ */
+static void benchTimerStart( int count, uint16 timeout )
+{
+  int i;
+
+  for ( i = 0; i < count; i++ )
+  {
+    osal_start_timerEx( i % BENCH_TASKS, BV( i / BENCH_TASKS ),
+                        timeout + (i * 37) % 1000 );
+  }
+}
+
+/*********************************************************************
+ * @fn      benchTimerStopAll
+ *
+ * @brief   Stops every timer, and clears the events they set. Stopped
+ *          timers are freed by the next tick.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchTimerStopAll( void )
+{
+  int i;
+
+  for ( i = 0; i < BENCH_MAX_TIMERS; i++ )
+  {
+    osal_stop_timerEx( i % BENCH_TASKS, BV( i / BENCH_TASKS ) );
+  }
+  osal_stop_timerEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT );
+  osalTimerUpdate( 0 );
+  osal_memset( tasksEvents, 0, sizeof( uint16 ) * tasksCnt );
+}
+
+/*********************************************************************
+ * @fn      benchMsgDrain
+ *
+ * @brief   Frees the messages of every task, and clears the events.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchMsgDrain( void )
+{
+  uint8 *msg;
+  int i;
+
+  for ( i = 0; i < BENCH_MSG_TASKS; i++ )
+  {
+    while ( (msg = osal_msg_receive( i )) != NULL )
+    {
+      osal_msg_deallocate( msg );
+    }
+  }
+  osal_memset( tasksEvents, 0, sizeof( uint16 ) * tasksCnt );
+}
+
+/*********************************************************************
+ * @fn      benchMsg
+ *
+ * @brief   A message through the queue of a task, with 0 or 16 other
+ *          messages queued to another task. Then, with BENCH_MSG_QUEUED
+ *          messages queued over the other tasks, messages taken and
+ *          sent back round robin, and a find on the task with none;
+ *          and the queues filled and drained.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchMsg( void )
+{
+  static const int depths[] = { 0, 16 };
+  const unsigned long ops = 500000;
+  const unsigned long rounds = ops / BENCH_MSG_QUEUED;
+  uint8 *msg;
+  char name[64];
+  unsigned long n;
+  uint8 task;
+  int d;
+  int i;
+
+  for ( d = 0; d < (int)(sizeof( depths ) / sizeof( depths[0] )); d++ )
+  {
+    for ( i = 0; i < depths[d]; i++ )
+    {
+      osal_msg_send( BENCH_MSG_TASKS - 1, osal_msg_allocate( 8 ) );
+    }
+
+    sprintf( name, "msg alloc+send+recv+free (%2d queued)", depths[d] );
+    do
+    {
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        msg = osal_msg_allocate( sizeof( osal_event_hdr_t ) + 8 );
+        osal_msg_send( 1, msg );
+        msg = osal_msg_receive( 1 );
+        osal_msg_deallocate( msg );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+
+    benchMsgDrain();
+  }
+
+  for ( i = 0; i < BENCH_MSG_QUEUED; i++ )
+  {
+    osal_msg_send( i % (BENCH_MSG_TASKS - 1), osal_msg_allocate( 8 ) );
+  }
+
+  sprintf( name, "msg recv+send, round robin (%d queued)", BENCH_MSG_QUEUED );
+  do
+  {
+    benchStart();
+    for ( n = 0; n < ops; n++ )
+    {
+      task = n % (BENCH_MSG_TASKS - 1);
+      msg = osal_msg_receive( task );
+      osal_msg_send( task, msg );
+    }
+    benchStop( name, ops );
+  } while ( benchRun != 0 );
+
+  sprintf( name, "msg find, none queued      (%d queued)", BENCH_MSG_QUEUED );
+  do
+  {
+    benchStart();
+    for ( n = 0; n < ops; n++ )
+    {
+      benchSink += ( osal_msg_find( BENCH_MSG_TASKS - 1, 1 ) != NULL );
+    }
+    benchStop( name, ops );
+  } while ( benchRun != 0 );
+
+  benchMsgDrain();
+
+  // Per message: allocated and sent round robin over all the tasks,
+  // then received and freed in the same order
+  sprintf( name, "msg fill %d over %d tasks, drain", BENCH_MSG_QUEUED, BENCH_MSG_TASKS );
+  do
+  {
+    benchStart();
+    for ( n = 0; n < rounds; n++ )
+    {
+      for ( i = 0; i < BENCH_MSG_QUEUED; i++ )
+      {
+        osal_msg_send( i % BENCH_MSG_TASKS, osal_msg_allocate( 8 ) );
+      }
+      for ( i = 0; i < BENCH_MSG_QUEUED; i++ )
+      {
+        osal_msg_deallocate( osal_msg_receive( i % BENCH_MSG_TASKS ) );
+      }
+    }
+    benchStop( name, rounds * BENCH_MSG_QUEUED );
+  } while ( benchRun != 0 );
+
+  benchMsgDrain();
+}
+
+/*********************************************************************
+ * @fn      benchDispatch
+ *
+ * @brief   An event of a task, from osal_set_event() to its handler,
+ *          for tasks of each priority, and a pass with no event set.
+ *          Then random sets, clears and passes, checked against a
+ *          model: each pass must call the first task with events, with
+ *          all of them.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchDispatch( void )
+{
+  static const uint8 tasks[] = { 0, 7, 15, BENCH_TASKS - 1 };
+  const unsigned long ops = 500000;
+  uint16 model[BENCH_TASKS];
+  unsigned long wrong;
+  unsigned long passes;
+  char name[64];
+  unsigned long n;
+  uint16 event;
+  int task;
+  int t;
+
+  benchTimerStopAll();
+  for ( t = 0; t < (int)(sizeof( tasks ) / sizeof( tasks[0] )); t++ )
+  {
+    sprintf( name, "event set+dispatch (task %2d of %d)", tasks[t], BENCH_TASKS );
+    do
+    {
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        osal_set_event( tasks[t], 0x0001 );
+        osal_run_system();
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+  }
+
+  do
+  {
+    benchStart();
+    for ( n = 0; n < ops; n++ )
+    {
+      osal_run_system();
+    }
+    benchStop( "idle pass of osal_run_system", ops );
+  } while ( benchRun != 0 );
+
+  osal_memset( model, 0, sizeof( model ) );
+  benchSeed = 5;
+  wrong = 0;
+  passes = 0;
+  for ( n = 0; n < 4 * ops; n++ )
+  {
+    task = benchRand() % BENCH_TASKS;
+    event = BV( benchRand() % 16 );
+    switch ( benchRand() % 4 )
+    {
+      case 0:
+        osal_set_event( task, event );
+        model[task] |= event;
+        break;
+
+      case 1:
+        osal_clear_event( task, event );
+        model[task] &= ~event;
+        break;
+
+      default:
+        benchLastTask = BENCH_TASKS;
+        osal_run_system();
+        passes++;
+        for ( task = 0; (task < BENCH_TASKS) && (model[task] == 0); task++ )
+        {
+        }
+        if ( task == BENCH_TASKS )
+        {
+          wrong += ( benchLastTask != BENCH_TASKS );
+        }
+        else
+        {
+          wrong += ( (benchLastTask != task) || (benchLastEvents != model[task]) );
+          model[task] = 0;
+        }
+        break;
+    }
+  }
+  printf( "%-40s %lu passes checked, %lu wrong\n", "", passes, wrong );
+}
+
+/*********************************************************************
+ * @fn      benchTimer
+ *
+ * @brief   Timer operations with 8, 32 and 128 timers running, the
+ *          benchmark's timer included. Only the starts, stops and
+ *          lookups walk the delta list; the ticks should not grow with
+ *          the timers.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchTimer( void )
+{
+  static const int counts[] = { 8, 32, 128 };
+  const unsigned long ops = 200000;
+  const unsigned long batch = 20000;
+  char name[64];
+  unsigned long n;
+  unsigned long done;
+  int active;
+  int c;
+  int i;
+
+  for ( c = 0; c < (int)(sizeof( counts ) / sizeof( counts[0] )); c++ )
+  {
+    active = counts[c];
+    benchTimerStopAll();
+    benchTimerStart( active - 1, 60000 );
+    if ( osal_timer_num_active() != active - 1 )
+    {
+      printf( "only %d of %d timers started\n", osal_timer_num_active(), active - 1 );
+    }
+
+    sprintf( name, "timer start+stop+tick (%3d active)", active );
+    do
+    {
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        osal_start_timerEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT, 5000 );
+        osal_stop_timerEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT );
+        osalTimerUpdate( 0 );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+
+    osal_start_timerEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT, 30000 );
+    sprintf( name, "timer restart         (%3d active)", active );
+    do
+    {
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        osal_start_timerEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT, 30000 + (n & 7) );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+
+    sprintf( name, "timer get_timeoutEx   (%3d active)", active );
+    do
+    {
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        benchSink += osal_get_timeoutEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+
+    // Ticks of 1 ms with nothing due: the timers are restarted every
+    // batch so that none runs out.
+    sprintf( name, "timer tick, none due  (%3d active)", active );
+    do
+    {
+      benchStart();
+      for ( done = 0; done < ops; done += batch )
+      {
+        benchPause();
+        benchTimerStopAll();
+        benchTimerStart( active, 60000 );
+        benchResume();
+        for ( n = 0; n < batch; n++ )
+        {
+          osalTimerUpdate( 1 );
+        }
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+
+    // Ticks of 1 ms, each with the benchmark's timer due
+    benchTimerStopAll();
+    benchTimerStart( active - 1, 60000 );
+    sprintf( name, "timer tick, one due   (%3d active)", active );
+    do
+    {
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        osal_start_timerEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT, 1 );
+        osalTimerUpdate( 1 );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+
+    // Ticks of 1 ms, each with the benchmark's reload timer due. It
+    // must be on the list again when the tick returns.
+    sprintf( name, "timer tick, reload    (%3d active)", active );
+    osal_start_reload_timer( BENCH_TIMER_TASK, BENCH_TIMER_EVT, 1 );
+    do
+    {
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        osalTimerUpdate( 1 );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+    if ( osal_get_timeoutEx( BENCH_TIMER_TASK, BENCH_TIMER_EVT ) != 1 )
+    {
+      printf( "reload timer lost\n" );
+    }
+
+    // Random restarts and stops of the background timers, with
+    // timeouts of up to 4 ms per timer, and a tick of 1 ms each: about
+    // half the timers run, and they keep falling due.
+    benchTimerStopAll();
+    sprintf( name, "timer churn           (%3d timers)", active );
+    do
+    {
+      benchSeed = 99;
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        i = benchRand() % active;
+        if ( (benchRand() & 3) == 0 )
+        {
+          osal_stop_timerEx( i % BENCH_TASKS, BV( i / BENCH_TASKS ) );
+        }
+        else
+        {
+          osal_start_timerEx( i % BENCH_TASKS, BV( i / BENCH_TASKS ),
+                              1 + benchRand() % (active * 4) );
+        }
+        osalTimerUpdate( 1 );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+  }
+
+  benchTimerStopAll();
+}
+
+/*********************************************************************
+ * @fn      benchPoolStep
+ *
+ * @brief   Starts or stops one of a number of timers at random, and
+ *          ticks 1 ms. About half of the timers run.
+ *
+ * @param   ids   - timers to choose from, at most BENCH_MAX_TIMERS
+ * @param   count - TRUE to find out if the start adds a timer
+ *
+ * @return  1 if a timer was added, else 0
+ */
+static int benchPoolStep( int ids, bool count )
+{
+  int added = 0;
+  int i = benchRand() % ids;
+  uint8 task = i % BENCH_TASKS;
+  uint16 event = BV( i / BENCH_TASKS );
+
+  if ( (benchRand() & 3) == 0 )
+  {
+    osal_stop_timerEx( task, event );
+  }
+  else
+  {
+    if ( count )
+    {
+      added = ( osal_get_timeoutEx( task, event ) == 0 );
+    }
+    osal_start_timerEx( task, event, 1 + benchRand() % (ids * 2) );
+  }
+  osalTimerUpdate( 1 );
+
+  return ( added );
+}
+
+/*********************************************************************
+ * @fn      benchPool
+ *
+ * @brief   Timer churn over 16, 32 and 64 timers. Untimed runs first
+ *          count the timer records taken, and how many of them came
+ *          from the heap: osal_timer_heap_allocs() saturates, so they
+ *          come before any other timer benchmark.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchPool( void )
+{
+  static const int ids[] = { 16, 32, 64 };
+  const unsigned long countOps = 40000;
+  const unsigned long ops = 200000;
+  unsigned long taken[3];
+  uint16 heapAllocs[3];
+  bool saturated;
+  char name[64];
+  unsigned long n;
+  int c;
+
+  for ( c = 0; c < 3; c++ )
+  {
+    benchTimerStopAll();
+    benchSeed = 99;
+    taken[c] = 0;
+    heapAllocs[c] = osal_timer_heap_allocs();
+    for ( n = 0; n < countOps; n++ )
+    {
+      taken[c] += benchPoolStep( ids[c], TRUE );
+    }
+    heapAllocs[c] = osal_timer_heap_allocs() - heapAllocs[c];
+  }
+  saturated = ( osal_timer_heap_allocs() == 0xFFFF );
+
+  for ( c = 0; c < 3; c++ )
+  {
+    sprintf( name, "timer pool churn      (%3d timers)", ids[c] );
+    do
+    {
+      benchTimerStopAll();
+      benchSeed = 99;
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        benchPoolStep( ids[c], FALSE );
+      }
+      benchStop( name, ops );
+    } while ( benchRun != 0 );
+
+    if ( OSAL_TIMERS_POOL_SIZE == 0 )
+    {
+      printf( "%-40s %lu records in %lu steps, no pool\n", "", taken[c], countOps );
+    }
+    else if ( saturated )
+    {
+      printf( "%-40s %lu records in %lu steps, heap count saturated\n", "",
+              taken[c], countOps );
+    }
+    else
+    {
+      printf( "%-40s %lu records in %lu steps, %.1f%% from the pool of %d\n", "",
+              taken[c], countOps, 100.0 * (taken[c] - heapAllocs[c]) / taken[c],
+              OSAL_TIMERS_POOL_SIZE );
+    }
+  }
+  printf( "%-40s pool high water %u\n", "", osal_timer_pool_high_water() );
+
+  benchTimerStopAll();
+}
+
+/*********************************************************************
+ * @fn      benchHeapSize
+ *
+ * @brief   Size of a new block of a mix: small blocks are of 6 to 24
+ *          bytes, large ones of 48 up to the mix's largest.
+ *
+ * @param   mix - of the heap benchmarks
+ *
+ * @return  bytes
+ */
+static uint16 benchHeapSize( const benchHeapMix_t *mix )
+{
+  if ( (int)(benchRand() % 100) < mix->largePct )
+  {
+    return ( 48 + benchRand() % (mix->largeMax - 48 + 1) );
+  }
+  return ( 6 + benchRand() % (24 - 6 + 1) );
+}
+
+/*********************************************************************
+ * @fn      benchHeapCheck
+ *
+ * @brief   The steps of a heap benchmark, untimed: every block is
+ *          filled when allocated and checked when freed. With
+ *          OSALMEM_METRICS, the fragmentation of the heap, 1 - largest
+ *          free run / free bytes, is sampled every 97 allocations.
+ *
+ * @param   mix - of the heap benchmarks
+ * @param   ops - steps
+ *
+ * @return  none
+ */
+static void benchHeapCheck( const benchHeapMix_t *mix, unsigned long ops )
+{
+  uint8 *blocks[BENCH_MAX_LIVE];
+  uint16 sizes[BENCH_MAX_LIVE];
+  unsigned long allocs = 0;
+  unsigned long failed = 0;
+  unsigned long corrupt = 0;
+  unsigned long n;
+  uint16 i;
+  int slot;
+#if OSALMEM_METRICS
+  unsigned long samples = 0;
+  double fragSum = 0;
+  double fragWorst = 0;
+  double frag;
+  uint16 largest;
+  uint16 free;
+#endif
+
+  osal_memset( blocks, 0, sizeof( blocks ) );
+  benchSeed = 777;
+  for ( n = 0; n < ops; n++ )
+  {
+    slot = benchRand() % mix->live;
+    if ( blocks[slot] != NULL )
+    {
+      for ( i = 0; i < sizes[slot]; i++ )
+      {
+        if ( blocks[slot][i] != (uint8)(slot + sizes[slot]) )
+        {
+          corrupt++;
+          break;
+        }
+      }
+      osal_mem_free( blocks[slot] );
+      blocks[slot] = NULL;
+      continue;
+    }
+
+    sizes[slot] = benchHeapSize( mix );
+    blocks[slot] = osal_mem_alloc( sizes[slot] );
+    allocs++;
+    if ( blocks[slot] == NULL )
+    {
+      failed++;
+      continue;
+    }
+    osal_memset( blocks[slot], (uint8)(slot + sizes[slot]), sizes[slot] );
+
+#if OSALMEM_METRICS
+    if ( (allocs % 97) == 0 )
+    {
+      free = osal_heap_mem_free( &largest );
+      frag = free ? 1.0 - (double)largest / free : 0.0;
+      fragSum += frag;
+      fragWorst = ( frag > fragWorst ) ? frag : fragWorst;
+      samples++;
+    }
+#endif
+  }
+
+  for ( slot = 0; slot < BENCH_MAX_LIVE; slot++ )
+  {
+    if ( blocks[slot] != NULL )
+    {
+      osal_mem_free( blocks[slot] );
+    }
+  }
+
+  printf( "%-40s %lu allocations, %lu failed, %lu corrupt\n", "", allocs, failed, corrupt );
+#if OSALMEM_METRICS
+  printf( "%-40s fragmentation mean %.1f%%, worst %.1f%%\n", "",
+          samples ? 100.0 * fragSum / samples : 0.0, 100.0 * fragWorst );
+#endif
+}
+
+/*********************************************************************
+ * @fn      benchHeap
+ *
+ * @brief   Random allocations and frees over a set of live blocks:
+ *          each step frees a random block, or allocates it if it is
+ *          free. Then the same steps again, checked.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void benchHeap( void )
+{
+  const unsigned long ops = 1000000;
+  const benchHeapMix_t *mix;
+  void *blocks[BENCH_MAX_LIVE];
+  unsigned long n;
+  int slot;
+  int m;
+
+  for ( m = 0; m < (int)(sizeof( benchHeapMixes ) / sizeof( benchHeapMixes[0] )); m++ )
+  {
+    mix = &benchHeapMixes[m];
+    do
+    {
+      osal_memset( blocks, 0, sizeof( blocks ) );
+      benchSeed = 777;
+
+      benchStart();
+      for ( n = 0; n < ops; n++ )
+      {
+        slot = benchRand() % mix->live;
+        if ( blocks[slot] != NULL )
+        {
+          osal_mem_free( blocks[slot] );
+          blocks[slot] = NULL;
+        }
+        else
+        {
+          blocks[slot] = osal_mem_alloc( benchHeapSize( mix ) );
+        }
+      }
+      benchStop( mix->name, ops );
+
+      for ( slot = 0; slot < BENCH_MAX_LIVE; slot++ )
+      {
+        if ( blocks[slot] != NULL )
+        {
+          osal_mem_free( blocks[slot] );
+        }
+      }
+    } while ( benchRun != 0 );
+
+    benchHeapCheck( mix, ops );
+  }
+}
+
+/*********************************************************************
+ * @fn      main
+ *
+ * @brief   Runs the suites named on the command line, or all.
+ *
+ * @param   argc, argv - see the usage above
+ *
+ * @return  0, or 1 for a bad argument
+ */
+int main( int argc, char *argv[] )
+{
+  unsigned int s;
+  int opt;
+  int i;
+
+  while ( (opt = getopt( argc, argv, "n:" )) != -1 )
+  {
+    if ( (opt == 'n') && (atoi( optarg ) > 0) )
+    {
+      benchRuns = atoi( optarg );
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-n runs] [suite ...]\n", argv[0] );
+      return 1;
+    }
+  }
+  for ( i = optind; i < argc; i++ )
+  {
+    for ( s = 0; (s < BENCH_SUITES) && strcmp( argv[i], benchSuites[s].name ); s++ )
+    {
+    }
+    if ( s == BENCH_SUITES )
+    {
+      fprintf( stderr, "unknown suite %s\n", argv[i] );
+      return 1;
+    }
+  }
+
+  InitBoard( OB_COLD );
+  osal_init_system();
+  osal_int_enable( INTS_ALL );
+  printf( "INT_HEAP_LEN %d, best of %d runs\n", INT_HEAP_LEN, benchRuns );
+
+  for ( s = 0; s < BENCH_SUITES; s++ )
+  {
+    for ( i = optind; (i < argc) && strcmp( argv[i], benchSuites[s].name ); i++ )
+    {
+    }
+    if ( (optind == argc) || (i < argc) )
+    {
+      benchSuites[s].fn();
+    }
+  }
+
+  if ( !HAL_INTERRUPTS_ARE_ENABLED() )
+  {
+    printf( "critical section left open\n" );
+    return 1;
+  }
+  return 0;
+}
+
+/*********************************************************************
+*********************************************************************/
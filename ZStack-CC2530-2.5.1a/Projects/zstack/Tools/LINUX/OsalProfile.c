@@ -0,0 +1,534 @@
+/**************************************************************************************************
+  Filename:       OsalProfile.c
+
+  Description:    Runs a simulated coordinator workload on the OSAL of the
+                  Linux host, built with OSAL_PROFILE, and prints the
+                  event latency and handler time profile of its tasks.
+
+  The tasks stand for those of the GenericApp coordinator, with handler
+  times of the order of the CC2530's:
+
+      MAC         frames from the radio, at -r frames/s; each is a
+                  message to NWK
+      NWK         its messages; a link status every 15 s
+      HAL         key polling every 100 ms
+      MT          commands from the UART, 5/s; every 20th writes NV
+      APS         data frames from NWK, passed on to GenericApp
+      ZDApp       a 1 s housekeeping timer
+      GenericApp  sensor frames; a report of the directory every 5 s
+
+  Handlers busy-wait their time. The radio and UART "interrupts" are
+  polled between the tasks and during the busy-waits while interrupts are
+  enabled, so they set their events while a handler runs, as on the
+  target.
+
+  The profile is read with osal_profile_read(), as MT_SYS_OSAL_PROFILE
+  does on a device. OSAL_PROF_TIME() counts usec on the host.
+
+  Build on the Linux host target (see Projects/zstack/ZMain/LINUX/OnBoard.h):
+
+    gcc -std=gnu99 -O2 -DUBIT -DRTR_NWK -DOSAL_PROFILE=TRUE \
+        -I Components/hal/target/LINUX -I Projects/zstack/ZMain/LINUX \
+        -I Components/hal/include -I Components/osal/include \
+        Components/osal/common/OSAL.c Components/osal/common/OSAL_Clock.c \
+        Components/osal/common/OSAL_Memory.c Components/osal/common/OSAL_PwrMgr.c \
+        Components/osal/common/OSAL_Timers.c Projects/zstack/ZMain/LINUX/OnBoard.c \
+        Projects/zstack/Tools/LINUX/OsalProfile.c -o OsalProfile
+
+  Usage: OsalProfile [-t seconds] [-r frames/s]
+    -t  length of the run, in seconds (20)
+    -r  frames received by the radio per second (50)
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "comdef.h"
+#include "OnBoard.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+
+#if !OSAL_PROFILE
+  #error OsalProfile needs OSAL_PROFILE=TRUE.
+#endif
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Tasks, in order of priority
+#define SIM_MAC           0
+#define SIM_NWK           1
+#define SIM_HAL           2
+#define SIM_MT            3
+#define SIM_APS           4
+#define SIM_ZDAPP         5
+#define SIM_APP           6
+#define SIM_TASKS         7
+
+// Events
+#define SIM_RX_EVT        0x0001  // MAC: frame received
+#define SIM_LINK_EVT      0x0002  // NWK: link status
+#define SIM_KEY_EVT       0x0001  // HAL: key poll
+#define SIM_UART_EVT      0x0001  // MT: command received
+#define SIM_ZDO_EVT       0x0001  // ZDApp: housekeeping
+#define SIM_REPORT_EVT    0x0001  // GenericApp: directory report
+
+// Handler times, in usec
+#define SIM_MAC_RX_US     150
+#define SIM_NWK_MSG_US    120
+#define SIM_NWK_LINK_US   1500
+#define SIM_KEY_US        15
+#define SIM_MT_CMD_US     200
+#define SIM_MT_NV_US      4000
+#define SIM_APS_MSG_US    60
+#define SIM_ZDO_US        300
+#define SIM_APP_MSG_US    400
+#define SIM_APP_REPORT_US 6000
+
+// Message event of the simulation
+#define SIM_FRAME         0x01
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  osal_event_hdr_t hdr;
+  uint8 data;            // TRUE for a data frame, which goes up to the app
+} simFrame_t;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint16 simMac( uint8 task_id, uint16 events );
+static uint16 simNwk( uint8 task_id, uint16 events );
+static uint16 simHal( uint8 task_id, uint16 events );
+static uint16 simMt( uint8 task_id, uint16 events );
+static uint16 simAps( uint8 task_id, uint16 events );
+static uint16 simZdo( uint8 task_id, uint16 events );
+static uint16 simApp( uint8 task_id, uint16 events );
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+const pTaskEventHandlerFn tasksArr[SIM_TASKS] =
+{
+  simMac, simNwk, simHal, simMt, simAps, simZdo, simApp
+};
+const uint8 tasksCnt = SIM_TASKS;
+uint16 *tasksEvents;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const char *simTaskNames[SIM_TASKS] =
+{
+  "MAC", "NWK", "HAL", "MT", "APS", "ZDApp", "GenericApp"
+};
+
+// Interrupt sources: time of the next radio frame and UART command, in usec
+static unsigned long simNextRx;
+static unsigned long simNextUart;
+static unsigned long simRxPeriod;
+static unsigned long simNow;
+static uint16 simLastTime;
+static unsigned simMtCmds;
+
+/*********************************************************************
+ * @fn      simTime
+ *
+ * @brief   Extends Onboard_prof_time() to a usec count that does not
+ *          wrap. Called at least every 65 ms.
+ *
+ * @param   none
+ *
+ * @return  usec since the start
+ */
+static unsigned long simTime( void )
+{
+  uint16 t = Onboard_prof_time();
+
+  simNow += (uint16)(t - simLastTime);
+  simLastTime = t;
+  return ( simNow );
+}
+
+/*********************************************************************
+ * @fn      simInterrupts
+ *
+ * @brief   Raises the radio and UART interrupts that are due, if
+ *          interrupts are enabled.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void simInterrupts( void )
+{
+  unsigned long now = simTime();
+
+  if ( !HAL_INTERRUPTS_ARE_ENABLED() )
+  {
+    return;
+  }
+
+  if ( now >= simNextRx )
+  {
+    osal_set_event( SIM_MAC, SIM_RX_EVT );
+    simNextRx += 1 + (random() % (2 * simRxPeriod));
+  }
+  if ( now >= simNextUart )
+  {
+    osal_set_event( SIM_MT, SIM_UART_EVT );
+    simNextUart += 100000 + (random() % 200000);
+  }
+}
+
+/*********************************************************************
+ * @fn      simWork
+ *
+ * @brief   Busy-waits a handler's time, taking the interrupts due.
+ *
+ * @param   us - time, in usec
+ *
+ * @return  none
+ */
+static void simWork( unsigned us )
+{
+  unsigned long end = simTime() + us;
+
+  while ( simTime() < end )
+  {
+    simInterrupts();
+  }
+}
+
+/*********************************************************************
+ * @fn      simSendFrame
+ *
+ * @brief   Sends a frame message to a task.
+ *
+ * @param   task - destination
+ * @param   data - TRUE for a data frame
+ *
+ * @return  none
+ */
+static void simSendFrame( uint8 task, uint8 data )
+{
+  simFrame_t *msg = (simFrame_t *)osal_msg_allocate( sizeof( simFrame_t ) );
+
+  if ( msg )
+  {
+    msg->hdr.event = SIM_FRAME;
+    msg->data = data;
+    osal_msg_send( task, (uint8 *)msg );
+  }
+}
+
+/*********************************************************************
+ * TASKS
+ */
+
+static uint16 simMac( uint8 task_id, uint16 events )
+{
+  (void)task_id;
+
+  if ( events & SIM_RX_EVT )
+  {
+    simWork( SIM_MAC_RX_US );
+    simSendFrame( SIM_NWK, (random() % 5) != 0 );
+    return ( events ^ SIM_RX_EVT );
+  }
+  return ( 0 );
+}
+
+static uint16 simNwk( uint8 task_id, uint16 events )
+{
+  simFrame_t *msg;
+
+  if ( events & SYS_EVENT_MSG )
+  {
+    while ( (msg = (simFrame_t *)osal_msg_receive( task_id )) )
+    {
+      simWork( SIM_NWK_MSG_US );
+      if ( msg->data )
+      {
+        simSendFrame( SIM_APS, TRUE );
+      }
+      osal_msg_deallocate( (uint8 *)msg );
+    }
+    return ( events ^ SYS_EVENT_MSG );
+  }
+  if ( events & SIM_LINK_EVT )
+  {
+    simWork( SIM_NWK_LINK_US );
+    return ( events ^ SIM_LINK_EVT );
+  }
+  return ( 0 );
+}
+
+static uint16 simHal( uint8 task_id, uint16 events )
+{
+  (void)task_id;
+
+  if ( events & SIM_KEY_EVT )
+  {
+    simWork( SIM_KEY_US );
+    return ( events ^ SIM_KEY_EVT );
+  }
+  return ( 0 );
+}
+
+static uint16 simMt( uint8 task_id, uint16 events )
+{
+  (void)task_id;
+
+  if ( events & SIM_UART_EVT )
+  {
+    simWork( (++simMtCmds % 20) ? SIM_MT_CMD_US : SIM_MT_NV_US );
+    return ( events ^ SIM_UART_EVT );
+  }
+  return ( 0 );
+}
+
+static uint16 simAps( uint8 task_id, uint16 events )
+{
+  uint8 *msg;
+
+  if ( events & SYS_EVENT_MSG )
+  {
+    while ( (msg = osal_msg_receive( task_id )) )
+    {
+      simWork( SIM_APS_MSG_US );
+      simSendFrame( SIM_APP, TRUE );
+      osal_msg_deallocate( msg );
+    }
+    return ( events ^ SYS_EVENT_MSG );
+  }
+  return ( 0 );
+}
+
+static uint16 simZdo( uint8 task_id, uint16 events )
+{
+  (void)task_id;
+
+  if ( events & SIM_ZDO_EVT )
+  {
+    simWork( SIM_ZDO_US );
+    return ( events ^ SIM_ZDO_EVT );
+  }
+  return ( 0 );
+}
+
+static uint16 simApp( uint8 task_id, uint16 events )
+{
+  uint8 *msg;
+
+  if ( events & SYS_EVENT_MSG )
+  {
+    while ( (msg = osal_msg_receive( task_id )) )
+    {
+      simWork( SIM_APP_MSG_US );
+      osal_msg_deallocate( msg );
+    }
+    return ( events ^ SYS_EVENT_MSG );
+  }
+  if ( events & SIM_REPORT_EVT )
+  {
+    simWork( SIM_APP_REPORT_US );
+    return ( events ^ SIM_REPORT_EVT );
+  }
+  return ( 0 );
+}
+
+void osalInitTasks( void )
+{
+  tasksEvents = (uint16 *)osal_mem_alloc( sizeof( uint16 ) * tasksCnt );
+  osal_memset( tasksEvents, 0, sizeof( uint16 ) * tasksCnt );
+}
+
+/*********************************************************************
+ * @fn      simPercentile
+ *
+ * @brief   Upper bound of the bucket that reaches a share of the samples.
+ *
+ * @param   hist - histogram
+ * @param   share - share of the samples, 0-1
+ *
+ * @return  the bound, in ticks; 0 with no samples, -1 for the last bucket
+ */
+static long simPercentile( const uint16 *hist, double share )
+{
+  unsigned long total = 0;
+  unsigned long sum = 0;
+  int b;
+
+  for ( b = 0; b < OSAL_PROF_BUCKETS; b++ )
+  {
+    total += hist[b];
+  }
+  if ( total == 0 )
+  {
+    return ( 0 );
+  }
+
+  for ( b = 0; b < OSAL_PROF_BUCKETS; b++ )
+  {
+    sum += hist[b];
+    if ( sum >= share * total )
+    {
+      break;
+    }
+  }
+  return ( (b == OSAL_PROF_BUCKETS - 1) ? -1 : (1L << b) - 1 );
+}
+
+/*********************************************************************
+ * @fn      simPrintBound
+ *
+ * @brief   Prints a bucket bound of simPercentile().
+ *
+ * @param   bound - the bound, in usec
+ *
+ * @return  none
+ */
+static void simPrintBound( long bound )
+{
+  char text[24];
+
+  if ( bound < 0 )
+  {
+    snprintf( text, sizeof( text ), ">=%ld", 1L << (OSAL_PROF_BUCKETS - 2) );
+  }
+  else
+  {
+    snprintf( text, sizeof( text ), "<=%ld", bound );
+  }
+  printf( " %8s", text );
+}
+
+/*********************************************************************
+ * @fn      simPrintHist
+ *
+ * @brief   Prints a histogram on one line, a column per bucket.
+ *
+ * @param   name - name of the line
+ * @param   hist - histogram
+ *
+ * @return  none
+ */
+static void simPrintHist( const char *name, const uint16 *hist )
+{
+  int b;
+
+  printf( "    %-8s", name );
+  for ( b = 0; b < OSAL_PROF_BUCKETS; b++ )
+  {
+    printf( " %6u", hist[b] );
+  }
+  printf( "\n" );
+}
+
+int main( int argc, char **argv )
+{
+  osalProfile_t prof;
+  unsigned long end;
+  unsigned long calls;
+  int seconds = 20;
+  int rate = 50;
+  int opt;
+  uint8 slot;
+  int b;
+
+  while ( (opt = getopt( argc, argv, "t:r:" )) != -1 )
+  {
+    switch ( opt )
+    {
+      case 't':
+        seconds = atoi( optarg );
+        break;
+      case 'r':
+        rate = atoi( optarg );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-t seconds] [-r frames/s]\n", argv[0] );
+        return ( 1 );
+    }
+  }
+  if ( (seconds <= 0) || (rate <= 0) )
+  {
+    fprintf( stderr, "-t and -r must be positive\n" );
+    return ( 1 );
+  }
+
+  InitBoard( OB_COLD );
+  osal_init_system();
+  osal_int_enable( INTS_ALL );
+
+  simRxPeriod = 1000000UL / rate;
+  simLastTime = Onboard_prof_time();
+  simNextRx = simRxPeriod;
+  simNextUart = 200000;
+
+  osal_start_reload_timer( SIM_NWK, SIM_LINK_EVT, 15000 );
+  osal_start_reload_timer( SIM_HAL, SIM_KEY_EVT, 100 );
+  osal_start_reload_timer( SIM_ZDAPP, SIM_ZDO_EVT, 1000 );
+  osal_start_reload_timer( SIM_APP, SIM_REPORT_EVT, 5000 );
+
+  end = seconds * 1000000UL;
+  while ( simTime() < end )
+  {
+    simInterrupts();
+    osal_run_system();
+  }
+
+  printf( "%d s, %d frames/s; times in usec (tick %d ns), %u samples missed\n\n",
+          seconds, rate, OSAL_PROF_TICK_NS, osal_profile_missed() );
+  printf( "%-10s %6s %7s %8s %8s %8s %8s %8s\n", "task", "event", "calls",
+          "lat p50", "lat p99", "lat max", "exec p99", "exec max" );
+
+  for ( slot = 0; osal_profile_read( slot, &prof ); slot++ )
+  {
+    calls = 0;
+    for ( b = 0; b < OSAL_PROF_BUCKETS; b++ )
+    {
+      calls += prof.exec[b];
+    }
+    printf( "%-10s 0x%04x %7lu", simTaskNames[prof.task], 1 << prof.event, calls );
+    simPrintBound( simPercentile( prof.latency, 0.5 ) );
+    simPrintBound( simPercentile( prof.latency, 0.99 ) );
+    printf( " %8u", prof.maxLatency );
+    simPrintBound( simPercentile( prof.exec, 0.99 ) );
+    printf( " %8u\n", prof.maxExec );
+  }
+
+  printf( "\nHistograms, by significant bits of the time:\n" );
+  printf( "    %-8s", "" );
+  for ( b = 0; b < OSAL_PROF_BUCKETS; b++ )
+  {
+    printf( " %6ld", (b == 0) ? 0 : (1L << (b - 1)) );
+  }
+  printf( "\n" );
+  for ( slot = 0; osal_profile_read( slot, &prof ); slot++ )
+  {
+    printf( "%s 0x%04x\n", simTaskNames[prof.task], 1 << prof.event );
+    simPrintHist( "latency", prof.latency );
+    simPrintHist( "exec", prof.exec );
+  }
+
+  return ( 0 );
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,900 @@
+/**************************************************************************************************
+  Filename:       RouteSim.c
+
+  Description:    Simulates the routing of a network of GenericApp routers
+                  to the coordinator on the Linux host, with and without
+                  the concentrator of the coordinator (SourceRoute.c), and
+                  counts the route discoveries it avoids.
+
+  The nodes are placed at random in a square, the coordinator at its
+  center, and hear each other within a range; a placement that leaves a
+  node out of reach is drawn again. Every device joins, which adds it to
+  the coordinator's directory (DeviceDirectory.c), then reports to the
+  coordinator every minute, at a phase of its own; the gateway sends a
+  command to a device picked at random every few seconds. Half way
+  through, routers that relay for others die. Paths are the shortest
+  ones over the living nodes.
+
+  Each seed runs twice, on the same placement and events:
+
+      before    the mesh routing alone: a unicast on a route unused for
+                ROUTE_EXPIRY_TIME (30 s), or broken, starts a route
+                discovery, whose request every node rebroadcasts
+      after     SourceRoute.c, linked as it is built for the coordinator,
+                over stubs of AF, NWK and ZDO: a many-to-one route request
+                every SRCROUTE_MTO_INTERVAL, after which each device sends
+                a route record with its next report, and the commands
+                sent with SourceRoute_DataRequest(). The stack's own
+                source route table keeps the last 12 records for 10 s. A
+                command on a relay list that is no longer a path is lost,
+                and given to SourceRoute_DeliveryFailed() as the ack
+                timeout of coordinator.c does. Reports go up the
+                many-to-one routes, and a device whose route broke falls
+                back to route discovery until the next request.
+
+  For each it prints the floods (route discoveries and many-to-one route
+  requests), the transmissions of every frame, request and reply, and
+  the commands, those that needed a route discovery and those lost; then
+  SourceRoute_Stats of the run after, whose unicasts sent on a relay list
+  are the route discoveries avoided.
+
+  Build on the Linux host target (see Projects/zstack/ZMain/LINUX/OnBoard.h)
+  with "make RouteSim": SourceRoute.c needs the include paths of the stack
+  (AF_INCLUDES of the Makefile), and it is built with the largest
+  directory, DEVDIR_MAX_DEVICES=128, so that the devices beyond it show
+  what a device without an index costs.
+
+  Usage: RouteSim [-n nodes] [-s seeds] [-t minutes] [-c command ms] [-k deaths]
+    -n  devices besides the coordinator (200, at most 250)
+    -s  seeds run (3)
+    -t  length of each run, in minutes (60)
+    -c  interval of the gateway commands, in ms (5000)
+    -k  routers that die half way through (8)
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "OSAL_Nv.h"
+#include "AF.h"
+#include "ZDApp.h"
+#include "NLMEDE.h"
+#include "rtg.h"
+
+#include "DeviceDirectory.h"
+#include "SourceRoute.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define SIM_MAX_NODES         251     // the coordinator and the devices
+#define SIM_MAX_HOPS          32
+#define SIM_SIDE              320     // m
+#define SIM_RANGE             40      // m
+#define SIM_REPORT_INTERVAL   60000   // ms
+#define SIM_ROUTE_EXPIRY      30000   // ms, ROUTE_EXPIRY_TIME
+#define SIM_STEP              100     // ms
+#define SIM_SRC_TABLE         12      // entries of the stack's source route table
+#define SIM_SRC_EXPIRY        10000   // ms they last
+#define SIM_NO_HOPS           0xFF
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Route of a device to or from the coordinator: the relays, nearest the
+// device first
+typedef struct
+{
+  uint8 relayCnt;               // SIM_NO_HOPS if none
+  uint8 relays[SIM_MAX_HOPS];   // node numbers
+} simPath_t;
+
+// Entry of the stack's source route table
+typedef struct
+{
+  uint16 nwkAddr;
+  uint32 time;
+  uint8 relayCnt;
+  uint16 relays[SIM_MAX_HOPS];
+} simSrcEntry_t;
+
+typedef struct
+{
+  unsigned long floods;
+  unsigned long transmissions;
+  unsigned long commands;
+  unsigned long commandsDiscovered;
+  unsigned long commandsLost;
+} simCounts_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+uint8 zgConcentratorRadius = 10;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static int simNodes = 201;
+static int simSeeds = 3;
+static long simMinutes = 60;
+static long simCommandInterval = 5000;
+static int simDeaths = 8;
+
+static uint32 simRandState;
+static uint32 simNow;
+
+// Placement and links
+static int simX[SIM_MAX_NODES];
+static int simY[SIM_MAX_NODES];
+static uint8 simLink[SIM_MAX_NODES][SIM_MAX_NODES];
+static uint8 simAlive[SIM_MAX_NODES];
+
+// Shortest paths to the coordinator over the living nodes
+static uint8 simParent[SIM_MAX_NODES];
+static uint8 simHops[SIM_MAX_NODES];
+
+static uint16 simNwkAddr[SIM_MAX_NODES];
+static uint32 simPhase[SIM_MAX_NODES];
+
+// Mesh routes, between each device and the coordinator both ways
+static simPath_t simRoute[SIM_MAX_NODES];
+static uint32 simRouteUsed[SIM_MAX_NODES];
+
+// Many-to-one routes of the devices, and the route records due
+static simPath_t simMtoRoute[SIM_MAX_NODES];
+static uint8 simRecordDue[SIM_MAX_NODES];
+static simSrcEntry_t simSrcTable[SIM_SRC_TABLE];
+
+static simCounts_t simCounts;
+static uint8 simConcentrator;
+
+// The OSAL and ZDO of the coordinator
+static uint32 simMtoDue;
+static pfnZdoCb simRecordCB;
+static uint8 simNv[DEVDIR_MAX_DEVICES * sizeof( devDirEntry_t )];
+static uint8 simNvCreated;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint32 simRand( void );
+static int simNode( uint16 nwkAddr );
+static void simShortestPaths( void );
+static void simPathOf( int node, simPath_t *path );
+static int simPathUp( simPath_t *path, int node );
+static uint8 simDiscover( int node );
+static void simReport( int node );
+static void simCommand( int node );
+static void simRecord( int node );
+
+/*********************************************************************
+ * The OSAL, as far as SourceRoute.c and DeviceDirectory.c call it,
+ * on the clock of the simulation. The timer of the many-to-one route
+ * requests is the only one.
+ */
+
+uint32 osal_GetSystemClock( void )
+{
+  return simNow;
+}
+
+uint8 osal_start_timerEx( uint8 task_id, uint16 event_id, uint16 timeout_value )
+{
+  (void)task_id;
+  (void)event_id;
+  simMtoDue = simNow + timeout_value;
+  return SUCCESS;
+}
+
+uint8 osal_stop_timerEx( uint8 task_id, uint16 event_id )
+{
+  (void)task_id;
+  (void)event_id;
+  simMtoDue = 0xFFFFFFFF;
+  return SUCCESS;
+}
+
+uint16 osal_get_timeoutEx( uint8 task_id, uint16 event_id )
+{
+  (void)task_id;
+  (void)event_id;
+  return ( simMtoDue == 0xFFFFFFFF ) ? 0 : (uint16)(simMtoDue - simNow);
+}
+
+uint8 osal_set_event( uint8 task_id, uint16 event_flag )
+{
+  (void)task_id;
+  (void)event_flag;
+  simMtoDue = simNow;
+  return SUCCESS;
+}
+
+void *osal_memcpy( void *dst, const void GENERIC *src, unsigned int len )
+{
+  return memcpy( dst, src, len );
+}
+
+void *osal_memset( void *dest, uint8 value, int len )
+{
+  return memset( dest, value, len );
+}
+
+uint8 osal_memcmp( const void GENERIC *src1, const void GENERIC *src2, unsigned int len )
+{
+  return ( memcmp( src1, src2, len ) == 0 );
+}
+
+uint8 osal_isbufset( uint8 *buf, uint8 val, uint8 len )
+{
+  uint8 i;
+
+  for ( i = 0; i < len; i++ )
+  {
+    if ( buf[i] != val )
+    {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+uint8 osal_nv_item_init( uint16 id, uint16 len, void *buf )
+{
+  (void)id;
+  if ( simNvCreated )
+  {
+    return ZSUCCESS;
+  }
+  memcpy( simNv, buf, len );
+  simNvCreated = TRUE;
+  return NV_ITEM_UNINIT;
+}
+
+uint8 osal_nv_read( uint16 id, uint16 offset, uint16 len, void *buf )
+{
+  (void)id;
+  memcpy( buf, &simNv[offset], len );
+  return ZSUCCESS;
+}
+
+uint8 osal_nv_write( uint16 id, uint16 offset, uint16 len, void *buf )
+{
+  (void)id;
+  memcpy( &simNv[offset], buf, len );
+  return ZSUCCESS;
+}
+
+/*********************************************************************
+ * ZDO, NWK and AF of the coordinator.
+ */
+
+ZStatus_t ZDO_RegisterForZdoCB( uint8 indID, pfnZdoCb pFn )
+{
+  if ( indID == ZDO_SRC_RTG_IND_CBID )
+  {
+    simRecordCB = pFn;
+  }
+  return ZSuccess;
+}
+
+/*********************************************************************
+ * @fn      NLME_RouteDiscoveryRequest
+ *
+ * @brief   Floods a many-to-one route request: every living node
+ *          rebroadcasts it and learns its route to the coordinator, and
+ *          sends a route record before its next report.
+ */
+ZStatus_t NLME_RouteDiscoveryRequest( uint16 DstAddress, byte options, uint8 radius )
+{
+  int node;
+
+  (void)DstAddress;
+  (void)options;
+  (void)radius;
+
+  simCounts.floods++;
+  simShortestPaths();
+  for ( node = 0; node < simNodes; node++ )
+  {
+    if ( simAlive[node] )
+    {
+      simCounts.transmissions++;
+    }
+    if ( (node != 0) && simAlive[node] )
+    {
+      simPathOf( node, &simMtoRoute[node] );
+      simRecordDue[node] = TRUE;
+    }
+  }
+  return ZSuccess;
+}
+
+/*********************************************************************
+ * @fn      RTG_GetRtgSrcEntry
+ *
+ * @brief   The stack's source route table: the last SIM_SRC_TABLE route
+ *          records, for SIM_SRC_EXPIRY ms.
+ */
+RTG_Status_t RTG_GetRtgSrcEntry( uint16 dstAddr, uint8* pRelayCnt, uint16** ppRelayList )
+{
+  int i;
+
+  for ( i = 0; i < SIM_SRC_TABLE; i++ )
+  {
+    if ( (simSrcTable[i].nwkAddr == dstAddr) && (simNow - simSrcTable[i].time < SIM_SRC_EXPIRY) )
+    {
+      *pRelayCnt = simSrcTable[i].relayCnt;
+      *ppRelayList = simSrcTable[i].relays;
+      return RTG_SUCCESS;
+    }
+  }
+  return RTG_FAIL;
+}
+
+/*********************************************************************
+ * @fn      AF_DataRequest
+ *
+ * @brief   A command to a device on the mesh route, discovered if need
+ *          be.
+ */
+afStatus_t AF_DataRequest( afAddrType_t *dstAddr, endPointDesc_t *srcEP,
+                           uint16 cID, uint16 len, uint8 *buf, uint8 *transID,
+                           uint8 options, uint8 radius )
+{
+  int node = simNode( dstAddr->addr.shortAddr );
+
+  (void)srcEP;
+  (void)cID;
+  (void)len;
+  (void)buf;
+  (void)transID;
+  (void)options;
+  (void)radius;
+
+  if ( simDiscover( node ) )
+  {
+    simCounts.commandsDiscovered++;
+  }
+  if ( simRoute[node].relayCnt == SIM_NO_HOPS )
+  {
+    simCounts.commandsLost++;
+    return afStatus_SUCCESS;
+  }
+  simCounts.transmissions += simRoute[node].relayCnt + 1;
+  simRouteUsed[node] = simNow;
+  return afStatus_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      AF_DataRequestSrcRtg
+ *
+ * @brief   A command to a device on a relay list, lost at the first hop
+ *          that is no longer a link.
+ */
+afStatus_t AF_DataRequestSrcRtg( afAddrType_t *dstAddr, endPointDesc_t *srcEP,
+                           uint16 cID, uint16 len, uint8 *buf, uint8 *transID,
+                           uint8 options, uint8 radius, uint8 relayCnt,
+                           uint16* pRelayList )
+{
+  int node = simNode( dstAddr->addr.shortAddr );
+  int from = 0;
+  int to;
+  int i;
+
+  (void)srcEP;
+  (void)cID;
+  (void)len;
+  (void)buf;
+  (void)transID;
+  (void)options;
+  (void)radius;
+
+  // From the coordinator down the list, which is nearest the device first
+  for ( i = relayCnt; i >= 0; i-- )
+  {
+    to = ( i == 0 ) ? node : simNode( pRelayList[i - 1] );
+    simCounts.transmissions++;
+    if ( (to < 0) || !simAlive[to] || !simLink[from][to] )
+    {
+      simCounts.commandsLost++;
+      SourceRoute_DeliveryFailed( dstAddr->addr.shortAddr );
+      return afStatus_SUCCESS;
+    }
+    from = to;
+  }
+  return afStatus_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      simRand
+ *
+ * @brief   xorshift32, so that both runs of a seed draw the same events.
+ */
+static uint32 simRand( void )
+{
+  simRandState ^= simRandState << 13;
+  simRandState ^= simRandState >> 17;
+  simRandState ^= simRandState << 5;
+  return simRandState;
+}
+
+/*********************************************************************
+ * @fn      simNode
+ *
+ * @brief   Node of a NWK address, or -1.
+ */
+static int simNode( uint16 nwkAddr )
+{
+  int node;
+
+  for ( node = 0; node < simNodes; node++ )
+  {
+    if ( simNwkAddr[node] == nwkAddr )
+    {
+      return node;
+    }
+  }
+  return -1;
+}
+
+/*********************************************************************
+ * @fn      simShortestPaths
+ *
+ * @brief   Breadth-first search from the coordinator over the living
+ *          nodes.
+ */
+static void simShortestPaths( void )
+{
+  static uint8 queue[SIM_MAX_NODES];
+  int head = 0;
+  int tail = 0;
+  int node;
+  int next;
+
+  memset( simHops, SIM_NO_HOPS, sizeof( simHops ) );
+  simHops[0] = 0;
+  queue[tail++] = 0;
+  while ( head < tail )
+  {
+    node = queue[head++];
+    for ( next = 0; next < simNodes; next++ )
+    {
+      if ( simLink[node][next] && simAlive[next] && (simHops[next] == SIM_NO_HOPS) )
+      {
+        simHops[next] = simHops[node] + 1;
+        simParent[next] = (uint8)node;
+        queue[tail++] = (uint8)next;
+      }
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      simPathOf
+ *
+ * @brief   Current shortest path of a device to the coordinator.
+ */
+static void simPathOf( int node, simPath_t *path )
+{
+  int relay;
+
+  if ( simHops[node] == SIM_NO_HOPS )
+  {
+    path->relayCnt = SIM_NO_HOPS;
+    return;
+  }
+  path->relayCnt = 0;
+  for ( relay = simParent[node]; relay != 0; relay = simParent[relay] )
+  {
+    path->relays[path->relayCnt++] = (uint8)relay;
+  }
+}
+
+/*********************************************************************
+ * @fn      simPathUp
+ *
+ * @brief   Sends a frame from a device up a path to the coordinator.
+ *
+ * @return  TRUE if it arrives; the transmissions are counted either way
+ */
+static int simPathUp( simPath_t *path, int node )
+{
+  int from = node;
+  int to;
+  int i;
+
+  if ( path->relayCnt == SIM_NO_HOPS )
+  {
+    return FALSE;
+  }
+  for ( i = 0; i <= path->relayCnt; i++ )
+  {
+    to = ( i == path->relayCnt ) ? 0 : path->relays[i];
+    simCounts.transmissions++;
+    if ( !simAlive[to] || !simLink[from][to] )
+    {
+      return FALSE;
+    }
+    from = to;
+  }
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      simDiscover
+ *
+ * @brief   Discovers the mesh route between a device and the coordinator
+ *          if it expired or broke: the request is flooded, the reply
+ *          comes back along the route.
+ *
+ * @return  TRUE if a discovery was needed
+ */
+static uint8 simDiscover( int node )
+{
+  simPath_t *route = &simRoute[node];
+  int from = node;
+  int to;
+  int i;
+  int live = (route->relayCnt != SIM_NO_HOPS) && (simNow - simRouteUsed[node] < SIM_ROUTE_EXPIRY);
+
+  for ( i = 0; live && (i <= route->relayCnt); i++ )
+  {
+    to = ( i == route->relayCnt ) ? 0 : route->relays[i];
+    live = simAlive[to] && simLink[from][to];
+    from = to;
+  }
+  if ( live )
+  {
+    return FALSE;
+  }
+
+  simCounts.floods++;
+  simShortestPaths();
+  for ( i = 0; i < simNodes; i++ )
+  {
+    if ( simAlive[i] && (simHops[i] != SIM_NO_HOPS) )
+    {
+      simCounts.transmissions++;
+    }
+  }
+  simPathOf( node, route );
+  if ( route->relayCnt != SIM_NO_HOPS )
+  {
+    simCounts.transmissions += route->relayCnt + 1;
+  }
+  simRouteUsed[node] = simNow;
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      simRecord
+ *
+ * @brief   Sends the route record of a device, on its many-to-one route,
+ *          to the coordinator's stack table and ZDO callback.
+ */
+static void simRecord( int node )
+{
+  simPath_t *route = &simMtoRoute[node];
+  simSrcEntry_t *entry;
+  zdoSrcRtg_t record;
+  int oldest = 0;
+  int i;
+
+  simRecordDue[node] = FALSE;
+  if ( !simPathUp( route, node ) )
+  {
+    return;
+  }
+
+  for ( i = 1; i < SIM_SRC_TABLE; i++ )
+  {
+    if ( simSrcTable[i].time < simSrcTable[oldest].time )
+    {
+      oldest = i;
+    }
+  }
+  entry = &simSrcTable[oldest];
+  entry->nwkAddr = simNwkAddr[node];
+  entry->time = simNow;
+  entry->relayCnt = route->relayCnt;
+  for ( i = 0; i < route->relayCnt; i++ )
+  {
+    entry->relays[i] = simNwkAddr[route->relays[i]];
+  }
+
+  record.srcAddr = entry->nwkAddr;
+  record.relayCnt = entry->relayCnt;
+  record.pRelayList = entry->relays;
+  simRecordCB( &record );
+}
+
+/*********************************************************************
+ * @fn      simReport
+ *
+ * @brief   Sends a report of a device to the coordinator.
+ */
+static void simReport( int node )
+{
+  if ( !simConcentrator )
+  {
+    simDiscover( node );
+    if ( simPathUp( &simRoute[node], node ) )
+    {
+      simRouteUsed[node] = simNow;
+    }
+    return;
+  }
+
+  if ( simRecordDue[node] )
+  {
+    simRecord( node );
+  }
+  if ( !simPathUp( &simMtoRoute[node], node ) )
+  {
+    // The many-to-one route broke; the device discovers one of its own
+    // until the next request.
+    simDiscover( node );
+    simMtoRoute[node] = simRoute[node];
+    simPathUp( &simMtoRoute[node], node );
+  }
+}
+
+/*********************************************************************
+ * @fn      simCommand
+ *
+ * @brief   Sends a gateway command from the coordinator to a device.
+ */
+static void simCommand( int node )
+{
+  static endPointDesc_t epDesc;
+  static uint8 payload[4];
+  afAddrType_t dstAddr;
+  uint8 transId = 0;
+
+  simCounts.commands++;
+  dstAddr.addrMode = afAddr16Bit;
+  dstAddr.addr.shortAddr = simNwkAddr[node];
+  dstAddr.endPoint = 1;
+  if ( simConcentrator )
+  {
+    SourceRoute_DataRequest( &dstAddr, &epDesc, 1, sizeof( payload ), payload, &transId,
+                             AF_ACK_REQUEST, AF_DEFAULT_RADIUS );
+  }
+  else
+  {
+    AF_DataRequest( &dstAddr, &epDesc, 1, sizeof( payload ), payload, &transId,
+                    AF_ACK_REQUEST, AF_DEFAULT_RADIUS );
+  }
+}
+
+/*********************************************************************
+ * @fn      simRun
+ *
+ * @brief   Runs one seed before or after.
+ */
+static void simRun( uint32 seed, uint8 concentrator )
+{
+  uint32 end = (uint32)simMinutes * 60000;
+  uint32 nextCommand;
+  uint8 joined[SIM_MAX_NODES];
+  uint8 extAddr[Z_EXTADDR_LEN];
+  bool changed;
+  unsigned int hops = 0;
+  unsigned int maxHops = 0;
+  int tries;
+  int node;
+  int other;
+  int i;
+
+  // The placement: the coordinator in the middle, every node in reach
+  simRandState = seed;
+  do
+  {
+    simX[0] = SIM_SIDE / 2;
+    simY[0] = SIM_SIDE / 2;
+    for ( node = 1; node < simNodes; node++ )
+    {
+      simX[node] = simRand() % SIM_SIDE;
+      simY[node] = simRand() % SIM_SIDE;
+    }
+    for ( node = 0; node < simNodes; node++ )
+    {
+      simAlive[node] = TRUE;
+      for ( other = 0; other < simNodes; other++ )
+      {
+        int dx = simX[node] - simX[other];
+        int dy = simY[node] - simY[other];
+        simLink[node][other] = (node != other) && (dx * dx + dy * dy <= SIM_RANGE * SIM_RANGE);
+      }
+    }
+    simShortestPaths();
+    for ( node = 1; (node < simNodes) && (simHops[node] != SIM_NO_HOPS); node++ );
+  } while ( node < simNodes );
+
+  if ( !concentrator )
+  {
+    for ( node = 1; node < simNodes; node++ )
+    {
+      hops += simHops[node];
+      maxHops = ( simHops[node] > maxHops ) ? simHops[node] : maxHops;
+    }
+    printf( "  seed %u: %.1f hops on average, %u at most\n", seed,
+            (double)hops / (simNodes - 1), maxHops );
+    printf( "    %-6s %8s %14s %9s %11s %5s\n", "", "floods", "transmissions", "commands",
+            "discovered", "lost" );
+  }
+
+  // Addresses, the phases of the reports, and the joins in random order
+  memset( simNwkAddr, 0xFF, sizeof( simNwkAddr ) );
+  simNwkAddr[0] = 0x0000;
+  for ( node = 1; node < simNodes; node++ )
+  {
+    do
+    {
+      simNwkAddr[node] = (uint16)(1 + simRand() % 0xFFF7);
+    } while ( simNode( simNwkAddr[node] ) != node );
+    simPhase[node] = simRand() % SIM_REPORT_INTERVAL;
+  }
+
+  memset( &simCounts, 0, sizeof( simCounts ) );
+  memset( simRoute, SIM_NO_HOPS, sizeof( simRoute ) );
+  memset( simRouteUsed, 0, sizeof( simRouteUsed ) );
+  memset( simMtoRoute, SIM_NO_HOPS, sizeof( simMtoRoute ) );
+  memset( simRecordDue, 0, sizeof( simRecordDue ) );
+  memset( simSrcTable, 0, sizeof( simSrcTable ) );
+  simNow = 0;
+  simConcentrator = concentrator;
+  simNvCreated = FALSE;
+  simMtoDue = 0xFFFFFFFF;
+
+  DeviceDirectory_Init( 0x0402 );
+  memset( joined, 0, sizeof( joined ) );
+  for ( i = 1; i < simNodes; i++ )
+  {
+    do
+    {
+      node = 1 + simRand() % (simNodes - 1);
+    } while ( joined[node] );
+    joined[node] = TRUE;
+    memset( extAddr, 0, sizeof( extAddr ) );
+    extAddr[0] = (uint8)node;
+    extAddr[7] = 0x12;
+    DeviceDirectory_Update( simNwkAddr[node], extAddr, &changed );
+  }
+
+  if ( concentrator )
+  {
+    SourceRoute_Init( 0, 0x0001 );
+    // The stack sends the first request when the network starts
+    NLME_RouteDiscoveryRequest( 0, MTO_ROUTE, zgConcentratorRadius );
+  }
+
+  nextCommand = simCommandInterval;
+  for ( simNow = 0; simNow < end; simNow += SIM_STEP )
+  {
+    if ( (simNow == end / 2) && (simDeaths > 0) )
+    {
+      // Routers that relay for others die
+      for ( i = 0, tries = 0; (i < simDeaths) && (tries < 100000); tries++ )
+      {
+        node = 1 + simRand() % (simNodes - 1);
+        for ( other = 1; other < simNodes; other++ )
+        {
+          if ( simAlive[node] && simAlive[other] && (simHops[other] != SIM_NO_HOPS)
+              && (simParent[other] == node) )
+          {
+            simAlive[node] = FALSE;
+            i++;
+            break;
+          }
+        }
+      }
+      simShortestPaths();
+    }
+
+    if ( simNow >= simMtoDue )
+    {
+      SourceRoute_ProcessEvent();
+    }
+
+    for ( node = 1; node < simNodes; node++ )
+    {
+      if ( simAlive[node] && ((simNow % SIM_REPORT_INTERVAL) / SIM_STEP == simPhase[node] / SIM_STEP) )
+      {
+        simReport( node );
+      }
+    }
+
+    if ( simNow >= nextCommand )
+    {
+      nextCommand += simCommandInterval;
+      do
+      {
+        node = 1 + simRand() % (simNodes - 1);
+      } while ( !simAlive[node] );
+      simCommand( node );
+    }
+  }
+
+  printf( "    %-6s %8lu %14lu %9lu %11lu %5lu\n", concentrator ? "after" : "before",
+          simCounts.floods, simCounts.transmissions, simCounts.commands,
+          simCounts.commandsDiscovered, simCounts.commandsLost );
+}
+
+/*********************************************************************
+ * @fn      main
+ *
+ * @brief   Runs the seeds.
+ *
+ * @param   argc, argv - see the usage above
+ *
+ * @return  0, or 1 for a bad argument
+ */
+int main( int argc, char **argv )
+{
+  srcRouteStats_t *stats = &SourceRoute_Stats;
+  int seed;
+  int opt;
+
+  while ( (opt = getopt( argc, argv, "n:s:t:c:k:" )) != -1 )
+  {
+    if ( (opt == 'n') && (atoi( optarg ) > 0) && (atoi( optarg ) < SIM_MAX_NODES) )
+    {
+      simNodes = atoi( optarg ) + 1;
+    }
+    else if ( (opt == 's') && (atoi( optarg ) > 0) )
+    {
+      simSeeds = atoi( optarg );
+    }
+    else if ( (opt == 't') && (atol( optarg ) > 0) )
+    {
+      simMinutes = atol( optarg );
+    }
+    else if ( (opt == 'c') && (atol( optarg ) >= SIM_STEP) )
+    {
+      simCommandInterval = atol( optarg ) / SIM_STEP * SIM_STEP;
+    }
+    else if ( (opt == 'k') && (atoi( optarg ) >= 0) )
+    {
+      simDeaths = atoi( optarg );
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-n nodes] [-s seeds] [-t minutes] [-c command ms] "
+               "[-k deaths]\n", argv[0] );
+      return 1;
+    }
+  }
+
+  printf( "%d devices in %d m, range %d m, %ld min, a command every %ld ms, %d routers die, "
+          "DEVDIR_MAX_DEVICES %d\n", simNodes - 1, SIM_SIDE, SIM_RANGE, simMinutes,
+          simCommandInterval, simDeaths, DEVDIR_MAX_DEVICES );
+
+  for ( seed = 1; seed <= simSeeds; seed++ )
+  {
+    simRun( (uint32)seed, FALSE );
+    simRun( (uint32)seed, TRUE );
+    printf( "    SourceRoute_Stats: %u requests, %u records, %u cached, %u stack cached, "
+            "%u discovered, %u failed; %u route discoveries avoided\n",
+            stats->mtoRequests, stats->routeRecords, stats->cached, stats->stackCached,
+            stats->discovered, stats->failed, stats->cached + stats->stackCached );
+  }
+  return 0;
+}
+
+/*********************************************************************
+*********************************************************************/
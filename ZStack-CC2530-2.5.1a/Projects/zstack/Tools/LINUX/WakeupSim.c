@@ -0,0 +1,576 @@
+/**************************************************************************************************
+  Filename:       WakeupSim.c
+
+  Description:    Runs the timers of the GenericApp end device on the OSAL
+                  of the Linux host, built with POWER_SAVING and
+                  OSAL_TICKLESS on a virtual clock, and estimates its
+                  wakeups per hour before and after the sample timer took
+                  a slack.
+
+  The tasks stand for those of the end device that run timers:
+
+      NWK         the data poll, a reload timer of POLL_RATE ms (-p)
+      GenericApp  the sample timer (enddevice.c) of the sample interval;
+                  each sample starts the DHT11 (DHT11.c), whose 20 ms
+                  start signal is a timer of its own, then reads it
+
+  "Before" is the sample timer as enddevice.c had it, a one-shot timer
+  started again by each sample. "After" is the reload timer with half an
+  interval of slack that it has now. Handlers take their time on the
+  target with Onboard_wait(), so that a one-shot timer drifts as it does
+  there; sleeps take none.
+
+  Whether the slack of the sample timer reaches a poll depends on where
+  the join falls between two polls, which a device does not choose. So
+  each line is the mean of SIM_PHASES runs, the join falling at as many
+  points spread over a poll period; -o runs one. The max gap is the
+  longest of all the runs.
+
+  The runs are preceded by a check of osal_next_timeout() against a
+  model of the timer list: random starts, restarts and stops of up to
+  SIM_CHECK_TIMERS timers with random slack, and ticks. The wakeup it
+  gives must never be later than a timer's window allows, nor earlier
+  than the first timer expires, and must be that of the model when no
+  more timers overlap than OSAL_TIMERS_SLACK_SCAN lets osalTimerCoalesce()
+  look at. The check counts the wakeups the bound brought forward.
+
+  The counts are those of osal_pwrmgr_stats(), as MT_SYS_OSAL_PWR_STATS
+  reads them on a device. A sleep is counted as the power manager asks for
+  it: on the CC2530, halSleep() stays awake instead for less than
+  PM_MIN_SLEEP_TIME (14 ms), and the MAC also wakes the device, for the
+  poll's data request, which the simulation leaves out.
+
+  Build on the Linux host target (see Projects/zstack/ZMain/LINUX/OnBoard.h):
+
+    gcc -std=gnu99 -O2 -DUBIT -DPOWER_SAVING -DOSAL_TICKLESS=TRUE \
+        -DONBOARD_VIRTUAL_TIME \
+        -I Components/hal/target/LINUX -I Projects/zstack/ZMain/LINUX \
+        -I Components/hal/include -I Components/osal/include \
+        Components/osal/common/OSAL.c Components/osal/common/OSAL_Clock.c \
+        Components/osal/common/OSAL_Memory.c Components/osal/common/OSAL_PwrMgr.c \
+        Components/osal/common/OSAL_Timers.c Projects/zstack/ZMain/LINUX/OnBoard.c \
+        Projects/zstack/Tools/LINUX/WakeupSim.c -o WakeupSim
+
+  Usage: WakeupSim [-t hours] [-p poll ms] [-i sample ms] [-o join ms]
+    -t  length of the run, in hours (1)
+    -p  data poll rate, in ms (1000, POLL_RATE of f8wConfig.cfg)
+    -i  sample interval, in ms; without it, 1000, 2000 (the default of
+        enddevice.c), 5000 and 10000
+    -o  time from power-up, when the polls start, to the join, when the
+        sample timer starts, in ms; without it, SIM_PHASES times spread
+        over a poll period
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "comdef.h"
+#include "OnBoard.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "OSAL_PwrMgr.h"
+
+#if !OSAL_TICKLESS || !defined( ONBOARD_VIRTUAL_TIME )
+  #error WakeupSim needs POWER_SAVING, OSAL_TICKLESS=TRUE and ONBOARD_VIRTUAL_TIME.
+#endif
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Tasks, in order of priority
+#define SIM_NWK           0
+#define SIM_APP           1
+#define SIM_TASKS         2
+
+// Events
+#define SIM_POLL_EVT      0x0001  // NWK: data poll
+#define SIM_SAMPLE_EVT    0x0001  // GenericApp: sample
+#define SIM_DHT11_EVT     0x0002  // GenericApp: DHT11 start signal sent
+#define SIM_JOIN_EVT      0x0004  // GenericApp: joined (ZDO_STATE_CHANGE)
+
+// Times of the target
+#define SIM_DHT11_START_MS  20    // DHT11_START_MS
+#define SIM_POLL_US         2500  // data request and its acknowledgement
+#define SIM_SAMPLE_US       800   // ADC channels
+#define SIM_DHT11_READ_US   4500  // DHT11 frame and the report
+
+// Sample intervals of a run without -i, and joins of a run without -o
+#define SIM_INTERVALS     4
+#define SIM_PHASES        10
+
+// The check of osal_next_timeout(): timers, which are events of SIM_APP,
+// and steps
+#define SIM_CHECK_TIMERS  12
+#define SIM_CHECK_STEPS   200000
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Counts of a run, per hour
+typedef struct
+{
+  double sleeps;
+  double timerWakeups;
+  double timersBatched;
+  double interval;        // mean time between samples, in ms
+  unsigned long maxGap;   // ms
+} simResult_t;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint16 simNwk( uint8 task_id, uint16 events );
+static uint16 simApp( uint8 task_id, uint16 events );
+static uint32 simRand( void );
+static int simCheck( void );
+static void simRun( int hours, uint16 poll, uint16 join, simResult_t *result );
+static int simFork( int hours, uint16 poll, uint16 join, simResult_t *result );
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+const pTaskEventHandlerFn tasksArr[SIM_TASKS] =
+{
+  simNwk, simApp
+};
+const uint8 tasksCnt = SIM_TASKS;
+uint16 *tasksEvents;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const uint16 simIntervals[SIM_INTERVALS] = { 1000, 2000, 5000, 10000 };
+
+// The run
+static uint16 simInterval;
+static uint8 simSlack;
+
+// Samples taken, and the times between them, in ms
+static unsigned long simSamples;
+static uint32 simFirstSample;
+static uint32 simLastSample;
+static uint32 simMaxGap;
+
+static uint32 simRandState = 50;
+
+/*********************************************************************
+ * TASKS
+ */
+
+static uint16 simNwk( uint8 task_id, uint16 events )
+{
+  (void)task_id;
+
+  if ( events & SIM_POLL_EVT )
+  {
+    Onboard_wait( SIM_POLL_US );
+    return ( events ^ SIM_POLL_EVT );
+  }
+  return ( 0 );
+}
+
+static uint16 simApp( uint8 task_id, uint16 events )
+{
+  uint32 now;
+
+  if ( events & SIM_SAMPLE_EVT )
+  {
+    now = osal_GetSystemClock();
+    if ( simSamples == 0 )
+    {
+      simFirstSample = now;
+    }
+    else if ( now - simLastSample > simMaxGap )
+    {
+      simMaxGap = now - simLastSample;
+    }
+    simLastSample = now;
+    simSamples++;
+
+    Onboard_wait( SIM_SAMPLE_US );
+    osal_start_timerEx( task_id, SIM_DHT11_EVT, SIM_DHT11_START_MS );
+
+    if ( !simSlack )
+    {
+      osal_start_timerEx( task_id, SIM_SAMPLE_EVT, simInterval );
+    }
+    return ( events ^ SIM_SAMPLE_EVT );
+  }
+  if ( events & SIM_DHT11_EVT )
+  {
+    Onboard_wait( SIM_DHT11_READ_US );
+    return ( events ^ SIM_DHT11_EVT );
+  }
+  if ( events & SIM_JOIN_EVT )
+  {
+    if ( simSlack )
+    {
+      osal_start_reload_timer_slack( task_id, SIM_SAMPLE_EVT, simInterval, simInterval / 2 );
+    }
+    else
+    {
+      osal_start_timerEx( task_id, SIM_SAMPLE_EVT, simInterval );
+    }
+    return ( events ^ SIM_JOIN_EVT );
+  }
+  return ( 0 );
+}
+
+void osalInitTasks( void )
+{
+  tasksEvents = (uint16 *)osal_mem_alloc( sizeof( uint16 ) * tasksCnt );
+  osal_memset( tasksEvents, 0, sizeof( uint16 ) * tasksCnt );
+}
+
+/*********************************************************************
+ * @fn      simRand
+ *
+ * @brief   xorshift32, for the check.
+ */
+static uint32 simRand( void )
+{
+  simRandState ^= simRandState << 13;
+  simRandState ^= simRandState >> 17;
+  simRandState ^= simRandState << 5;
+  return simRandState;
+}
+
+/*********************************************************************
+ * @fn      simCheck
+ *
+ * @brief   Checks osal_next_timeout() against a model of the timers,
+ *          and prints a line of counts.
+ *
+ * @param   none
+ *
+ * @return  the number of steps that failed
+ */
+static int simCheck( void )
+{
+  uint8 running[SIM_CHECK_TIMERS];
+  uint32 expiry[SIM_CHECK_TIMERS];
+  uint16 slack[SIM_CHECK_TIMERS];
+  unsigned long wakeups = 0;
+  unsigned long early = 0;
+  int failed = 0;
+  uint32 now;
+  uint32 first;
+  uint32 wake;
+  uint16 timeout;
+  uint16 next;
+  uint8 count;
+  int step;
+  int kind;
+  int t;
+
+  InitBoard( OB_COLD );
+  osal_init_system();
+  memset( running, 0, sizeof( running ) );
+
+  for ( step = 0; step < SIM_CHECK_STEPS; step++ )
+  {
+    kind = simRand() % 10;
+    t = simRand() % SIM_CHECK_TIMERS;
+    now = osal_GetSystemClock();
+
+    if ( kind < 3 )
+    {
+      // Start or restart with a slack, none for a third of them
+      timeout = (uint16)(1 + simRand() % 3000);
+      slack[t] = ( simRand() % 3 ) ? (uint16)(simRand() % 1500) : 0;
+      osal_start_timerEx_slack( SIM_APP, (uint16)(1 << t), timeout, slack[t] );
+      expiry[t] = now + timeout;
+      running[t] = TRUE;
+    }
+    else if ( kind < 5 )
+    {
+      // Start, or restart keeping the slack
+      timeout = (uint16)(1 + simRand() % 3000);
+      osal_start_timerEx( SIM_APP, (uint16)(1 << t), timeout );
+      if ( !running[t] )
+      {
+        slack[t] = 0;
+      }
+      expiry[t] = now + timeout;
+      running[t] = TRUE;
+    }
+    else if ( kind < 6 )
+    {
+      osal_stop_timerEx( SIM_APP, (uint16)(1 << t) );
+      running[t] = FALSE;
+    }
+    else
+    {
+      osalTimerUpdate( (uint16)(simRand() % 400) );
+      now = osal_GetSystemClock();
+      for ( t = 0; t < SIM_CHECK_TIMERS; t++ )
+      {
+        if ( running[t] && (expiry[t] <= now) )
+        {
+          running[t] = FALSE;
+        }
+      }
+    }
+
+    // The model: the first expiry, and the first window to close
+    count = 0;
+    first = 0xFFFFFFFF;
+    wake = 0xFFFFFFFF;
+    for ( t = 0; t < SIM_CHECK_TIMERS; t++ )
+    {
+      if ( running[t] )
+      {
+        count++;
+        first = ( expiry[t] - now < first ) ? expiry[t] - now : first;
+        wake = ( expiry[t] + slack[t] - now < wake ) ? expiry[t] + slack[t] - now : wake;
+      }
+    }
+
+    next = osal_next_timeout();
+    if ( count == 0 )
+    {
+      failed += ( next != 0 );
+      continue;
+    }
+    wakeups++;
+    if ( (next < first) || (next > wake)
+        || ((count <= OSAL_TIMERS_SLACK_SCAN + 1) && (next != wake)) )
+    {
+      if ( failed++ < 10 )
+      {
+        printf( "check step %d: %u timers, next %u, expected %lu to %lu\n",
+                step, count, next, (unsigned long)first, (unsigned long)wake );
+      }
+    }
+    else if ( next < wake )
+    {
+      early++;
+    }
+  }
+
+  printf( "check of osal_next_timeout(): %d steps, %d failed; %lu of %lu wakeups brought "
+          "forward by OSAL_TIMERS_SLACK_SCAN (%d)\n\n", SIM_CHECK_STEPS, failed, early, wakeups,
+          OSAL_TIMERS_SLACK_SCAN );
+  return ( failed );
+}
+
+/*********************************************************************
+ * @fn      simRun
+ *
+ * @brief   Runs the end device for a time and counts its sleeps.
+ *
+ * @param   hours - length of the run
+ * @param   poll - data poll rate, in ms
+ * @param   join - time from power-up to the join, in ms
+ * @param   result - the counts of the run
+ *
+ * @return  none
+ */
+static void simRun( int hours, uint16 poll, uint16 join, simResult_t *result )
+{
+  pwrmgr_stats_t stats;
+  uint32 end;
+  double perHour;
+
+  InitBoard( OB_COLD );
+  osal_init_system();
+  osal_int_enable( INTS_ALL );
+  osal_pwrmgr_device( PWRMGR_BATTERY );
+
+  osal_start_reload_timer( SIM_NWK, SIM_POLL_EVT, poll );
+  if ( join )
+  {
+    osal_start_timerEx( SIM_APP, SIM_JOIN_EVT, join );
+  }
+  else
+  {
+    osal_set_event( SIM_APP, SIM_JOIN_EVT );
+  }
+
+  end = hours * 3600000UL;
+  while ( osal_GetSystemClock() < end )
+  {
+    osal_run_system();
+  }
+  osal_pwrmgr_stats( &stats, FALSE );
+
+  perHour = 1.0 / hours;
+  result->sleeps = stats.sleeps * perHour;
+  result->timerWakeups = stats.timerWakeups * perHour;
+  result->timersBatched = stats.timersBatched * perHour;
+  result->interval = ( simSamples > 1 )
+                   ? (double)(simLastSample - simFirstSample) / (simSamples - 1) : 0.0;
+  result->maxGap = simMaxGap;
+}
+
+/*********************************************************************
+ * @fn      simFork
+ *
+ * @brief   Runs simRun() in a process of its own, since the OSAL keeps
+ *          its state in statics, and reads back its counts.
+ *
+ * @param   hours, poll, join - see simRun()
+ * @param   result - the counts of the run
+ *
+ * @return  0, or -1 if the run failed
+ */
+static int simFork( int hours, uint16 poll, uint16 join, simResult_t *result )
+{
+  int fds[2];
+  pid_t pid;
+  ssize_t got;
+
+  if ( pipe( fds ) < 0 )
+  {
+    perror( "pipe" );
+    return ( -1 );
+  }
+  pid = fork();
+  if ( pid == 0 )
+  {
+    close( fds[0] );
+    simRun( hours, poll, join, result );
+    got = write( fds[1], result, sizeof( *result ) );
+    _exit( (got == sizeof( *result )) ? 0 : 1 );
+  }
+  close( fds[1] );
+  if ( pid < 0 )
+  {
+    perror( "fork" );
+    close( fds[0] );
+    return ( -1 );
+  }
+  got = read( fds[0], result, sizeof( *result ) );
+  close( fds[0] );
+  waitpid( pid, NULL, 0 );
+  return ( (got == sizeof( *result )) ? 0 : -1 );
+}
+
+int main( int argc, char **argv )
+{
+  simResult_t result;
+  simResult_t sum;
+  int hours = 1;
+  int poll = 1000;
+  int interval = 0;
+  int join = 0;
+  int phases = SIM_PHASES;
+  int opt;
+  int status;
+  int i;
+  int k;
+  int run;
+  pid_t pid;
+
+  while ( (opt = getopt( argc, argv, "t:p:i:o:" )) != -1 )
+  {
+    switch ( opt )
+    {
+      case 't':
+        hours = atoi( optarg );
+        break;
+      case 'p':
+        poll = atoi( optarg );
+        break;
+      case 'i':
+        interval = atoi( optarg );
+        break;
+      case 'o':
+        join = atoi( optarg );
+        phases = 1;
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-t hours] [-p poll ms] [-i sample ms] [-o join ms]\n",
+                 argv[0] );
+        return ( 1 );
+    }
+  }
+  if ( (hours <= 0) || (poll <= 0) || (poll > 0xFFFF) || (interval < 0) || (interval > 0xFFFF)
+      || (join < 0) || (join > 0xFFFF) )
+  {
+    fprintf( stderr, "-t and -p must be positive, -o not negative, and -p, -i and -o at "
+             "most 65535\n" );
+    return ( 1 );
+  }
+  fflush( stdout );
+  pid = fork();
+  if ( pid == 0 )
+  {
+    status = simCheck();
+    fflush( stdout );
+    _exit( status ? 1 : 0 );
+  }
+  if ( (pid < 0) || (waitpid( pid, &status, 0 ) < 0) || !WIFEXITED( status )
+      || (WEXITSTATUS( status ) != 0) )
+  {
+    fprintf( stderr, "the check of osal_next_timeout() failed\n" );
+    return ( 1 );
+  }
+
+  printf( "GenericApp end device, poll %d ms, %d h; counts per hour", poll, hours );
+  if ( phases > 1 )
+  {
+    printf( ", the mean of %d joins over a poll period", phases );
+  }
+  printf( "\n\n%8s %-6s %9s %9s %9s %9s %9s %8s\n", "sample", "timer", "sleeps",
+          "timer wk", "other wk", "batched", "interval", "max gap" );
+
+  for ( i = 0; i < SIM_INTERVALS; i++ )
+  {
+    if ( interval && (i > 0) )
+    {
+      break;
+    }
+    simInterval = interval ? (uint16)interval : simIntervals[i];
+
+    for ( run = 0; run < 2; run++ )
+    {
+      simSlack = (uint8)run;
+
+      memset( &sum, 0, sizeof( sum ) );
+      for ( k = 0; k < phases; k++ )
+      {
+        // The joins fall in the middle of equal parts of a poll period
+        if ( simFork( hours, (uint16)poll,
+                      (uint16)(( phases > 1 ) ? (long)poll * (2 * k + 1) / (2 * phases) : join),
+                      &result ) < 0 )
+        {
+          return ( 1 );
+        }
+        sum.sleeps += result.sleeps;
+        sum.timerWakeups += result.timerWakeups;
+        sum.timersBatched += result.timersBatched;
+        sum.interval += result.interval;
+        sum.maxGap = ( result.maxGap > sum.maxGap ) ? result.maxGap : sum.maxGap;
+      }
+
+      printf( "%8u %-6s %9.0f %9.0f %9.0f %9.0f %9.1f %8lu\n", simInterval,
+              simSlack ? "after" : "before", sum.sleeps / phases, sum.timerWakeups / phases,
+              (sum.sleeps - sum.timerWakeups) / phases, sum.timersBatched / phases,
+              sum.interval / phases, sum.maxGap );
+    }
+  }
+
+  printf( "\nsleeps    : sleeps the power manager asked for\n"
+          "timer wk  : sleeps ended by OSAL timers falling due\n"
+          "other wk  : sleeps ended otherwise\n"
+          "batched   : timers that fell due in the wakeup of another\n"
+          "interval  : mean time between samples, in ms; max gap the longest\n" );
+
+  return ( 0 );
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,2 @@
+// ZDApp.h includes ZMAC.h by the name it has on a case-insensitive file system.
+#include "ZMAC.h"
@@ -0,0 +1,2 @@
+// BindingTable.h includes OSAL.h by the name it has on a case-insensitive file system.
+#include "OSAL.h"
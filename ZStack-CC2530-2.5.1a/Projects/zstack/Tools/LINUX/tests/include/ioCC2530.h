@@ -0,0 +1,19 @@
+// The CC2530 registers used by the drivers of the sample, as variables that the test of each
+// driver defines and drives.
+#pragma once
+
+#include "hal_types.h"
+
+extern uint8 P0DIR;
+extern uint8 P1_1;
+extern uint8 P1DIR;
+extern uint8 P1SEL;
+extern uint8 PERCFG;
+extern uint8 T1CTL;
+extern uint8 T1CNTL;
+extern uint8 T1STAT;
+extern uint8 T1CCTL1;
+extern uint8 T1CC1L;
+extern uint8 T1CC1H;
+extern uint8 T1IE;
+extern uint8 T1IF;
@@ -0,0 +1,2 @@
+// ds18b20.c includes ioCC2530.h by the name it has on a case-insensitive file system.
+#include "ioCC2530.h"
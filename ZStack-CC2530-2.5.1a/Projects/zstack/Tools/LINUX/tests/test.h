@@ -0,0 +1,40 @@
+/// \file test.h
+/// \brief Minimal assertions for the host tests of the GenericApp sample.
+///
+/// The modules under test are built for the host with the compiler of the host; see the
+/// Makefile. A failed check prints its location and the test goes on, so that one run reports
+/// every failure; main returns TEST_RESULT().
+#pragma once
+
+#include <stdio.h>
+
+static unsigned int testChecks = 0;
+static unsigned int testFailures = 0;
+
+#define TEST_CHECK(condition)                                                       \
+    do {                                                                            \
+        testChecks++;                                                               \
+        if (!(condition)) {                                                         \
+            testFailures++;                                                         \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                           \
+    } while (0)
+
+#define TEST_CHECK_EQUAL(expected, actual)                                                   \
+    do {                                                                                     \
+        long long testExpected = (long long)(expected);                                      \
+        long long testActual = (long long)(actual);                                          \
+        testChecks++;                                                                        \
+        if (testExpected != testActual) {                                                    \
+            testFailures++;                                                                  \
+            fprintf(stderr, "%s:%d: %s: expected %lld, got %lld\n", __FILE__, __LINE__, #actual, \
+                    testExpected, testActual);                                               \
+        }                                                                                    \
+    } while (0)
+
+/// <summary>
+///     Prints the summary of the run and evaluates to the exit status of the test.
+/// </summary>
+#define TEST_RESULT()                                                                       \
+    (printf("%s: %u checks, %u failed\n", __FILE__, testChecks, testFailures), \
+     (testFailures != 0) ? 1 : 0)
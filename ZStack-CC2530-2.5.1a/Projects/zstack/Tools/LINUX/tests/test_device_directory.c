@@ -0,0 +1,300 @@
+/// \file test_device_directory.c
+/// \brief Tests the device directory of the coordinator, DeviceDirectory.c of the GenericApp
+/// sample, against a reference model: 500 simulated device announces, covering joins, rejoins
+/// with a new NWK address, address takeovers, unchanged announces and restarts from NV, which
+/// is kept in memory. After every event each index, entry and lookup is checked against the
+/// model, and the NV writes against the entries that changed. The source is included here so
+/// that the test can count the probes of the lookups. Build with -DDEVDIR_MAX_DEVICES=n for
+/// another capacity.
+
+#include <stdlib.h>
+#include <string.h>
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "OSAL_Nv.h"
+
+#include "DeviceDirectory.c"
+#include "test.h"
+
+#define TEST_NV_ID 0x0402
+#define EVENTS 500
+#define NO_NWK_ADDR DEVDIR_NO_NWK_ADDR
+
+// The OSAL.
+
+static uint8 nvItem[sizeof(devDir_Entries)];
+static bool nvCreated;
+static unsigned int nvWrites;
+static unsigned long nvBytes;
+
+void *osal_memcpy(void *dst, const void GENERIC *src, unsigned int len)
+{
+    return memcpy(dst, src, len);
+}
+
+void *osal_memset(void *dest, uint8 value, int len)
+{
+    return memset(dest, value, len);
+}
+
+uint8 osal_memcmp(const void GENERIC *src1, const void GENERIC *src2, unsigned int len)
+{
+    return memcmp(src1, src2, len) == 0;
+}
+
+uint8 osal_isbufset(uint8 *buf, uint8 val, uint8 len)
+{
+    for (uint8 i = 0; i < len; i++) {
+        if (buf[i] != val) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+uint8 osal_nv_item_init(uint16 id, uint16 len, void *buf)
+{
+    TEST_CHECK_EQUAL(TEST_NV_ID, id);
+    TEST_CHECK_EQUAL(sizeof(nvItem), len);
+    if (nvCreated) {
+        return ZSUCCESS;
+    }
+    memcpy(nvItem, buf, sizeof(nvItem));
+    nvCreated = true;
+    return NV_ITEM_UNINIT;
+}
+
+uint8 osal_nv_read(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    TEST_CHECK_EQUAL(TEST_NV_ID, id);
+    TEST_CHECK(offset + len <= sizeof(nvItem));
+    memcpy(buf, &nvItem[offset], len);
+    return ZSUCCESS;
+}
+
+uint8 osal_nv_write(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    TEST_CHECK_EQUAL(TEST_NV_ID, id);
+    TEST_CHECK(offset + len <= sizeof(nvItem));
+    memcpy(&nvItem[offset], buf, len);
+    nvWrites++;
+    nvBytes += len;
+    return ZSUCCESS;
+}
+
+// The reference model: the devices in the order of their indexes.
+
+typedef struct {
+    uint8 extAddr[Z_EXTADDR_LEN];
+    uint16 nwkAddr;
+} ModelDevice;
+
+static ModelDevice model[DEVDIR_MAX_DEVICES];
+static unsigned int modelCount;
+static unsigned int expectedWrites;
+
+static unsigned long probes;
+static unsigned long lookups;
+static unsigned int worstProbes;
+
+/// <summary>
+///     Returns the index of the device of the model with a NWK address, or DEVDIR_INVALID_INDEX.
+/// </summary>
+static uint8 ModelLookup(uint16 nwkAddr)
+{
+    for (unsigned int i = 0; i < modelCount; i++) {
+        if (model[i].nwkAddr == nwkAddr) {
+            return (uint8)i;
+        }
+    }
+    return DEVDIR_INVALID_INDEX;
+}
+
+/// <summary>
+///     DeviceDirectory_Update() on the model: the index it returns and whether it changes.
+/// </summary>
+static uint8 ModelUpdate(uint16 nwkAddr, const uint8 *extAddr, bool *changed)
+{
+    unsigned int index;
+    *changed = false;
+    for (index = 0; index < modelCount; index++) {
+        if (memcmp(model[index].extAddr, extAddr, Z_EXTADDR_LEN) == 0) {
+            break;
+        }
+    }
+    if (index == modelCount) {
+        if (modelCount == DEVDIR_MAX_DEVICES) {
+            return DEVDIR_INVALID_INDEX;
+        }
+        memcpy(model[modelCount++].extAddr, extAddr, Z_EXTADDR_LEN);
+    } else if (model[index].nwkAddr == nwkAddr) {
+        return (uint8)index;
+    }
+
+    uint8 other = ModelLookup(nwkAddr);
+    if (other != DEVDIR_INVALID_INDEX) {
+        model[other].nwkAddr = NO_NWK_ADDR;
+        expectedWrites++;
+    }
+    model[index].nwkAddr = nwkAddr;
+    expectedWrites++;
+    *changed = true;
+    return (uint8)index;
+}
+
+/// <summary>
+///     Looks a NWK address up in the directory, counting the slots it probes.
+/// </summary>
+static uint8 Lookup(uint16 nwkAddr)
+{
+    unsigned int count = 1;
+    for (uint8 slot = DEVDIR_NWK_HASH(nwkAddr); devDir_NwkSlots[slot] != DEVDIR_EMPTY_SLOT;
+         slot = (slot + 1) & DEVDIR_SLOT_MASK) {
+        if (devDir_Entries[devDir_NwkSlots[slot] - 1].nwkAddr == nwkAddr) {
+            break;
+        }
+        count++;
+    }
+    probes += count;
+    lookups++;
+    if (count > worstProbes) {
+        worstProbes = count;
+    }
+    return DeviceDirectory_Lookup(nwkAddr);
+}
+
+/// <summary>
+///     Returns a NWK address that no device of the model holds.
+/// </summary>
+static uint16 FreeNwkAddr(void)
+{
+    uint16 addr;
+    do {
+        addr = (uint16)(1 + rand() % 0xFFF7);
+    } while (ModelLookup(addr) != DEVDIR_INVALID_INDEX);
+    return addr;
+}
+
+/// <summary>
+///     Makes the IEEE address of a new device, with the OUI of TI and a random serial number.
+/// </summary>
+static void NewExtAddr(uint8 *extAddr)
+{
+    static const uint8 oui[3] = {0x4B, 0x12, 0x00};
+    for (unsigned int i = 0; i < 5; i++) {
+        extAddr[i] = (uint8)rand();
+    }
+    memcpy(&extAddr[5], oui, sizeof(oui));
+}
+
+/// <summary>
+///     Checks every entry and lookup of the directory against the model.
+/// </summary>
+static void CheckDirectory(void)
+{
+    TEST_CHECK_EQUAL(expectedWrites, nvWrites);
+    for (unsigned int i = 0; i < modelCount; i++) {
+        devDirEntry_t *entry = DeviceDirectory_GetEntry((uint8)i);
+        TEST_CHECK(entry != NULL);
+        if (entry == NULL) {
+            continue;
+        }
+        TEST_CHECK(memcmp(entry->extAddr, model[i].extAddr, Z_EXTADDR_LEN) == 0);
+        TEST_CHECK_EQUAL(model[i].nwkAddr, entry->nwkAddr);
+        if (model[i].nwkAddr != NO_NWK_ADDR) {
+            TEST_CHECK_EQUAL(i, Lookup(model[i].nwkAddr));
+        }
+    }
+    TEST_CHECK(DeviceDirectory_GetEntry((uint8)modelCount) == NULL);
+    for (unsigned int i = 0; i < 4; i++) {
+        TEST_CHECK_EQUAL(DEVDIR_INVALID_INDEX, Lookup(FreeNwkAddr()));
+    }
+}
+
+static void TestEvents(void)
+{
+    unsigned int restarts = 0;
+    unsigned int refused = 0;
+    unsigned int takeovers = 0;
+    unsigned int moves = 0;
+
+    srand(38);
+    DeviceDirectory_Init(TEST_NV_ID);
+    CheckDirectory();
+
+    for (unsigned int event = 0; event < EVENTS; event++) {
+        int kind = rand() % 100;
+        uint8 extAddr[Z_EXTADDR_LEN];
+        uint16 nwkAddr;
+
+        if (kind < 5) {
+            // A restart restores the directory from NV.
+            DeviceDirectory_Init(TEST_NV_ID);
+            restarts++;
+            CheckDirectory();
+            continue;
+        }
+
+        if ((kind < 35) || (modelCount == 0)) {
+            // A new device joins.
+            NewExtAddr(extAddr);
+        } else {
+            // A known device announces itself again.
+            memcpy(extAddr, model[rand() % modelCount].extAddr, Z_EXTADDR_LEN);
+        }
+
+        uint8 self = DEVDIR_INVALID_INDEX;
+        for (unsigned int i = 0; i < modelCount; i++) {
+            if (memcmp(model[i].extAddr, extAddr, Z_EXTADDR_LEN) == 0) {
+                self = (uint8)i;
+            }
+        }
+        if ((kind % 4 == 0) && (modelCount > 1)) {
+            // The address of another device, left over from before a conflict was resolved.
+            nwkAddr = model[rand() % modelCount].nwkAddr;
+            if (nwkAddr == NO_NWK_ADDR) {
+                nwkAddr = FreeNwkAddr();
+            }
+        } else if ((kind % 4 == 1) && (self != DEVDIR_INVALID_INDEX) &&
+                   (model[self].nwkAddr != NO_NWK_ADDR)) {
+            // Unchanged.
+            nwkAddr = model[self].nwkAddr;
+        } else {
+            nwkAddr = FreeNwkAddr();
+        }
+
+        uint8 holder = ModelLookup(nwkAddr);
+        bool expectedChanged;
+        uint8 expected = ModelUpdate(nwkAddr, extAddr, &expectedChanged);
+        bool changed = !expectedChanged;
+        TEST_CHECK_EQUAL(expected, DeviceDirectory_Update(nwkAddr, extAddr, &changed));
+        TEST_CHECK_EQUAL(expectedChanged, changed);
+        if (expected == DEVDIR_INVALID_INDEX) {
+            refused++;
+        } else if ((holder != DEVDIR_INVALID_INDEX) && (holder != expected)) {
+            takeovers++;
+        } else if (changed && (self != DEVDIR_INVALID_INDEX)) {
+            moves++;
+        }
+        CheckDirectory();
+    }
+
+    // Enough joins to fill the directory, so that the full directory was exercised.
+    TEST_CHECK_EQUAL(DEVDIR_MAX_DEVICES, modelCount);
+    TEST_CHECK(refused > 0);
+    TEST_CHECK(restarts > 0);
+    TEST_CHECK(takeovers > 0);
+    TEST_CHECK(moves > 0);
+
+    printf("DEVDIR_MAX_DEVICES %d: %d events, %u restarts, %u address changes, %u takeovers, "
+           "%u joins refused\n",
+           DEVDIR_MAX_DEVICES, EVENTS, restarts, moves, takeovers, refused);
+    printf("  %u entry writes (%lu bytes), lookups %.2f probes on average, %u at worst\n",
+           nvWrites, nvBytes, (double)probes / lookups, worstProbes);
+}
+
+int main(void)
+{
+    TestEvents();
+    return TEST_RESULT();
+}
@@ -0,0 +1,279 @@
+/// \file test_dht11.c
+/// \brief Tests the non-blocking DHT11 driver of the end device, DHT11.c of the GenericApp
+/// sample: the edges of the sensor's frame are fed to its Timer 1 capture interrupt, and its
+/// OSAL timer, event and message are stubbed. The source is included here so that the test can
+/// check the state of the driver; include/ioCC2530.h declares the registers it uses.
+
+#include <stdlib.h>
+#include <string.h>
+#include "ZComDef.h"
+#include "OSAL.h"
+
+volatile unsigned char halIntEnable = 1;
+
+// The registers.
+uint8 P1_1;
+uint8 P1DIR;
+uint8 P1SEL;
+uint8 PERCFG;
+uint8 T1CTL;
+uint8 T1CNTL;
+uint8 T1STAT;
+uint8 T1CCTL1;
+uint8 T1CC1L;
+uint8 T1CC1H;
+uint8 T1IE;
+uint8 T1IF;
+
+#include "DHT11.c"
+#include "test.h"
+
+#define TEST_TASK 3
+#define TEST_EVENT 0x0010
+
+// The OSAL.
+
+static uint16 timerTimeout; // 0 when stopped
+static uint16 eventsSet;
+static dht11Reading_t reading;
+static unsigned int readings;
+
+void Onboard_wait(uint16 timeout)
+{
+    (void)timeout;
+}
+
+uint8 osal_start_timerEx(uint8 task_id, uint16 event_id, uint16 timeout_value)
+{
+    TEST_CHECK_EQUAL(TEST_TASK, task_id);
+    TEST_CHECK_EQUAL(TEST_EVENT, event_id);
+    timerTimeout = timeout_value;
+    return SUCCESS;
+}
+
+uint8 osal_stop_timerEx(uint8 task_id, uint16 event_id)
+{
+    TEST_CHECK_EQUAL(TEST_TASK, task_id);
+    TEST_CHECK_EQUAL(TEST_EVENT, event_id);
+    timerTimeout = 0;
+    return SUCCESS;
+}
+
+uint8 osal_set_event(uint8 task_id, uint16 event_flag)
+{
+    TEST_CHECK_EQUAL(TEST_TASK, task_id);
+    eventsSet |= event_flag;
+    return SUCCESS;
+}
+
+uint8 *osal_msg_allocate(uint16 len)
+{
+    return malloc(len);
+}
+
+uint8 osal_msg_send(uint8 destination_task, uint8 *msg_ptr)
+{
+    TEST_CHECK_EQUAL(TEST_TASK, destination_task);
+    memcpy(&reading, msg_ptr, sizeof(reading));
+    readings++;
+    free(msg_ptr);
+    return SUCCESS;
+}
+
+// The sensor.
+
+/// <summary>
+///     Captures a falling edge at a time of Timer 1, and runs the interrupt.
+/// </summary>
+static void Edge(uint16 time)
+{
+    T1CC1L = (uint8)(time & 0xFF);
+    T1CC1H = (uint8)(time >> 8);
+    T1STAT |= 0x02;
+    T1IF = 1;
+    dht11Timer1Isr();
+}
+
+/// <summary>
+///     Sends a frame from a time of Timer 1 with high times of highZero and highOne us, and
+///     returns the number of falling edges sent.
+/// </summary>
+static unsigned int SendFrame(uint16 start, const uint8 *data, unsigned int bits, uint16 highZero,
+                              uint16 highOne)
+{
+    uint16 time = start;
+    unsigned int edges = 0;
+
+    // The response: 80 us low, 80 us high.
+    Edge(time);
+    time += 160;
+    edges++;
+    for (unsigned int i = 0; i < bits; i++) {
+        Edge(time);
+        edges++;
+        time += 50 + ((data[i / 8] & (0x80 >> (i % 8))) ? highOne : highZero);
+    }
+    // The end of the last bit.
+    Edge(time);
+    return edges + 1;
+}
+
+static void MakeFrame(uint8 *data, uint8 humidity, uint8 temperature)
+{
+    data[0] = humidity;
+    data[1] = 0;
+    data[2] = temperature;
+    data[3] = 0;
+    data[4] = (uint8)(data[0] + data[1] + data[2] + data[3]);
+}
+
+/// <summary>
+///     Starts a reading and releases the line after the start signal, as the OSAL timer does.
+/// </summary>
+static void Start(void)
+{
+    TEST_CHECK_EQUAL(SUCCESS, DHT11_Start());
+    TEST_CHECK_EQUAL(DHT11_START_MS, timerTimeout);
+    TEST_CHECK_EQUAL(0, P1_1);
+    TEST_CHECK(P1DIR & 0x02);
+    DHT11_ProcessEvent();
+    TEST_CHECK_EQUAL(DHT11_RECEIVE_MS, timerTimeout);
+    TEST_CHECK(!(P1DIR & 0x02));
+    TEST_CHECK(P1SEL & 0x02);
+    TEST_CHECK_EQUAL(1, T1IE);
+}
+
+/// <summary>
+///     Finishes a reading, on the event of the last edge or of the timeout.
+/// </summary>
+static void Finish(void)
+{
+    unsigned int before = readings;
+    eventsSet = 0;
+    DHT11_ProcessEvent();
+    TEST_CHECK_EQUAL(before + 1, readings);
+    TEST_CHECK_EQUAL(DHT11_READING_IND, reading.hdr.event);
+    TEST_CHECK_EQUAL(DHT11_STATE_IDLE, dht11_State);
+    TEST_CHECK_EQUAL(0, T1IE);
+    TEST_CHECK_EQUAL(1, P1_1);
+    TEST_CHECK(P1DIR & 0x02);
+    TEST_CHECK(!(P1SEL & 0x02));
+}
+
+static void TestReading(void)
+{
+    uint8 data[5];
+    DHT11_Init(TEST_TASK, TEST_EVENT);
+
+    MakeFrame(data, 45, 23);
+    Start();
+    TEST_CHECK_EQUAL(FAILURE, DHT11_Start());
+    TEST_CHECK_EQUAL(DHT11_BITS + 2, SendFrame(1000, data, DHT11_BITS, 27, 70));
+    TEST_CHECK_EQUAL(TEST_EVENT, eventsSet);
+    TEST_CHECK_EQUAL(DHT11_STATE_DONE, dht11_State);
+    Finish();
+    TEST_CHECK_EQUAL(0, timerTimeout);
+    TEST_CHECK_EQUAL(DHT11_SUCCESS, reading.hdr.status);
+    TEST_CHECK_EQUAL(45, reading.humidity);
+    TEST_CHECK_EQUAL(23, reading.temperature);
+
+    // Every value, with the high times of the data sheet, across the wrap of Timer 1.
+    srand(1);
+    for (unsigned int run = 0; run < 10000; run++) {
+        uint8 humidity = (uint8)(20 + rand() % 71);
+        uint8 temperature = (uint8)(rand() % 51);
+        MakeFrame(data, humidity, temperature);
+        Start();
+        SendFrame((uint16)(0xFFFF - rand() % 4000), data, DHT11_BITS, (uint16)(26 + rand() % 3),
+                  70);
+        Finish();
+        TEST_CHECK_EQUAL(DHT11_SUCCESS, reading.hdr.status);
+        TEST_CHECK_EQUAL(humidity, reading.humidity);
+        TEST_CHECK_EQUAL(temperature, reading.temperature);
+    }
+}
+
+static void TestErrors(void)
+{
+    uint8 data[5];
+
+    // A corrupted bit fails the checksum.
+    MakeFrame(data, 60, 20);
+    data[2] ^= 0x04;
+    Start();
+    SendFrame(0, data, DHT11_BITS, 27, 70);
+    Finish();
+    TEST_CHECK_EQUAL(DHT11_BAD_CHECKSUM, reading.hdr.status);
+
+    // No sensor, or a frame cut short: the receive timer ends the reading.
+    Start();
+    DHT11_ProcessEvent();
+    TEST_CHECK_EQUAL(DHT11_TIMEOUT, reading.hdr.status);
+    TEST_CHECK_EQUAL(DHT11_STATE_IDLE, dht11_State);
+    MakeFrame(data, 60, 20);
+    Start();
+    SendFrame(0, data, DHT11_BITS - 1, 27, 70);
+    TEST_CHECK_EQUAL(DHT11_STATE_RECEIVE, dht11_State);
+    TEST_CHECK_EQUAL(0, eventsSet);
+    Finish();
+    TEST_CHECK_EQUAL(DHT11_TIMEOUT, reading.hdr.status);
+
+    // Edges outside a reading are ignored, and the next reading starts afresh.
+    Edge(100);
+    Edge(200);
+    TEST_CHECK_EQUAL(DHT11_STATE_IDLE, dht11_State);
+    TEST_CHECK_EQUAL(SUCCESS, DHT11_Start());
+    Edge(300);
+    DHT11_ProcessEvent();
+    TEST_CHECK_EQUAL(0, dht11_Edges);
+    SendFrame(500, data, DHT11_BITS, 27, 70);
+    Finish();
+    TEST_CHECK_EQUAL(DHT11_SUCCESS, reading.hdr.status);
+    TEST_CHECK_EQUAL(60, reading.humidity);
+
+    // A capture without the channel 1 flag is not an edge.
+    Start();
+    T1STAT = 0;
+    dht11Timer1Isr();
+    TEST_CHECK_EQUAL(0, dht11_Edges);
+    DHT11_ProcessEvent();
+}
+
+/// <summary>
+///     The high times read as 0 and as 1, against the 26-28 us and 70 us of the data sheet.
+/// </summary>
+static void TestMargins(void)
+{
+    uint8 data[5] = {0x55, 0xAA, 0x0F, 0xF0, 0};
+    data[4] = (uint8)(data[0] + data[1] + data[2] + data[3]);
+    unsigned int maxZero = 0;
+    unsigned int minOne = 0;
+    for (uint16 high = 10; high <= 100; high++) {
+        // All bits sent with the same high time read as all 0 or all 1.
+        Start();
+        SendFrame(0, data, DHT11_BITS, high, high);
+        bool zero = (dht11_Data[0] | dht11_Data[1] | dht11_Data[2] | dht11_Data[3] |
+                     dht11_Data[4]) == 0;
+        bool one = (dht11_Data[0] & dht11_Data[1] & dht11_Data[2] & dht11_Data[3] &
+                    dht11_Data[4]) == 0xFF;
+        TEST_CHECK(zero || one);
+        if (zero) {
+            maxZero = high;
+        } else if (minOne == 0) {
+            minOne = high;
+        }
+        Finish();
+    }
+    TEST_CHECK(maxZero >= 28 + 15);
+    TEST_CHECK(minOne <= 70 - 15);
+    TEST_CHECK_EQUAL(maxZero + 1, minOne);
+    printf("High times read as 0 up to %u us, as 1 from %u us\n", maxZero, minOne);
+}
+
+int main(void)
+{
+    TestReading();
+    TestErrors();
+    TestMargins();
+    return TEST_RESULT();
+}
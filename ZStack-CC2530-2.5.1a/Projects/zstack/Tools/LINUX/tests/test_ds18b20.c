@@ -0,0 +1,607 @@
+/// \file test_ds18b20.c
+/// \brief Tests the 1-Wire bus master and the multi-drop DS18B20 driver of the end device,
+/// OneWire.c and ds18b20.c of the GenericApp sample, over a model of the bus: the devices on it
+/// follow the slots the master drives on P1.1, answering the reset, the ROM commands and the
+/// DS18B20 function commands. The master's waits advance the time of the bus. The model checks
+/// the timing the devices rely on: the reset pulse, the presence and read samples within the
+/// windows in which every device drives the bus, and the slot length. The sources are included
+/// here so that the test supplies the port registers that include/ioCC2530.h declares.
+
+#include <stdlib.h>
+#include <string.h>
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "ioCC2530.h"
+
+volatile unsigned char halIntEnable = 1;
+
+// The registers.
+uint8 P0DIR;
+uint8 P1_1 = 1;
+uint8 P1DIR;
+uint8 P1SEL;
+
+#include "OneWire.c"
+#include "ds18b20.c"
+#include "test.h"
+
+#define TEST_TASK 4
+#define TEST_EVENT 0x0020
+#define MAX_DEVICES 16
+
+// Guaranteed timing of the data sheets, in us.
+#define RESET_LOW_MIN 480
+#define PRESENCE_FROM 60    // release to presence, worst case: tPDH max
+#define PRESENCE_UNTIL 120  // tPDH max + tPDL min
+#define READ_VALID 15       // falling edge to the end of valid data, tRDV
+#define WRITE1_LOW_MAX 15
+#define WRITE0_LOW_MIN 60
+#define SLOT_MIN 60
+#define DS18B20_POWER_ON 0x0550 // 85 degrees C
+
+// Device states
+enum { DEV_IDLE, DEV_ROM_CMD, DEV_SEARCH, DEV_MATCH, DEV_READ_ROM, DEV_FUNCTION, DEV_SEND,
+       DEV_WRITE_PAD };
+
+typedef struct {
+    uint8 rom[ONEWIRE_ROM_LEN];
+    bool present;
+    uint8 pad[DS18B20_SCRATCHPAD_LEN];
+    uint8 eepromConfig;
+    int16 temperature; // 1/16 degrees C, converted by Convert T
+    unsigned int conversions;
+
+    int state;
+    unsigned int bitNum;
+    uint8 shift;
+    uint8 sendBuf[DS18B20_SCRATCHPAD_LEN];
+    unsigned int sendLen;
+    uint8 searchStep; // 0: send the bit, 1: its complement, 2: read the direction
+} Device;
+
+static Device devices[MAX_DEVICES];
+static unsigned int deviceCount;
+static bool shorted;
+
+// Time of the bus, and the edges of the master.
+static unsigned long now;
+static bool masterLow;
+static unsigned long fallTime;
+static unsigned long riseTime;
+static bool presenceWindow;
+static bool deviceHolds; // a device holds the bus low for a 0 in this slot
+static unsigned long maskedRun;
+static unsigned long maxMasked;
+static unsigned long slots;
+static unsigned int timingErrors;
+
+// The OSAL.
+
+static uint16 timerTimeout;
+static uint16 eventsSet;
+static ds18b20Readings_t readings;
+static unsigned int readingCount;
+
+uint8 osal_start_timerEx(uint8 task_id, uint16 event_id, uint16 timeout_value)
+{
+    TEST_CHECK_EQUAL(TEST_TASK, task_id);
+    TEST_CHECK_EQUAL(TEST_EVENT, event_id);
+    timerTimeout = timeout_value;
+    return SUCCESS;
+}
+
+uint8 osal_set_event(uint8 task_id, uint16 event_flag)
+{
+    TEST_CHECK_EQUAL(TEST_TASK, task_id);
+    eventsSet |= event_flag;
+    return SUCCESS;
+}
+
+uint8 *osal_msg_allocate(uint16 len)
+{
+    return malloc(len);
+}
+
+uint8 osal_msg_send(uint8 destination_task, uint8 *msg_ptr)
+{
+    TEST_CHECK_EQUAL(TEST_TASK, destination_task);
+    memcpy(&readings, msg_ptr, sizeof(readings));
+    readingCount++;
+    free(msg_ptr);
+    return SUCCESS;
+}
+
+void *osal_memset(void *dest, uint8 value, int len)
+{
+    return memset(dest, value, (size_t)len);
+}
+
+void *osal_memcpy(void *dst, const void GENERIC *src, unsigned int len)
+{
+    return memcpy(dst, src, len);
+}
+
+// The devices.
+
+static uint8 Crc8(const uint8 *data, unsigned int len)
+{
+    uint8 crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x01) ? ((crc >> 1) ^ 0x8C) : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static Device *AddDevice(uint8 family, uint64_t serial)
+{
+    Device *device = &devices[deviceCount++];
+    memset(device, 0, sizeof(*device));
+    device->rom[0] = family;
+    for (int i = 1; i < 7; i++) {
+        device->rom[i] = (uint8)(serial >> (8 * (i - 1)));
+    }
+    device->rom[7] = Crc8(device->rom, 7);
+    device->present = true;
+    device->eepromConfig = 0x1F | (0 << 5); // 9 bits, as a sensor may have been set
+    device->pad[DS18B20_TEMP_LSB] = DS18B20_POWER_ON & 0xFF;
+    device->pad[DS18B20_TEMP_MSB] = DS18B20_POWER_ON >> 8;
+    device->pad[DS18B20_ALARM_HIGH] = 0x4B;
+    device->pad[DS18B20_ALARM_LOW] = 0x46;
+    device->pad[DS18B20_CONFIG] = device->eepromConfig;
+    device->pad[5] = 0xFF;
+    device->pad[7] = 0x10;
+    device->pad[8] = Crc8(device->pad, 8);
+    return device;
+}
+
+static void PowerCycle(Device *device)
+{
+    device->pad[DS18B20_TEMP_LSB] = DS18B20_POWER_ON & 0xFF;
+    device->pad[DS18B20_TEMP_MSB] = DS18B20_POWER_ON >> 8;
+    device->pad[DS18B20_CONFIG] = device->eepromConfig;
+    device->pad[8] = Crc8(device->pad, 8);
+}
+
+static bool RomBit(const Device *device, unsigned int bitNum)
+{
+    return (device->rom[bitNum / 8] >> (bitNum % 8)) & 1;
+}
+
+/// <summary>
+///     The bit a device drives in a slot: false to hold the bus low.
+/// </summary>
+static bool DeviceSends(const Device *device)
+{
+    switch (device->state) {
+    case DEV_SEARCH:
+        if (device->searchStep == 0) {
+            return RomBit(device, device->bitNum);
+        }
+        if (device->searchStep == 1) {
+            return !RomBit(device, device->bitNum);
+        }
+        return true;
+    case DEV_READ_ROM:
+        return RomBit(device, device->bitNum);
+    case DEV_SEND:
+        return (device->sendBuf[device->bitNum / 8] >> (device->bitNum % 8)) & 1;
+    default:
+        return true;
+    }
+}
+
+static void Convert(Device *device)
+{
+    int16 raw = device->temperature;
+    int res = DS18B20_CONFIG_RES(device->pad[DS18B20_CONFIG]);
+    raw &= (int16)~((1 << (3 - res)) - 1);
+    device->pad[DS18B20_TEMP_LSB] = (uint8)(raw & 0xFF);
+    device->pad[DS18B20_TEMP_MSB] = (uint8)((uint16)raw >> 8);
+    device->pad[8] = Crc8(device->pad, 8);
+    device->conversions++;
+}
+
+/// <summary>
+///     Advances a device by the bit of a slot, as seen on the bus.
+/// </summary>
+static void DeviceSlot(Device *device, bool bit)
+{
+    switch (device->state) {
+    case DEV_ROM_CMD:
+    case DEV_FUNCTION:
+    case DEV_MATCH:
+    case DEV_WRITE_PAD:
+        device->shift = (uint8)((device->shift >> 1) | (bit ? 0x80 : 0));
+        device->bitNum++;
+        break;
+    case DEV_SEARCH:
+        if (device->searchStep < 2) {
+            device->searchStep++;
+            return;
+        }
+        device->searchStep = 0;
+        if (bit != RomBit(device, device->bitNum)) {
+            device->state = DEV_IDLE;
+        } else if (++device->bitNum == 64) {
+            device->state = DEV_FUNCTION;
+            device->bitNum = 0;
+        }
+        return;
+    case DEV_READ_ROM:
+        if (++device->bitNum == 64) {
+            device->state = DEV_FUNCTION;
+            device->bitNum = 0;
+        }
+        return;
+    case DEV_SEND:
+        if (++device->bitNum == 8 * device->sendLen) {
+            device->state = DEV_IDLE;
+        }
+        return;
+    default:
+        return;
+    }
+
+    if (device->state == DEV_MATCH) {
+        if (bit != RomBit(device, device->bitNum - 1)) {
+            device->state = DEV_IDLE;
+        } else if (device->bitNum == 64) {
+            device->state = DEV_FUNCTION;
+            device->bitNum = 0;
+        }
+        return;
+    }
+    if (device->bitNum % 8 != 0) {
+        return;
+    }
+
+    uint8 byte = device->shift;
+    if (device->state == DEV_ROM_CMD) {
+        device->bitNum = 0;
+        device->searchStep = 0;
+        device->state = (byte == ONEWIRE_SEARCH_ROM)  ? DEV_SEARCH
+                        : (byte == ONEWIRE_MATCH_ROM) ? DEV_MATCH
+                        : (byte == ONEWIRE_READ_ROM)  ? DEV_READ_ROM
+                        : (byte == ONEWIRE_SKIP_ROM)  ? DEV_FUNCTION
+                                                      : DEV_IDLE;
+    } else if (device->state == DEV_FUNCTION) {
+        device->bitNum = 0;
+        device->state = DEV_IDLE;
+        if (device->rom[0] != DS18B20_FAMILY) {
+            return;
+        }
+        if (byte == DS18B20_CONVERT_T) {
+            Convert(device);
+        } else if (byte == DS18B20_READ_SCRATCHPAD) {
+            memcpy(device->sendBuf, device->pad, DS18B20_SCRATCHPAD_LEN);
+            device->sendLen = DS18B20_SCRATCHPAD_LEN;
+            device->state = DEV_SEND;
+        } else if (byte == DS18B20_WRITE_SCRATCHPAD) {
+            device->state = DEV_WRITE_PAD;
+        }
+    } else if (device->state == DEV_WRITE_PAD) {
+        device->pad[DS18B20_ALARM_HIGH + device->bitNum / 8 - 1] = byte;
+        if (device->bitNum == 24) {
+            device->pad[DS18B20_CONFIG] = (byte & 0x60) | DS18B20_CONFIG_FIXED;
+            device->pad[8] = Crc8(device->pad, 8);
+            device->state = DEV_IDLE;
+        }
+    }
+}
+
+// The bus.
+
+static bool MasterDrivesLow(void)
+{
+    return (P1DIR & ONEWIRE_BIT) && (P1_1 == 0);
+}
+
+static void TimingError(const char *what, unsigned long value)
+{
+    if (timingErrors++ < 10) {
+        fprintf(stderr, "timing: %s (%lu us)\n", what, value);
+    }
+}
+
+/// <summary>
+///     Takes the edges of the master since the last wait: a falling edge starts a slot or a
+///     reset, a rising edge ends the low part and tells what it was.
+/// </summary>
+static void Edges(void)
+{
+    bool low = MasterDrivesLow();
+    if (low == masterLow) {
+        return;
+    }
+    masterLow = low;
+
+    if (low) {
+        if (riseTime && (now - fallTime < SLOT_MIN)) {
+            TimingError("slot too short", now - fallTime);
+        }
+        fallTime = now;
+        presenceWindow = false;
+        deviceHolds = false;
+        for (unsigned int i = 0; i < deviceCount; i++) {
+            if (devices[i].present && !DeviceSends(&devices[i])) {
+                deviceHolds = true;
+            }
+        }
+        return;
+    }
+
+    riseTime = now;
+    unsigned long width = now - fallTime;
+    if (width >= RESET_LOW_MIN) {
+        presenceWindow = true;
+        for (unsigned int i = 0; i < deviceCount; i++) {
+            devices[i].state = DEV_ROM_CMD;
+            devices[i].bitNum = 0;
+        }
+        return;
+    }
+    if ((width > WRITE1_LOW_MAX) && (width < WRITE0_LOW_MIN)) {
+        TimingError("low pulse neither a 1 nor a 0", width);
+    }
+    slots++;
+    bool bit = (width <= WRITE1_LOW_MAX) && !deviceHolds;
+    for (unsigned int i = 0; i < deviceCount; i++) {
+        if (devices[i].present) {
+            DeviceSlot(&devices[i], bit);
+        }
+    }
+}
+
+/// <summary>
+///     The level of the bus, as the pin reads it.
+/// </summary>
+static uint8 BusLevel(void)
+{
+    if (shorted || masterLow) {
+        return 0;
+    }
+    if (presenceWindow) {
+        for (unsigned int i = 0; i < deviceCount; i++) {
+            if (devices[i].present && (now >= riseTime + PRESENCE_FROM) &&
+                (now < riseTime + PRESENCE_UNTIL)) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    return (deviceHolds && (now <= fallTime + READ_VALID)) ? 0 : 1;
+}
+
+/// <summary>
+///     The busy-wait of the driver. Interrupts are off from the start of a slot: the wait of a
+///     falling edge starts a new run of them, as the driver enters its critical section before
+///     driving the bus low.
+/// </summary>
+void Onboard_wait(uint16 timeout)
+{
+    bool falling = !masterLow && MasterDrivesLow();
+    Edges();
+    if (halIntEnable || falling) {
+        maskedRun = 0;
+    }
+    now += timeout;
+    if (!halIntEnable) {
+        maskedRun += timeout;
+        if (maskedRun > maxMasked) {
+            maxMasked = maskedRun;
+        }
+    }
+    if (!masterLow) {
+        P1_1 = BusLevel();
+    }
+}
+
+// The tests.
+
+static void ResetBus(void)
+{
+    deviceCount = 0;
+    shorted = false;
+    P1_1 = 1;
+    P1DIR = 0;
+    OneWire_Init();
+}
+
+static int CompareRoms(const void *a, const void *b)
+{
+    return memcmp(a, b, ONEWIRE_ROM_LEN);
+}
+
+static void TestCrc(void)
+{
+    // The check value of CRC-8/MAXIM, and the ROM code of application note 27.
+    uint8 check[] = "123456789";
+    TEST_CHECK_EQUAL(0xA1, OneWire_Crc8(check, 9));
+    uint8 rom[ONEWIRE_ROM_LEN] = {0x02, 0x1C, 0xB8, 0x01, 0x00, 0x00, 0x00, 0xA2};
+    TEST_CHECK_EQUAL(0xA2, OneWire_Crc8(rom, 7));
+    TEST_CHECK_EQUAL(0, OneWire_Crc8(rom, ONEWIRE_ROM_LEN));
+    TEST_CHECK_EQUAL(0, OneWire_Crc8(rom, 0));
+}
+
+static void TestSearch(void)
+{
+    uint8 roms[MAX_DEVICES][ONEWIRE_ROM_LEN];
+    uint8 expected[MAX_DEVICES][ONEWIRE_ROM_LEN];
+
+    // An empty bus, and one held low.
+    ResetBus();
+    TEST_CHECK(!OneWire_Reset());
+    TEST_CHECK_EQUAL(0, OneWire_Search(roms[0], MAX_DEVICES));
+    shorted = true;
+    TEST_CHECK(OneWire_Reset());
+    TEST_CHECK_EQUAL(0, OneWire_Search(roms[0], MAX_DEVICES));
+
+    // Random buses, some with codes that fork at every bit.
+    srand(1);
+    for (int run = 0; run < 500; run++) {
+        ResetBus();
+        unsigned int count = 1 + (unsigned int)rand() % MAX_DEVICES;
+        uint64_t base = ((uint64_t)rand() << 31) | (uint64_t)rand();
+        for (unsigned int i = 0; i < count; i++) {
+            uint64_t serial = (run % 2) ? (base ^ (1ull << (i % 48))) + (i / 48)
+                                        : (((uint64_t)rand() << 31) | (uint64_t)rand());
+            uint8 family = (rand() % 4) ? DS18B20_FAMILY : 0x01;
+            AddDevice(family, serial);
+            for (unsigned int j = 0; j + 1 < deviceCount; j++) {
+                if (memcmp(devices[j].rom, devices[i].rom, ONEWIRE_ROM_LEN) == 0) {
+                    deviceCount--;
+                    break;
+                }
+            }
+        }
+        for (unsigned int i = 0; i < deviceCount; i++) {
+            memcpy(expected[i], devices[i].rom, ONEWIRE_ROM_LEN);
+        }
+        qsort(expected, deviceCount, ONEWIRE_ROM_LEN, CompareRoms);
+
+        uint8 found = OneWire_Search(roms[0], MAX_DEVICES);
+        TEST_CHECK_EQUAL(deviceCount, found);
+        qsort(roms, found, ONEWIRE_ROM_LEN, CompareRoms);
+        TEST_CHECK(memcmp(roms, expected, found * ONEWIRE_ROM_LEN) == 0);
+
+        // Fewer slots than devices.
+        if (deviceCount > 1) {
+            TEST_CHECK_EQUAL(deviceCount - 1, OneWire_Search(roms[0], deviceCount - 1));
+        }
+    }
+    TEST_CHECK_EQUAL(0, timingErrors);
+
+    // A code with a bad CRC ends the search.
+    ResetBus();
+    Device *device = AddDevice(DS18B20_FAMILY, 0x123456);
+    device->rom[7] ^= 0x01;
+    TEST_CHECK_EQUAL(0, OneWire_Search(roms[0], MAX_DEVICES));
+}
+
+/// <summary>
+///     Runs a conversion cycle as the task does, passing the driver its events.
+/// </summary>
+static void Cycle(void)
+{
+    unsigned int before = readingCount;
+    TEST_CHECK_EQUAL(SUCCESS, Ds18b20_Start());
+    if (readingCount != before) {
+        return;
+    }
+    TEST_CHECK_EQUAL(DS18B20_CONVERT_MS, timerTimeout);
+    TEST_CHECK_EQUAL(FAILURE, Ds18b20_Start());
+    for (int events = 0; events <= DS18B20_MAX_SENSORS && readingCount == before; events++) {
+        eventsSet = 0;
+        Ds18b20_ProcessEvent();
+        TEST_CHECK(readingCount != before || eventsSet == TEST_EVENT);
+    }
+    TEST_CHECK_EQUAL(before + 1, readingCount);
+}
+
+static void TestSensors(void)
+{
+    ResetBus();
+    Device *a = AddDevice(DS18B20_FAMILY, 0x0000A1);
+    Device *id = AddDevice(0x01, 0x0000B2); // a DS2401 serial number on the same bus
+    Device *b = AddDevice(DS18B20_FAMILY, 0x0000C3);
+    Device *c = AddDevice(DS18B20_FAMILY, 0x0000D4);
+    c->eepromConfig = DS18B20_CONFIG_12BIT;
+    PowerCycle(c);
+
+    TEST_CHECK_EQUAL(3, Ds18b20_Init(TEST_TASK, TEST_EVENT));
+    TEST_CHECK(Ds18b20_GetRom(3) == NULL);
+    Device *order[3];
+    for (uint8 i = 0; i < 3; i++) {
+        uint8 *rom = Ds18b20_GetRom(i);
+        TEST_CHECK(rom != NULL && rom[0] == DS18B20_FAMILY);
+        order[i] = (memcmp(rom, a->rom, ONEWIRE_ROM_LEN) == 0)   ? a
+                   : (memcmp(rom, b->rom, ONEWIRE_ROM_LEN) == 0) ? b
+                                                                 : c;
+    }
+    TEST_CHECK(order[0] != order[1] && order[1] != order[2] && order[0] != order[2]);
+    (void)id;
+
+    // Set to 12 bits in the scratchpad, with the alarms written back.
+    TEST_CHECK_EQUAL(DS18B20_CONFIG_12BIT, a->pad[DS18B20_CONFIG]);
+    TEST_CHECK_EQUAL(DS18B20_CONFIG_12BIT, b->pad[DS18B20_CONFIG]);
+    TEST_CHECK_EQUAL(0x4B, a->pad[DS18B20_ALARM_HIGH]);
+    TEST_CHECK_EQUAL(0x46, a->pad[DS18B20_ALARM_LOW]);
+
+    // One conversion for all, then each read in the order of Ds18b20_GetRom().
+    a->temperature = 25 * 16 + 1;     // 25.0625 degrees C
+    b->temperature = -10 * 16 - 2;    // -10.125
+    c->temperature = 125 * 16;
+    unsigned long start = now;
+    TEST_CHECK_EQUAL(SUCCESS, Ds18b20_Start());
+    TEST_CHECK_EQUAL(DS18B20_CONVERT_US, now - start);
+    TEST_CHECK_EQUAL(1, a->conversions);
+    TEST_CHECK_EQUAL(1, b->conversions);
+    Ds18b20_ProcessEvent();
+    start = now;
+    Ds18b20_ProcessEvent();
+    TEST_CHECK_EQUAL(DS18B20_READ_US, now - start);
+    Ds18b20_ProcessEvent();
+    Ds18b20_ProcessEvent();
+    TEST_CHECK_EQUAL(1, readingCount);
+    TEST_CHECK_EQUAL(DS18B20_READING_IND, readings.hdr.event);
+    TEST_CHECK_EQUAL(DS18B20_SUCCESS, readings.hdr.status);
+    TEST_CHECK_EQUAL(3, readings.count);
+    for (int i = 0; i < 3; i++) {
+        TEST_CHECK_EQUAL(DS18B20_SUCCESS, readings.sample[i].status);
+        TEST_CHECK_EQUAL(order[i]->temperature, readings.sample[i].temperature);
+    }
+
+    // A sensor that lost power is back at the 9 bits of its EEPROM: the undefined bits are
+    // cleared. One that left the bus does not answer.
+    PowerCycle(a);
+    b->present = false;
+    Cycle();
+    for (int i = 0; i < 3; i++) {
+        if (order[i] == a) {
+            TEST_CHECK_EQUAL(DS18B20_SUCCESS, readings.sample[i].status);
+            TEST_CHECK_EQUAL(25 * 16, readings.sample[i].temperature);
+        } else if (order[i] == b) {
+            TEST_CHECK_EQUAL(DS18B20_BAD_CRC, readings.sample[i].status);
+        } else {
+            TEST_CHECK_EQUAL(DS18B20_SUCCESS, readings.sample[i].status);
+        }
+    }
+
+    // Nothing on the bus.
+    a->present = false;
+    c->present = false;
+    id->present = false;
+    Cycle();
+    TEST_CHECK_EQUAL(DS18B20_NO_RESPONSE, readings.hdr.status);
+    for (int i = 0; i < 3; i++) {
+        TEST_CHECK_EQUAL(DS18B20_NO_RESPONSE, readings.sample[i].status);
+    }
+
+    // A sensor plugged into an empty bus is found by the next cycle.
+    ResetBus();
+    TEST_CHECK_EQUAL(0, Ds18b20_Init(TEST_TASK, TEST_EVENT));
+    Cycle();
+    TEST_CHECK_EQUAL(DS18B20_NO_RESPONSE, readings.hdr.status);
+    TEST_CHECK_EQUAL(0, readings.count);
+    a = AddDevice(DS18B20_FAMILY, 0x0000E5);
+    a->temperature = 20 * 16;
+    Cycle();
+    TEST_CHECK_EQUAL(DS18B20_SUCCESS, readings.hdr.status);
+    TEST_CHECK_EQUAL(1, readings.count);
+    TEST_CHECK_EQUAL(20 * 16, readings.sample[0].temperature);
+
+    TEST_CHECK_EQUAL(0, timingErrors);
+    TEST_CHECK(maxMasked <= ONEWIRE_SLOT_US);
+    printf("%lu slots; interrupts off for at most %lu us\n", slots, maxMasked);
+}
+
+int main(void)
+{
+    TestCrc();
+    TestSearch();
+    TestSensors();
+    return TEST_RESULT();
+}
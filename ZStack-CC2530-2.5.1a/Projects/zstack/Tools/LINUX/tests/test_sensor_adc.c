@@ -0,0 +1,190 @@
+/// \file test_sensor_adc.c
+/// \brief Tests the interrupt-driven, oversampled ADC acquisition of the end device, SensorAdc.c
+/// of the GenericApp sample, over a model of the CC2530 ADC: each write of ADCCON3 starts a
+/// conversion of the input it selects, which completes with the ADC interrupt. The source is
+/// included here so that the test supplies the ADC registers.
+
+#include <math.h>
+#include <stdlib.h>
+#include "hal_mcu.h"
+
+volatile unsigned char halIntEnable = 1;
+
+// The ADC registers.
+static uint8 ADCCFG;
+static uint8 ADCCON3;
+static uint8 ADCL;
+static uint8 ADCH;
+static uint8 ADCIE;
+
+#include "SensorAdc.c"
+#include "test.h"
+
+// Voltages of the inputs selected by ADCCON3, in LSB of a single conversion, and the RMS noise of the ADC.
+static double input[HAL_ADC_CHN_BITS + 1];
+static double noise;
+
+static double Gaussian(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/// <summary>
+///     Completes the conversion selected by ADCCON3: a 10-bit two's complement result,
+///     left-aligned in ADCH:ADCL.
+/// </summary>
+static void Convert(void)
+{
+    double volts = input[ADCCON3 & HAL_ADC_CHN_BITS] + ((noise > 0) ? noise * Gaussian() : 0);
+    long code = lround(volts);
+    code = (code < -512) ? -512 : (code > 511) ? 511 : code;
+    uint16 result = (uint16)((code & 0x3FF) << 6);
+    ADCL = (uint8)(result & 0xFF);
+    ADCH = (uint8)(result >> 8);
+}
+
+/// <summary>
+///     Runs a burst to completion, as the ADC interrupt does on the target.
+/// </summary>
+static unsigned int Burst(void)
+{
+    unsigned int conversions = 0;
+    SensorAdc_Start();
+    while (sensorAdc_Busy) {
+        Convert();
+        sensorAdcIsr();
+        conversions++;
+    }
+    return conversions;
+}
+
+static void TestBurst(void)
+{
+    SensorAdc_Init();
+    TEST_CHECK_EQUAL(BV(HAL_ADC_CHN_AIN6) | BV(HAL_ADC_CHN_AIN7), ADCCFG);
+    TEST_CHECK_EQUAL(1, ADCIE);
+    TEST_CHECK_EQUAL(0, SensorAdc_Read(SENSORADC_LIGHT));
+    TEST_CHECK_EQUAL(0, SensorAdc_Read(SENSORADC_GAS));
+    TEST_CHECK_EQUAL(0, SensorAdc_Read(SENSORADC_CHANNELS));
+
+    // A burst converts each channel SENSORADC_OVERSAMPLE times, and adds
+    // SENSORADC_OVERSAMPLE_SHIFT bits to the readings.
+    input[HAL_ADC_CHN_AIN6] = 100;
+    input[HAL_ADC_CHN_AIN7] = 511;
+    TEST_CHECK_EQUAL(SENSORADC_CHANNELS * SENSORADC_OVERSAMPLE, Burst());
+    TEST_CHECK_EQUAL(100 << SENSORADC_OVERSAMPLE_SHIFT, SensorAdc_Read(SENSORADC_LIGHT));
+    TEST_CHECK_EQUAL(511 << SENSORADC_OVERSAMPLE_SHIFT, SensorAdc_Read(SENSORADC_GAS));
+
+    // Full scale over a whole ring does not overflow the sums.
+    for (int i = 0; i < SENSORADC_AVERAGE_LEN; i++) {
+        Burst();
+    }
+    TEST_CHECK_EQUAL(511 << SENSORADC_OVERSAMPLE_SHIFT, SensorAdc_Read(SENSORADC_GAS));
+    TEST_CHECK_EQUAL((1 << SENSORADC_RESOLUTION_BITS) - (1 << SENSORADC_OVERSAMPLE_SHIFT),
+                     SensorAdc_Read(SENSORADC_GAS));
+
+    // Small negative readings of a single-ended input near ground count as 0.
+    input[HAL_ADC_CHN_AIN7] = -3;
+    for (int i = 0; i < SENSORADC_AVERAGE_LEN; i++) {
+        Burst();
+    }
+    TEST_CHECK_EQUAL(0, SensorAdc_Read(SENSORADC_GAS));
+}
+
+static void TestMovingAverage(void)
+{
+    input[HAL_ADC_CHN_AIN6] = 0;
+    for (int i = 0; i < SENSORADC_AVERAGE_LEN; i++) {
+        Burst();
+    }
+    TEST_CHECK_EQUAL(0, SensorAdc_Read(SENSORADC_LIGHT));
+
+    // A step reaches the reading over SENSORADC_AVERAGE_LEN bursts.
+    input[HAL_ADC_CHN_AIN6] = 256;
+    for (int i = 1; i <= SENSORADC_AVERAGE_LEN; i++) {
+        Burst();
+        TEST_CHECK_EQUAL((256 << SENSORADC_OVERSAMPLE_SHIFT) * i / SENSORADC_AVERAGE_LEN,
+                         SensorAdc_Read(SENSORADC_LIGHT));
+    }
+}
+
+static void TestInterruptedBurst(void)
+{
+    input[HAL_ADC_CHN_AIN6] = 50;
+    input[HAL_ADC_CHN_AIN7] = 60;
+    for (int i = 0; i < SENSORADC_AVERAGE_LEN; i++) {
+        Burst();
+    }
+
+    // A burst is not restarted while it runs.
+    SensorAdc_Start();
+    TEST_CHECK(sensorAdc_Busy);
+    Convert();
+    sensorAdcIsr();
+    uint8 count = sensorAdc_Count;
+    SensorAdc_Start();
+    TEST_CHECK_EQUAL(count, sensorAdc_Count);
+
+    // A conversion started by other code, such as HalAdcCheckVdd(), ends the burst without
+    // reading the result, and the readings keep their last values.
+    ADCCON3 = HAL_ADC_REF_125V | HAL_ADC_CHN_VDD3;
+    Convert();
+    uint8 adch = ADCH;
+    sensorAdcIsr();
+    TEST_CHECK(!sensorAdc_Busy);
+    TEST_CHECK_EQUAL(adch, ADCH);
+    TEST_CHECK_EQUAL(50 << SENSORADC_OVERSAMPLE_SHIFT, SensorAdc_Read(SENSORADC_LIGHT));
+    TEST_CHECK_EQUAL(60 << SENSORADC_OVERSAMPLE_SHIFT, SensorAdc_Read(SENSORADC_GAS));
+
+    // The next burst starts afresh.
+    TEST_CHECK_EQUAL(SENSORADC_CHANNELS * SENSORADC_OVERSAMPLE, Burst());
+    TEST_CHECK_EQUAL(50 << SENSORADC_OVERSAMPLE_SHIFT, SensorAdc_Read(SENSORADC_LIGHT));
+}
+
+/// <summary>
+///     The error of the readings against the input, with the noise of the ADC dithering the
+///     oversampled conversions, compared with a single conversion as HalAdcRead() takes it.
+/// </summary>
+static void TestResolution(void)
+{
+    const int runs = 20000;
+    double singleError = 0;
+    double readError = 0;
+    srand(1);
+    noise = 0.5;
+    for (int run = 0; run < runs; run++) {
+        double volts = 20 + (rand() % 4800) / 10.0;
+        input[HAL_ADC_CHN_AIN6] = volts;
+        for (int i = 0; i < SENSORADC_AVERAGE_LEN; i++) {
+            Burst();
+        }
+
+        ADCCON3 = HAL_ADC_CHN_AIN6;
+        Convert();
+        double single = (int16)(ADCL | (ADCH << 8)) >> 6;
+        double read = SensorAdc_Read(SENSORADC_LIGHT) / (double)(1 << SENSORADC_OVERSAMPLE_SHIFT);
+        singleError += (single - volts) * (single - volts);
+        readError += (read - volts) * (read - volts);
+    }
+    singleError = sqrt(singleError / runs);
+    readError = sqrt(readError / runs);
+    noise = 0;
+
+    // Truncation by the decimation and the average biases the reading low by up to one LSB of
+    // the reading; the noise is averaged away well below one LSB of a single conversion.
+    TEST_CHECK(readError < singleError / 2);
+    printf("RMS error, LSB of a single conversion: single %.3f, oversampled and averaged %.3f "
+           "(%.1f bits better)\n",
+           singleError, readError, log2(singleError / readError));
+}
+
+int main(void)
+{
+    TestBurst();
+    TestMovingAverage();
+    TestInterruptedBurst();
+    TestResolution();
+    return TEST_RESULT();
+}
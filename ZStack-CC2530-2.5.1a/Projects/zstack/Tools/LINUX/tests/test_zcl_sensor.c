@@ -0,0 +1,569 @@
+/// \file test_zcl_sensor.c
+/// \brief Tests the ZCL endpoint of the end device, ZclSensor.c of the GenericApp sample: the
+/// measurement attributes converted from the samples, the Configure Reporting command, and the
+/// attribute reporting with the reportable change (the deadband of GENERICAPP_CMD_SET_DEADBAND),
+/// the minimum interval and the maximum interval that serves as the heartbeat. ZCL, AF and NV
+/// are stubbed; the test is built with the Z-Stack headers of the Linux host target.
+
+#include <stdlib.h>
+#include <string.h>
+#include "ZComDef.h"
+#include "OSAL.h"
+#include "OSAL_Nv.h"
+#include "AF.h"
+#include "zcl.h"
+#include "zcl_general.h"
+#include "zcl_ms.h"
+#include "GenericApp.h"
+#include "ZclSensor.h"
+#include "test.h"
+
+#define TEST_NV_ID 0x0401
+#define MAX_SENT 16
+
+// A Report Attributes command sent by the endpoint.
+typedef struct {
+    uint16 clusterId;
+    uint8 numAttr;
+    uint16 attrId[ZCLSENSOR_REPORTED_ATTRS];
+    long value[ZCLSENSOR_REPORTED_ATTRS];
+} TestReport;
+
+static TestReport sent[MAX_SENT];
+static unsigned int sentCount;
+static unsigned long sentTotal;
+static uint8 sendStatus = ZSuccess;
+static uint32 testClock;
+static uint8 nvData[64];
+static unsigned int nvWrites;
+
+// The last Configure Reporting response.
+static zclCfgReportStatus_t cfgStatus[8];
+static unsigned int cfgStatusCount;
+static unsigned int cfgResponses;
+
+// The stack.
+
+uint8 zcl_TaskID;
+
+uint32 osal_GetSystemClock(void)
+{
+    return testClock;
+}
+
+void *osal_mem_alloc(uint16 size)
+{
+    return malloc(size);
+}
+
+void osal_mem_free(void *ptr)
+{
+    free(ptr);
+}
+
+void *osal_memcpy(void *dst, const void GENERIC *src, unsigned int len)
+{
+    return memcpy(dst, src, len);
+}
+
+uint8 osal_nv_item_init(uint16 id, uint16 len, void *buf)
+{
+    (void)id;
+    (void)len;
+    (void)buf;
+    return nvWrites ? ZSUCCESS : NV_ITEM_UNINIT;
+}
+
+uint8 osal_nv_read(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    (void)id;
+    memcpy(buf, &nvData[offset], len);
+    return ZSUCCESS;
+}
+
+uint8 osal_nv_write(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    TEST_CHECK_EQUAL(TEST_NV_ID, id);
+    memcpy(&nvData[offset], buf, len);
+    nvWrites++;
+    return ZSUCCESS;
+}
+
+afStatus_t afRegister(endPointDesc_t *epDesc)
+{
+    (void)epDesc;
+    return afStatus_SUCCESS;
+}
+
+ZStatus_t zcl_registerAttrList(uint8 endpoint, uint8 numAttr, CONST zclAttrRec_t attrList[])
+{
+    (void)endpoint;
+    (void)numAttr;
+    (void)attrList;
+    return ZSuccess;
+}
+
+uint8 zcl_registerForMsg(uint8 taskId)
+{
+    (void)taskId;
+    return ZSuccess;
+}
+
+ZStatus_t zcl_SendConfigReportRspCmd(uint8 srcEP, afAddrType_t *dstAddr, uint16 realClusterID,
+                                     zclCfgReportRspCmd_t *cfgReportRspCmd, uint8 direction,
+                                     uint8 disableDefaultRsp, uint8 seqNum)
+{
+    (void)srcEP;
+    (void)dstAddr;
+    (void)realClusterID;
+    (void)direction;
+    (void)disableDefaultRsp;
+    (void)seqNum;
+    cfgResponses++;
+    cfgStatusCount = cfgReportRspCmd->numAttr;
+    memcpy(cfgStatus, cfgReportRspCmd->attrList, cfgStatusCount * sizeof(cfgStatus[0]));
+    return ZSuccess;
+}
+
+ZStatus_t zcl_SendReportCmd(uint8 srcEP, afAddrType_t *dstAddr, uint16 realClusterID,
+                            zclReportCmd_t *reportCmd, uint8 direction, uint8 disableDefaultRsp,
+                            uint8 seqNum)
+{
+    (void)srcEP;
+    (void)direction;
+    (void)disableDefaultRsp;
+    (void)seqNum;
+    TEST_CHECK_EQUAL(0x0000, dstAddr->addr.shortAddr);
+    if (sendStatus != ZSuccess) {
+        return sendStatus;
+    }
+
+    sentTotal++;
+    if (sentCount == MAX_SENT) {
+        return ZSuccess;
+    }
+    TestReport *report = &sent[sentCount++];
+    report->clusterId = realClusterID;
+    report->numAttr = reportCmd->numAttr;
+    for (uint8 i = 0; i < reportCmd->numAttr; i++) {
+        zclReport_t *attr = &reportCmd->attrList[i];
+        report->attrId[i] = attr->attrID;
+        switch (attr->dataType) {
+        case ZCL_DATATYPE_INT16:
+            report->value[i] = *(int16 *)attr->attrData;
+            break;
+        case ZCL_DATATYPE_UINT16:
+            report->value[i] = *(uint16 *)attr->attrData;
+            break;
+        case ZCL_DATATYPE_SINGLE_PREC:
+            report->value[i] = (long)*(float *)attr->attrData;
+            break;
+        default:
+            report->value[i] = *(uint8 *)attr->attrData;
+            break;
+        }
+    }
+    return ZSuccess;
+}
+
+// The tests.
+
+/// <summary>
+///     Samples, as enddevice.c passes them: 0.01 degrees C, 0.01 %RH and the SensorAdc
+///     readings.
+/// </summary>
+static uint16 sample[4];
+static uint8 pir;
+
+/// <summary>
+///     Advances the clock and updates the endpoint with the sample, clearing the reports sent
+///     before.
+/// </summary>
+static void Update(uint32 ms, uint8 force)
+{
+    testClock += ms;
+    sentCount = 0;
+    ZclSensor_Update(sample, pir, force);
+}
+
+/// <summary>
+///     Returns the bit per attribute (ZCLSENSOR_ constants) reported by the last update.
+/// </summary>
+static unsigned int Reported(void)
+{
+    static const uint16 clusters[ZCLSENSOR_REPORTED_ATTRS] = {
+        ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT, ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY,
+        ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT, ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC,
+        ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING};
+    unsigned int bits = 0;
+    for (unsigned int i = 0; i < sentCount; i++) {
+        for (unsigned int attr = 0; attr < ZCLSENSOR_REPORTED_ATTRS; attr++) {
+            if (sent[i].clusterId == clusters[attr]) {
+                bits |= 1u << attr;
+            }
+        }
+    }
+    return bits;
+}
+
+#define ALL_ATTRS ((1u << ZCLSENSOR_REPORTED_ATTRS) - 1)
+#define BIT(attr) (1u << (attr))
+
+static void Start(void)
+{
+    sample[ZCLSENSOR_TEMPERATURE] = 2500;
+    sample[ZCLSENSOR_HUMIDITY] = 5000;
+    sample[ZCLSENSOR_LIGHT] = 1000;
+    sample[ZCLSENSOR_GAS] = 300;
+    pir = 0;
+    ZclSensor_Init(1, TEST_NV_ID);
+}
+
+static void TestAttributes(void)
+{
+    // Every attribute is reported once at the start, one frame per cluster, in ZCL units:
+    // hundredths of degrees C and of %RH as sampled, the SensorAdc readings, and the occupancy
+    // bitmap.
+    static const struct {
+        uint16 clusterId;
+        uint16 attrId;
+        long value;
+    } expected[ZCLSENSOR_REPORTED_ATTRS] = {
+        {ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT, ATTRID_MS_TEMPERATURE_MEASURED_VALUE, 2500},
+        {ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY, ATTRID_MS_RELATIVE_HUMIDITY_MEASURED_VALUE, 5000},
+        {ZCL_CLUSTER_ID_MS_ILLUMINANCE_MEASUREMENT, ATTRID_MS_ILLUMINANCE_MEASURED_VALUE, 1000},
+        {ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC, ATTRID_IOV_BASIC_PRESENT_VALUE, 300},
+        {ZCL_CLUSTER_ID_MS_OCCUPANCY_SENSING, ATTRID_MS_OCCUPANCY_SENSING_CONFIG_OCCUPANCY, 1}};
+    pir = 1;
+    Update(0, FALSE);
+    TEST_CHECK_EQUAL(ALL_ATTRS, Reported());
+    TEST_CHECK_EQUAL(ZCLSENSOR_REPORTED_ATTRS, sentCount);
+    for (unsigned int i = 0; i < sentCount; i++) {
+        TEST_CHECK_EQUAL(1, sent[i].numAttr);
+        TEST_CHECK_EQUAL(expected[i].clusterId, sent[i].clusterId);
+        TEST_CHECK_EQUAL(expected[i].attrId, sent[i].attrId[0]);
+        TEST_CHECK_EQUAL(expected[i].value, sent[i].value[0]);
+    }
+
+    // The extremes of the DHT11 and of the SensorAdc readings, and a temperature below zero at
+    // the 0.0625 degree resolution of a DS18B20, which the ZCL keeps to the hundredth.
+    sample[ZCLSENSOR_TEMPERATURE] = 5000;
+    sample[ZCLSENSOR_HUMIDITY] = 9000;
+    sample[ZCLSENSOR_LIGHT] = 0xFFFF;
+    sample[ZCLSENSOR_GAS] = 0xFFFF;
+    pir = 0;
+    Update(2000, TRUE);
+    TEST_CHECK_EQUAL(5000, sent[0].value[0]);
+    TEST_CHECK_EQUAL(9000, sent[1].value[0]);
+    TEST_CHECK_EQUAL(0xFFFF, sent[2].value[0]);
+    TEST_CHECK_EQUAL(0xFFFF, sent[3].value[0]);
+    TEST_CHECK_EQUAL(0, sent[4].value[0]);
+    sample[ZCLSENSOR_TEMPERATURE] = (uint16)-1006;
+    Update(2000, TRUE);
+    TEST_CHECK_EQUAL(-1006, sent[0].value[0]);
+
+    sample[ZCLSENSOR_TEMPERATURE] = 2500;
+    sample[ZCLSENSOR_HUMIDITY] = 5000;
+    sample[ZCLSENSOR_LIGHT] = 1000;
+    sample[ZCLSENSOR_GAS] = 300;
+    Update(2000, TRUE);
+}
+
+static void TestDeadband(void)
+{
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+
+    // The default deadband of the temperature is 1 degree C: more than that is reported, in
+    // either direction, and changes are measured from the value last reported.
+    sample[ZCLSENSOR_TEMPERATURE] = 2600;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    sample[ZCLSENSOR_TEMPERATURE] = 2601;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_TEMPERATURE), Reported());
+    TEST_CHECK_EQUAL(2601, sent[0].value[0]);
+    sample[ZCLSENSOR_TEMPERATURE] = 2501;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    sample[ZCLSENSOR_TEMPERATURE] = 2500;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_TEMPERATURE), Reported());
+
+    // The light and gas readings, with their own deadbands.
+    sample[ZCLSENSOR_LIGHT] += 160;
+    sample[ZCLSENSOR_GAS] -= 81;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_GAS), Reported());
+    sample[ZCLSENSOR_LIGHT] += 1;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_LIGHT), Reported());
+
+    // The occupancy on every change.
+    pir = 1;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_OCCUPANCY), Reported());
+    pir = 0;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_OCCUPANCY), Reported());
+
+    // A deadband of 0 reports every change; one too large for the attribute, none. Each is
+    // saved.
+    unsigned int writes = nvWrites;
+    ZclSensor_SetDeadband(ZCLSENSOR_HUMIDITY, 0);
+    TEST_CHECK_EQUAL(writes + 1, nvWrites);
+    sample[ZCLSENSOR_HUMIDITY] = 5001;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_HUMIDITY), Reported());
+    ZclSensor_SetDeadband(ZCLSENSOR_HUMIDITY, 1000);
+    sample[ZCLSENSOR_HUMIDITY] = 9000;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    ZclSensor_SetDeadband(ZCLSENSOR_OCCUPANCY, 5);
+    pir = 1;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_OCCUPANCY), Reported());
+}
+
+static void TestIntervals(void)
+{
+    // A change is held back until the minimum interval (1 s) has passed since the last report.
+    sample[ZCLSENSOR_TEMPERATURE] = 3000;
+    Update(1000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_TEMPERATURE), Reported());
+    sample[ZCLSENSOR_TEMPERATURE] = 3500;
+    Update(500, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    Update(500, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_TEMPERATURE), Reported());
+
+    // The heartbeat: every attribute is reported at its maximum interval, unchanged or not.
+    uint32 elapsed = 0;
+    unsigned int heartbeat = 0;
+    while (elapsed < 300000 && heartbeat != ALL_ATTRS) {
+        Update(2000, FALSE);
+        elapsed += 2000;
+        heartbeat |= Reported();
+    }
+    TEST_CHECK_EQUAL(ALL_ATTRS, heartbeat);
+    TEST_CHECK(elapsed <= 300000);
+    unsigned int count[ZCLSENSOR_REPORTED_ATTRS] = {0};
+    for (unsigned int i = 0; i < 300; i++) {
+        Update(2000, FALSE);
+        for (unsigned int attr = 0; attr < ZCLSENSOR_REPORTED_ATTRS; attr++) {
+            count[attr] += (Reported() & BIT(attr)) ? 1 : 0;
+        }
+    }
+    for (unsigned int attr = 0; attr < ZCLSENSOR_REPORTED_ATTRS; attr++) {
+        TEST_CHECK_EQUAL(2, count[attr]);
+    }
+
+    // A shorter maximum interval, set from the heartbeat command; it also caps the minimum.
+    unsigned int writes = nvWrites;
+    ZclSensor_SetMaxInterval(10);
+    TEST_CHECK_EQUAL(writes + 1, nvWrites);
+    Update(10000, FALSE);
+    TEST_CHECK_EQUAL(ALL_ATTRS, Reported());
+    Update(9000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    Update(1000, FALSE);
+    TEST_CHECK_EQUAL(ALL_ATTRS, Reported());
+
+    // A maximum interval of 0 sends changes only.
+    ZclSensor_SetMaxInterval(0);
+    Update(3600000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    sample[ZCLSENSOR_GAS] += 100;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_GAS), Reported());
+
+    // A forced update reports everything.
+    Update(2000, TRUE);
+    TEST_CHECK_EQUAL(ALL_ATTRS, Reported());
+
+    // A report that cannot be sent stays due.
+    sample[ZCLSENSOR_GAS] += 100;
+    sendStatus = ZMemError;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    sendStatus = ZSuccess;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_GAS), Reported());
+    ZclSensor_SetMaxInterval(300);
+}
+
+/// <summary>
+///     Sends a Configure Reporting command to the endpoint, with the records given.
+/// </summary>
+static void Configure(uint16 clusterId, const zclCfgReportRec_t *recs, uint8 count)
+{
+    zclCfgReportCmd_t *cmd = malloc(sizeof(*cmd) + count * sizeof(cmd->attrList[0]));
+    cmd->numAttr = count;
+    memcpy(cmd->attrList, recs, count * sizeof(recs[0]));
+
+    zclIncomingMsg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.zclHdr.commandID = ZCL_CMD_CONFIG_REPORT;
+    msg.clusterId = clusterId;
+    msg.endPoint = GENERICAPP_ZCL_ENDPOINT;
+    msg.attrCmd = cmd;
+    cfgStatusCount = 0;
+    ZclSensor_ProcessMsg(&msg);
+}
+
+static zclCfgReportRec_t Record(uint16 attrId, uint8 dataType, uint16 minInterval,
+                                uint16 maxInterval, void *change)
+{
+    zclCfgReportRec_t rec = {ZCL_SEND_ATTR_REPORTS, attrId, dataType, minInterval, maxInterval,
+                             0, change};
+    return rec;
+}
+
+static void TestConfigureReporting(void)
+{
+    Update(2000, TRUE);
+
+    // A reportable change of 0.5 degrees C and a minimum interval of 5 s: all records succeed,
+    // answered by a single success status, and the configuration is saved.
+    uint16 temperatureChange = 50;
+    zclCfgReportRec_t rec = Record(ATTRID_MS_TEMPERATURE_MEASURED_VALUE, ZCL_DATATYPE_INT16, 5,
+                                   60, &temperatureChange);
+    unsigned int writes = nvWrites;
+    Configure(ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT, &rec, 1);
+    TEST_CHECK_EQUAL(writes + 1, nvWrites);
+    TEST_CHECK_EQUAL(1, cfgStatusCount);
+    TEST_CHECK_EQUAL(ZCL_STATUS_SUCCESS, cfgStatus[0].status);
+    sample[ZCLSENSOR_TEMPERATURE] = 3551;
+    Update(4000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    Update(1000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_TEMPERATURE), Reported());
+    Update(60000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_TEMPERATURE), Reported());
+
+    // Records that fail are listed in order, and change nothing.
+    uint16 change = 1;
+    zclCfgReportRec_t bad[4] = {
+        Record(ATTRID_MS_TEMPERATURE_MIN_MEASURED_VALUE, ZCL_DATATYPE_INT16, 1, 10, &change),
+        Record(ATTRID_MS_TEMPERATURE_MEASURED_VALUE, ZCL_DATATYPE_UINT16, 1, 10, &change),
+        Record(ATTRID_MS_TEMPERATURE_MEASURED_VALUE, ZCL_DATATYPE_INT16, 20, 10, &change),
+        Record(ATTRID_MS_TEMPERATURE_MEASURED_VALUE, ZCL_DATATYPE_INT16, 1, 10, &change)};
+    bad[3].direction = ZCL_EXPECT_ATTR_REPORTS;
+    writes = nvWrites;
+    Configure(ZCL_CLUSTER_ID_MS_TEMPERATURE_MEASUREMENT, bad, 4);
+    TEST_CHECK_EQUAL(writes, nvWrites);
+    TEST_CHECK_EQUAL(4, cfgStatusCount);
+    TEST_CHECK_EQUAL(ZCL_STATUS_UNREPORTABLE_ATTRIBUTE, cfgStatus[0].status);
+    TEST_CHECK_EQUAL(ATTRID_MS_TEMPERATURE_MIN_MEASURED_VALUE, cfgStatus[0].attrID);
+    TEST_CHECK_EQUAL(ZCL_STATUS_INVALID_DATA_TYPE, cfgStatus[1].status);
+    TEST_CHECK_EQUAL(ZCL_STATUS_INVALID_VALUE, cfgStatus[2].status);
+    TEST_CHECK_EQUAL(ZCL_STATUS_UNREPORTABLE_ATTRIBUTE, cfgStatus[3].status);
+    TEST_CHECK_EQUAL(ZCL_EXPECT_ATTR_REPORTS, cfgStatus[3].direction);
+    sample[ZCLSENSOR_TEMPERATURE] = 3602;
+    Update(5000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_TEMPERATURE), Reported());
+
+    // The same attribute ID in another cluster is another attribute.
+    zclCfgReportRec_t humidity = Record(ATTRID_MS_RELATIVE_HUMIDITY_MEASURED_VALUE,
+                                        ZCL_DATATYPE_INT16, 1, 10, &change);
+    Configure(ZCL_CLUSTER_ID_MS_RELATIVE_HUMIDITY, &humidity, 1);
+    TEST_CHECK_EQUAL(ZCL_STATUS_INVALID_DATA_TYPE, cfgStatus[0].status);
+
+    // The reportable change of the gas reading is a float, truncated to whole readings and
+    // clamped to the range of the reading.
+    float gasChange = 10.7f;
+    zclCfgReportRec_t gas = Record(ATTRID_IOV_BASIC_PRESENT_VALUE, ZCL_DATATYPE_SINGLE_PREC, 1,
+                                   300, &gasChange);
+    Configure(ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC, &gas, 1);
+    TEST_CHECK_EQUAL(ZCL_STATUS_SUCCESS, cfgStatus[0].status);
+    sample[ZCLSENSOR_GAS] += 9;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+    sample[ZCLSENSOR_GAS] += 1;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_GAS), Reported());
+    TEST_CHECK_EQUAL(sample[ZCLSENSOR_GAS], sent[0].value[0]);
+    gasChange = -3.0f;
+    Configure(ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC, &gas, 1);
+    sample[ZCLSENSOR_GAS] += 1;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(BIT(ZCLSENSOR_GAS), Reported());
+    gasChange = 1e9f;
+    Configure(ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC, &gas, 1);
+    sample[ZCLSENSOR_GAS] = 0xFFFF;
+    Update(2000, FALSE);
+    TEST_CHECK_EQUAL(0, Reported());
+
+    // A record without a reportable change keeps the change; a maximum interval of 0xFFFF
+    // turns the reports of the attribute off, even forced ones.
+    zclCfgReportRec_t off = Record(ATTRID_IOV_BASIC_PRESENT_VALUE, ZCL_DATATYPE_SINGLE_PREC, 1,
+                                   0xFFFF, NULL);
+    Configure(ZCL_CLUSTER_ID_GEN_ANALOG_INPUT_BASIC, &off, 1);
+    TEST_CHECK_EQUAL(ZCL_STATUS_SUCCESS, cfgStatus[0].status);
+    Update(3600000, TRUE);
+    TEST_CHECK_EQUAL(ALL_ATTRS & ~BIT(ZCLSENSOR_GAS), Reported());
+
+    // Other commands, and commands for other endpoints, are not answered.
+    unsigned int responses = cfgResponses;
+    zclIncomingMsg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.zclHdr.commandID = ZCL_CMD_READ;
+    msg.endPoint = GENERICAPP_ZCL_ENDPOINT;
+    msg.attrCmd = malloc(4);
+    ZclSensor_ProcessMsg(&msg);
+    msg.zclHdr.commandID = ZCL_CMD_CONFIG_REPORT;
+    msg.endPoint = GENERICAPP_ZCL_ENDPOINT + 1;
+    msg.attrCmd = calloc(1, sizeof(zclCfgReportCmd_t));
+    ZclSensor_ProcessMsg(&msg);
+    TEST_CHECK_EQUAL(responses, cfgResponses);
+
+    // The configuration saved in NV is restored at the start.
+    static const uint8 savedOff[2] = {0xFF, 0xFF};
+    TEST_CHECK(memcmp(&nvData[ZCLSENSOR_GAS * 6 + 2], savedOff, 2) == 0);
+    nvData[ZCLSENSOR_GAS * 6 + 2] = 60;
+    nvData[ZCLSENSOR_GAS * 6 + 3] = 0;
+    ZclSensor_Init(1, TEST_NV_ID);
+    Update(60000, FALSE);
+    TEST_CHECK(Reported() & BIT(ZCLSENSOR_GAS));
+}
+
+/// <summary>
+///     A day of samples every 2 s of a slowly drifting room with sensor noise, to show how many
+///     reports the deadbands and the heartbeat leave.
+/// </summary>
+static void TestDay(void)
+{
+    const unsigned long samples = 24 * 3600 / 2;
+    long temperature = 2200; // centi-degrees
+    long humidity = 5000;
+    srand(1);
+    Update(2000, TRUE);
+    sentTotal = 0;
+    for (unsigned long i = 0; i < samples; i++) {
+        temperature += rand() % 21 - 10;
+        humidity += rand() % 41 - 20;
+        temperature = (temperature < 1000) ? 1000 : (temperature > 3500) ? 3500 : temperature;
+        humidity = (humidity < 2000) ? 2000 : (humidity > 9000) ? 9000 : humidity;
+        // Rounded to the whole degrees and %RH of the DHT11
+        sample[ZCLSENSOR_TEMPERATURE] = (uint16)((temperature + 50) / 100 * 100);
+        sample[ZCLSENSOR_HUMIDITY] = (uint16)((humidity + 50) / 100 * 100);
+        sample[ZCLSENSOR_LIGHT] = (uint16)(1000 + rand() % 64);
+        sample[ZCLSENSOR_GAS] = (uint16)(300 + rand() % 32);
+        pir = (rand() % 500) == 0;
+        Update(2000, FALSE);
+    }
+    TEST_CHECK(sentTotal < samples * ZCLSENSOR_REPORTED_ATTRS / 10);
+    printf("%lu samples a day, %lu report frames (%.1f%% of one per attribute and sample)\n",
+           samples, sentTotal, 100.0 * sentTotal / (samples * ZCLSENSOR_REPORTED_ATTRS));
+}
+
+int main(void)
+{
+    Start();
+    TestAttributes();
+    TestDeadband();
+    TestIntervals();
+    TestDay();
+    TestConfigureReporting();
+    return TEST_RESULT();
+}
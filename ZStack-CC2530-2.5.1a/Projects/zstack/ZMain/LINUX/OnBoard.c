@@ -0,0 +1,254 @@
+/**************************************************************************************************
+  Filename:       OnBoard.c
+
+  Description:    Board of the Linux host target. See OnBoard.h.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "comdef.h"
+#include "OnBoard.h"
+#include "OSAL.h"
+
+/* Hal */
+#include "hal_assert.h"
+#include "hal_mcu.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Length of a tick of macMcuPrecisionCount(), in ns
+#define ONBOARD_TICK_NS  320000ULL
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+// Interrupt enable flag; off until the application enables it, as EA
+volatile unsigned char halIntEnable = 0;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// CLOCK_MONOTONIC at InitBoard( OB_COLD ), in ns
+static unsigned long long onboardStartNs;
+
+#if defined( ONBOARD_VIRTUAL_TIME )
+// The clock, in ns
+static unsigned long long onboardVirtualNs;
+#endif
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static unsigned long long onboardNow( void );
+
+/*********************************************************************
+ * @fn      InitBoard()
+ * @brief   Starts the tick source on a cold start
+ * @param   level: COLD,WARM,READY
+ * @return  None
+ */
+void InitBoard( uint8 level )
+{
+  if ( level == OB_COLD )
+  {
+    onboardStartNs = onboardNow();
+    srandom( (unsigned)onboardStartNs );
+  }
+}
+
+/*********************************************************************
+ * @fn      macMcuPrecisionCount
+ *
+ * @brief   Free-running count of 320 usec ticks since InitBoard(),
+ *          which osalTimeUpdate() turns into milliseconds as on the
+ *          target.
+ *
+ * @param   none
+ *
+ * @return  tick count
+ */
+uint32 macMcuPrecisionCount( void )
+{
+  return ( (uint32)((onboardNow() - onboardStartNs) / ONBOARD_TICK_NS) );
+}
+
+/*********************************************************************
+ * @fn      Hal_ProcessPoll
+ *
+ * @brief   Polls the HAL drivers; the host has none.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void Hal_ProcessPoll( void )
+{
+}
+
+/*********************************************************************
+ * @fn      halAssertHandler
+ *
+ * @brief   HAL_ASSERT() failure: the host process ends.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void halAssertHandler( void )
+{
+  abort();
+}
+
+/*********************************************************************
+ * @fn        Onboard_rand
+ *
+ * @brief    Random number generator
+ *
+ * @param   none
+ *
+ * @return  uint16 - new random number
+ *
+ *********************************************************************/
+uint16 Onboard_rand( void )
+{
+  return ( (uint16)random() );
+}
+
+/*********************************************************************
+ * @fn        Onboard_wait
+ *
+ * @brief    Delay wait
+ *
+ * @param   uint16 - time to wait, in usec
+ *
+ * @return  none
+ *
+ *********************************************************************/
+void Onboard_wait( uint16 timeout )
+{
+#if defined( ONBOARD_VIRTUAL_TIME )
+  onboardVirtualNs += timeout * 1000ULL;
+#else
+  unsigned long long end = onboardNow() + timeout * 1000ULL;
+
+  while ( onboardNow() < end )
+  {
+  }
+#endif
+}
+
+/*********************************************************************
+ * @fn      Onboard_soft_reset
+ *
+ * @brief   Effect a soft reset: the host process ends.
+ *
+ * @param   none
+ *
+ * @return  none
+ *
+ *********************************************************************/
+void Onboard_soft_reset( void )
+{
+  HAL_SYSTEM_RESET();
+}
+
+/*********************************************************************
+ * @fn        Onboard_prof_time
+ *
+ * @brief    Clock of the OSAL profiler: usec since InitBoard(), modulo
+ *           65536.
+ *
+ * @param   none
+ *
+ * @return  uint16 - time
+ *
+ *********************************************************************/
+uint16 Onboard_prof_time( void )
+{
+  return ( (uint16)((onboardNow() - onboardStartNs) / 1000) );
+}
+
+/*********************************************************************
+ * @fn      Onboard_sleep
+ *
+ * @brief   Sleep of the power manager, until the next OSAL timer. As
+ *          halSleep() of the target, the time is rounded up to 320 usec
+ *          ticks. With no timer, there is no interrupt to wake the
+ *          host, so it does not sleep.
+ *
+ * @param   uint16 - time to sleep, in ms; 0 if there is no timer
+ *
+ * @return  none
+ */
+void Onboard_sleep( uint16 timeout )
+{
+  unsigned long long ns;
+
+  if ( timeout == 0 )
+  {
+    return;
+  }
+
+  ns = ((timeout * 1000000ULL) + ONBOARD_TICK_NS - 1) / ONBOARD_TICK_NS * ONBOARD_TICK_NS;
+
+#if defined( ONBOARD_VIRTUAL_TIME )
+  onboardVirtualNs += ns;
+#else
+  {
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+    nanosleep( &ts, NULL );
+  }
+#endif
+}
+
+/*********************************************************************
+ * @fn      TimerElapsed
+ *
+ * @brief   Timer counts elapsed during a sleep. The time asleep reaches
+ *          the OSAL timers through macMcuPrecisionCount() instead.
+ *
+ * @param   none
+ *
+ * @return  0
+ */
+uint32 TimerElapsed( void )
+{
+  return ( 0 );
+}
+
+/*********************************************************************
+ * @fn      onboardNow
+ *
+ * @brief   Reads CLOCK_MONOTONIC, or the virtual clock.
+ *
+ * @param   none
+ *
+ * @return  time in ns
+ */
+static unsigned long long onboardNow( void )
+{
+#if defined( ONBOARD_VIRTUAL_TIME )
+  return ( onboardVirtualNs );
+#else
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+#endif
+}
+
+/*********************************************************************
+*********************************************************************/
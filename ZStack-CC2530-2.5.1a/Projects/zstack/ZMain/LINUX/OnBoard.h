@@ -0,0 +1,148 @@
+/**************************************************************************************************
+  Filename:       OnBoard.h
+
+  Description:    Board of the Linux host target, on which the OSAL core
+                  (Components/osal/common) is built unchanged with GCC to
+                  measure it off the 8051.
+
+  The board gives OSAL its tick source, from CLOCK_MONOTONIC, and a heap
+  of INT_HEAP_LEN bytes, the size of the target's. The host has no
+  interrupts, so a critical section only clears a flag (see hal_mcu.h of
+  Components/hal/target/LINUX). With POWER_SAVING, the power manager's
+  sleep is a nanosleep() up to the next OSAL timer.
+
+  With ONBOARD_VIRTUAL_TIME, for simulations, the clock is not
+  CLOCK_MONOTONIC but a count that only sleeps and Onboard_wait() move
+  on, and a sleep takes no time. Task handlers then take no time either.
+
+  The OSAL core builds with:
+
+    gcc -std=gnu99 -O2 -DUBIT \
+        -I Components/hal/target/LINUX -I Projects/zstack/ZMain/LINUX \
+        -I Components/hal/include -I Components/osal/include \
+        Components/osal/common/OSAL.c Components/osal/common/OSAL_Timers.c \
+        Components/osal/common/OSAL_Memory.c Components/osal/common/OSAL_Clock.c \
+        Components/osal/common/OSAL_PwrMgr.c Projects/zstack/ZMain/LINUX/OnBoard.c \
+        <tasks> ...
+
+  where <tasks> defines tasksArr[], tasksCnt, tasksEvents and
+  osalInitTasks() as an OSAL_<App>.c does. UBIT leaves out _ltoa(), which
+  has no GCC library function to wrap on Linux, and makes
+  osal_start_system() a single pass of osal_run_system().
+
+  The board keeps the target's 16-bit heap and the 2-byte block headers
+  (halDataAlign_t is uint8 on the target), so the heap behaves as it does
+  on the 8051, except that the messages and timers hold 8-byte pointers.
+**************************************************************************************************/
+
+#ifndef ONBOARD_H
+#define ONBOARD_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include "hal_mcu.h"
+#include "OSAL.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Timer clock and power-saving definitions
+#define TIMER_DECR_TIME    1  // 1ms
+
+/* OSAL timer defines */
+#define TICK_TIME   1000   // Timer per tick - in micro-sec
+#define TICK_COUNT  1
+
+/* Heap of the target */
+#if !defined INT_HEAP_LEN
+#if defined RTR_NWK
+  #define INT_HEAP_LEN  3072
+#else
+  #define INT_HEAP_LEN  2048
+#endif
+#endif
+#define MAXMEMHEAP INT_HEAP_LEN
+
+// Initialization levels
+#define OB_COLD  0
+#define OB_WARM  1
+#define OB_READY 2
+
+/*********************************************************************
+ * MACROS
+ */
+
+#define MicroWait(t) Onboard_wait(t)
+
+// Clock of the OSAL profiler (OSAL_PROFILE), in usec
+#define OSAL_PROF_TIME()    Onboard_prof_time()
+#define OSAL_PROF_TICK_NS   1000
+
+#define OSAL_SET_CPU_INTO_SLEEP(timeout) Onboard_sleep(timeout); /* Called from OSAL_PwrMgr */
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+  /*
+   * Initialize the board: the interrupt flag and the tick source.
+   *    level: 0=cold, 1=warm, 2=ready
+   */
+  extern void InitBoard( uint8 level );
+
+  /*
+   * Free-running count of 320 usec ticks, as the MAC backoff timer
+   */
+  extern uint32 macMcuPrecisionCount( void );
+
+  /*
+   * Polls the HAL drivers; there are none on the host
+   */
+  extern void Hal_ProcessPoll( void );
+
+  /*
+   * Board specific random number generator
+   */
+  extern uint16 Onboard_rand( void );
+
+  /*
+   * Board specific micro-second wait
+   */
+  extern void Onboard_wait( uint16 timeout );
+
+  /*
+   * Board specific soft reset.
+   */
+  extern void Onboard_soft_reset( void );
+
+  /*
+   * Board specific clock of the OSAL profiler
+   */
+  extern uint16 Onboard_prof_time( void );
+
+  /*
+   * Sleep until the next OSAL timer, in ms; 0 if there is none
+   */
+  extern void Onboard_sleep( uint16 timeout );
+
+  /*
+   * Get elapsed timer clock counts
+   */
+  extern uint32 TimerElapsed( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONBOARD_H
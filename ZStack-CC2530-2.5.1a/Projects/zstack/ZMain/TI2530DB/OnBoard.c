@@ -356,6 +356,38 @@ uint16 Onboard_rand( void )
   return ( MAC_RADIO_RANDOM_WORD() );
 }
 
+#if ( OSAL_PROFILE )
+/*********************************************************************
+ * @fn        Onboard_prof_time
+ *
+ * @brief    Clock of the OSAL profiler: the MAC timer, which the MAC
+ *           runs free from its init, in ticks of 4 usec. The timer
+ *           counts 32 MHz ticks over a backoff period, and its
+ *           overflow count the periods; the time wraps every 262 ms.
+ *
+ * @param   none
+ *
+ * @return  uint16 - MAC timer count, in 4 usec ticks
+ *
+ *********************************************************************/
+uint16 Onboard_prof_time( void )
+{
+  halIntState_t intState;
+  uint8 lo, hi;
+  uint16 ovf;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );
+  MAC_MCU_T2_ACCESS_OVF_COUNT_VALUE();  // Also selects the timer count
+  lo = T2M0;  // Reading T2M0 latches T2M1 and T2MOVFx
+  hi = T2M1;
+  ovf = BUILD_UINT16( T2MOVF0, T2MOVF1 );
+  HAL_EXIT_CRITICAL_SECTION( intState );
+
+  return ( (ovf * (MAC_SPEC_USECS_PER_BACKOFF / 4)) +
+           (BUILD_UINT16( lo, hi ) / (MAC_RADIO_TIMER_TICKS_PER_USEC() * 4)) );
+}
+#endif
+
 /*********************************************************************
  * @fn        Onboard_wait
  *
@@ -196,6 +196,11 @@ extern uint8 aExtendedAddress[8];
 // Wait for specified microseconds
 #define MicroWait(t) Onboard_wait(t)
 
+// Clock of the OSAL profiler (OSAL_PROFILE): the MAC timer, 4 usec ticks.
+// Times wrap at 262 ms; a longer one counts as its remainder.
+#define OSAL_PROF_TIME()    Onboard_prof_time()
+#define OSAL_PROF_TICK_NS   4000
+
 #define OSAL_SET_CPU_INTO_SLEEP(timeout) halSleep(timeout); /* Called from OSAL_PwrMgr */
 
 #ifdef __IAR_SYSTEMS_ICC__
@@ -324,6 +329,11 @@ typedef struct
    */
   extern __near_func void Onboard_soft_reset( void );
 
+  /*
+   * Board specific clock of the OSAL profiler
+   */
+  extern uint16 Onboard_prof_time( void );
+
 /*********************************************************************
 *********************************************************************/
 